@@ -0,0 +1,82 @@
+// Runs OnlineSetCover on the adversarial instances of Util, one rule
+// at a time, and prints for each how often it fell back to greedy and
+// how long rules took.
+//
+// Usage: adversarial_benchmark [scale]
+// where @scale, 1 by default, multiplies number of rules.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "log4cxx/basicconfigurator.h"
+#include "latency_histogram.h"
+#include "online_set_cover.h"
+#include "util.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::chrono::steady_clock;
+  using std::chrono::duration;
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+
+  // Adds @rules to an empty OnlineSetCover, timing AddRule and
+  // UpdateCover of each, and prints a line of stats.
+  static void RunWorkload(const string& name, const vector<vector<string> >& rules) {
+    OnlineSetCover cover;
+    LatencyHistogram latency;
+    steady_clock::time_point start = steady_clock::now();
+    for (auto const& rule : rules) {
+      steady_clock::time_point begin = steady_clock::now();
+      cover.AddRule(rule);
+      cover.UpdateCover();
+      latency.Record(duration_cast<nanoseconds>(steady_clock::now() - begin).count());
+    }
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    if (latency.count() == 0) {
+      printf("%-14s no rules\n", name.c_str());
+      return;
+    }
+    printf("%-14s %8lu %9.4f %10.1f %10.1f %10.1f %9.0f %6lu\n", name.c_str(),
+	   (unsigned long) rules.size(),
+	   double(cover.num_greedy_updates()) / cover.num_updates(),
+	   latency.mean() / 1000, latency.ValueAt(0.99) / 1000.0,
+	   latency.max() / 1000.0, rules.size() / seconds,
+	   (unsigned long) cover.GetCover().size());
+  }
+}  // namespace incremental_atpg
+
+int main(int argc, char** argv) {
+  using namespace incremental_atpg;
+  log4cxx::BasicConfigurator::configure();
+  log4cxx::Logger::getRootLogger()->setLevel(log4cxx::Level::getError());
+  uint64_t scale = argc > 1 ? std::max(1L, atol(argv[1])) : 1;
+
+  Util util;
+  vector<vector<string> > rules;
+  printf("%-14s %8s %9s %10s %10s %10s %9s %6s\n", "workload", "rules",
+	 "fallback", "mean_us", "p99_us", "max_us", "rules/s", "cover");
+  util.MakeNestedChainRules(20, 50, 2 * scale, &rules);
+  RunWorkload("nested_chain", rules);
+  util.MakeStarRules(50, 20, 4000 * scale, &rules);
+  RunWorkload("star", rules);
+  util.MakeWideRules(100, 50, 2000 * scale, &rules);
+  RunWorkload("wide", rules);
+  // Baseline to compare with.
+  rules.clear();
+  util.MakeRules(2000 * scale, 1000, 100, Util::zipf_1, &rules);
+  vector<vector<string> > non_empty;
+  for (auto const& rule : rules) {
+    if (!rule.empty()) {
+      non_empty.push_back(rule);
+    }
+  }
+  RunWorkload("zipf", non_empty);
+  return 0;
+}
@@ -0,0 +1,351 @@
+#include "binary_rule_file.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+  using std::sort;
+  using std::min;
+
+  static const char kMagic[8] = {'I', 'A', 'T', 'P', 'G', 'R', 'U', 'L'};
+  static const uint32_t kByteOrderMark = 0x01020304;
+
+  // Fixed size start of file.
+  struct BinaryRuleHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t num_rules;
+    uint64_t num_sets;
+    uint64_t rules_per_block;
+    uint64_t dictionary_offset;
+    uint64_t index_offset;
+  };
+
+  static void PutVarint(uint64_t value, string* out) {
+    while (value >= 0x80) {
+      out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+  }
+
+  static bool GetVarint(const char** pos, const char* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+      uint8_t byte = *(*pos)++;
+      result |= uint64_t(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+	*value = result;
+	return true;
+      }
+    }
+    return false;
+  }
+
+  BinaryRuleWriter::BinaryRuleWriter()
+    : num_rules_(0) {
+  }
+
+  bool BinaryRuleWriter::Open(const string& path) {
+    out_.open(path.c_str(), std::ios::binary | std::ios::trunc);
+    symbols_ = SymbolTable();
+    block_.clear();
+    block_offsets_.clear();
+    num_rules_ = 0;
+    // Zeros till Close writes the header.
+    BinaryRuleHeader header;
+    std::memset(&header, 0, sizeof(header));
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return out_.good();
+  }
+
+  void BinaryRuleWriter::AddRule(const vector<string>& sets) {
+    set_ids_.clear();
+    for (auto const& name : sets) {
+      set_ids_.push_back(symbols_.Intern(name));
+    }
+    AddRule(&set_ids_);
+  }
+
+  void BinaryRuleWriter::AddRule(const vector<Span<char> >& sets) {
+    set_ids_.clear();
+    for (auto const& name : sets) {
+      name_.assign(name.begin(), name.size());
+      set_ids_.push_back(symbols_.Intern(name_));
+    }
+    AddRule(&set_ids_);
+  }
+
+  void BinaryRuleWriter::AddRule(vector<SetId>* set_ids) {
+    if (num_rules_ % kRulesPerBlock == 0) {
+      FlushBlock();
+      block_offsets_.push_back(out_.tellp());
+    }
+    sort(set_ids->begin(), set_ids->end());
+    PutVarint(set_ids->size(), &block_);
+    SetId last = 0;
+    for (auto set_id : *set_ids) {
+      PutVarint(set_id - last, &block_);
+      last = set_id;
+    }
+    ++num_rules_;
+  }
+
+  void BinaryRuleWriter::FlushBlock() {
+    out_.write(block_.data(), block_.size());
+    block_.clear();
+  }
+
+  bool BinaryRuleWriter::Close() {
+    if (!out_.is_open()) {
+      return false;
+    }
+    FlushBlock();
+    BinaryRuleHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kBinaryRuleVersion;
+    header.byte_order = kByteOrderMark;
+    header.num_rules = num_rules_;
+    header.num_sets = symbols_.size();
+    header.rules_per_block = kRulesPerBlock;
+    header.dictionary_offset = out_.tellp();
+    string dictionary;
+    for (SetId set_id = 0; set_id < symbols_.size(); set_id++) {
+      const string& name = symbols_.Name(set_id);
+      PutVarint(name.size(), &dictionary);
+      dictionary.append(name);
+    }
+    out_.write(dictionary.data(), dictionary.size());
+    header.index_offset = out_.tellp();
+    out_.write(reinterpret_cast<const char*>(block_offsets_.data()),
+	       block_offsets_.size() * sizeof(uint64_t));
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.close();
+    return !out_.fail();
+  }
+
+  BinaryRuleReader::BinaryRuleReader()
+    : data_(nullptr),
+      size_(0),
+      num_rules_(0),
+      rules_per_block_(0),
+      dictionary_offset_(0),
+      next_(nullptr),
+      next_rule_(0) {
+  }
+
+  BinaryRuleReader::~BinaryRuleReader() {
+    Close();
+  }
+
+  void BinaryRuleReader::Close() {
+    if (data_ != nullptr) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = next_ = nullptr;
+    size_ = num_rules_ = rules_per_block_ = dictionary_offset_ = 0;
+    next_rule_ = 0;
+    block_offsets_.clear();
+    symbols_ = SymbolTable();
+  }
+
+  bool BinaryRuleReader::IsBinary(const string& path) {
+    char magic[sizeof(kMagic)];
+    std::ifstream in(path.c_str(), std::ios::binary);
+    return in.read(magic, sizeof(magic))
+      && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+  }
+
+  bool BinaryRuleReader::Open(const string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(BinaryRuleHeader)) {
+      close(fd);
+      return false;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      return false;
+    }
+    data_ = static_cast<const char*>(data);
+    size_ = st.st_size;
+
+    BinaryRuleHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+    uint64_t num_blocks = header.rules_per_block == 0 ? 0
+      : (header.num_rules + header.rules_per_block - 1) / header.rules_per_block;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+	|| header.version != kBinaryRuleVersion
+	|| header.byte_order != kByteOrderMark
+	|| header.rules_per_block == 0
+	|| header.dictionary_offset < sizeof(header)
+	|| header.dictionary_offset > header.index_offset
+	// Every rule takes at least a byte, its number of sets.
+	|| header.num_rules > header.dictionary_offset - sizeof(header)
+	|| header.index_offset > size_
+	|| (size_ - header.index_offset) / sizeof(uint64_t) != num_blocks) {
+      Close();
+      return false;
+    }
+    block_offsets_.resize(num_blocks);
+    std::memcpy(block_offsets_.data(), data_ + header.index_offset,
+		num_blocks * sizeof(uint64_t));
+    uint64_t last = sizeof(header);
+    for (auto offset : block_offsets_) {
+      if (offset < last || offset > header.dictionary_offset) {
+	Close();
+	return false;
+      }
+      last = offset;
+    }
+    const char* pos = data_ + header.dictionary_offset;
+    const char* end = data_ + header.index_offset;
+    for (uint64_t set_id = 0; set_id < header.num_sets; set_id++) {
+      uint64_t size = 0;
+      if (!GetVarint(&pos, end, &size) || size > (uint64_t) (end - pos)) {
+	Close();
+	return false;
+      }
+      symbols_.Intern(string(pos, size));
+      pos += size;
+    }
+    if (pos != end || symbols_.size() != header.num_sets) {
+      Close();
+      return false;
+    }
+    num_rules_ = header.num_rules;
+    rules_per_block_ = header.rules_per_block;
+    dictionary_offset_ = header.dictionary_offset;
+    return Seek(0);
+  }
+
+  const char* BinaryRuleReader::BlockEnd(uint64_t block) const {
+    return data_ + (block + 1 < block_offsets_.size() ? block_offsets_[block + 1]
+		    : dictionary_offset_);
+  }
+
+  bool BinaryRuleReader::DecodeRule(const char** pos, const char* end,
+				    vector<SetId>* set_ids) const {
+    uint64_t num_sets = 0;
+    // Every set takes a byte at least.
+    if (!GetVarint(pos, end, &num_sets) || num_sets > (uint64_t) (end - *pos)) {
+      return false;
+    }
+    uint64_t set_id = 0;
+    for (uint64_t i = 0; i < num_sets; i++) {
+      uint64_t delta = 0;
+      if (!GetVarint(pos, end, &delta)) {
+	return false;
+      }
+      set_id += delta;
+      if (set_id >= symbols_.size()) {
+	return false;
+      }
+      set_ids->push_back(set_id);
+    }
+    return true;
+  }
+
+  bool BinaryRuleReader::Seek(uint64_t rule_id) {
+    if (rule_id > num_rules_) {
+      return false;
+    }
+    uint64_t block = rule_id / rules_per_block_;
+    next_rule_ = block * rules_per_block_;
+    if (block == block_offsets_.size()) {
+      next_ = data_ + dictionary_offset_;
+      return true;
+    }
+    next_ = data_ + block_offsets_[block];
+    vector<SetId> skipped;
+    while (next_rule_ < rule_id) {
+      skipped.clear();
+      if (!NextRule(&skipped)) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+  bool BinaryRuleReader::NextRule(vector<SetId>* set_ids) {
+    set_ids->clear();
+    if (next_rule_ >= num_rules_) {
+      return false;
+    }
+    uint64_t block = next_rule_ / rules_per_block_;
+    if (next_rule_ % rules_per_block_ == 0) {
+      next_ = data_ + block_offsets_[block];
+    }
+    if (!DecodeRule(&next_, BlockEnd(block), set_ids)) {
+      return false;
+    }
+    ++next_rule_;
+    return true;
+  }
+
+  bool BinaryRuleReader::ReadBlock(uint64_t block, vector<uint64_t>* offsets,
+				   vector<SetId>* set_ids) const {
+    if (block >= block_offsets_.size()) {
+      return false;
+    }
+    const char* pos = data_ + block_offsets_[block];
+    const char* end = BlockEnd(block);
+    uint64_t num_rules = min(rules_per_block_, num_rules_ - block * rules_per_block_);
+    for (uint64_t rule = 0; rule < num_rules; rule++) {
+      offsets->push_back(set_ids->size());
+      if (!DecodeRule(&pos, end, set_ids)) {
+	return false;
+      }
+    }
+    offsets->push_back(set_ids->size());
+    return pos == end;
+  }
+
+  bool BinaryRuleReader::ReadAll(ThreadPool* pool, vector<uint64_t>* offsets,
+				 vector<SetId>* set_ids) const {
+    uint64_t num_blocks = block_offsets_.size();
+    vector<vector<uint64_t> > block_starts(num_blocks);
+    vector<vector<SetId> > block_ids(num_blocks);
+    vector<char> good(num_blocks, false);
+    pool->Run(num_blocks, [&](uint64_t block) {
+	good[block] = ReadBlock(block, &block_starts[block], &block_ids[block]);
+      });
+    if (std::find(good.begin(), good.end(), false) != good.end()) {
+      return false;
+    }
+    vector<uint64_t> first_ids(num_blocks + 1, 0);
+    for (uint64_t block = 0; block < num_blocks; block++) {
+      first_ids[block + 1] = first_ids[block] + block_ids[block].size();
+    }
+    offsets->assign(num_rules_ + 1, first_ids.back());
+    set_ids->resize(first_ids.back());
+    pool->Run(num_blocks, [&](uint64_t block) {
+	// Last start is the next block's first.
+	for (uint64_t rule = 0; rule + 1 < block_starts[block].size(); rule++) {
+	  (*offsets)[block * rules_per_block_ + rule] =
+	    first_ids[block] + block_starts[block][rule];
+	}
+	std::copy(block_ids[block].begin(), block_ids[block].end(),
+		  set_ids->begin() + first_ids[block]);
+      });
+    return true;
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,128 @@
+#ifndef INCREMENTAL_ATPG_BINARY_RULE_FILE_H_
+#define INCREMENTAL_ATPG_BINARY_RULE_FILE_H_
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "span.h"
+#include "symbol_table.h"
+#include "thread_pool.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+
+  // Bumped whenever the layout changes.
+  const uint32_t kBinaryRuleVersion = 1;
+  // Rules in a block, but the last.
+  const uint64_t kRulesPerBlock = 4096;
+
+  // Binary rule file: a header with magic, version, byte order mark,
+  // number of rules and sets, rules per block, and where the
+  // dictionary and block index start. Then blocks of rules, each
+  // rule the number of its sets as a varint, then its set ids,
+  // sorted, as varint differences to the one before. Then the
+  // dictionary, names of set ids 0, 1, ..., each its length as a
+  // varint and its bytes. Then the block index, where each block
+  // starts.
+  //
+  // Set ids are in order names were first seen, so they're small
+  // where rules start, and sorted ids close to each other take a
+  // byte or two. Sets of a rule come back sorted by id, not in the
+  // order they were added. Blocks can be decoded on their own, so
+  // readers can start at any block, or decode all in parallel.
+  class BinaryRuleWriter {
+  public:
+    BinaryRuleWriter();
+
+    // Starts writing to @path. Returns false if it can't.
+    bool Open(const string& path);
+    void AddRule(const vector<string>& sets);
+    void AddRule(const vector<Span<char> >& sets);
+    // Writes dictionary, index and header. Returns false if anything
+    // failed since Open. A file that wasn't closed has no header, so
+    // readers don't take it.
+    bool Close();
+    uint64_t num_rules() const {
+      return num_rules_;
+    }
+
+  protected:
+    // Adds rule with @set_ids, which it sorts.
+    void AddRule(vector<SetId>* set_ids);
+    void FlushBlock();
+
+    ofstream out_;
+    SymbolTable symbols_;
+    // Rules of block being written.
+    string block_;
+    vector<uint64_t> block_offsets_;
+    uint64_t num_rules_;
+    vector<SetId> set_ids_;
+    string name_;
+  private:
+    friend class BinaryRuleFileTest;
+  };
+
+  class BinaryRuleReader {
+  public:
+    BinaryRuleReader();
+    // Unmaps file.
+    ~BinaryRuleReader();
+
+    // Maps @path in and reads its dictionary. Returns false if it
+    // can't, or it isn't a binary rule file of this version.
+    bool Open(const string& path);
+    void Close();
+    // Whether @path starts like a binary rule file.
+    static bool IsBinary(const string& path);
+
+    uint64_t num_rules() const {
+      return num_rules_;
+    }
+    uint64_t num_blocks() const {
+      return block_offsets_.size();
+    }
+    // Names of set ids in the file.
+    const SymbolTable& symbols() const {
+      return symbols_;
+    }
+    // Set ids of next rule. Returns false after the last rule, or if
+    // the file is bad.
+    bool NextRule(vector<SetId>* set_ids);
+    // Next rule is @rule_id, decoding only from the start of its block.
+    bool Seek(uint64_t rule_id);
+    // Appends rules of @block to @set_ids, with @offsets[i] where the
+    // i-th starts, and one more where the last ends. Safe to call from
+    // many threads. Returns false if the block is bad.
+    bool ReadBlock(uint64_t block, vector<uint64_t>* offsets,
+		   vector<SetId>* set_ids) const;
+    // Reads all blocks on @pool. Sets of rule i are
+    // @set_ids[@offsets[i], @offsets[i + 1]).
+    bool ReadAll(ThreadPool* pool, vector<uint64_t>* offsets,
+		 vector<SetId>* set_ids) const;
+
+  protected:
+    // Decodes rule at @*pos, before @end, moving @*pos past it.
+    bool DecodeRule(const char** pos, const char* end,
+		    vector<SetId>* set_ids) const;
+    const char* BlockEnd(uint64_t block) const;
+
+    const char* data_;
+    uint64_t size_;
+    uint64_t num_rules_;
+    uint64_t rules_per_block_;
+    uint64_t dictionary_offset_;
+    vector<uint64_t> block_offsets_;
+    SymbolTable symbols_;
+    // Where NextRule is, and rule id there.
+    const char* next_;
+    uint64_t next_rule_;
+  private:
+    friend class BinaryRuleFileTest;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_BINARY_RULE_FILE_H_
@@ -0,0 +1,150 @@
+#include "binary_rule_file.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <unistd.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+  using std::sort;
+
+class BinaryRuleFileTest : public testing::Test {
+ protected:
+  BinaryRuleFileTest()
+    : path_("binary_rule_file_test.bin") { }
+  virtual void TearDown() {
+    std::remove(path_.c_str());
+  }
+  // Rules with sets @rule % 13 apart, some empty.
+  vector<vector<string> > MakeRules(uint64_t num_rules) {
+    vector<vector<string> > rules(num_rules);
+    for (uint64_t rule = 0; rule < num_rules; rule++) {
+      for (uint64_t set = 0; set < rule % 7; set++) {
+	rules[rule].push_back("s" + std::to_string((rule + set * (rule % 13)) % 5000));
+      }
+    }
+    return rules;
+  }
+  // Names of @set_ids.
+  vector<string> Names(const BinaryRuleReader& reader,
+		       vector<SetId>::const_iterator begin,
+		       vector<SetId>::const_iterator end) {
+    vector<string> names;
+    for (; begin != end; ++begin) {
+      names.push_back(reader.symbols().Name(*begin));
+    }
+    return names;
+  }
+  string path_;
+};
+
+TEST_F(BinaryRuleFileTest, WriteRead) {
+  // More than two blocks.
+  const uint64_t num_rules = 2 * kRulesPerBlock + 100;
+  vector<vector<string> > rules = MakeRules(num_rules);
+  BinaryRuleWriter writer;
+  ASSERT_TRUE(writer.Open(path_));
+  for (auto const& rule : rules) {
+    writer.AddRule(rule);
+  }
+  ASSERT_TRUE(writer.Close());
+
+  BinaryRuleReader reader;
+  ASSERT_TRUE(reader.Open(path_));
+  EXPECT_TRUE(BinaryRuleReader::IsBinary(path_));
+  EXPECT_EQ(num_rules, reader.num_rules());
+  EXPECT_EQ(3, reader.num_blocks());
+  // Ids are in order names were first seen.
+  EXPECT_EQ(rules[1][0], reader.symbols().Name(0));
+  vector<SetId> set_ids;
+  for (uint64_t rule = 0; rule < num_rules; rule++) {
+    ASSERT_TRUE(reader.NextRule(&set_ids));
+    EXPECT_TRUE(std::is_sorted(set_ids.begin(), set_ids.end()));
+    vector<string> expected = rules[rule];
+    vector<string> names = Names(reader, set_ids.begin(), set_ids.end());
+    sort(expected.begin(), expected.end());
+    sort(names.begin(), names.end());
+    ASSERT_EQ(expected, names);
+  }
+  EXPECT_FALSE(reader.NextRule(&set_ids));
+
+  // Partial read from the middle of the second block.
+  ASSERT_TRUE(reader.Seek(kRulesPerBlock + 5));
+  vector<SetId> after_seek;
+  ASSERT_TRUE(reader.NextRule(&after_seek));
+  vector<uint64_t> offsets;
+  vector<SetId> block_ids;
+  ASSERT_TRUE(reader.ReadBlock(1, &offsets, &block_ids));
+  EXPECT_EQ(kRulesPerBlock + 1, offsets.size());
+  EXPECT_EQ(after_seek, vector<SetId>(block_ids.begin() + offsets[5],
+				      block_ids.begin() + offsets[6]));
+  EXPECT_FALSE(reader.Seek(num_rules + 1));
+
+  for (unsigned num_threads : {1, 4}) {
+    ThreadPool pool(num_threads);
+    vector<SetId> all_ids;
+    ASSERT_TRUE(reader.ReadAll(&pool, &offsets, &all_ids));
+    ASSERT_EQ(num_rules + 1, offsets.size());
+    ASSERT_TRUE(reader.Seek(0));
+    for (uint64_t rule = 0; rule < num_rules; rule++) {
+      ASSERT_TRUE(reader.NextRule(&set_ids));
+      ASSERT_EQ(set_ids, vector<SetId>(all_ids.begin() + offsets[rule],
+				       all_ids.begin() + offsets[rule + 1]));
+    }
+  }
+}
+
+TEST_F(BinaryRuleFileTest, BadFiles) {
+  BinaryRuleReader reader;
+  EXPECT_FALSE(reader.Open(path_));
+  EXPECT_FALSE(BinaryRuleReader::IsBinary(path_));
+  {
+    ofstream out(path_.c_str());
+    out << "1 2 3\n4 5 6\n7 8 9\n10 11 12\n13 14 15\n16 17 18\n";
+  }
+  EXPECT_FALSE(BinaryRuleReader::IsBinary(path_));
+  EXPECT_FALSE(reader.Open(path_));
+
+  // Writer that wasn't closed has no header.
+  {
+    BinaryRuleWriter writer;
+    ASSERT_TRUE(writer.Open(path_));
+    writer.AddRule(vector<string>({"a", "b"}));
+  }
+  EXPECT_FALSE(reader.Open(path_));
+
+  // Cut off index.
+  BinaryRuleWriter writer;
+  ASSERT_TRUE(writer.Open(path_));
+  writer.AddRule(vector<string>({"a", "b"}));
+  ASSERT_TRUE(writer.Close());
+  ASSERT_TRUE(reader.Open(path_));
+
+  // More rules in header than fit before the dictionary, in the same
+  // number of blocks.
+  {
+    std::fstream file(path_.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+    uint64_t num_rules = kRulesPerBlock;
+    file.seekp(16);
+    file.write(reinterpret_cast<const char*>(&num_rules), sizeof(num_rules));
+  }
+  EXPECT_FALSE(reader.Open(path_));
+  {
+    std::fstream file(path_.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+    uint64_t num_rules = 1;
+    file.seekp(16);
+    file.write(reinterpret_cast<const char*>(&num_rules), sizeof(num_rules));
+  }
+  ASSERT_TRUE(reader.Open(path_));
+  std::ifstream in(path_.c_str(), std::ios::binary | std::ios::ate);
+  ASSERT_EQ(0, truncate(path_.c_str(), (uint64_t) in.tellg() - 1));
+  EXPECT_FALSE(reader.Open(path_));
+}
+}  // namespace incremental_atpg
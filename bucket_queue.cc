@@ -0,0 +1,94 @@
+#include "bucket_queue.h"
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::pair;
+  using std::make_pair;
+  using std::sort;
+
+  BucketQueue::BucketQueue()
+    : size_(0),
+      top_(0),
+      top_sorted_(false) {
+  }
+
+  void BucketQueue::Reset(uint64_t num_sets) {
+    buckets_.clear();
+    values_.assign(num_sets, 0);
+    in_queue_.assign(num_sets, false);
+    size_ = 0;
+    top_ = 0;
+    top_sorted_ = false;
+  }
+
+  void BucketQueue::Push(SetId set_id, uint64_t value) {
+    if (set_id >= values_.size()) {
+      values_.resize(set_id + 1, 0);
+      in_queue_.resize(set_id + 1, false);
+    }
+    if (value >= buckets_.size()) {
+      buckets_.resize(value + 1);
+    }
+    buckets_[value].push_back(set_id);
+    values_[set_id] = value;
+    in_queue_[set_id] = true;
+    ++size_;
+    if (value > top_ || size_ == 1) {
+      top_ = value;
+      top_sorted_ = false;
+    } else if (value == top_) {
+      top_sorted_ = false;
+    }
+  }
+
+  bool BucketQueue::Decrease(SetId set_id, uint64_t new_value) {
+    if (!Contains(set_id) || new_value > values_[set_id]) {
+      return false;
+    }
+    if (new_value == values_[set_id]) {
+      return true;
+    }
+    // Old entry goes stale. Can't land in @top_, it only has sets
+    // with larger values.
+    buckets_[new_value].push_back(set_id);
+    values_[set_id] = new_value;
+    return true;
+  }
+
+  void BucketQueue::FindTop() {
+    while (true) {
+      vector<SetId>& bucket = buckets_[top_];
+      if (!top_sorted_) {
+	sort(bucket.begin(), bucket.end());
+	top_sorted_ = true;
+      }
+      while (!bucket.empty() && !Live(bucket.back(), top_)) {
+	bucket.pop_back();
+      }
+      if (!bucket.empty() || top_ == 0) {
+	return;
+      }
+      vector<SetId>().swap(bucket);
+      --top_;
+      top_sorted_ = false;
+    }
+  }
+
+  pair<SetId, uint64_t> BucketQueue::Top() {
+    FindTop();
+    return make_pair(buckets_[top_].back(), top_);
+  }
+
+  void BucketQueue::Pop() {
+    FindTop();
+    SetId set_id = buckets_[top_].back();
+    buckets_[top_].pop_back();
+    in_queue_[set_id] = false;
+    --size_;
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,76 @@
+#ifndef INCREMENTAL_ATPG_BUCKET_QUEUE_H_
+#define INCREMENTAL_ATPG_BUCKET_QUEUE_H_
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "symbol_table.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::pair;
+
+  // Max priority queue of sets keyed by small non-negative integers,
+  // e.g., number of uncovered rules in a set. Keys can only decrease.
+  //
+  // Bucket v holds sets whose key is v. Decrease just appends the set
+  // to its new bucket, the entry left in the old bucket is stale and
+  // skipped later. Since keys never increase, nothing new can land in
+  // the highest non-empty bucket, so it's sorted by set id once when
+  // it gets to the top and then popped from the back. Ties are
+  // broken in favor of the larger set id, like heap_data.
+  class BucketQueue {
+  public:
+    BucketQueue();
+
+    // Empties queue, makes room for sets with id < @num_sets.
+    void Reset(uint64_t num_sets);
+    // Adds @set_id with @value. @set_id shouldn't be in queue.
+    void Push(SetId set_id, uint64_t value);
+    // Set with largest value (and largest id among those). Queue
+    // shouldn't be empty.
+    pair<SetId, uint64_t> Top();
+    void Pop();
+    // Lowers value of @set_id to @new_value. Returns false if @set_id
+    // isn't in queue or @new_value is larger than its current value.
+    bool Decrease(SetId set_id, uint64_t new_value);
+
+    bool Contains(SetId set_id) const {
+      return set_id < in_queue_.size() && in_queue_[set_id];
+    }
+    // Current value of @set_id, which should be in queue.
+    uint64_t Value(SetId set_id) const {
+      return values_[set_id];
+    }
+    bool empty() const {
+      return size_ == 0;
+    }
+    uint64_t size() const {
+      return size_;
+    }
+
+  protected:
+    // Moves @top_ down to the highest bucket with a live entry,
+    // sorting it if it wasn't sorted yet. Queue shouldn't be empty.
+    void FindTop();
+    bool Live(SetId set_id, uint64_t bucket) const {
+      return in_queue_[set_id] && values_[set_id] == bucket;
+    }
+
+    // Indexed by value.
+    vector<vector<SetId> > buckets_;
+    // Indexed by set id.
+    vector<uint64_t> values_;
+    vector<bool> in_queue_;
+    uint64_t size_;
+    // No live entry above this bucket.
+    uint64_t top_;
+    // Whether @buckets_[@top_] is sorted by set id.
+    bool top_sorted_;
+  private:
+    friend class BucketQueueTest;
+    FRIEND_TEST(BucketQueueTest, StaleEntries);
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_BUCKET_QUEUE_H_
@@ -0,0 +1,71 @@
+#include "bucket_queue.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdint.h>
+#include <utility>
+
+namespace incremental_atpg {
+  using std::make_pair;
+
+class BucketQueueTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    queue_.reset(new BucketQueue);
+    queue_->Reset(4);
+  }
+  std::unique_ptr<BucketQueue> queue_;
+};
+
+TEST_F(BucketQueueTest, PushPop) {
+  queue_->Push(0, 2);
+  queue_->Push(1, 5);
+  queue_->Push(2, 2);
+  queue_->Push(3, 0);
+  EXPECT_EQ(4, queue_->size());
+  EXPECT_EQ(make_pair((SetId) 1, (uint64_t) 5), queue_->Top());
+  queue_->Pop();
+  // Larger id first on ties.
+  EXPECT_EQ(make_pair((SetId) 2, (uint64_t) 2), queue_->Top());
+  queue_->Pop();
+  EXPECT_EQ(make_pair((SetId) 0, (uint64_t) 2), queue_->Top());
+  queue_->Pop();
+  EXPECT_EQ(make_pair((SetId) 3, (uint64_t) 0), queue_->Top());
+  queue_->Pop();
+  EXPECT_TRUE(queue_->empty());
+  EXPECT_FALSE(queue_->Contains(3));
+}
+
+TEST_F(BucketQueueTest, Decrease) {
+  queue_->Push(0, 3);
+  queue_->Push(1, 3);
+  queue_->Push(2, 1);
+  EXPECT_TRUE(queue_->Decrease(1, 1));
+  EXPECT_FALSE(queue_->Decrease(1, 2));
+  EXPECT_FALSE(queue_->Decrease(3, 0));
+  EXPECT_TRUE(queue_->Decrease(0, 3));
+  EXPECT_EQ(1, queue_->Value(1));
+  EXPECT_EQ(make_pair((SetId) 0, (uint64_t) 3), queue_->Top());
+  queue_->Pop();
+  EXPECT_EQ(make_pair((SetId) 2, (uint64_t) 1), queue_->Top());
+  queue_->Pop();
+  EXPECT_EQ(make_pair((SetId) 1, (uint64_t) 1), queue_->Top());
+  queue_->Pop();
+  EXPECT_TRUE(queue_->empty());
+}
+
+TEST_F(BucketQueueTest, StaleEntries) {
+  queue_->Push(0, 4);
+  queue_->Push(1, 4);
+  EXPECT_EQ(make_pair((SetId) 1, (uint64_t) 4), queue_->Top());
+  queue_->Decrease(1, 2);
+  queue_->Decrease(1, 0);
+  // Set 1 left entries behind in buckets 4 and 2.
+  EXPECT_EQ(2, queue_->buckets_[4].size());
+  EXPECT_EQ(make_pair((SetId) 0, (uint64_t) 4), queue_->Top());
+  EXPECT_EQ(1, queue_->buckets_[4].size());
+  queue_->Pop();
+  EXPECT_EQ(make_pair((SetId) 1, (uint64_t) 0), queue_->Top());
+  EXPECT_EQ(1, queue_->size());
+}
+}  // namespace incremental_atpg
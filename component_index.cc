@@ -0,0 +1,99 @@
+#include "component_index.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::swap;
+  using std::max;
+
+  ComponentIndex::ComponentIndex()
+    : num_components_(0) {
+  }
+
+  void ComponentIndex::AddSet(SetId set_id) {
+    for (SetId new_id = parent_.size(); new_id <= set_id; new_id++) {
+      parent_.push_back(new_id);
+      sets_.push_back(vector<SetId>(1, new_id));
+      rules_.push_back(vector<uint64_t>());
+      ++num_components_;
+    }
+  }
+
+  void ComponentIndex::AddRule(uint64_t rule_id, const vector<SetId>& sets) {
+    if (sets.empty()) {
+      return;
+    }
+    SetId root = kNoSet;
+    for (auto set_id : sets) {
+      if (set_id >= parent_.size()) {
+	AddSet(set_id);
+      }
+      SetId other = Find(set_id);
+      root = (root == kNoSet) ? other : Union(root, other);
+    }
+    rules_[root].push_back(rule_id);
+  }
+
+  void ComponentIndex::Connect(SetId a, SetId b) {
+    AddSet(max(a, b));
+    Union(Find(a), Find(b));
+  }
+
+  SetId ComponentIndex::Find(SetId set_id) const {
+    if (set_id >= parent_.size()) {
+      return set_id;
+    }
+    // No path compression so Find stays const and safe to call from
+    // many threads. Union by size keeps paths O(log n) long.
+    while (parent_[set_id] != set_id) {
+      set_id = parent_[set_id];
+    }
+    return set_id;
+  }
+
+  SetId ComponentIndex::Union(SetId a, SetId b) {
+    if (a == b) {
+      return a;
+    }
+    if (sets_[a].size() + rules_[a].size() < sets_[b].size() + rules_[b].size()) {
+      swap(a, b);
+    }
+    parent_[b] = a;
+    sets_[a].insert(sets_[a].end(), sets_[b].begin(), sets_[b].end());
+    rules_[a].insert(rules_[a].end(), rules_[b].begin(), rules_[b].end());
+    vector<SetId>().swap(sets_[b]);
+    vector<uint64_t>().swap(rules_[b]);
+    --num_components_;
+    return a;
+  }
+
+  const vector<SetId>& ComponentIndex::SetsIn(SetId root) const {
+    static const vector<SetId> kEmpty;
+    if (root >= parent_.size() || parent_[root] != root) {
+      return kEmpty;
+    }
+    return sets_[root];
+  }
+
+  const vector<uint64_t>& ComponentIndex::RulesIn(SetId root) const {
+    static const vector<uint64_t> kEmpty;
+    if (root >= parent_.size() || parent_[root] != root) {
+      return kEmpty;
+    }
+    return rules_[root];
+  }
+
+  vector<SetId> ComponentIndex::Roots() const {
+    vector<SetId> roots;
+    roots.reserve(num_components_);
+    for (SetId set_id = 0; set_id < parent_.size(); set_id++) {
+      if (parent_[set_id] == set_id) {
+	roots.push_back(set_id);
+      }
+    }
+    return roots;
+  }
+}  // namespace incremental_atpg
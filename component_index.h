@@ -0,0 +1,61 @@
+#ifndef INCREMENTAL_ATPG_COMPONENT_INDEX_H_
+#define INCREMENTAL_ATPG_COMPONENT_INDEX_H_
+#include <vector>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "symbol_table.h"
+
+namespace incremental_atpg {
+  using std::vector;
+
+  // Connected components of the graph with an edge between a rule and
+  // every set it's in. Two sets are in the same component if some
+  // chain of rules links them, so a set cover of the whole graph is
+  // just set covers of the components put together.
+  //
+  // Union-find over sets, by size, each component named by its root
+  // set. Roots also keep lists of the sets and rules in their
+  // component, the smaller list is appended to the larger one on a
+  // union.
+  class ComponentIndex {
+  public:
+    ComponentIndex();
+
+    // Adds rule @rule_id, which is in @sets, merging their components.
+    void AddRule(uint64_t rule_id, const vector<SetId>& sets);
+    // Merges components of @a and @b, e.g., when a rule in @a is put
+    // in @b too.
+    void Connect(SetId a, SetId b);
+    // Root of the component @set_id is in. Sets never seen are their
+    // own root.
+    SetId Find(SetId set_id) const;
+    // Sets and rules in component with root @root, in no particular
+    // order. Empty if @root isn't a root.
+    const vector<SetId>& SetsIn(SetId root) const;
+    const vector<uint64_t>& RulesIn(SetId root) const;
+    // All roots, in increasing order.
+    vector<SetId> Roots() const;
+    uint64_t num_components() const {
+      return num_components_;
+    }
+
+  protected:
+    // Makes room for sets with id <= @set_id, new sets are components
+    // by themselves.
+    void AddSet(SetId set_id);
+    // Merges components with roots @a and @b, returns the new root.
+    SetId Union(SetId a, SetId b);
+
+    // Indexed by set id.
+    vector<SetId> parent_;
+    // Indexed by set id, empty unless it's a root.
+    vector<vector<SetId> > sets_;
+    vector<vector<uint64_t> > rules_;
+    uint64_t num_components_;
+  private:
+    friend class ComponentIndexTest;
+    FRIEND_TEST(ComponentIndexTest, Union);
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_COMPONENT_INDEX_H_
@@ -0,0 +1,72 @@
+#include "component_index.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::sort;
+
+class ComponentIndexTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    index_.reset(new ComponentIndex);
+  }
+  vector<SetId> Sets(SetId set_id) {
+    vector<SetId> sets = index_->SetsIn(index_->Find(set_id));
+    sort(sets.begin(), sets.end());
+    return sets;
+  }
+  vector<uint64_t> Rules(SetId set_id) {
+    vector<uint64_t> rules = index_->RulesIn(index_->Find(set_id));
+    sort(rules.begin(), rules.end());
+    return rules;
+  }
+  std::unique_ptr<ComponentIndex> index_;
+};
+
+TEST_F(ComponentIndexTest, AddRule) {
+  index_->AddRule(0, {0, 1});
+  index_->AddRule(1, {3});
+  index_->AddRule(2, {4, 5});
+  // Set 2 was never in a rule, but ids up to 5 were seen.
+  EXPECT_EQ(4, index_->num_components());
+  EXPECT_EQ(index_->Find(0), index_->Find(1));
+  EXPECT_NE(index_->Find(0), index_->Find(3));
+  EXPECT_EQ(vector<SetId>({0, 1}), Sets(1));
+  EXPECT_EQ(vector<uint64_t>({0}), Rules(1));
+  EXPECT_EQ(vector<uint64_t>(), Rules(2));
+
+  // Links {0, 1}, {3} and {4, 5}.
+  index_->AddRule(3, {1, 3, 5});
+  EXPECT_EQ(2, index_->num_components());
+  EXPECT_EQ(index_->Find(0), index_->Find(4));
+  EXPECT_EQ(vector<SetId>({0, 1, 3, 4, 5}), Sets(3));
+  EXPECT_EQ(vector<uint64_t>({0, 1, 2, 3}), Rules(0));
+  EXPECT_EQ(vector<SetId>({index_->Find(0), 2}), index_->Roots());
+
+  // Not a root.
+  SetId root = index_->Find(0);
+  SetId other = (root == 0) ? 1 : 0;
+  EXPECT_TRUE(index_->SetsIn(other).empty());
+  EXPECT_TRUE(index_->RulesIn(other).empty());
+  EXPECT_EQ(7, index_->Find(7));
+}
+
+TEST_F(ComponentIndexTest, Union) {
+  index_->AddRule(0, {0});
+  index_->AddRule(1, {0});
+  index_->AddRule(2, {1});
+  // Smaller component goes under the larger one.
+  EXPECT_EQ(0, index_->Union(1, 0));
+  EXPECT_EQ(0, index_->parent_[1]);
+  EXPECT_TRUE(index_->sets_[1].empty());
+  EXPECT_TRUE(index_->rules_[1].empty());
+  EXPECT_EQ(0, index_->Union(0, 0));
+  EXPECT_EQ(1, index_->num_components());
+}
+
+}  // namespace incremental_atpg
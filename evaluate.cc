@@ -30,25 +30,22 @@ namespace incremental_atpg {
   using std::ofstream;
 
   void Evaluate::Compare(uint64_t from_num_rules, uint64_t for_time) {
-    uint64_t num_rules_seen = 0;
-    uint64_t num_rules_added = 0;
-    uint64_t total_rules = sets_.size();
-    gr_.reset(new GreedySetCover);
-    if (from_num_rules > total_rules) {
-      LOG4CXX_ERROR(evaluate_logger, "Can't start from " << from_num_rules
-		    << ", sets_ has only " << total_rules);
+    // Files start over every time, other sources go on.
+    if (!input_file_.empty()) {
+      source_.reset(OpenRuleSource(input_file_));
+    }
+    if (source_.get() == nullptr) {
+      LOG4CXX_ERROR(evaluate_logger, "Can't read rules from " << input_file_);
       return;
     }
-    LOG4CXX_WARN(evaluate_logger, "sets_ has " << total_rules << " rules.");
+    gr_.reset(new GreedySetCover);
     clock_t begin = clock();
     clock_t last = begin;
-    while (num_rules_added < from_num_rules && num_rules_seen < total_rules) {
-      const vector<string>& rule = sets_[num_rules_seen];
-      num_rules_seen++;
-      if (rule.size() > 0) {
-	gr_->AddRule(rule);
-	num_rules_added++;
-      }
+    uint64_t num_rules_added = gr_->IngestRules(source_.get(), from_num_rules);
+    if (num_rules_added < from_num_rules) {
+      LOG4CXX_ERROR(evaluate_logger, "Can't start from " << from_num_rules
+		    << ", there are only " << num_rules_added << " rules.");
+      return;
     }
     uint64_t time_taken = 0;
     clock_t now = clock();
@@ -67,8 +64,8 @@ namespace incremental_atpg {
     
     begin = now;
     on_.reset(new OnlineSetCover(
-				gr_->ReleaseSetInfos(),
-				gr_->ReleaseRuleInfos(),
+				gr_->ReleaseSetNames(),
+				gr_->ReleaseIncidence(),
 				gr_->ReleaseSetProcessingInfos(),
 				gr_->ReleaseRuleProcessingInfos(),
 				gr_->ReleaseCover()));
@@ -82,9 +79,8 @@ namespace incremental_atpg {
     now = clock();
     time_taken = double(now-begin)/CLOCKS_PER_SEC;
     gr_.reset(nullptr);
-    while(num_rules_seen < total_rules && time_taken < for_time) {
-      const vector<string>& rule = sets_[num_rules_seen];
-      num_rules_seen++;
+    vector<string> rule;
+    while(time_taken < for_time && source_->NextRule(&rule)) {
       if (rule.size() > 0) {
 	on_->AddRule(rule);
 	num_rules_added++;
@@ -17,6 +17,7 @@
 #include "greedy_set_cover.h"
 #include "online_set_cover.h"
 #include "util.h"
+#include "rule_source.h"
 
 namespace incremental_atpg {
   using std::vector;
@@ -39,7 +40,8 @@ namespace incremental_atpg {
       evaluate_logger->setLevel(log4cxx::Level::getInfo());
     }
 
-    // Takes ownership of @set_infos..
+    // Compare reads rules from @input_file, text or binary, as it
+    // goes, see OpenRuleSource.
   Evaluate(const string& input_file, const string& output_file) 
     : gr_(nullptr),
       on_(nullptr),
@@ -47,9 +49,21 @@ namespace incremental_atpg {
       output_file_(output_file) {
       evaluate_logger = Logger::getLogger("Evaluate");
       evaluate_logger->setLevel(log4cxx::Level::getWarn());
-      util.ReadRulesFromFile(input_file, &sets_);
     }
 
+    // Takes ownership of @source, e.g., a generator, which Compare
+    // reads rules from instead, going on where the last one stopped.
+  Evaluate(RuleSource* source, const string& output_file)
+    : gr_(nullptr),
+      on_(nullptr),
+      output_file_(output_file),
+      source_(source) {
+      evaluate_logger = Logger::getLogger("Evaluate");
+      evaluate_logger->setLevel(log4cxx::Level::getWarn());
+    }
+
+    // Greedy cover of first @at_num_rules non-empty rules, then
+    // OnlineSetCover adds rules after them for @for_time seconds.
     void Compare(uint64_t at_num_rules, uint64_t for_time);
 
   protected:
@@ -58,7 +72,7 @@ namespace incremental_atpg {
     Util util;
     string input_file_;
     string output_file_;
-    vector<vector<string> > sets_;
+    unique_ptr<RuleSource> source_;
   private:
     friend class EvaluateTest;
     FRIEND_TEST(EvaluateTest, UpdateCover);
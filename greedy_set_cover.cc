@@ -4,6 +4,9 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <algorithm>
+#include <queue>
+#include <set>
 #include <stdint.h>
 #include <log4cxx/logger.h>
 
@@ -16,6 +19,13 @@ namespace incremental_atpg {
   using std::map;
   using std::pair;
   using std::make_pair;
+  using std::min;
+  using std::max;
+  using std::sort;
+  using std::lower_bound;
+  using std::binary_search;
+  using std::priority_queue;
+  using std::set;
 
   using log4cxx::LoggerPtr;
   using log4cxx::Logger;
@@ -23,174 +33,301 @@ namespace incremental_atpg {
   //LoggerPtr GreedySetCover::logger(Logger::getLogger("GreedySetCover"));
 
   GreedySetCover::GreedySetCover() 
-    : heap_(new fibonacci_heap<heap_data>),
-      handles_(new map<string, pair<handle_t, uint64_t> >) {
+    : queue_policy_(kBucketQueue),
+      lazy_gains_(true),
+      warm_start_(false),
+      num_cover_rules_(0),
+      infos_match_cover_(true),
+      solve_by_component_(false),
+      num_threads_(0),
+      kernelize_(false),
+      heap_(new fibonacci_heap<heap_data>),
+      handles_(new vector<heap_handle>),
+      buckets_(new BucketQueue) {
     greedy_set_cover_logger = Logger::getLogger("GreedySetCover");
     greedy_set_cover_logger->setLevel(log4cxx::Level::getWarn());
     }
 
-  GreedySetCover::GreedySetCover(map<string, SetInfo>* set_infos,
-			      vector<RuleInfo>* rule_infos)
-    : SetCover(set_infos, rule_infos),
+  GreedySetCover::GreedySetCover(SymbolTable* set_names,
+				 Incidence* incidence)
+    : SetCover(set_names, incidence),
+      queue_policy_(kBucketQueue),
+      lazy_gains_(true),
+      warm_start_(false),
+      num_cover_rules_(0),
+      infos_match_cover_(true),
+      solve_by_component_(false),
+      num_threads_(0),
+      kernelize_(false),
       heap_(new fibonacci_heap<heap_data>),
-      handles_(new map<string, pair<handle_t, uint64_t> >) {
+      handles_(new vector<heap_handle>),
+      buckets_(new BucketQueue) {
     greedy_set_cover_logger = Logger::getLogger("GreedySetCover");
     greedy_set_cover_logger->setLevel(log4cxx::Level::getWarn());
     }
 
-  GreedySetCover::GreedySetCover(map<string, SetInfo>* set_infos,
-				 vector<RuleInfo>* rule_infos,
-				 map<string, SetProcessingInfo>* set_processing_infos,
+  GreedySetCover::GreedySetCover(SymbolTable* set_names,
+				 Incidence* incidence,
+				 vector<SetProcessingInfo>* set_processing_infos,
 				 vector<RuleProcessingInfo>* rule_processing_infos,
-				 list<string>* cover)
-    : SetCover(set_infos, rule_infos, set_processing_infos, 
+				 OrderList* cover)
+    : SetCover(set_names, incidence, set_processing_infos, 
 	       rule_processing_infos, cover),
+      queue_policy_(kBucketQueue),
+      lazy_gains_(true),
+      warm_start_(false),
+      num_cover_rules_(0),
+      infos_match_cover_(true),
+      solve_by_component_(false),
+      num_threads_(0),
+      kernelize_(false),
       heap_(new fibonacci_heap<heap_data>),
-      handles_(new map<string, pair<handle_t, uint64_t> >) {
+      handles_(new vector<heap_handle>),
+      buckets_(new BucketQueue) {
     greedy_set_cover_logger = Logger::getLogger("GreedySetCover");
     greedy_set_cover_logger->setLevel(log4cxx::Level::getWarn());
     }
 
   void GreedySetCover::AddAllSetsToHeap() {
     // add all sets to heap
-    uint64_t uncovered;
-    handle_t ht;
-    pair<handle_t, uint64_t> handle_value;
+    uint64_t num_sets = incidence_->num_sets();
+
+    if (queue_policy_ == kBucketQueue) {
+      buckets_->Reset(num_sets);
+      for (SetId set_id = 0; set_id < num_sets; set_id++) {
+	if (!InCover(set_id)) {
+	  buckets_->Push(set_id, incidence_->RulesOf(set_id).size());
+	}
+      }
+      return;
+    }
 
-    handles_.reset(new map<string, pair<handle_t, uint64_t> >);
+    handles_.reset(new vector<heap_handle>(num_sets));
     heap_.reset(new fibonacci_heap<heap_data>);
-    //    LOG4CXX_WARN(greedy_set_cover_logger, 
-    //		 "set_infos now has " << set_infos_->size() << " sets.");
-    for (auto const& set_info : *set_infos_) {
-      uncovered = set_info.second.all_rules.size();
-      ht = heap_->push(heap_data(set_info.first, uncovered));
-      handle_value = make_pair(ht, uncovered);
-      //      LOG4CXX_WARN(greedy_set_cover_logger, "Updating handles_ with " << set_info.first 
-      //		   << " - ( x, " << handle_value.second << ").");
-      handles_->operator[](set_info.first) = handle_value;
-      //      LOG4CXX_WARN(greedy_set_cover_logger, "handles["<< set_info.first <<"]="
-      //		   << "(" << *ht << ", " << handles_->operator[](set_info.first).second <<").")
+    for (SetId set_id = 0; set_id < num_sets; set_id++) {
+      if (InCover(set_id)) {
+	continue;
+      }
+      heap_handle& h = handles_->at(set_id);
+      h.value = incidence_->RulesOf(set_id).size();
+      h.handle = heap_->push(heap_data(set_id, h.value));
+      h.in_heap = true;
     }
     
   }
 
   void GreedySetCover::UpdateProcessingInfo(uint64_t* num_covered,
-					     map<string, uint64_t>* key_changes) {
+					     map<SetId, uint64_t>* key_changes) {
     if (cover_->size() == 0) {
       LOG4CXX_INFO(greedy_set_cover_logger,
 		   "Cover is empty.");
       return;
     }
-    const string& set_name = cover_->back();
-    if (set_infos_->find(set_name) == set_infos_->end()) {
+    SetId set_id = cover_->back();
+    if (set_id >= incidence_->num_sets()) {
       LOG4CXX_WARN(greedy_set_cover_logger,
-		   "Can't find " << set_name << " in set_infos_.");
+		   "Can't find " << set_id << " in incidence_.");
       return;
     }
-    map<string, SetProcessingInfo>::iterator spIt;
-    if ((spIt = set_processing_infos_->find(set_name))
-	!= set_processing_infos_->end()) {
-      LOG4CXX_WARN(set_cover_logger, "Set " << set_name << " duplicate in cover.");
+    if (InCover(set_id)) {
+      LOG4CXX_WARN(set_cover_logger, "Set " << GetSetName(set_id) << " duplicate in cover.");
       return;
     }
 
       // If there's any new rule, add it to rule_processing_infos_
-    int diff = rule_infos_->size() - rule_processing_infos_->size();
-    RuleProcessingInfo uncovered_rule;
+    uint64_t num_rules = incidence_->num_rules();
+    int diff = num_rules - rule_processing_infos_->size();
     if (diff != 1) {
 	LOG4CXX_INFO(set_cover_logger, diff << " new rules since last update.");
     }
-    while (diff > 0) {
-      rule_processing_infos_->push_back(uncovered_rule);
-      --diff;
+    if (diff > 0) {
+      rule_processing_infos_->resize(num_rules);
+    }
+    if (set_processing_infos_->size() < incidence_->num_sets()) {
+      set_processing_infos_->resize(incidence_->num_sets());
     }
      
-    SetProcessingInfo sp;
-    // TODO(lav): Okay to say rule_infos_ has all rules.
-    if (rule_infos_->size() < *num_covered) {
+    // TODO(lav): Okay to say incidence_ has all rules.
+    if (num_rules < *num_covered) {
       LOG4CXX_WARN(set_cover_logger, *num_covered << " rules covered out of " 
-		   << rule_infos_->size() << ".");
+		   << num_rules << ".");
     }
-    sp.num_uncovered = rule_infos_->size() - *num_covered;
-    spIt = set_processing_infos_->insert(make_pair(set_name, sp)).first;
-    
+    SetProcessingInfo& sp = set_processing_infos_->at(set_id);
+    sp.num_uncovered = num_rules - *num_covered;
+    sp.in_cover = true;
 
-    const vector<uint64_t>& all_rules = set_infos_->operator[](set_name).all_rules;
-    for (auto const& rule_id: all_rules) {
+    for (auto const& rule_id: incidence_->RulesOf(set_id)) {
       if (rule_id >= rule_processing_infos_->size()) {
 	LOG4CXX_WARN(set_cover_logger, rule_id << " not in rule_processing_infos_");
       }
       RuleProcessingInfo& rp = rule_processing_infos_->at(rule_id);
-      if (rp.first_covered_by.empty()) {
+      if (!rp.Covered()) {
 	*num_covered += 1;
-	spIt->second.AddRule(rule_id);
-	rp.first_covered_by = set_name;
-	const RuleInfo& rule_info = rule_infos_->at(rule_id);
-	  for (auto const& set_id: rule_info.all_sets) {
-	    if (!key_changes->insert(make_pair(set_id, 1)).second) {
-	      key_changes->operator[](set_id) += 1;
+	sp.AddRule(rule_id);
+	rp.first_covered_by = set_id;
+	if (key_changes == nullptr) {
+	  continue;
+	}
+	  for (auto const& other_set_id: incidence_->SetsOf(rule_id)) {
+	    if (!key_changes->insert(make_pair(other_set_id, 1)).second) {
+	      key_changes->operator[](other_set_id) += 1;
 	    }
 	  }
 	}
     }
   }
 
-  void GreedySetCover::UpdateSetsInHeap(const map<string, uint64_t>& key_changes) {
-    //    LOG4CXX_WARN(greedy_set_cover_logger,
-    //		 key_changes.size() << " keys to update in heap.");
+  heap_data GreedySetCover::TopOfQueue() {
+    if (queue_policy_ == kBucketQueue) {
+      pair<SetId, uint64_t> top = buckets_->Top();
+      return heap_data(top.first, top.second);
+    }
+    return heap_->top();
+  }
+
+  void GreedySetCover::DecreaseInQueue(SetId set_id, uint64_t new_value) {
+    if (queue_policy_ == kBucketQueue) {
+      buckets_->Decrease(set_id, new_value);
+      return;
+    }
+    heap_handle& handle_value = handles_->at(set_id);
+    handle_value.value = new_value;
+    heap_->decrease(handle_value.handle, heap_data(set_id, new_value));
+  }
+
+  heap_data GreedySetCover::PopTop() {
+    if (queue_policy_ == kBucketQueue) {
+      pair<SetId, uint64_t> top = buckets_->Top();
+      buckets_->Pop();
+      return heap_data(top.first, top.second);
+    }
+    heap_data data = heap_->top();
+    heap_->pop();
+    handles_->at(data.key).in_heap = false;
+    return data;
+  }
+
+  void GreedySetCover::UpdateSetsInHeap(const map<SetId, uint64_t>& key_changes) {
+    if (queue_policy_ == kBucketQueue) {
+      for (auto const& change: key_changes) {
+	if (!buckets_->Contains(change.first)) {
+	  if (cover_->size() > 0 && change.first != cover_->back()) {
+	    LOG4CXX_WARN(greedy_set_cover_logger, "Key " << change.first
+			 << " no longer in buckets_. Popped out?");
+	  }
+	  continue;
+	}
+	uint64_t value = buckets_->Value(change.first);
+	if (change.second > value) {
+	  LOG4CXX_ERROR(greedy_set_cover_logger, "Set " << GetSetName(change.first)
+			<< " does not have " << change.second << " rules.");
+	  continue;
+	}
+	buckets_->Decrease(change.first, value - change.second);
+      }
+      return;
+    }
 
     for (auto const& change: key_changes) {
-      //      LOG4CXX_WARN(greedy_set_cover_logger, "handles_ has  " << handles_->size() << " handles.");
-      //      LOG4CXX_WARN(greedy_set_cover_logger, "cover_ has  " << cover_->size() << " sets.");
-      if (handles_->find(change.first) == handles_->end()) {
+      if (change.first >= handles_->size()
+	  || !handles_->at(change.first).in_heap) {
 	if (cover_->size() > 0 && change.first != cover_->back()) {
 	    LOG4CXX_WARN(greedy_set_cover_logger, "Key " << change.first
 			 << " no longer in handles_. Popped out?");
 	} 
 	continue;
       } 
-      //      LOG4CXX_WARN(greedy_set_cover_logger,
-      //		   key_changes.size() << " Key " << change.first << " is in handles_.");
 
-      pair<handle_t, uint64_t>& handle_value = handles_->at(change.first);
-      if (change.second > handle_value.second) {
-	LOG4CXX_ERROR(greedy_set_cover_logger, "Set " << change.first 
+      heap_handle& handle_value = handles_->at(change.first);
+      if (change.second > handle_value.value) {
+	LOG4CXX_ERROR(greedy_set_cover_logger, "Set " << GetSetName(change.first)
 		      << " does not have " << change.second << " rules.");
 	continue;
       }
-      //      LOG4CXX_WARN(greedy_set_cover_logger,
-      //		   " Set has more than " << change.second
-      //		   << " rules.");
 
-      uint64_t new_value = handle_value.second - change.second;
-      handle_t h = handle_value.first;
-      heap_data new_heap_data(change.first, new_value);
-      handles_->operator[](change.first) = make_pair(h, new_value);
-      heap_->decrease(h, new_heap_data);
-      //      LOG4CXX_WARN(greedy_set_cover_logger, "Updated handle to " << *h << ".");
+      handle_value.value -= change.second;
+      heap_->decrease(handle_value.handle, heap_data(change.first, handle_value.value));
+    }
+  }
+
+  uint64_t GreedySetCover::NumUncovered(SetId set_id) {
+    uint64_t num_uncovered = 0;
+    for (auto const& rule_id: incidence_->RulesOf(set_id)) {
+      if (!rule_processing_infos_->at(rule_id).Covered()) {
+	num_uncovered++;
+      }
     }
+    return num_uncovered;
   }
 
   void GreedySetCover::UpdateCover() {
+    if (incidence_->num_removed_rules() > 0) {
+      DropRemovedRules();
+      num_cover_rules_ = 0;
+      component_covers_.reset(nullptr);
+    }
+    if (kernelize_) {
+      UpdateCoverKernelized();
+    } else if (solve_by_component_) {
+      UpdateCoverByComponent();
+    } else if (warm_start_ && num_cover_rules_ > 0
+	&& num_cover_rules_ <= incidence_->num_rules()) {
+      UpdateCoverWarm();
+    } else if (lazy_gains_) {
+      UpdateCoverLazily();
+    } else {
+      UpdateCoverEagerly();
+    }
+    if (!solve_by_component_ || kernelize_) {
+      component_covers_.reset(nullptr);
+    }
+    // Cover with a kernel isn't what greedy picks, can't warm start
+    // from it.
+    num_cover_rules_ = kernelize_ ? 0 : incidence_->num_rules();
+    infos_match_cover_ = true;
+  }
+
+  void GreedySetCover::UpdateCoverKernelized() {
+    Kernel kernel;
+    kernel.Reduce(*incidence_);
+    GreedySetCover reduced(new SymbolTable, kernel.ReleaseIncidence());
+    reduced.SetQueuePolicy(queue_policy_);
+    reduced.SetLazyGains(lazy_gains_);
+    reduced.SetSolveByComponent(solve_by_component_, num_threads_);
+    reduced.UpdateCover();
+    LOG4CXX_INFO(greedy_set_cover_logger, "Kernel has " << kernel.forced().size()
+		 << " forced sets, " << kernel.num_dominated() << " dominated sets and "
+		 << reduced.incidence_->num_rules() << " of "
+		 << incidence_->num_rules() << " rules.");
+
+    cover_->clear();
+    for (auto const& set_id: kernel.forced()) {
+      cover_->push_back(set_id);
+    }
+    for (auto const& set_id: *reduced.cover_) {
+      cover_->push_back(kernel.OriginalId(set_id));
+    }
+    ResetProcessingInfo();
+  }
+
+  void GreedySetCover::UpdateCoverEagerly() {
     // Clear cover
     cover_->clear();
     // Goes through all rules once only.
     ResetProcessingInfo();
     AddAllSetsToHeap();
 
-    uint64_t num_rules = rule_infos_->size();
+    uint64_t num_rules = incidence_->num_rules();
     uint64_t num_covered = 0;
     while(num_covered < num_rules) {
-      heap_data data = heap_->top();
-      heap_->pop();
-      handles_->erase(data.key);
+      heap_data data = PopTop();
 
       cover_->push_back(data.key);
 
       LOG4CXX_INFO(greedy_set_cover_logger,
-		 "Pushed back " << data.key << " on cover.");
+		 "Pushed back " << GetSetName(data.key) << " on cover.");
 
-      map<string, uint64_t> key_changes;
+      map<SetId, uint64_t> key_changes;
       UpdateProcessingInfo(&num_covered, 
 			   &key_changes);
 
@@ -199,6 +336,293 @@ namespace incremental_atpg {
       UpdateSetsInHeap(key_changes);
     }	    
   }
+
+  void GreedySetCover::UpdateCoverLazily() {
+    cover_->clear();
+    ResetProcessingInfo();
+    AddAllSetsToHeap();
+    RunLazily(0);
+  }
+
+  void GreedySetCover::RunLazily(uint64_t num_covered) {
+    uint64_t num_rules = incidence_->num_rules();
+    while(num_covered < num_rules) {
+      heap_data data = TopOfQueue();
+      // Keys in queue are upper bounds on what sets really have left.
+      // If top's key is still right, it beats the real key of every
+      // other set, ties included.
+      uint64_t num_uncovered = NumUncovered(data.key);
+      if (num_uncovered < data.value) {
+	DecreaseInQueue(data.key, num_uncovered);
+	continue;
+      }
+      PopTop();
+      cover_->push_back(data.key);
+
+      LOG4CXX_INFO(greedy_set_cover_logger,
+		 "Pushed back " << GetSetName(data.key) << " on cover.");
+
+      UpdateProcessingInfo(&num_covered, nullptr);
+    }
+  }
+
+  uint64_t GreedySetCover::KeptPrefix(const vector<SetId>& old_cover,
+				      vector<uint64_t>* new_rule_steps) {
+    const uint64_t kNever = UINT64_MAX;
+    vector<uint64_t> step_of_set(incidence_->num_sets(), kNever);
+    for (uint64_t step = 0; step < old_cover.size(); step++) {
+      if (old_cover[step] < step_of_set.size()
+	  && step_of_set[old_cover[step]] == kNever) {
+	step_of_set[old_cover[step]] = step;
+      }
+    }
+    // Step at which old cover first covers a rule.
+    auto step_of_rule = [&](uint64_t rule_id) {
+      uint64_t step = kNever;
+      for (auto const& set_id: incidence_->SetsOf(rule_id)) {
+	step = min(step, step_of_set[set_id]);
+      }
+      return step;
+    };
+
+    // Sets with new rules, and last step at which one of them is
+    // still uncovered. Only these sets have more uncovered rules at
+    // some step than they did when @old_cover was picked.
+    map<SetId, uint64_t> last_new_step;
+    uint64_t last_step = 0;
+    new_rule_steps->clear();
+    for (uint64_t rule_id = num_cover_rules_; rule_id < incidence_->num_rules();
+	 rule_id++) {
+      uint64_t step = step_of_rule(rule_id);
+      new_rule_steps->push_back(step);
+      last_step = max(last_step, step);
+      for (auto const& set_id: incidence_->SetsOf(rule_id)) {
+	auto inserted = last_new_step.insert(make_pair(set_id, step));
+	if (!inserted.second) {
+	  inserted.first->second = max(inserted.first->second, step);
+	}
+      }
+    }
+    // For those sets, steps at which each of their rules is covered.
+    map<SetId, vector<uint64_t> > rule_steps;
+    for (auto const& set_step: last_new_step) {
+      vector<uint64_t>& steps = rule_steps[set_step.first];
+      for (auto const& rule_id: incidence_->RulesOf(set_step.first)) {
+	steps.push_back(step_of_rule(rule_id));
+      }
+      sort(steps.begin(), steps.end());
+    }
+    auto num_uncovered_at = [&](SetId set_id, uint64_t step) {
+      const vector<uint64_t>& steps = rule_steps[set_id];
+      return (uint64_t) (steps.end() - lower_bound(steps.begin(), steps.end(), step));
+    };
+
+    // Set picked at a step had most uncovered rules without new
+    // rules, so it's still picked unless a set with new rules now
+    // beats it.
+    for (uint64_t step = 0; step < old_cover.size() && step <= last_step; step++) {
+      SetId picked_id = old_cover[step];
+      uint64_t picked_uncovered = 0;
+      if (last_new_step.count(picked_id) > 0) {
+	picked_uncovered = num_uncovered_at(picked_id, step);
+      } else if (infos_match_cover_) {
+	picked_uncovered = set_processing_infos_->at(picked_id).GetNumRules();
+      } else {
+	for (auto const& rule_id: incidence_->RulesOf(picked_id)) {
+	  if (step_of_rule(rule_id) == step) {
+	    picked_uncovered++;
+	  }
+	}
+      }
+      heap_data picked(picked_id, picked_uncovered);
+      for (auto const& set_step: last_new_step) {
+	SetId set_id = set_step.first;
+	if (set_id == picked_id || set_step.second < step
+	    || step_of_set[set_id] < step) {
+	  continue;
+	}
+	if (picked < heap_data(set_id, num_uncovered_at(set_id, step))) {
+	  return step;
+	}
+      }
+    }
+    return old_cover.size();
+  }
+
+  void GreedySetCover::UpdateCoverWarm() {
+    vector<SetId> old_cover(cover_->begin(), cover_->end());
+    vector<uint64_t> new_rule_steps;
+    uint64_t num_kept = KeptPrefix(old_cover, &new_rule_steps);
+    LOG4CXX_INFO(greedy_set_cover_logger, "Keeping " << num_kept << " of "
+		 << old_cover.size() << " sets in cover.");
+
+    while (cover_->size() > num_kept) {
+      cover_->pop_back();
+    }
+    if (!infos_match_cover_) {
+      ResetProcessingInfo();
+    } else {
+      // Sets after @num_kept leave cover, their rules are uncovered.
+      for (uint64_t step = num_kept; step < old_cover.size(); step++) {
+	SetProcessingInfo& sp = set_processing_infos_->at(old_cover[step]);
+	for (auto const& rule_id: sp.covers_rules) {
+	  rule_processing_infos_->at(rule_id).first_covered_by = kNoSet;
+	}
+	sp = SetProcessingInfo();
+      }
+      rule_processing_infos_->resize(incidence_->num_rules());
+      set_processing_infos_->resize(incidence_->num_sets());
+      // New rules go to the first kept set they are in.
+      vector<uint64_t> num_new_covered_at(num_kept, 0);
+      for (uint64_t i = 0; i < new_rule_steps.size(); i++) {
+	uint64_t step = new_rule_steps[i];
+	if (step >= num_kept) {
+	  continue;
+	}
+	uint64_t rule_id = num_cover_rules_ + i;
+	rule_processing_infos_->at(rule_id).first_covered_by = old_cover[step];
+	set_processing_infos_->at(old_cover[step]).AddRule(rule_id);
+	num_new_covered_at[step]++;
+      }
+      uint64_t num_new_uncovered = new_rule_steps.size();
+      for (uint64_t step = 0; step < num_kept; step++) {
+	set_processing_infos_->at(old_cover[step]).num_uncovered += num_new_uncovered;
+	num_new_uncovered -= num_new_covered_at[step];
+      }
+    }
+
+    uint64_t num_covered = 0;
+    for (auto const& set_id: *cover_) {
+      num_covered += set_processing_infos_->at(set_id).GetNumRules();
+    }
+    AddAllSetsToHeap();
+    RunLazily(num_covered);
+  }
  
 
+  vector<heap_data> GreedySetCover::SolveComponent(SetId root) {
+    const ComponentIndex& components = incidence_->components();
+    for (auto const& rule_id: components.RulesIn(root)) {
+      rule_processing_infos_->at(rule_id).first_covered_by = kNoSet;
+    }
+    priority_queue<heap_data> queue;
+    for (auto const& set_id: components.SetsIn(root)) {
+      set_processing_infos_->at(set_id) = SetProcessingInfo();
+      queue.push(heap_data(set_id, incidence_->RulesOf(set_id).size()));
+    }
+
+    vector<heap_data> picked;
+    uint64_t num_uncovered = components.RulesIn(root).size();
+    while (num_uncovered > 0 && !queue.empty()) {
+      heap_data data = queue.top();
+      queue.pop();
+      uint64_t set_uncovered = NumUncovered(data.key);
+      if (set_uncovered < data.value) {
+	queue.push(heap_data(data.key, set_uncovered));
+	continue;
+      }
+      picked.push_back(data);
+      SetProcessingInfo& sp = set_processing_infos_->at(data.key);
+      sp.in_cover = true;
+      for (auto const& rule_id: incidence_->RulesOf(data.key)) {
+	RuleProcessingInfo& rp = rule_processing_infos_->at(rule_id);
+	if (!rp.Covered()) {
+	  rp.first_covered_by = data.key;
+	  sp.AddRule(rule_id);
+	  --num_uncovered;
+	}
+      }
+    }
+    return picked;
+  }
+
+  void GreedySetCover::UpdateCoverByComponent() {
+    const ComponentIndex& components = incidence_->components();
+    uint64_t num_rules = incidence_->num_rules();
+    rule_processing_infos_->resize(num_rules);
+    set_processing_infos_->resize(incidence_->num_sets());
+
+    // Components that got new rules, or all of them.
+    vector<SetId> dirty;
+    if (component_covers_.get() == nullptr
+	|| component_covers_->num_rules > num_rules) {
+      component_covers_.reset(new ComponentCovers);
+      dirty = components.Roots();
+      // Every component gets solved, which leaves infos of all sets
+      // and rules in one right, and the rest are in none.
+      set_processing_infos_->assign(incidence_->num_sets(), SetProcessingInfo());
+      rule_processing_infos_->assign(num_rules, RuleProcessingInfo());
+      infos_match_cover_ = true;
+    } else {
+      set<SetId> roots;
+      for (uint64_t rule_id = component_covers_->num_rules; rule_id < num_rules;
+	   rule_id++) {
+	Span<SetId> sets = incidence_->SetsOf(rule_id);
+	if (!sets.empty()) {
+	  roots.insert(components.Find(sets[0]));
+	}
+      }
+      dirty.assign(roots.begin(), roots.end());
+    }
+    // Covers of dirty components, or of components merged into others,
+    // are out of date.
+    map<SetId, vector<heap_data> >& covers = component_covers_->covers;
+    for (auto it = covers.begin(); it != covers.end(); ) {
+      if (components.Find(it->first) != it->first
+	  || binary_search(dirty.begin(), dirty.end(), it->first)) {
+	covers.erase(it++);
+      } else {
+	++it;
+      }
+    }
+    LOG4CXX_INFO(greedy_set_cover_logger, "Solving " << dirty.size() << " of "
+		 << components.num_components() << " components.");
+
+    vector<vector<heap_data> > dirty_covers(dirty.size());
+    if (dirty.size() > 1) {
+      if (pool_.get() == nullptr) {
+	pool_.reset(new ThreadPool(num_threads_));
+      }
+      pool_->Run(dirty.size(), [&](uint64_t i) {
+	  dirty_covers[i] = SolveComponent(dirty[i]);
+	});
+    } else if (dirty.size() == 1) {
+      dirty_covers[0] = SolveComponent(dirty[0]);
+    }
+    for (uint64_t i = 0; i < dirty.size(); i++) {
+      covers[dirty[i]].swap(dirty_covers[i]);
+    }
+    component_covers_->num_rules = num_rules;
+
+    // Each component's cover is in decreasing order already, merge them.
+    typedef pair<heap_data, pair<const vector<heap_data>*, uint64_t> > head_t;
+    priority_queue<head_t> heads;
+    for (auto const& root_cover: covers) {
+      if (!root_cover.second.empty()) {
+	heads.push(make_pair(root_cover.second[0], make_pair(&root_cover.second, 0)));
+      }
+    }
+    cover_->clear();
+    while (!heads.empty()) {
+      head_t head = heads.top();
+      heads.pop();
+      cover_->push_back(head.first.key);
+      const vector<heap_data>& cover = *head.second.first;
+      uint64_t next = head.second.second + 1;
+      if (next < cover.size()) {
+	heads.push(make_pair(cover[next], make_pair(&cover, next)));
+      }
+    }
+
+    if (!infos_match_cover_) {
+      ResetProcessingInfo();
+      return;
+    }
+    uint64_t num_covered = 0;
+    for (auto const& set_id: *cover_) {
+      SetProcessingInfo& sp = set_processing_infos_->at(set_id);
+      sp.num_uncovered = num_rules - num_covered;
+      num_covered += sp.GetNumRules();
+    }
+  }
 }  // namespace incremental_atpg
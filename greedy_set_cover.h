@@ -11,6 +11,9 @@
 
 #include "gtest/gtest_prod.h"
 #include "set_cover.h"
+#include "bucket_queue.h"
+#include "thread_pool.h"
+#include "kernel.h"
 
 namespace incremental_atpg {
   using std::vector;
@@ -22,9 +25,9 @@ namespace incremental_atpg {
   using std::pair;
 
   struct heap_data {
-    string key;
+    SetId key;
     uint64_t value;
-  heap_data(string key, uint64_t value) :
+  heap_data(SetId key, uint64_t value) :
     key(key),
       value(value) {}
 
@@ -46,46 +49,182 @@ namespace incremental_atpg {
   template<typename charT, typename traits>
     std::basic_ostream<charT, traits> &
     operator<< (std::basic_ostream<charT, traits> &lhs, heap_data const &rhs) {
-    return lhs << "heap_data(\"" << rhs.key << "\", " << rhs.value << ")";
+    return lhs << "heap_data(" << rhs.key << ", " << rhs.value << ")";
   }
 
   typedef typename fibonacci_heap<heap_data>::handle_type handle_t;
 
+  // Handle of a set in heap and its current value, indexed by set id.
+  struct heap_handle {
+    handle_t handle;
+    uint64_t value;
+    // False once the set is popped out of heap (or was never pushed.)
+    bool in_heap;
+  heap_handle() :
+    value(0),
+      in_heap(false) {}
+  };
+
+  // Priority queue GreedySetCover keeps sets in. Both pick sets
+  // in the same order.
+  enum QueuePolicy {
+    kFibonacciHeap,
+    // Cheaper, uses a BucketQueue since keys are small integers.
+    kBucketQueue
+  };
+
+  // What greedy picked in each connected component, see
+  // ComponentIndex, for the first @num_rules rules. Indexed by root
+  // of the component, sets in the order picked with the number of
+  // rules each one covered.
+  struct ComponentCovers {
+    uint64_t num_rules;
+    map<SetId, vector<heap_data> > covers;
+  ComponentCovers()
+  : num_rules(0) { }
+  };
+
   class GreedySetCover : public SetCover {
   public:
     log4cxx::LoggerPtr greedy_set_cover_logger;
     GreedySetCover();
-    GreedySetCover(map<string, SetInfo>* set_infos,
-		     vector<RuleInfo>* rule_infos);
-    GreedySetCover(map<string, SetInfo>* set_infos,
-		   vector<RuleInfo>* rule_infos,
-		   map<string, SetProcessingInfo>* set_processing_infos,
+    GreedySetCover(SymbolTable* set_names,
+		   Incidence* incidence);
+    GreedySetCover(SymbolTable* set_names,
+		   Incidence* incidence,
+		   vector<SetProcessingInfo>* set_processing_infos,
 		   vector<RuleProcessingInfo>* rule_processing_infos,
-		   list<string>* cover);
+		   OrderList* cover);
 
     // AddRule inherited from SetCover.
     // Get..ProcessingInfo also.
-    // Finds set cover from scratch for rules in latest @rule_infos_.
+    // Finds set cover from scratch for rules in latest @incidence_.
+    // Drops removed rules from it first, which renumbers rules, so
+    // there's no warm start or component covers to reuse then.
   void UpdateCover();
+
+    // Queue used by later UpdateCover's. Default is kBucketQueue.
+    void SetQueuePolicy(QueuePolicy queue_policy) {
+      queue_policy_ = queue_policy;
+    }
+    // Whether later UpdateCover's fix keys in queue only when a set
+    // gets to the top, instead of after every set added to cover.
+    // Same cover either way. Default is true.
+    void SetLazyGains(bool lazy_gains) {
+      lazy_gains_ = lazy_gains;
+    }
+    // Whether later UpdateCover's keep the start of last cover that
+    // greedy would still pick with the rules added since, and only
+    // re-run greedy after it. Same cover either way. Default is false.
+    void SetWarmStart(bool warm_start) {
+      warm_start_ = warm_start;
+    }
+    // For warm start, when @cover_ was handed in: it's what greedy
+    // picked for the first @num_rules rules. Processing infos aren't
+    // for it and get rebuilt for the part that's kept.
+    void SetCoverIsGreedyFor(uint64_t num_rules) {
+      num_cover_rules_ = num_rules;
+      infos_match_cover_ = false;
+    }
+    // Whether later UpdateCover's run greedy in each connected
+    // component by itself, @num_threads components at a time (0 means
+    // one per hardware thread), and only in components with rules
+    // added since. Same cover either way. Default is false.
+    void SetSolveByComponent(bool solve_by_component, unsigned num_threads = 0) {
+      solve_by_component_ = solve_by_component;
+      num_threads_ = num_threads;
+    }
+    // Takes ownership of @component_covers, from ReleaseComponentCovers
+    // of an earlier GreedySetCover. @infos_match if processing infos
+    // handed in are the ones it left with them, but for components
+    // with rules added since, so only those get rebuilt.
+    void SetComponentCovers(ComponentCovers* component_covers,
+			    bool infos_match = false) {
+      component_covers_.reset(component_covers);
+      infos_match_cover_ = infos_match;
+    }
+    ComponentCovers* ReleaseComponentCovers() {
+      return component_covers_.release();
+    }
+    // Whether later UpdateCover's run greedy on a Kernel of the rules,
+    // with forced sets first in cover. Cover isn't the same as without
+    // and can't be warm started from. Default is false.
+    void SetKernelize(bool kernelize) {
+      kernelize_ = kernelize;
+    }
  
   protected:
-    // Adds all sets in @set_infos_ to @heap_ and populates @handles_. 
+    // Adds all sets in @incidence_ not in cover to @heap_ and
+    // populates @handles_, or to @buckets_, depending on @queue_policy_.
     void AddAllSetsToHeap();
 
+    // Pops set with most uncovered rules out of queue.
+    heap_data PopTop();
+    // Set with largest key in queue, left in queue.
+    heap_data TopOfQueue();
+    // Lowers key of @set_id, which is in queue, to @new_value.
+    void DecreaseInQueue(SetId set_id, uint64_t new_value);
+    // Number of rules in @set_id not covered yet, per
+    // @rule_processing_infos_.
+    uint64_t NumUncovered(SetId set_id);
+
     // Given that a new set was just added to cover,
     // updates processing_info for affected rules and sets
-    // and gets net @key_changes for affected sets.
+    // and gets net @key_changes for affected sets, unless it's null.
     // set_processing_infos_ should have info. for all sets in cover up to new set.
     // rule_processing_infos_ should have info for all rules added up to when
     // new set was added.
     void UpdateProcessingInfo(uint64_t* num_covered,
-			      map<string, uint64_t>* key_changes);
-    // Given set name and change in number of uncovered rules it has, updates
-    // set in @heap_ using @handles_.
-    void UpdateSetsInHeap(const map<string, uint64_t>& key_changes);
+			      map<SetId, uint64_t>* key_changes);
+    // Given set id and change in number of uncovered rules it has, updates
+    // set in @heap_ using @handles_, or in @buckets_.
+    void UpdateSetsInHeap(const map<SetId, uint64_t>& key_changes);
+    // UpdateCover with lazy gains: keys in queue may be stale (too
+    // large). Set at the top gets its key recomputed and goes back in
+    // if it dropped, else it's added to cover.
+    void UpdateCoverLazily();
+    // Adds sets in queue to cover till @num_covered is all rules,
+    // with lazy gains.
+    void RunLazily(uint64_t num_covered);
+    void UpdateCoverEagerly();
+    // How many sets at the start of @old_cover, greedy's cover for the
+    // first @num_cover_rules_ rules, greedy would still pick now. Fills
+    // in @new_rule_steps, for each rule since, the first step of
+    // @old_cover that covers it (UINT64_MAX if none.)
+    uint64_t KeptPrefix(const vector<SetId>& old_cover,
+			vector<uint64_t>* new_rule_steps);
+    // UpdateCover with warm start.
+    void UpdateCoverWarm();
+    // Greedy with lazy gains on component with root @root only, with
+    // a queue of its own. Only touches processing infos of sets and
+    // rules in the component, so components can be solved in parallel.
+    vector<heap_data> SolveComponent(SetId root);
+    // UpdateCover by component. Cover is the per-component covers
+    // merged by number of rules covered, then set id, both largest
+    // first, which is the order greedy on everything picks them.
+    void UpdateCoverByComponent();
+    // UpdateCover with a kernel, solved by a GreedySetCover with the
+    // same options.
+    void UpdateCoverKernelized();
 
+    QueuePolicy queue_policy_;
+    bool lazy_gains_;
+    bool warm_start_;
+    // Number of rules @cover_ is greedy's cover for, 0 if none.
+    uint64_t num_cover_rules_;
+    // Whether processing infos are the ones for @cover_.
+    bool infos_match_cover_;
+    bool solve_by_component_;
+    unsigned num_threads_;
+    unique_ptr<ComponentCovers> component_covers_;
+    unique_ptr<ThreadPool> pool_;
+    bool kernelize_;
+    // Used with kFibonacciHeap.
     unique_ptr<fibonacci_heap<heap_data> > heap_;
-    unique_ptr<map<string, pair<handle_t, uint64_t> > > handles_;
+    // Indexed by set id.
+    unique_ptr<vector<heap_handle> > handles_;
+    // Used with kBucketQueue.
+    unique_ptr<BucketQueue> buckets_;
     
   private:
     friend class GreedySetCoverTest;
@@ -94,6 +233,12 @@ namespace incremental_atpg {
     FRIEND_TEST(GreedySetCoverTest, UpdateSetsInHeap);
     FRIEND_TEST(GreedySetCoverTest, UpdateCover);
     FRIEND_TEST(GreedySetCoverTest, AddRule);
+    FRIEND_TEST(GreedySetCoverTest, BucketQueue);
+    FRIEND_TEST(GreedySetCoverTest, LazyGains);
+    FRIEND_TEST(GreedySetCoverTest, WarmStart);
+    FRIEND_TEST(GreedySetCoverTest, KeptPrefix);
+    FRIEND_TEST(GreedySetCoverTest, SolveByComponent);
+    FRIEND_TEST(GreedySetCoverTest, Kernelize);
   };
 }  // namespace incremental_atpg
 #endif  // INCREMENTAL_ATPG_GREEDY_SET_COVER_H_
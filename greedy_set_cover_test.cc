@@ -29,6 +29,21 @@ namespace incremental_atpg {
     }
     virtual void TearDown() {
     }
+    SetId Id(const string& set_name) {
+      SetId set_id = kNoSet;
+      sc_->GetSetId(set_name, &set_id);
+      return set_id;
+    }
+    // Sets of rule @rule of an instance with lots of ties. With
+    // @phase, each run of 40 rules is also in a set of its own.
+    vector<string> TieRule(uint64_t rule, bool phase) {
+      vector<string> sets = {to_string(rule % 13), to_string(rule % 7 + 13),
+			     to_string((rule * rule) % 11)};
+      if (phase) {
+	sets.push_back(to_string(rule / 40 + 24));
+      }
+      return sets;
+    }
     std::unique_ptr<GreedySetCover> sc_;
   };
   /*
@@ -42,43 +57,45 @@ namespace incremental_atpg {
     sc_->AddRule({"cat", "dog"});
     sc_->AddRule({"cat"});
     sc_->ResetProcessingInfo();
-    sc_->cover_->push_back("dog");
-    map<string, uint64_t> key_changes;
+    sc_->cover_->push_back(Id("dog"));
+    map<SetId, uint64_t> key_changes;
     uint64_t covered = 0;
     sc_->UpdateProcessingInfo(&covered, &key_changes);
     EXPECT_EQ(1, covered);
     EXPECT_EQ(2, key_changes.size()); // Need to update both "dog" and "cat" in heap. 
-    EXPECT_TRUE(key_changes.find("dog") != key_changes.end());
-    EXPECT_EQ(1, key_changes.find("dog")->second);
-    EXPECT_TRUE(key_changes.find("cat") != key_changes.end());
-    EXPECT_EQ(1, key_changes.find("cat")->second);
+    EXPECT_TRUE(key_changes.find(Id("dog")) != key_changes.end());
+    EXPECT_EQ(1, key_changes.find(Id("dog"))->second);
+    EXPECT_TRUE(key_changes.find(Id("cat")) != key_changes.end());
+    EXPECT_EQ(1, key_changes.find(Id("cat"))->second);
 
 
     EXPECT_EQ(2, sc_->rule_processing_infos_->size());
     RuleProcessingInfo rp0 = sc_->rule_processing_infos_->at(0);
     RuleProcessingInfo rp1 = sc_->rule_processing_infos_->at(1);
-    EXPECT_EQ("dog", rp0.first_covered_by);
-    EXPECT_TRUE(rp1.first_covered_by.empty());
+    EXPECT_EQ(Id("dog"), rp0.first_covered_by);
+    EXPECT_FALSE(rp1.Covered());
   }
 
   TEST_F(GreedySetCoverTest, AddAllSetsToHeap) {
+    sc_->SetQueuePolicy(kFibonacciHeap);
     sc_->AddRule({"cat", "dog"});
     sc_->AddRule({"cat"});
 
     sc_->AddAllSetsToHeap();    
     EXPECT_EQ(2, sc_->heap_->size());
-    EXPECT_EQ(heap_data("cat", 2), sc_->heap_->top());
+    EXPECT_EQ(heap_data(Id("cat"), 2), sc_->heap_->top());
     sc_->heap_->pop();
-    EXPECT_EQ(heap_data("dog", 1), sc_->heap_->top());
+    EXPECT_EQ(heap_data(Id("dog"), 1), sc_->heap_->top());
   }
 
   TEST_F(GreedySetCoverTest, AddRule) {
     sc_->AddRule({"cat", "dog"});
     sc_->AddRule({"cat"});
 
-    map<string, SetInfo> si = sc_->GetSetInfos();
-    EXPECT_EQ(2, si.size());
-    EXPECT_TRUE(si.find("cat") != si.end());    
+    Incidence incidence = sc_->GetIncidence();
+    EXPECT_EQ(2, incidence.num_sets());
+    EXPECT_NE(kNoSet, Id("cat"));
+    EXPECT_EQ(2, incidence.RulesOf(Id("cat")).size());
   }
 
   TEST_F(GreedySetCoverTest, UpdateCover) {
@@ -86,43 +103,45 @@ namespace incremental_atpg {
     sc_->AddRule({"cat"});
     sc_->UpdateCover();
     EXPECT_EQ(1, sc_->cover_->size());
-    EXPECT_EQ("cat", sc_->cover_->back());
+    EXPECT_EQ(Id("cat"), sc_->cover_->back());
 
     sc_->AddRule({"jam"});
     sc_->UpdateCover();
     EXPECT_EQ(2, sc_->cover_->size());
-    EXPECT_EQ("jam", sc_->cover_->back());
+    EXPECT_EQ(list<string>({"cat", "jam"}), sc_->GetCover());
+    EXPECT_EQ(Id("jam"), sc_->cover_->back());
     sc_->cover_->pop_back();
-    EXPECT_EQ("cat", sc_->cover_->back());
+    EXPECT_EQ(Id("cat"), sc_->cover_->back());
     sc_->cover_->pop_back();
   }
 
   
   TEST_F(GreedySetCoverTest, UpdateSetsInHeap) {
+    sc_->SetQueuePolicy(kFibonacciHeap);
     sc_->AddRule({"cat", "dog"});
     sc_->AddRule({"cat"});
 
     
       sc_->AddAllSetsToHeap();    
       {
-	map<string, uint64_t> key_changes;
-	key_changes["cat"] = 1;
-	key_changes["dog"] = 0;
+	map<SetId, uint64_t> key_changes;
+	key_changes[Id("cat")] = 1;
+	key_changes[Id("dog")] = 0;
 	
 	sc_->UpdateSetsInHeap(key_changes);
 	EXPECT_EQ(2, sc_->heap_->size());
-	EXPECT_EQ(heap_data("dog", 1), sc_->heap_->top());
+	EXPECT_EQ(heap_data(Id("dog"), 1), sc_->heap_->top());
 	sc_->heap_->pop();
-	EXPECT_EQ(heap_data("cat", 1), sc_->heap_->top());
+	EXPECT_EQ(heap_data(Id("cat"), 1), sc_->heap_->top());
 	sc_->heap_->pop();
       }
         
 	  sc_->AddAllSetsToHeap();    
        
       {
-	map<string, uint64_t> key_changes;
-	key_changes["cat"] = 2;
-	key_changes["bubblewrap"] = 5;
+	map<SetId, uint64_t> key_changes;
+	key_changes[Id("cat")] = 2;
+	key_changes[Id("bubblewrap")] = 5;
 	sc_->UpdateSetsInHeap(key_changes);
       }
 	/*
@@ -135,5 +154,163 @@ namespace incremental_atpg {
 
   }
   
+  TEST_F(GreedySetCoverTest, BucketQueue) {
+    // Lots of ties, both queues should break them the same way.
+    vector<vector<string> > rules;
+    for (uint64_t rule = 0; rule < 200; rule++) {
+      rules.push_back(TieRule(rule, false));
+    }
+    for (auto const& rule : rules) {
+      sc_->AddRule(rule);
+    }
+    sc_->SetLazyGains(false);
+    sc_->SetQueuePolicy(kFibonacciHeap);
+    sc_->UpdateCover();
+    list<string> heap_cover = sc_->GetCover();
+
+    sc_.reset(new GreedySetCover);
+    for (auto const& rule : rules) {
+      sc_->AddRule(rule);
+    }
+    sc_->SetLazyGains(false);
+    sc_->SetQueuePolicy(kBucketQueue);
+    sc_->UpdateCover();
+    EXPECT_EQ(heap_cover, sc_->GetCover());
+    EXPECT_TRUE(sc_->buckets_->empty() || sc_->buckets_->Top().second == 0);
+  }
+
+  TEST_F(GreedySetCoverTest, LazyGains) {
+    vector<vector<string> > rules;
+    for (uint64_t rule = 0; rule < 200; rule++) {
+      rules.push_back(TieRule(rule, true));
+    }
+    for (auto const& rule : rules) {
+      sc_->AddRule(rule);
+    }
+    sc_->SetLazyGains(false);
+    sc_->UpdateCover();
+    list<string> eager_cover = sc_->GetCover();
+    vector<RuleProcessingInfo> eager_rules = sc_->GetRuleProcessingInfos();
+
+    for (auto policy : {kFibonacciHeap, kBucketQueue}) {
+      sc_->SetLazyGains(true);
+      sc_->SetQueuePolicy(policy);
+      sc_->UpdateCover();
+      EXPECT_EQ(eager_cover, sc_->GetCover());
+      vector<RuleProcessingInfo> lazy_rules = sc_->GetRuleProcessingInfos();
+      ASSERT_EQ(eager_rules.size(), lazy_rules.size());
+      for (uint64_t rule_id = 0; rule_id < lazy_rules.size(); rule_id++) {
+	EXPECT_EQ(eager_rules[rule_id].first_covered_by,
+		  lazy_rules[rule_id].first_covered_by);
+      }
+    }
+  }
+
+  TEST_F(GreedySetCoverTest, KeptPrefix) {
+    sc_->AddRule({"cat", "dog"});
+    sc_->AddRule({"cat", "dog"});
+    sc_->AddRule({"cat"});
+    sc_->AddRule({"rain"});
+    sc_->UpdateCover();
+    vector<SetId> old_cover = {Id("cat"), Id("rain")};
+    vector<uint64_t> new_rule_steps;
+
+    // Covered by "cat" on the way, nothing changes.
+    sc_->AddRule({"cat", "rain"});
+    EXPECT_EQ(2, sc_->KeptPrefix(old_cover, &new_rule_steps));
+    EXPECT_EQ(vector<uint64_t>({0}), new_rule_steps);
+
+    // "rain" ties with "cat" at first step now, and wins the tie.
+    sc_->AddRule({"rain"});
+    sc_->AddRule({"rain"});
+    EXPECT_EQ(0, sc_->KeptPrefix(old_cover, &new_rule_steps));
+    EXPECT_EQ(vector<uint64_t>({0, 1, 1}), new_rule_steps);
+  }
+
+  TEST_F(GreedySetCoverTest, SolveByComponent) {
+    std::unique_ptr<GreedySetCover> whole(new GreedySetCover);
+    sc_->SetSolveByComponent(true, 4);
+    for (uint64_t rule = 0; rule < 400; rule++) {
+      // Ten slices, that get linked now and then.
+      uint64_t slice = rule % 10;
+      vector<string> sets = {to_string(slice * 100 + rule % 7),
+			     to_string(slice * 100 + (rule * rule) % 11 + 7)};
+      if (rule % 90 == 89) {
+	sets.push_back(to_string((slice + 1) % 10 * 100));
+      }
+      sc_->AddRule(sets);
+      whole->AddRule(sets);
+      sc_->UpdateCover();
+      whole->UpdateCover();
+      ASSERT_EQ(whole->GetCover(), sc_->GetCover());
+
+      vector<RuleProcessingInfo> whole_rules = whole->GetRuleProcessingInfos();
+      vector<RuleProcessingInfo> rules = sc_->GetRuleProcessingInfos();
+      ASSERT_EQ(whole_rules.size(), rules.size());
+      for (uint64_t rule_id = 0; rule_id < rules.size(); rule_id++) {
+	EXPECT_EQ(whole_rules[rule_id].first_covered_by, rules[rule_id].first_covered_by);
+      }
+      vector<SetProcessingInfo> whole_sets = whole->GetSetProcessingInfos();
+      vector<SetProcessingInfo> sets_infos = sc_->GetSetProcessingInfos();
+      for (SetId set_id = 0; set_id < sets_infos.size(); set_id++) {
+	EXPECT_EQ(whole_sets[set_id].in_cover, sets_infos[set_id].in_cover);
+	EXPECT_EQ(whole_sets[set_id].num_uncovered, sets_infos[set_id].num_uncovered);
+      }
+    }
+    EXPECT_EQ(sc_->incidence_->components().num_components(),
+	      sc_->component_covers_->covers.size());
+  }
+
+  TEST_F(GreedySetCoverTest, Kernelize) {
+    sc_->AddRule({"cat", "dog"});
+    sc_->AddRule({"dog", "cat"});
+    sc_->AddRule({"cat", "dog", "rain"});
+    sc_->AddRule({"sand"});
+    sc_->AddRule({"sand", "rain"});
+    sc_->AddRule({"rain", "sun"});
+    sc_->SetKernelize(true);
+    sc_->UpdateCover();
+    // "sand" is forced, "dog" and "sun" are dominated by "cat" and
+    // "rain" or the other way around.
+    EXPECT_EQ(3, sc_->cover_->size());
+    EXPECT_EQ(Id("sand"), sc_->cover_->front());
+    for (auto const& rule: sc_->GetRuleProcessingInfos()) {
+      EXPECT_TRUE(rule.Covered());
+    }
+    EXPECT_EQ(0, sc_->num_cover_rules_);
+
+    sc_->SetKernelize(false);
+    sc_->UpdateCover();
+    EXPECT_EQ(3, sc_->cover_->size());
+  }
+
+  TEST_F(GreedySetCoverTest, WarmStart) {
+    std::unique_ptr<GreedySetCover> cold(new GreedySetCover);
+    sc_->SetWarmStart(true);
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      vector<string> sets = TieRule(rule, true);
+      sc_->AddRule(sets);
+      cold->AddRule(sets);
+      sc_->UpdateCover();
+      cold->UpdateCover();
+      ASSERT_EQ(cold->GetCover(), sc_->GetCover());
+
+      vector<RuleProcessingInfo> cold_rules = cold->GetRuleProcessingInfos();
+      vector<RuleProcessingInfo> warm_rules = sc_->GetRuleProcessingInfos();
+      ASSERT_EQ(cold_rules.size(), warm_rules.size());
+      for (uint64_t rule_id = 0; rule_id < warm_rules.size(); rule_id++) {
+	EXPECT_EQ(cold_rules[rule_id].first_covered_by,
+		  warm_rules[rule_id].first_covered_by);
+      }
+      vector<SetProcessingInfo> cold_sets = cold->GetSetProcessingInfos();
+      vector<SetProcessingInfo> warm_sets = sc_->GetSetProcessingInfos();
+      ASSERT_EQ(cold_sets.size(), warm_sets.size());
+      for (SetId set_id = 0; set_id < warm_sets.size(); set_id++) {
+	EXPECT_EQ(cold_sets[set_id].in_cover, warm_sets[set_id].in_cover);
+	EXPECT_EQ(cold_sets[set_id].num_uncovered, warm_sets[set_id].num_uncovered);
+	EXPECT_EQ(cold_sets[set_id].covers_rules, warm_sets[set_id].covers_rules);
+      }
+    }
+  }
 
 }  // namespace incremental_atpg
@@ -0,0 +1,356 @@
+#include "incidence.h"
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <stdint.h>
+
+#include "snapshot.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::max;
+  using std::sort;
+  using std::unique;
+
+  // Room a set gets the first time it moves.
+  static const uint64_t kMinSetCapacity = 4;
+
+  Incidence::Incidence()
+    : num_rule_holes_(0),
+      num_removed_rules_(0),
+      num_holes_(0) {
+  }
+
+  uint64_t Incidence::AddRule(const vector<SetId>& sets) {
+    uint64_t rule_id = num_rules();
+    rule_offsets_.push_back(rule_sets_.size());
+    rule_sets_.insert(rule_sets_.end(), sets.begin(), sets.end());
+    rule_ends_.push_back(rule_sets_.size());
+    for (auto set_id : sets) {
+      AppendToSet(set_id, rule_id);
+    }
+    components_.AddRule(rule_id, sets);
+    CompactIfSparse();
+    return rule_id;
+  }
+
+  bool Incidence::AddMembership(uint64_t rule_id, SetId set_id) {
+    Span<SetId> sets = SetsOf(rule_id);
+    if (rule_id >= num_rules() || IsRemoved(rule_id) || set_id == kNoSet
+	|| std::find(sets.begin(), sets.end(), set_id) != sets.end()) {
+      return false;
+    }
+    SetId other = sets.empty() ? kNoSet : sets[0];
+    uint64_t begin = rule_offsets_[rule_id];
+    uint64_t end = rule_ends_[rule_id];
+    if (end != rule_sets_.size()) {
+      // Move block to the end.
+      vector<SetId> block(rule_sets_.begin() + begin, rule_sets_.begin() + end);
+      rule_offsets_[rule_id] = rule_sets_.size();
+      rule_sets_.insert(rule_sets_.end(), block.begin(), block.end());
+      num_rule_holes_ += end - begin;
+    }
+    rule_sets_.push_back(set_id);
+    rule_ends_[rule_id] = rule_sets_.size();
+
+    InsertIntoSet(set_id, rule_id);
+    if (other == kNoSet) {
+      components_.AddRule(rule_id, vector<SetId>(1, set_id));
+    } else {
+      components_.Connect(other, set_id);
+    }
+    CompactIfSparse();
+    return true;
+  }
+
+  bool Incidence::RemoveMembership(uint64_t rule_id, SetId set_id) {
+    if (rule_id >= num_rules() || IsRemoved(rule_id)) {
+      return false;
+    }
+    auto begin = rule_sets_.begin() + rule_offsets_[rule_id];
+    auto end = rule_sets_.begin() + rule_ends_[rule_id];
+    uint64_t count = std::count(begin, end, set_id);
+    if (count == 0 || count == (uint64_t) (end - begin)) {
+      return false;
+    }
+    std::remove(begin, end, set_id);
+    rule_ends_[rule_id] -= count;
+    num_rule_holes_ += count;
+    RemoveFromSet(set_id, rule_id);
+    CompactIfSparse();
+    return true;
+  }
+
+  bool Incidence::RemoveRule(uint64_t rule_id) {
+    if (rule_id >= num_rules() || IsRemoved(rule_id)) {
+      return false;
+    }
+    for (auto set_id : SetsOf(rule_id)) {
+      RemoveFromSet(set_id, rule_id);
+    }
+    if (removed_.size() <= rule_id) {
+      removed_.resize(rule_id + 1, false);
+    }
+    removed_[rule_id] = true;
+    ++num_removed_rules_;
+    return true;
+  }
+
+  uint64_t Incidence::FindRule(const vector<SetId>& sets) const {
+    if (sets.empty()) {
+      return kNoRule;
+    }
+    vector<SetId> wanted(sets);
+    sort(wanted.begin(), wanted.end());
+    wanted.erase(unique(wanted.begin(), wanted.end()), wanted.end());
+    // Only rules of the smallest set can match.
+    SetId smallest = wanted[0];
+    for (auto set_id : wanted) {
+      if (RulesOf(set_id).size() < RulesOf(smallest).size()) {
+	smallest = set_id;
+      }
+    }
+    for (auto rule_id : RulesOf(smallest)) {
+      Span<SetId> rule_sets = SetsOf(rule_id);
+      vector<SetId> have(rule_sets.begin(), rule_sets.end());
+      sort(have.begin(), have.end());
+      have.erase(unique(have.begin(), have.end()), have.end());
+      if (have == wanted) {
+	return rule_id;
+      }
+    }
+    return kNoRule;
+  }
+
+  Span<SetId> Incidence::SetsOf(uint64_t rule_id) const {
+    if (rule_id >= num_rules() || IsRemoved(rule_id)) {
+      return Span<SetId>();
+    }
+    const SetId* sets = rule_sets_.data();
+    return Span<SetId>(sets + rule_offsets_[rule_id],
+		       sets + rule_ends_[rule_id]);
+  }
+
+  Span<uint64_t> Incidence::RulesOf(SetId set_id) const {
+    if (set_id >= num_sets()) {
+      return Span<uint64_t>();
+    }
+    const uint64_t* rules = set_rules_.data() + set_offsets_[set_id];
+    return Span<uint64_t>(rules, rules + set_sizes_[set_id]);
+  }
+
+  void Incidence::AppendToSet(SetId set_id, uint64_t rule_id) {
+    if (set_id >= num_sets()) {
+      set_offsets_.resize(set_id + 1, set_rules_.size());
+      set_sizes_.resize(set_id + 1, 0);
+      set_capacities_.resize(set_id + 1, 0);
+    }
+    uint64_t offset = set_offsets_[set_id];
+    uint64_t size = set_sizes_[set_id];
+    uint64_t capacity = set_capacities_[set_id];
+
+    if (size == capacity) {
+      if (offset + capacity == set_rules_.size()) {
+	// Last block, just grow it.
+	set_rules_.push_back(rule_id);
+	++set_capacities_[set_id];
+	++set_sizes_[set_id];
+	return;
+      }
+      // Move block to the end, with more room.
+      uint64_t new_capacity = max(kMinSetCapacity, 2 * capacity);
+      uint64_t new_offset = set_rules_.size();
+      set_rules_.resize(new_offset + new_capacity);
+      std::copy(set_rules_.begin() + offset,
+		set_rules_.begin() + offset + size,
+		set_rules_.begin() + new_offset);
+      num_holes_ += capacity;
+      set_offsets_[set_id] = offset = new_offset;
+      set_capacities_[set_id] = new_capacity;
+    }
+    set_rules_[offset + size] = rule_id;
+    ++set_sizes_[set_id];
+  }
+
+  void Incidence::RemoveFromSet(SetId set_id, uint64_t rule_id) {
+    auto begin = set_rules_.begin() + set_offsets_[set_id];
+    auto end = begin + set_sizes_[set_id];
+    // Rule may be in set more than once.
+    auto range = std::equal_range(begin, end, rule_id);
+    std::copy(range.second, end, range.first);
+    set_sizes_[set_id] -= range.second - range.first;
+  }
+
+  void Incidence::InsertIntoSet(SetId set_id, uint64_t rule_id) {
+    AppendToSet(set_id, rule_id);
+    auto begin = set_rules_.begin() + set_offsets_[set_id];
+    auto last = begin + set_sizes_[set_id] - 1;
+    std::rotate(std::upper_bound(begin, last, rule_id), last, last + 1);
+  }
+
+  void Incidence::CompactIfSparse() {
+    if ((num_holes_ > kMinSetCapacity && 2 * num_holes_ > set_rules_.size())
+	|| (num_rule_holes_ > kMinSetCapacity && 2 * num_rule_holes_ > rule_sets_.size())) {
+      Compact();
+    }
+  }
+
+  void Incidence::Compact() {
+    vector<uint64_t> set_rules;
+    set_rules.reserve(set_rules_.size() - num_holes_);
+    for (SetId set_id = 0; set_id < num_sets(); set_id++) {
+      uint64_t offset = set_offsets_[set_id];
+      set_offsets_[set_id] = set_rules.size();
+      set_rules.insert(set_rules.end(),
+		       set_rules_.begin() + offset,
+		       set_rules_.begin() + offset + set_sizes_[set_id]);
+      set_capacities_[set_id] = set_sizes_[set_id];
+    }
+    set_rules_.swap(set_rules);
+    num_holes_ = 0;
+
+    vector<SetId> rule_sets;
+    rule_sets.reserve(rule_sets_.size() - num_rule_holes_);
+    for (uint64_t rule_id = 0; rule_id < num_rules(); rule_id++) {
+      uint64_t offset = rule_offsets_[rule_id];
+      rule_offsets_[rule_id] = rule_sets.size();
+      rule_sets.insert(rule_sets.end(),
+		       rule_sets_.begin() + offset,
+		       rule_sets_.begin() + rule_ends_[rule_id]);
+      rule_ends_[rule_id] = rule_sets.size();
+    }
+    rule_sets_.swap(rule_sets);
+    num_rule_holes_ = 0;
+  }
+
+  void Incidence::Save(SnapshotWriter* writer) const {
+    writer->Write(rule_offsets_);
+    writer->Write(rule_ends_);
+    writer->Write(rule_sets_);
+    writer->WriteValue(num_rule_holes_);
+    vector<uint64_t> removed;
+    removed.reserve(num_removed_rules_);
+    for (uint64_t rule_id = 0; rule_id < removed_.size(); rule_id++) {
+      if (removed_[rule_id]) {
+	removed.push_back(rule_id);
+      }
+    }
+    writer->Write(removed);
+    writer->Write(set_offsets_);
+    writer->Write(set_sizes_);
+    writer->Write(set_capacities_);
+    writer->Write(set_rules_);
+    writer->WriteValue(num_holes_);
+  }
+
+  bool Incidence::Load(SnapshotReader* reader) {
+    Incidence loaded;
+    vector<uint64_t> removed;
+    if (!reader->Read(&loaded.rule_offsets_)
+	|| !reader->Read(&loaded.rule_ends_)
+	|| !reader->Read(&loaded.rule_sets_)
+	|| !reader->ReadValue(&loaded.num_rule_holes_)
+	|| !reader->Read(&removed)
+	|| !reader->Read(&loaded.set_offsets_)
+	|| !reader->Read(&loaded.set_sizes_)
+	|| !reader->Read(&loaded.set_capacities_)
+	|| !reader->Read(&loaded.set_rules_)
+	|| !reader->ReadValue(&loaded.num_holes_)) {
+      return false;
+    }
+    // Blocks have to be inside their arrays, SetsOf and RulesOf
+    // trust them.
+    uint64_t num_rules = loaded.rule_ends_.size();
+    uint64_t num_sets = loaded.set_offsets_.size();
+    if (loaded.rule_offsets_.size() != num_rules
+	|| loaded.set_sizes_.size() != num_sets
+	|| loaded.set_capacities_.size() != num_sets) {
+      return false;
+    }
+    for (uint64_t rule_id = 0; rule_id < num_rules; rule_id++) {
+      if (loaded.rule_offsets_[rule_id] > loaded.rule_ends_[rule_id]
+	  || loaded.rule_ends_[rule_id] > loaded.rule_sets_.size()) {
+	return false;
+      }
+    }
+    // So do ids in them, and components_ below.
+    for (uint64_t rule_id = 0; rule_id < num_rules; rule_id++) {
+      for (auto set_id : loaded.SetsOf(rule_id)) {
+	if (set_id >= num_sets) {
+	  return false;
+	}
+      }
+    }
+    for (SetId set_id = 0; set_id < num_sets; set_id++) {
+      if (loaded.set_sizes_[set_id] > loaded.set_capacities_[set_id]
+	  || loaded.set_offsets_[set_id] > loaded.set_rules_.size()
+	  || loaded.set_capacities_[set_id]
+	  > loaded.set_rules_.size() - loaded.set_offsets_[set_id]) {
+	return false;
+      }
+      // Sorted, RemoveFromSet searches them.
+      uint64_t last = 0;
+      bool first = true;
+      for (auto rule_id : loaded.RulesOf(set_id)) {
+	if (rule_id >= num_rules || (!first && rule_id <= last)) {
+	  return false;
+	}
+	last = rule_id;
+	first = false;
+      }
+    }
+    for (auto rule_id : removed) {
+      if (rule_id >= num_rules || loaded.IsRemoved(rule_id)) {
+	return false;
+      }
+      if (loaded.removed_.size() <= rule_id) {
+	loaded.removed_.resize(rule_id + 1, false);
+      }
+      loaded.removed_[rule_id] = true;
+      ++loaded.num_removed_rules_;
+    }
+    for (uint64_t rule_id = 0; rule_id < num_rules; rule_id++) {
+      Span<SetId> sets = loaded.SetsOf(rule_id);
+      loaded.components_.AddRule(rule_id, vector<SetId>(sets.begin(), sets.end()));
+    }
+    *this = std::move(loaded);
+    return true;
+  }
+
+  void Incidence::DropRemovedRules(vector<uint64_t>* new_ids) {
+    new_ids->assign(num_rules(), kNoRule);
+    vector<uint64_t> rule_offsets;
+    vector<uint64_t> rule_ends;
+    vector<SetId> rule_sets;
+    rule_sets.reserve(rule_sets_.size());
+    ComponentIndex components;
+    for (uint64_t rule_id = 0; rule_id < num_rules(); rule_id++) {
+      if (IsRemoved(rule_id)) {
+	continue;
+      }
+      (*new_ids)[rule_id] = rule_ends.size();
+      vector<SetId> sets(rule_sets_.begin() + rule_offsets_[rule_id],
+			 rule_sets_.begin() + rule_ends_[rule_id]);
+      components.AddRule((*new_ids)[rule_id], sets);
+      rule_offsets.push_back(rule_sets.size());
+      rule_sets.insert(rule_sets.end(), sets.begin(), sets.end());
+      rule_ends.push_back(rule_sets.size());
+    }
+    // Removed rules aren't in any block, and renumbering keeps blocks
+    // in increasing order.
+    for (SetId set_id = 0; set_id < num_sets(); set_id++) {
+      uint64_t offset = set_offsets_[set_id];
+      for (uint64_t i = offset; i < offset + set_sizes_[set_id]; i++) {
+	set_rules_[i] = (*new_ids)[set_rules_[i]];
+      }
+    }
+    rule_offsets_.swap(rule_offsets);
+    rule_ends_.swap(rule_ends);
+    rule_sets_.swap(rule_sets);
+    num_rule_holes_ = 0;
+    removed_.clear();
+    num_removed_rules_ = 0;
+    components_ = components;
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,142 @@
+#ifndef INCREMENTAL_ATPG_INCIDENCE_H_
+#define INCREMENTAL_ATPG_INCIDENCE_H_
+#include <vector>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "symbol_table.h"
+#include "component_index.h"
+#include "span.h"
+
+namespace incremental_atpg {
+  using std::vector;
+
+  // Id of no rule.
+  static const uint64_t kNoRule = UINT64_MAX;
+
+  // Rule <-> set memberships, in both directions, in a few flat arrays.
+  //
+  // Rules mostly get appended, so rule -> sets is close to compressed
+  // sparse rows: the sets of rule r are @rule_sets_[@rule_offsets_[r],
+  // @rule_ends_[r]), one block after the other. A rule that gains a set
+  // moves to the end of @rule_sets_, unless it's there already, and
+  // one that loses a set leaves a slot free at the end of its block.
+  //
+  // Sets gain a rule every time a new rule is in them, so set -> rules
+  // gives every set a block with some slack in @set_rules_. A set whose
+  // block is full moves to the end of @set_rules_ with twice the room,
+  // leaving a hole behind. Holes in either array are squeezed out by
+  // Compact(), which runs by itself once they are more than half of
+  // it.
+  //
+  // A removed rule leaves its sets' blocks right away but keeps its id
+  // and its slot in @rule_sets_, so other rule ids don't change, until
+  // DropRemovedRules renumbers rules.
+  class Incidence {
+  public:
+    Incidence();
+
+    // Adds rule with id num_rules(), which is in @sets. Returns its id.
+    uint64_t AddRule(const vector<SetId>& sets);
+    // Takes rule @rule_id out of its sets, in time linear in their
+    // sizes. Returns false if there's no such rule or it's removed
+    // already.
+    bool RemoveRule(uint64_t rule_id);
+    // Puts rule @rule_id in set @set_id too. Returns false if there's
+    // no such rule, it's removed, or it's in the set already.
+    bool AddMembership(uint64_t rule_id, SetId set_id);
+    // Takes rule @rule_id out of set @set_id. Returns false if it
+    // isn't in the set, or that's the only set it's in.
+    bool RemoveMembership(uint64_t rule_id, SetId set_id);
+    // Id of a rule that's in exactly @sets, in any order, kNoRule if
+    // there's none.
+    uint64_t FindRule(const vector<SetId>& sets) const;
+    // Spans below are invalidated by any change to the Incidence.
+    // Sets that rule @rule_id is in, in the order they were added.
+    // Empty for removed rules.
+    Span<SetId> SetsOf(uint64_t rule_id) const;
+    // Rules in set @set_id, in increasing order. Empty for unknown sets.
+    Span<uint64_t> RulesOf(SetId set_id) const;
+
+    // Including removed rules, i.e., one more than the largest rule id.
+    uint64_t num_rules() const {
+      return rule_ends_.size();
+    }
+    uint64_t num_removed_rules() const {
+      return num_removed_rules_;
+    }
+    uint64_t num_live_rules() const {
+      return num_rules() - num_removed_rules_;
+    }
+    bool IsRemoved(uint64_t rule_id) const {
+      return rule_id < removed_.size() && removed_[rule_id];
+    }
+    // One more than the largest set id seen.
+    uint64_t num_sets() const {
+      return set_offsets_.size();
+    }
+    // Total number of (rule, set) pairs, removed rules included.
+    uint64_t num_memberships() const {
+      return rule_sets_.size() - num_rule_holes_;
+    }
+
+    // Moves all set blocks, and all rule blocks, next to each other,
+    // with no slack.
+    void Compact();
+    // Renumbers rules that aren't removed 0, 1, ..., keeping their
+    // order, and rebuilds components. Fills @new_ids with new id of
+    // each old rule id, kNoRule for removed rules.
+    void DropRemovedRules(vector<uint64_t>* new_ids);
+
+    // Writes arrays, holes and all, to @writer.
+    void Save(SnapshotWriter* writer) const;
+    // Replaces everything with arrays from @reader, and rebuilds
+    // components. Returns false, and leaves incidence alone, if
+    // they're not there or don't fit together.
+    bool Load(SnapshotReader* reader);
+
+    // Connected components, kept up to date by AddRule and
+    // AddMembership. Removed rules and memberships stay in them until
+    // DropRemovedRules, so a component may really be a few.
+    const ComponentIndex& components() const {
+      return components_;
+    }
+
+  protected:
+    // Appends @rule_id to @set_id's block, moving it if it's full.
+    void AppendToSet(SetId set_id, uint64_t rule_id);
+    // Erases @rule_id from @set_id's block, keeping the rest in order.
+    void RemoveFromSet(SetId set_id, uint64_t rule_id);
+    // Puts @rule_id in @set_id's block, keeping it in order.
+    void InsertIntoSet(SetId set_id, uint64_t rule_id);
+    // Compact() if holes are more than half of either array.
+    void CompactIfSparse();
+
+    // Indexed by rule id.
+    vector<uint64_t> rule_offsets_;
+    vector<uint64_t> rule_ends_;
+    vector<SetId> rule_sets_;
+    // Slots in @rule_sets_ that don't belong to any block.
+    uint64_t num_rule_holes_;
+    // Indexed by rule id, only as long as the last removed rule.
+    vector<bool> removed_;
+    uint64_t num_removed_rules_;
+
+    // Indexed by set id.
+    vector<uint64_t> set_offsets_;
+    vector<uint64_t> set_sizes_;
+    vector<uint64_t> set_capacities_;
+    vector<uint64_t> set_rules_;
+    // Slots in @set_rules_ that don't belong to any block.
+    uint64_t num_holes_;
+
+    ComponentIndex components_;
+  private:
+    friend class IncidenceTest;
+    FRIEND_TEST(IncidenceTest, AppendToSet);
+    FRIEND_TEST(IncidenceTest, Compact);
+    FRIEND_TEST(IncidenceTest, RemoveRule);
+    FRIEND_TEST(IncidenceTest, Memberships);
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_INCIDENCE_H_
@@ -0,0 +1,163 @@
+#include "incidence.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace incremental_atpg {
+  using std::vector;
+
+class IncidenceTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    incidence_.reset(new Incidence);
+  }
+  vector<uint64_t> Rules(SetId set_id) {
+    Span<uint64_t> rules = incidence_->RulesOf(set_id);
+    return vector<uint64_t>(rules.begin(), rules.end());
+  }
+  vector<SetId> Sets(uint64_t rule_id) {
+    Span<SetId> sets = incidence_->SetsOf(rule_id);
+    return vector<SetId>(sets.begin(), sets.end());
+  }
+  std::unique_ptr<Incidence> incidence_;
+};
+
+TEST_F(IncidenceTest, AddRule) {
+  EXPECT_EQ(0, incidence_->AddRule({0, 1}));
+  EXPECT_EQ(1, incidence_->AddRule({1}));
+  EXPECT_EQ(2, incidence_->AddRule({3, 1}));
+  EXPECT_EQ(3, incidence_->num_rules());
+  EXPECT_EQ(4, incidence_->num_sets());
+  EXPECT_EQ(5, incidence_->num_memberships());
+
+  EXPECT_EQ(vector<SetId>({0, 1}), Sets(0));
+  EXPECT_EQ(vector<SetId>({1}), Sets(1));
+  EXPECT_EQ(vector<SetId>({3, 1}), Sets(2));
+  EXPECT_TRUE(incidence_->SetsOf(3).empty());
+
+  EXPECT_EQ(vector<uint64_t>({0}), Rules(0));
+  EXPECT_EQ(vector<uint64_t>({0, 1, 2}), Rules(1));
+  EXPECT_TRUE(Rules(2).empty());
+  EXPECT_EQ(vector<uint64_t>({2}), Rules(3));
+  EXPECT_TRUE(Rules(4).empty());
+
+  EXPECT_EQ(2, incidence_->components().num_components());
+  EXPECT_EQ(incidence_->components().Find(0), incidence_->components().Find(3));
+  EXPECT_NE(incidence_->components().Find(0), incidence_->components().Find(2));
+}
+
+TEST_F(IncidenceTest, AppendToSet) {
+  // Set 0 is the last block, so it grows in place.
+  incidence_->AddRule({0});
+  incidence_->AddRule({0});
+  EXPECT_EQ(0, incidence_->num_holes_);
+  // Set 0 is no longer last, moves to the end when it needs room.
+  incidence_->AddRule({1});
+  incidence_->AddRule({0});
+  EXPECT_EQ(2, incidence_->num_holes_);
+  EXPECT_EQ(4, incidence_->set_capacities_[0]);
+  EXPECT_EQ(vector<uint64_t>({0, 1, 3}), Rules(0));
+  EXPECT_EQ(vector<uint64_t>({2}), Rules(1));
+}
+
+TEST_F(IncidenceTest, Compact) {
+  for (uint64_t rule = 0; rule < 100; rule++) {
+    incidence_->AddRule({(SetId) (rule % 7), (SetId) (rule % 3 + 7)});
+    // Holes never take up more than half.
+    EXPECT_LE(incidence_->num_holes_, incidence_->set_rules_.size() / 2 + 4);
+  }
+  incidence_->Compact();
+  EXPECT_EQ(0, incidence_->num_holes_);
+  EXPECT_EQ(200, incidence_->set_rules_.size());
+  for (SetId set_id = 0; set_id < 7; set_id++) {
+    vector<uint64_t> rules = Rules(set_id);
+    ASSERT_EQ(set_id < 2 ? 15 : 14, rules.size());
+    for (uint64_t i = 0; i < rules.size(); i++) {
+      EXPECT_EQ(set_id + 7 * i, rules[i]);
+    }
+  }
+  EXPECT_EQ(34, Rules(7).size());
+  incidence_->AddRule({2});
+  EXPECT_EQ(100, Rules(2).back());
+}
+
+TEST_F(IncidenceTest, RemoveRule) {
+  incidence_->AddRule({0, 1});
+  incidence_->AddRule({1});
+  incidence_->AddRule({2, 1});
+  incidence_->AddRule({1, 0});
+  EXPECT_EQ(2, incidence_->FindRule({2, 1}));
+  EXPECT_EQ(0, incidence_->FindRule({1, 0, 1}));
+  EXPECT_EQ(kNoRule, incidence_->FindRule({0}));
+  EXPECT_EQ(kNoRule, incidence_->FindRule({}));
+
+  EXPECT_TRUE(incidence_->RemoveRule(0));
+  EXPECT_FALSE(incidence_->RemoveRule(0));
+  EXPECT_FALSE(incidence_->RemoveRule(4));
+  EXPECT_TRUE(incidence_->IsRemoved(0));
+  EXPECT_EQ(4, incidence_->num_rules());
+  EXPECT_EQ(3, incidence_->num_live_rules());
+  EXPECT_TRUE(Sets(0).empty());
+  EXPECT_EQ(vector<uint64_t>({3}), Rules(0));
+  EXPECT_EQ(vector<uint64_t>({1, 2, 3}), Rules(1));
+  EXPECT_EQ(3, incidence_->FindRule({0, 1}));
+  EXPECT_TRUE(incidence_->RemoveRule(2));
+  EXPECT_TRUE(Rules(2).empty());
+
+  vector<uint64_t> new_ids;
+  incidence_->DropRemovedRules(&new_ids);
+  EXPECT_EQ(vector<uint64_t>({kNoRule, 0, kNoRule, 1}), new_ids);
+  EXPECT_EQ(2, incidence_->num_rules());
+  EXPECT_EQ(0, incidence_->num_removed_rules());
+  EXPECT_EQ(3, incidence_->num_memberships());
+  EXPECT_EQ(vector<SetId>({1}), Sets(0));
+  EXPECT_EQ(vector<SetId>({1, 0}), Sets(1));
+  EXPECT_EQ(vector<uint64_t>({1}), Rules(0));
+  EXPECT_EQ(vector<uint64_t>({0, 1}), Rules(1));
+  // Set 2 has no rules left, so it's by itself.
+  EXPECT_NE(incidence_->components().Find(1), incidence_->components().Find(2));
+  EXPECT_EQ(2, incidence_->AddRule({2}));
+}
+
+TEST_F(IncidenceTest, Memberships) {
+  incidence_->AddRule({0, 1});
+  incidence_->AddRule({1});
+  incidence_->AddRule({2});
+  EXPECT_FALSE(incidence_->AddMembership(0, 1));
+  EXPECT_FALSE(incidence_->AddMembership(3, 1));
+
+  // Rule 2 is last, grows in place.
+  EXPECT_TRUE(incidence_->AddMembership(2, 0));
+  EXPECT_EQ(0, incidence_->num_rule_holes_);
+  EXPECT_EQ(vector<SetId>({2, 0}), Sets(2));
+  EXPECT_EQ(vector<uint64_t>({0, 2}), Rules(0));
+  EXPECT_EQ(incidence_->components().Find(2), incidence_->components().Find(1));
+  // Rule 1 moves to the end, and goes in order in set 3 and 0.
+  EXPECT_TRUE(incidence_->AddMembership(1, 3));
+  EXPECT_TRUE(incidence_->AddMembership(1, 0));
+  EXPECT_EQ(1, incidence_->num_rule_holes_);
+  EXPECT_EQ(vector<SetId>({1, 3, 0}), Sets(1));
+  EXPECT_EQ(vector<uint64_t>({0, 1, 2}), Rules(0));
+  EXPECT_EQ(vector<uint64_t>({1}), Rules(3));
+  EXPECT_EQ(7, incidence_->num_memberships());
+
+  EXPECT_FALSE(incidence_->RemoveMembership(1, 2));
+  EXPECT_TRUE(incidence_->RemoveMembership(1, 3));
+  EXPECT_TRUE(incidence_->RemoveMembership(1, 1));
+  EXPECT_FALSE(incidence_->RemoveMembership(1, 0));
+  EXPECT_EQ(vector<SetId>({0}), Sets(1));
+  EXPECT_EQ(vector<uint64_t>({0}), Rules(1));
+  EXPECT_TRUE(Rules(3).empty());
+  EXPECT_EQ(5, incidence_->num_memberships());
+  EXPECT_EQ(1, incidence_->FindRule({0}));
+
+  incidence_->Compact();
+  EXPECT_EQ(0, incidence_->num_rule_holes_);
+  EXPECT_EQ(5, incidence_->rule_sets_.size());
+  EXPECT_EQ(vector<SetId>({0, 1}), Sets(0));
+  EXPECT_EQ(vector<SetId>({0}), Sets(1));
+  EXPECT_EQ(vector<SetId>({2, 0}), Sets(2));
+}
+}  // namespace incremental_atpg
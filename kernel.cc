@@ -0,0 +1,152 @@
+#include "kernel.h"
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::map;
+  using std::unique_ptr;
+  using std::make_pair;
+  using std::sort;
+  using std::unique;
+  using std::includes;
+
+  Kernel::Kernel()
+    : incidence_(new Incidence),
+      num_dominated_(0) {
+  }
+
+  vector<SetId> Kernel::UniqueSets(const Incidence& incidence, uint64_t rule_id) {
+    Span<SetId> span = incidence.SetsOf(rule_id);
+    vector<SetId> sets(span.begin(), span.end());
+    sort(sets.begin(), sets.end());
+    sets.erase(unique(sets.begin(), sets.end()), sets.end());
+    return sets;
+  }
+
+  void Kernel::Reduce(const Incidence& incidence) {
+    uint64_t num_sets = incidence.num_sets();
+    uint64_t num_rules = incidence.num_rules();
+    incidence_.reset(new Incidence);
+    forced_.clear();
+    set_ids_.clear();
+    weights_.clear();
+    kernel_rules_.assign(num_rules, kNotInKernel);
+    num_dominated_ = 0;
+
+    vector<bool> forced(num_sets, false);
+    for (uint64_t rule_id = 0; rule_id < num_rules; rule_id++) {
+      Span<SetId> sets = incidence.SetsOf(rule_id);
+      if (!sets.empty() && UniqueSets(incidence, rule_id).size() == 1) {
+	forced[sets[0]] = true;
+      }
+    }
+    for (SetId set_id = 0; set_id < num_sets; set_id++) {
+      if (forced[set_id]) {
+	forced_.push_back(set_id);
+      }
+    }
+
+    // Rules no forced set covers, one per distinct list of sets.
+    map<vector<SetId>, uint64_t> kernel_rule_ids;
+    vector<vector<SetId> > kernel_rule_sets;
+    for (uint64_t rule_id = 0; rule_id < num_rules; rule_id++) {
+      vector<SetId> sets = UniqueSets(incidence, rule_id);
+      bool covered = sets.empty();
+      for (auto set_id : sets) {
+	covered = covered || forced[set_id];
+      }
+      if (covered) {
+	continue;
+      }
+      auto inserted = kernel_rule_ids.insert(make_pair(sets, weights_.size()));
+      if (inserted.second) {
+	kernel_rule_sets.push_back(sets);
+	weights_.push_back(0);
+      }
+      kernel_rules_[rule_id] = inserted.first->second;
+      ++weights_[inserted.first->second];
+    }
+
+    // Kernel rules in each set, in increasing order.
+    vector<vector<uint64_t> > set_rules(num_sets);
+    for (uint64_t kernel_rule_id = 0; kernel_rule_id < kernel_rule_sets.size();
+	 kernel_rule_id++) {
+      for (auto set_id : kernel_rule_sets[kernel_rule_id]) {
+	set_rules[set_id].push_back(kernel_rule_id);
+      }
+    }
+    // A set that dominates @set_id has its first rule, so only sets of
+    // that rule need checking.
+    vector<SetId> kernel_set_ids(num_sets, kNoSet);
+    for (SetId set_id = 0; set_id < num_sets; set_id++) {
+      const vector<uint64_t>& rules = set_rules[set_id];
+      if (rules.empty()) {
+	continue;
+      }
+      bool dominated = false;
+      for (auto other_id : kernel_rule_sets[rules[0]]) {
+	const vector<uint64_t>& other_rules = set_rules[other_id];
+	if (other_id == set_id || other_rules.size() < rules.size()
+	    || (other_rules.size() == rules.size() && other_id < set_id)) {
+	  continue;
+	}
+	if (includes(other_rules.begin(), other_rules.end(),
+		     rules.begin(), rules.end())) {
+	  dominated = true;
+	  break;
+	}
+      }
+      if (dominated) {
+	++num_dominated_;
+      } else {
+	kernel_set_ids[set_id] = set_ids_.size();
+	set_ids_.push_back(set_id);
+      }
+    }
+
+    for (auto const& sets : kernel_rule_sets) {
+      vector<SetId> kernel_sets;
+      for (auto set_id : sets) {
+	if (kernel_set_ids[set_id] != kNoSet) {
+	  kernel_sets.push_back(kernel_set_ids[set_id]);
+	}
+      }
+      incidence_->AddRule(kernel_sets);
+    }
+  }
+
+  IncrementalKernel::IncrementalKernel() {
+  }
+
+  bool IncrementalKernel::AddRule(const vector<SetId>& sets) {
+    vector<SetId> unique_sets(sets);
+    sort(unique_sets.begin(), unique_sets.end());
+    unique_sets.erase(unique(unique_sets.begin(), unique_sets.end()),
+		      unique_sets.end());
+    for (auto set_id : unique_sets) {
+      if (Forced(set_id)) {
+	kernel_rules_.push_back(kNotInKernel);
+	return false;
+      }
+    }
+    auto inserted = kernel_rule_ids_.insert(make_pair(unique_sets, weights_.size()));
+    kernel_rules_.push_back(inserted.first->second);
+    if (!inserted.second) {
+      ++weights_[inserted.first->second];
+      return false;
+    }
+    weights_.push_back(1);
+    if (unique_sets.size() == 1) {
+      if (unique_sets[0] >= forced_.size()) {
+	forced_.resize(unique_sets[0] + 1, false);
+      }
+      forced_[unique_sets[0]] = true;
+    }
+    return true;
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,116 @@
+#ifndef INCREMENTAL_ATPG_KERNEL_H_
+#define INCREMENTAL_ATPG_KERNEL_H_
+#include <vector>
+#include <map>
+#include <memory>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "symbol_table.h"
+#include "incidence.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::map;
+  using std::unique_ptr;
+
+  // Marks a rule that has no rule standing for it in a kernel.
+  const uint64_t kNotInKernel = UINT64_MAX;
+
+  // Smaller instance with the same smallest covers, for all rules in
+  // an @Incidence at once.
+  //  - A rule in just one set forces that set into every cover, and
+  //    rules in a forced set are covered by it.
+  //  - Rules in the same sets are the same rule, one of them stands for
+  //    all, with weight the number of rules it stands for. Weights don't
+  //    change which covers are smallest, so solvers can ignore them.
+  //  - A set whose remaining rules are all in some other set is
+  //    dominated and dropped. Sets with the same rules are dominated
+  //    by the one with the largest id, like heap_data breaks ties.
+  // Kernel sets get dense ids of their own, OriginalId maps them back.
+  class Kernel {
+  public:
+    Kernel();
+
+    void Reduce(const Incidence& incidence);
+    // Rules left, in sets left. Caller takes ownership.
+    Incidence* ReleaseIncidence() {
+      return incidence_.release();
+    }
+    // Forced sets, by original id, in increasing order.
+    const vector<SetId>& forced() const {
+      return forced_;
+    }
+    SetId OriginalId(SetId kernel_set_id) const {
+      return set_ids_[kernel_set_id];
+    }
+    // Number of rules kernel rule @kernel_rule_id stands for.
+    uint64_t Weight(uint64_t kernel_rule_id) const {
+      return weights_[kernel_rule_id];
+    }
+    // Kernel rule that rule @rule_id is the same as, kNotInKernel if a
+    // forced set covers it.
+    uint64_t KernelRule(uint64_t rule_id) const {
+      return kernel_rules_[rule_id];
+    }
+    uint64_t num_dominated() const {
+      return num_dominated_;
+    }
+
+  protected:
+    // Sorted sets of @rule_id without duplicates.
+    static vector<SetId> UniqueSets(const Incidence& incidence, uint64_t rule_id);
+
+    unique_ptr<Incidence> incidence_;
+    vector<SetId> forced_;
+    // Indexed by kernel set id.
+    vector<SetId> set_ids_;
+    // Indexed by kernel rule id.
+    vector<uint64_t> weights_;
+    // Indexed by rule id.
+    vector<uint64_t> kernel_rules_;
+    uint64_t num_dominated_;
+  private:
+    friend class KernelTest;
+  };
+
+  // Forced sets and duplicate rules, kept up to date one rule at a
+  // time, for LazySetCover. Kernel rules only ever get added: a rule
+  // goes to the solver unless a set forced by an earlier rule covers
+  // it, or an earlier rule that went to the solver has the same sets.
+  // Rules before the one that forces a set have already gone through,
+  // and dominated sets can stop being dominated by the next rule, so
+  // both are left to Kernel.
+  class IncrementalKernel {
+  public:
+    IncrementalKernel();
+
+    // Adds rule num_rules() in @sets. Returns true if it goes to the
+    // solver as kernel rule num_kernel_rules() - 1.
+    bool AddRule(const vector<SetId>& sets);
+    bool Forced(SetId set_id) const {
+      return set_id < forced_.size() && forced_[set_id];
+    }
+    uint64_t Weight(uint64_t kernel_rule_id) const {
+      return weights_[kernel_rule_id];
+    }
+    uint64_t KernelRule(uint64_t rule_id) const {
+      return kernel_rules_[rule_id];
+    }
+    uint64_t num_rules() const {
+      return kernel_rules_.size();
+    }
+    uint64_t num_kernel_rules() const {
+      return weights_.size();
+    }
+
+  protected:
+    // Indexed by set id.
+    vector<bool> forced_;
+    // Sorted sets of kernel rules, to their kernel rule id.
+    map<vector<SetId>, uint64_t> kernel_rule_ids_;
+    vector<uint64_t> weights_;
+    vector<uint64_t> kernel_rules_;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_KERNEL_H_
@@ -0,0 +1,79 @@
+#include "kernel.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace incremental_atpg {
+  using std::vector;
+
+class KernelTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    incidence_.reset(new Incidence);
+    kernel_.reset(new Kernel);
+  }
+  vector<SetId> Sets(const Incidence& incidence, uint64_t rule_id) {
+    Span<SetId> sets = incidence.SetsOf(rule_id);
+    vector<SetId> original;
+    for (auto set_id : sets) {
+      original.push_back(kernel_->OriginalId(set_id));
+    }
+    return original;
+  }
+  std::unique_ptr<Incidence> incidence_;
+  std::unique_ptr<Kernel> kernel_;
+};
+
+TEST_F(KernelTest, Reduce) {
+  incidence_->AddRule({0, 1});
+  incidence_->AddRule({1, 0});
+  incidence_->AddRule({0, 1, 2});
+  incidence_->AddRule({3, 3});
+  incidence_->AddRule({3, 2});
+  incidence_->AddRule({2, 4});
+  kernel_->Reduce(*incidence_);
+
+  // 3 is forced, covers rules 3 and 4.
+  EXPECT_EQ(vector<SetId>({3}), kernel_->forced());
+  EXPECT_EQ(kNotInKernel, kernel_->KernelRule(3));
+  EXPECT_EQ(kNotInKernel, kernel_->KernelRule(4));
+  // Rules 0 and 1 are the same.
+  EXPECT_EQ(0, kernel_->KernelRule(0));
+  EXPECT_EQ(0, kernel_->KernelRule(1));
+  EXPECT_EQ(2, kernel_->Weight(0));
+  EXPECT_EQ(1, kernel_->KernelRule(2));
+  EXPECT_EQ(2, kernel_->KernelRule(5));
+  // 0 has the same rules as 1, and 4's only rule is in 2.
+  EXPECT_EQ(2, kernel_->num_dominated());
+
+  std::unique_ptr<Incidence> reduced(kernel_->ReleaseIncidence());
+  EXPECT_EQ(3, reduced->num_rules());
+  EXPECT_EQ(2, reduced->num_sets());
+  EXPECT_EQ(vector<SetId>({1}), Sets(*reduced, 0));
+  EXPECT_EQ(vector<SetId>({1, 2}), Sets(*reduced, 1));
+  EXPECT_EQ(vector<SetId>({2}), Sets(*reduced, 2));
+}
+
+TEST(IncrementalKernelTest, AddRule) {
+  IncrementalKernel kernel;
+  EXPECT_TRUE(kernel.AddRule({0, 1}));
+  EXPECT_FALSE(kernel.AddRule({1, 0, 1}));
+  EXPECT_TRUE(kernel.AddRule({2, 1}));
+  // Forces 2, but rule 2 has gone through already.
+  EXPECT_TRUE(kernel.AddRule({2}));
+  EXPECT_TRUE(kernel.Forced(2));
+  EXPECT_FALSE(kernel.Forced(1));
+  EXPECT_FALSE(kernel.AddRule({3, 2}));
+  EXPECT_FALSE(kernel.AddRule({2, 2}));
+
+  EXPECT_EQ(6, kernel.num_rules());
+  EXPECT_EQ(3, kernel.num_kernel_rules());
+  EXPECT_EQ(0, kernel.KernelRule(1));
+  EXPECT_EQ(2, kernel.Weight(0));
+  EXPECT_EQ(kNotInKernel, kernel.KernelRule(4));
+  EXPECT_EQ(kNotInKernel, kernel.KernelRule(5));
+}
+
+}  // namespace incremental_atpg
@@ -0,0 +1,290 @@
+// Measures how long OnlineSetCover takes per rule, the way
+// Evaluate::Compare does, without its logging and with wall-clock
+// time per rule: greedy covers the first rules, then each further
+// rule's AddRule and UpdateCover is timed with steady_clock into a
+// LatencyHistogram.
+//
+// Usage: latency_benchmark [--flag=value ...]
+//   --input=PATH     text or binary rule file, see OpenRuleSource
+//   --generate=N     N rules of RuleGenerator instead, see --sets
+//   --sets=N         sets of generated rules, 3/7 of rules by default
+//   --seed=N         seed of generated rules, 10 by default
+//   --offline=N      rules greedy covers first, 0 by default
+//   --online=N       most rules to add one at a time, all by default
+//   --seconds=S      stop adding after S seconds, checked every sample,
+//                    no limit by default
+//   --sample=N       CSV row every N rules, 1000 by default
+//   --json=PATH      write summary as JSON
+//   --csv=PATH       write latency, cover size and greedy fallbacks
+//                    over time, a row per sample
+//
+// Prints the summary either way.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "log4cxx/basicconfigurator.h"
+#include "greedy_set_cover.h"
+#include "latency_histogram.h"
+#include "online_set_cover.h"
+#include "rule_generator.h"
+#include "rule_source.h"
+#include "util.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::unique_ptr;
+  using std::ofstream;
+  using std::chrono::steady_clock;
+  using std::chrono::duration;
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+
+  struct BenchmarkOptions {
+    string input;
+    uint64_t generate;
+    uint64_t num_sets;
+    uint64_t seed;
+    uint64_t offline;
+    uint64_t online;
+    double seconds;
+    uint64_t sample;
+    string json;
+    string csv;
+  BenchmarkOptions()
+  : generate(0),
+      num_sets(0),
+      seed(10),
+      offline(0),
+      online(UINT64_MAX),
+      seconds(0.0),
+      sample(1000) { }
+  };
+
+  // Sets @options from "--name=value" arguments. Returns false, and
+  // says why, on one it doesn't know.
+  static bool ParseFlags(int argc, char** argv, BenchmarkOptions* options) {
+    for (int i = 1; i < argc; i++) {
+      string arg = argv[i];
+      string::size_type equals = arg.find('=');
+      if (arg.compare(0, 2, "--") != 0 || equals == string::npos) {
+	fprintf(stderr, "Expected --flag=value, got %s\n", argv[i]);
+	return false;
+      }
+      string name = arg.substr(2, equals - 2);
+      string value = arg.substr(equals + 1);
+      uint64_t number = strtoull(value.c_str(), nullptr, 10);
+      if (name == "input") {
+	options->input = value;
+      } else if (name == "generate") {
+	options->generate = number;
+      } else if (name == "sets") {
+	options->num_sets = number;
+      } else if (name == "seed") {
+	options->seed = number;
+      } else if (name == "offline") {
+	options->offline = number;
+      } else if (name == "online") {
+	options->online = number;
+      } else if (name == "seconds") {
+	options->seconds = strtod(value.c_str(), nullptr);
+      } else if (name == "sample") {
+	options->sample = std::max<uint64_t>(1, number);
+      } else if (name == "json") {
+	options->json = value;
+      } else if (name == "csv") {
+	options->csv = value;
+      } else {
+	fprintf(stderr, "Unknown flag --%s\n", name.c_str());
+	return false;
+      }
+    }
+    if (options->input.empty() == (options->generate == 0)) {
+      fprintf(stderr, "Need one of --input and --generate\n");
+      return false;
+    }
+    return true;
+  }
+
+  // What one run of the benchmark saw.
+  struct BenchmarkResult {
+    uint64_t offline_rules;
+    double offline_seconds;
+    uint64_t online_rules;
+    double online_seconds;
+    uint64_t greedy_fallbacks;
+    uint64_t cover_size;
+    LatencyHistogram latency;
+  BenchmarkResult()
+  : offline_rules(0),
+      offline_seconds(0.0),
+      online_rules(0),
+      online_seconds(0.0),
+      greedy_fallbacks(0),
+      cover_size(0) { }
+  };
+
+  static double Seconds(steady_clock::time_point begin) {
+    return duration<double>(steady_clock::now() - begin).count();
+  }
+
+  // Runs benchmark on rules of @source, writing a row to @csv, if
+  // it's open, every @options.sample rules.
+  static void Run(const BenchmarkOptions& options, RuleSource* source,
+		  ofstream* csv, BenchmarkResult* result) {
+    steady_clock::time_point begin = steady_clock::now();
+    unique_ptr<OnlineSetCover> online;
+    if (options.offline > 0) {
+      GreedySetCover greedy;
+      result->offline_rules = greedy.IngestRules(source, options.offline);
+      greedy.UpdateCover();
+      online.reset(new OnlineSetCover(greedy.ReleaseSetNames(),
+				      greedy.ReleaseIncidence(),
+				      greedy.ReleaseSetProcessingInfos(),
+				      greedy.ReleaseRuleProcessingInfos(),
+				      greedy.ReleaseCover()));
+    } else {
+      online.reset(new OnlineSetCover);
+    }
+    result->offline_seconds = Seconds(begin);
+
+    if (csv->is_open()) {
+      *csv << "rules,seconds,cover_size,greedy_fallbacks,p50_ns,p99_ns,max_ns\n";
+    }
+    // Latencies since the last row.
+    LatencyHistogram window;
+    vector<string> rule;
+    begin = steady_clock::now();
+    while (result->online_rules < options.online && source->NextRule(&rule)) {
+      if (rule.empty()) {
+	continue;
+      }
+      steady_clock::time_point start = steady_clock::now();
+      online->AddRule(rule);
+      online->UpdateCover();
+      uint64_t nanos = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+      result->latency.Record(nanos);
+      window.Record(nanos);
+      ++result->online_rules;
+      if (result->online_rules % options.sample == 0) {
+	double seconds = Seconds(begin);
+	if (csv->is_open()) {
+	  *csv << result->online_rules << "," << seconds << ","
+	       << online->GetCover().size() << ","
+	       << online->num_greedy_updates() << ","
+	       << window.ValueAt(0.5) << "," << window.ValueAt(0.99) << ","
+	       << window.max() << "\n";
+	}
+	window.Clear();
+	if (options.seconds > 0.0 && seconds >= options.seconds) {
+	  break;
+	}
+      }
+    }
+    result->online_seconds = Seconds(begin);
+    result->greedy_fallbacks = online->num_greedy_updates();
+    result->cover_size = online->GetCover().size();
+  }
+
+  // @value quoted, with quotes and backslashes in it escaped.
+  static string JsonString(const string& value) {
+    string quoted = "\"";
+    for (auto c : value) {
+      if (c == '"' || c == '\\') {
+	quoted.push_back('\\');
+      }
+      quoted.push_back(c);
+    }
+    return quoted + "\"";
+  }
+
+  static void WriteJson(const BenchmarkOptions& options,
+			const BenchmarkResult& result, ofstream* out) {
+    const LatencyHistogram& latency = result.latency;
+    *out << "{\n"
+	 << "  \"input\": " << JsonString(options.input) << ",\n"
+	 << "  \"generate\": " << options.generate << ",\n"
+	 << "  \"offline_rules\": " << result.offline_rules << ",\n"
+	 << "  \"offline_seconds\": " << result.offline_seconds << ",\n"
+	 << "  \"online_rules\": " << result.online_rules << ",\n"
+	 << "  \"online_seconds\": " << result.online_seconds << ",\n"
+	 << "  \"rules_per_second\": "
+	 << (result.online_seconds > 0.0 ? result.online_rules / result.online_seconds : 0.0)
+	 << ",\n"
+	 << "  \"greedy_fallbacks\": " << result.greedy_fallbacks << ",\n"
+	 << "  \"cover_size\": " << result.cover_size << ",\n"
+	 << "  \"latency_ns\": {\"mean\": " << latency.mean()
+	 << ", \"p50\": " << latency.ValueAt(0.5)
+	 << ", \"p99\": " << latency.ValueAt(0.99)
+	 << ", \"p999\": " << latency.ValueAt(0.999)
+	 << ", \"max\": " << latency.max() << "}\n"
+	 << "}\n";
+  }
+}  // namespace incremental_atpg
+
+int main(int argc, char** argv) {
+  using namespace incremental_atpg;
+  log4cxx::BasicConfigurator::configure();
+  log4cxx::Logger::getRootLogger()->setLevel(log4cxx::Level::getError());
+  BenchmarkOptions options;
+  if (!ParseFlags(argc, argv, &options)) {
+    return 2;
+  }
+
+  unique_ptr<RuleGenerator> generator;
+  unique_ptr<RuleSource> source;
+  if (options.generate > 0) {
+    uint64_t num_sets = options.num_sets > 0 ? options.num_sets
+      : options.generate * 3 / 7 + 1;
+    generator.reset(new RuleGenerator(options.generate, num_sets, 200,
+				      Util::zipf_1, options.seed));
+    source.reset(generator->NewRuleSource());
+  } else {
+    source.reset(OpenRuleSource(options.input));
+  }
+  if (source.get() == nullptr) {
+    fprintf(stderr, "Can't read rules from %s\n", options.input.c_str());
+    return 1;
+  }
+
+  ofstream csv;
+  if (!options.csv.empty()) {
+    csv.open(options.csv.c_str());
+    if (!csv.good()) {
+      fprintf(stderr, "Can't write %s\n", options.csv.c_str());
+      return 1;
+    }
+  }
+  BenchmarkResult result;
+  Run(options, source.get(), &csv, &result);
+
+  const LatencyHistogram& latency = result.latency;
+  printf("offline: %lu rules, %.3f s\n", (unsigned long) result.offline_rules,
+	 result.offline_seconds);
+  printf("online: %lu rules, %.3f s, %.1f rules/s\n",
+	 (unsigned long) result.online_rules, result.online_seconds,
+	 result.online_seconds > 0.0 ? result.online_rules / result.online_seconds : 0.0);
+  printf("latency us: mean %.1f p50 %.1f p99 %.1f p999 %.1f max %.1f\n",
+	 latency.mean() / 1000, latency.ValueAt(0.5) / 1000.0,
+	 latency.ValueAt(0.99) / 1000.0, latency.ValueAt(0.999) / 1000.0,
+	 latency.max() / 1000.0);
+  printf("greedy fallbacks: %lu, cover size: %lu\n",
+	 (unsigned long) result.greedy_fallbacks, (unsigned long) result.cover_size);
+  if (!options.json.empty()) {
+    ofstream json(options.json.c_str());
+    WriteJson(options, result, &json);
+    if (!json.good()) {
+      fprintf(stderr, "Can't write %s\n", options.json.c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,84 @@
+#include "latency_histogram.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+
+  static const uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+  static const uint64_t kHalfSubBuckets = kSubBuckets / 2;
+  // Values under kSubBuckets, then half as many for each shift up to
+  // the top bit.
+  static const uint64_t kNumBuckets =
+    kSubBuckets + (64 - kSubBucketBits) * kHalfSubBuckets;
+
+  LatencyHistogram::LatencyHistogram()
+    : counts_(kNumBuckets, 0),
+      count_(0),
+      min_(UINT64_MAX),
+      max_(0),
+      sum_(0) {
+  }
+
+  uint64_t LatencyHistogram::BucketOf(uint64_t value) {
+    if (value < kSubBuckets) {
+      return value;
+    }
+    // Shift that leaves value in [kHalfSubBuckets, kSubBuckets).
+    unsigned shift = 64 - __builtin_clzll(value) - kSubBucketBits;
+    return kSubBuckets + (shift - 1) * kHalfSubBuckets
+      + ((value >> shift) - kHalfSubBuckets);
+  }
+
+  uint64_t LatencyHistogram::BucketEnd(uint64_t bucket) {
+    if (bucket < kSubBuckets) {
+      return bucket;
+    }
+    uint64_t shift = (bucket - kSubBuckets) / kHalfSubBuckets + 1;
+    uint64_t first = kHalfSubBuckets + (bucket - kSubBuckets) % kHalfSubBuckets;
+    return ((first + 1) << shift) - 1;
+  }
+
+  void LatencyHistogram::Record(uint64_t value) {
+    ++counts_[BucketOf(value)];
+    ++count_;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += value;
+  }
+
+  void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (uint64_t bucket = 0; bucket < kNumBuckets; bucket++) {
+      counts_[bucket] += other.counts_[bucket];
+    }
+    count_ += other.count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+  }
+
+  void LatencyHistogram::Clear() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = sum_ = max_ = 0;
+    min_ = UINT64_MAX;
+  }
+
+  uint64_t LatencyHistogram::ValueAt(double quantile) const {
+    if (count_ == 0) {
+      return 0;
+    }
+    // Rank of the value, from 1.
+    uint64_t rank = std::max<uint64_t>(1, std::ceil(quantile * count_));
+    uint64_t seen = 0;
+    for (uint64_t bucket = 0; bucket < kNumBuckets; bucket++) {
+      seen += counts_[bucket];
+      if (seen >= rank) {
+	return std::min(BucketEnd(bucket), max_);
+      }
+    }
+    return max_;
+  }
+}  // namespace incremental_atpg
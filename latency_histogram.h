@@ -0,0 +1,60 @@
+#ifndef INCREMENTAL_ATPG_LATENCY_HISTOGRAM_H_
+#define INCREMENTAL_ATPG_LATENCY_HISTOGRAM_H_
+#include <vector>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+
+namespace incremental_atpg {
+  using std::vector;
+
+  // Buckets under 2^kSubBucketBits are 1 wide, so values are kept to
+  // within 1 / 2^(kSubBucketBits - 1) of what they were.
+  const unsigned kSubBucketBits = 8;
+
+  // Counts of values, e.g., latencies in nanoseconds, in buckets that
+  // get twice as wide with every power of 2, HdrHistogram style, so
+  // any quantile is within 1% of the exact one, from nanoseconds to
+  // hours, in about 60 KB, and Record is a couple of shifts.
+  class LatencyHistogram {
+  public:
+    LatencyHistogram();
+
+    void Record(uint64_t value);
+    // Adds counts of @other, e.g., of another thread or interval.
+    void Merge(const LatencyHistogram& other);
+    void Clear();
+    // Smallest value that @quantile of recorded values, e.g., 0.99,
+    // are at or below, i.e., the ceil(@quantile * count())th smallest,
+    // rounded up to the end of its bucket, but not past max(). 0 if
+    // nothing was recorded.
+    uint64_t ValueAt(double quantile) const;
+    uint64_t count() const {
+      return count_;
+    }
+    uint64_t min() const {
+      return count_ == 0 ? 0 : min_;
+    }
+    uint64_t max() const {
+      return max_;
+    }
+    double mean() const {
+      return count_ == 0 ? 0.0 : double(sum_) / count_;
+    }
+
+  protected:
+    static uint64_t BucketOf(uint64_t value);
+    // Largest value in @bucket.
+    static uint64_t BucketEnd(uint64_t bucket);
+
+    vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t min_;
+    uint64_t max_;
+    uint64_t sum_;
+  private:
+    friend class LatencyHistogramTest;
+    FRIEND_TEST(LatencyHistogramTest, Buckets);
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_LATENCY_HISTOGRAM_H_
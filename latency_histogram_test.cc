@@ -0,0 +1,71 @@
+#include "latency_histogram.h"
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+
+namespace incremental_atpg {
+
+class LatencyHistogramTest : public testing::Test {
+};
+
+TEST_F(LatencyHistogramTest, Buckets) {
+  // Small values get a bucket each.
+  for (uint64_t value = 0; value < 256; value++) {
+    EXPECT_EQ(value, LatencyHistogram::BucketOf(value));
+    EXPECT_EQ(value, LatencyHistogram::BucketEnd(value));
+  }
+  // Every value falls in a bucket that ends at or after it, within 1%,
+  // and buckets follow each other.
+  uint64_t last_bucket = 255;
+  for (uint64_t value = 256; value < (1 << 20); value++) {
+    uint64_t bucket = LatencyHistogram::BucketOf(value);
+    ASSERT_TRUE(bucket == last_bucket || bucket == last_bucket + 1);
+    ASSERT_GE(LatencyHistogram::BucketEnd(bucket), value);
+    ASSERT_LE(LatencyHistogram::BucketEnd(bucket) - value, value / 128);
+    last_bucket = bucket;
+  }
+  uint64_t top = LatencyHistogram::BucketOf(UINT64_MAX);
+  EXPECT_EQ(LatencyHistogram().counts_.size() - 1, top);
+  EXPECT_EQ(UINT64_MAX, LatencyHistogram::BucketEnd(top));
+}
+
+TEST_F(LatencyHistogramTest, ValueAt) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.ValueAt(0.5));
+  for (uint64_t value = 1; value <= 100000; value++) {
+    histogram.Record(value);
+  }
+  EXPECT_EQ(100000, histogram.count());
+  EXPECT_EQ(1, histogram.min());
+  EXPECT_EQ(100000, histogram.max());
+  EXPECT_DOUBLE_EQ(50000.5, histogram.mean());
+  EXPECT_NEAR(50000, histogram.ValueAt(0.5), 50000 / 128);
+  EXPECT_NEAR(99000, histogram.ValueAt(0.99), 99000 / 128);
+  EXPECT_NEAR(99900, histogram.ValueAt(0.999), 99900 / 128);
+  EXPECT_EQ(100000, histogram.ValueAt(1.0));
+  EXPECT_EQ(1, histogram.ValueAt(0.0));
+
+  // One outlier shows at the top only.
+  LatencyHistogram other;
+  other.Record(uint64_t(3600) * 1000000000);
+  histogram.Merge(other);
+  EXPECT_EQ(100001, histogram.count());
+  EXPECT_EQ(uint64_t(3600) * 1000000000, histogram.max());
+  EXPECT_NEAR(99000, histogram.ValueAt(0.99), 99000 / 128);
+
+  histogram.Clear();
+  EXPECT_EQ(0, histogram.count());
+  EXPECT_EQ(0, histogram.ValueAt(0.99));
+  histogram.Record(7);
+  EXPECT_EQ(7, histogram.min());
+  EXPECT_EQ(7, histogram.ValueAt(0.5));
+
+  // Rank is rounded up: the median of 1, 2 is 1, anything above is 2.
+  histogram.Clear();
+  histogram.Record(1);
+  histogram.Record(2);
+  EXPECT_EQ(1, histogram.ValueAt(0.5));
+  EXPECT_EQ(2, histogram.ValueAt(0.51));
+  EXPECT_EQ(2, histogram.ValueAt(0.75));
+}
+}  // namespace incremental_atpg
@@ -18,125 +18,117 @@ namespace incremental_atpg {
   using std::vector;
   using std::list;
   using std::string;
-  using std::strcmp;
   using std::unique_ptr;
   using std::map;
   using std::make_pair;
   using std::pair;
-  using std::bind;
   using std::sort;
   using std::unique;
+  using std::find;
 
   using log4cxx::LoggerPtr;
   using log4cxx::Logger;
   using log4cxx::Level;
 
   LazySetCover::LazySetCover()
-    : cover_order_ (new map<string, uint64_t>) {
+    : last_rule_in_kernel_(false) {
     lazy_set_cover_logger = Logger::getLogger("LazySetCover");
     lazy_set_cover_logger->setLevel(log4cxx::Level::getWarn());
   }
 
-  LazySetCover::LazySetCover(map<string, SetInfo>* set_infos,
-			       vector<RuleInfo>* rule_infos)
-    : SetCover(set_infos, rule_infos),
-      cover_order_ (new map<string, uint64_t>) {
+  LazySetCover::LazySetCover(SymbolTable* set_names,
+			     Incidence* incidence)
+    : SetCover(set_names, incidence),
+      last_rule_in_kernel_(false) {
     lazy_set_cover_logger = Logger::getLogger("LazySetCover");
     lazy_set_cover_logger->setLevel(log4cxx::Level::getWarn());
   }
 
-  LazySetCover::LazySetCover(map<string, SetInfo>* set_infos,
-			     vector<RuleInfo>* rule_infos,
-			     map<string, SetProcessingInfo>* set_processing_infos,
+  LazySetCover::LazySetCover(SymbolTable* set_names,
+			     Incidence* incidence,
+			     vector<SetProcessingInfo>* set_processing_infos,
 			     vector<RuleProcessingInfo>* rule_processing_infos,
-			     list<string>* cover)
-    : SetCover(set_infos, rule_infos, set_processing_infos, 
+			     OrderList* cover)
+    : SetCover(set_names, incidence, set_processing_infos, 
 	       rule_processing_infos, cover),
-      cover_order_ (new map<string, uint64_t>) {
+      last_rule_in_kernel_(false) {
     lazy_set_cover_logger = Logger::getLogger("LazySetCover");
     lazy_set_cover_logger->setLevel(log4cxx::Level::getWarn());
+    RebuildCoverCounts();
   }  
 
 
-  string LazySetCover::InsertNewSet(pair<string, uint64_t> best_move_up) {
-    if (best_move_up.first.empty()) {
-      LOG4CXX_ERROR(lazy_set_cover_logger, "Set name to insert, is empty.");
-      return "";
+  SetId LazySetCover::InsertNewSet(pair<SetId, uint64_t> best_move_up,
+				   SetId before_set) {
+    if (best_move_up.first == kNoSet) {
+      LOG4CXX_ERROR(lazy_set_cover_logger, "Set to insert, is kNoSet.");
+      return kNoSet;
     }
 
-    string tmp_set_name = best_move_up.first + string("_tmp");
-
-    // Insert in set_infos_
-    SetInfo tmp_info = set_infos_->at(best_move_up.first);
-    set_infos_->insert(make_pair(tmp_set_name, tmp_info));
+    if (set_processing_infos_->size() < incidence_->num_sets()) {
+      set_processing_infos_->resize(incidence_->num_sets());
+    }
+    SetId tmp_set_id = set_processing_infos_->size();
 
     // Insert in set_processing_infos_
     SetProcessingInfo tmp_sp;
-    for (auto rule : tmp_info.all_rules) {
-      if (rule != rule_infos_->size() - 1) {
+    uint64_t last_rule = incidence_->num_rules() - 1;
+    for (auto rule : incidence_->RulesOf(best_move_up.first)) {
+      if (rule != last_rule) {
 	tmp_sp.AddRule(rule);
       }
     }
-    set_processing_infos_->insert(make_pair(tmp_set_name, tmp_sp));
+    tmp_sp.in_cover = true;
+    set_processing_infos_->push_back(tmp_sp);
 
-    // Insert in cover_ and cover_order_
-    if (best_move_up.second == 0) {
-      cover_order_->insert(make_pair(tmp_set_name, cover_->size()));
-      cover_->push_back(tmp_set_name);
+    // Insert in cover_, before the first set with as many uncovered
+    // rules. Sets before @before_set with no rules of their own have
+    // as many too.
+    if (best_move_up.second == 0 || !cover_->Contains(before_set)) {
+      before_set = kNoSet;
     } else {
-      uint64_t order = 0;
-      list<string>::iterator it;
-      for (it = cover_->begin(); it != cover_->end(); it++) {
-	if (set_processing_infos_->at(*it).num_uncovered 
-	    == best_move_up.second) {
-	  cover_->insert(it, tmp_set_name);
-	  cover_order_->insert(make_pair(tmp_set_name, order + 0.5));
-	  break;
-	}
-	++order;
+      SetId prev = cover_->Prev(before_set);
+      while (prev != kNoSet && NumUncovered(prev) == best_move_up.second) {
+	before_set = prev;
+	prev = cover_->Prev(before_set);
       }
     }
-    return tmp_set_name;
+    cover_->InsertBefore(before_set, tmp_set_id);
+    cover_counts_.InsertBefore(before_set, tmp_set_id, tmp_sp.GetNumRules());
+    return tmp_set_id;
     
   }
 
-  string LazySetCover::FirstSetThatCoversLastRule() {
-    string first_set_that;
-    set<string> last_rule_in_sets = 
-      set<string>(rule_infos_->back().all_sets.begin(),
-		  rule_infos_->back().all_sets.end());
+  SetId LazySetCover::FirstSetThatCoversLastRule() {
+    SetId first_set_that = kNoSet;
+    Span<SetId> last_rule_in_sets = incidence_->SetsOf(incidence_->num_rules() - 1);
     
-    for (auto set_name : *cover_.get()) {
-      if (last_rule_in_sets.find(set_name) != 
-	  last_rule_in_sets.end()) {
-	first_set_that = set_name;
+    for (auto set_id : *cover_.get()) {
+      if (find(last_rule_in_sets.begin(), last_rule_in_sets.end(), set_id)
+	  != last_rule_in_sets.end()) {
+	first_set_that = set_id;
 	break;
       }
     }
-    if (first_set_that.empty()) {
+    if (first_set_that == kNoSet) {
       LOG4CXX_ERROR(lazy_set_cover_logger, "Can't find any set in cover with last rule.");
     }
     return first_set_that;
   }
 
-  void LazySetCover::ResetProcessingInfo() {
-      MakeCoverOrderMap();
-      SetCover::ResetProcessingInfo();
-  }
-  void LazySetCover::UpdateCoverRules(string last_rule_covered_by) {
-    uint64_t last_rule = rule_infos_->size() - 1;
-    if (set_processing_infos_->find(last_rule_covered_by)
-	== set_processing_infos_->end()) {
+  void LazySetCover::UpdateCoverRules(SetId last_rule_covered_by) {
+    uint64_t last_rule = incidence_->num_rules() - 1;
+    if (!InCover(last_rule_covered_by)) {
       LOG4CXX_ERROR(lazy_set_cover_logger, "Set not in @set_processing_infos_");
       return;
     }
-    SetProcessingInfo& sp = set_processing_infos_->operator[](last_rule_covered_by);
+    SetProcessingInfo& sp = set_processing_infos_->at(last_rule_covered_by);
     sp.AddRule(last_rule);
+    changed_sets_.push_back(last_rule_covered_by);
 
-    if (cover_order_->find(last_rule_covered_by)
-	== cover_order_->end()) {
+    if (!InCoverOrder(last_rule_covered_by)) {
 	LOG4CXX_ERROR(lazy_set_cover_logger, "Set "
-		      << last_rule_covered_by << " not in @cover_order_");
+		      << last_rule_covered_by << " not in @cover_");
 	return;
       } 
 
@@ -152,25 +144,24 @@ namespace incremental_atpg {
 	continue;
     }
 
-      const string& now_covered_by = rule_processing_infos_->at(rule_id).first_covered_by;
-      if (cover_order_->find(now_covered_by)
-	== cover_order_->end()) {
-	LOG4CXX_ERROR(lazy_set_cover_logger, "Set not in @cover_order_");
+      SetId now_covered_by = rule_processing_infos_->at(rule_id).first_covered_by;
+      if (!InCoverOrder(now_covered_by)) {
+	LOG4CXX_ERROR(lazy_set_cover_logger, "Set not in @cover_");
 	continue;
       } 
       if (now_covered_by != last_rule_covered_by) {
-	if (cover_order_->at(now_covered_by) < cover_order_->at(last_rule_covered_by)) {
+	if (cover_->Precedes(now_covered_by, last_rule_covered_by)) {
 	  sp.RemoveRule(rule_id);
 	} else {
-	  if (set_processing_infos_->find(now_covered_by)
-	      == set_processing_infos_->end()) {
+	  if (!InCover(now_covered_by)) {
 	    LOG4CXX_ERROR(lazy_set_cover_logger, "Set " << now_covered_by
 			  << " not in @set_processing_infos_");
 	    continue;
 	  } 
 
-	  SetProcessingInfo& other_sp = set_processing_infos_->operator[](now_covered_by);
+	  SetProcessingInfo& other_sp = set_processing_infos_->at(now_covered_by);
 	  other_sp.RemoveRule(rule_id);
+	  changed_sets_.push_back(now_covered_by);
 	  rule_processing_infos_->operator[](rule_id).first_covered_by
 	    = last_rule_covered_by;
 	}
@@ -178,97 +169,271 @@ namespace incremental_atpg {
     }
   }
 
-  void LazySetCover::FixNumUncoveredUsingCoverRules(set<string>* empty_sets) {
+  void LazySetCover::UpdateCoverCounts(set<SetId>* empty_sets) {
     empty_sets->clear();
-    uint64_t num_uncovered = rule_infos_->size();
-    for (auto set_name : *cover_) {
-        SetProcessingInfo& tmp = set_processing_infos_->operator[](set_name);
-	tmp.num_uncovered = num_uncovered;
-	num_uncovered -= tmp.GetNumRules();
-	if (tmp.GetNumRules() == 0) {
-	  empty_sets->insert(set_name);
-	}
+    for (auto set_id : changed_sets_) {
+      if (!cover_counts_.Contains(set_id)) {
+	continue;
+      }
+      const SetProcessingInfo& tmp = set_processing_infos_->at(set_id);
+      cover_counts_.Set(set_id, tmp.GetNumRules());
+      if (tmp.GetNumRules() == 0) {
+	empty_sets->insert(set_id);
+      }
     }
+    changed_sets_.clear();
   }
 
-  void LazySetCover::CleanUpEmptySets(const set<string>& empty_sets) {
-      using std::placeholders::_1;
-      auto check_empty = [&] (const string& set_name) { 
-	return empty_sets.find(set_name) != empty_sets.end();};
-      cover_->remove_if(check_empty);
-      for (auto set_name : empty_sets) {
-	set_processing_infos_->erase(set_name);
-	cover_order_->erase(set_name);
+  void LazySetCover::RebuildCoverCounts() {
+    cover_counts_.clear();
+    changed_sets_.clear();
+    for (auto set_id : *cover_) {
+      uint64_t num_rules = 0;
+      if (set_id < set_processing_infos_->size()) {
+	num_rules = set_processing_infos_->at(set_id).GetNumRules();
       }
+      cover_counts_.push_back(set_id, num_rules);
+      if (num_rules == 0) {
+	changed_sets_.push_back(set_id);
+      }
+    }
   }
 
-  void LazySetCover::ChangeSetName(const string& tmp_set_name,
-				   const string& real_set_name) {
+  void LazySetCover::ResetProcessingInfo() {
+    SetCover::ResetProcessingInfo();
+    RebuildCoverCounts();
+  }
 
-    // Change in cover. Make sure cover doesn't have @real_set_name.
-    list<string>::iterator it;
-    for (it = cover_->begin(); it != cover_->end(); it++) {
-      if (*it == tmp_set_name) {
-	break;
-      }
+  bool LazySetCover::LoadState(SnapshotReader* reader) {
+    if (!SetCover::LoadState(reader)) {
+      return false;
     }
-    auto new_it = cover_->insert(it, real_set_name);
-    cover_->erase(++new_it);
+    RebuildCoverCounts();
+    return true;
+  }
+
+  void LazySetCover::CleanUpEmptySets(const set<SetId>& empty_sets) {
+      for (auto set_id : empty_sets) {
+	cover_->Erase(set_id);
+	cover_counts_.Erase(set_id);
+	if (set_id < set_processing_infos_->size()) {
+	  set_processing_infos_->at(set_id) = SetProcessingInfo();
+	}
+      }
+  }
+
+  void LazySetCover::ChangeSetName(SetId tmp_set_id,
+				   SetId real_set_id) {
+
+    // Change in cover, in place. Make sure cover doesn't have
+    // @real_set_id.
+    cover_->Erase(real_set_id);
+    cover_->Replace(tmp_set_id, real_set_id);
+    cover_counts_.Erase(real_set_id);
+    cover_counts_.Replace(tmp_set_id, real_set_id);
+
+    uint64_t num_slots = std::max<uint64_t>(set_processing_infos_->size(), real_set_id + 1);
+    set_processing_infos_->resize(num_slots);
 
     // Change/ replace in @set_processing_infos_.
-    SetProcessingInfo sp = set_processing_infos_->at(tmp_set_name);
-    set_processing_infos_->erase(tmp_set_name);
-    set_processing_infos_->operator[](real_set_name) = sp;
+    set_processing_infos_->at(real_set_id) = set_processing_infos_->at(tmp_set_id);
+    set_processing_infos_->at(tmp_set_id) = SetProcessingInfo();
+    const SetProcessingInfo& sp = set_processing_infos_->at(real_set_id);
 
     // Change in @rule_processing_infos_.
-    for (auto rule_id: sp.GetRules()) {
-      // TODO(lav): Check it was tmp_set_name before.
+    for (auto rule_id: sp.covers_rules) {
+      // TODO(lav): Check it was tmp_set_id before.
       rule_processing_infos_->operator[](rule_id)
-	= RuleProcessingInfo(real_set_name);
+	= RuleProcessingInfo(real_set_id);
     }
 
-    // Change/ replace in @set_infos_.
-    SetInfo info = set_infos_->at(tmp_set_name);
-    set_infos_->erase(tmp_set_name);
-    set_infos_->operator[](real_set_name) = info;
-
-    // Change/ replace in @cover_order_.
-    double order = cover_order_->at(tmp_set_name);
-    cover_order_->erase(tmp_set_name);
-    cover_order_->operator[](real_set_name) = order;
+    // Temporary sets live past the last set, drop the slot.
+    if (tmp_set_id + 1 == set_processing_infos_->size()
+	&& tmp_set_id >= incidence_->num_sets()) {
+      set_processing_infos_->pop_back();
+    }
   }
 
-  void LazySetCover::GetBestSetToMoveUp(pair<string, uint64_t>* best_move_up) {
-    const vector<string>& move_up_sets = rule_infos_->back().all_sets;
-    *best_move_up = make_pair("", 0);
+  void LazySetCover::GetBestSetToMoveUp(pair<SetId, uint64_t>* best_move_up,
+					SetId* before_set) {
+    Span<SetId> move_up_sets = incidence_->SetsOf(incidence_->num_rules() - 1);
+    *best_move_up = make_pair(kNoSet, 0);
+    *before_set = kNoSet;
     uint64_t before_uncovered = 0;
-    for (auto set_name : move_up_sets) {
-      if (WhereWouldSetGo(set_name, &before_uncovered)) {
-	if (best_move_up->first.empty() ||
+    SetId set_before = kNoSet;
+    for (auto set_id : move_up_sets) {
+      if (WhereWouldSetGo(set_id, &before_uncovered, &set_before)) {
+	if (best_move_up->first == kNoSet ||
 	    (before_uncovered > best_move_up->second) ||
 	    (before_uncovered == best_move_up->second &&
-	     strcmp(best_move_up->first.c_str(), set_name.c_str()) < 0)) {
-	  best_move_up->first = set_name;
+	     best_move_up->first < set_id)) {
+	  best_move_up->first = set_id;
 	  best_move_up->second = before_uncovered;
+	  *before_set = set_before;
 	}
       }
     }
   }
 
+  void LazySetCover::AddRule(const vector<string>& sets) {
+    if (kernel_.get() == nullptr) {
+      SetCover::AddRule(sets);
+      return;
+    }
+    vector<SetId> set_ids = InternSets(sets);
+    last_rule_in_kernel_ = kernel_->AddRule(set_ids);
+    if (last_rule_in_kernel_) {
+      AddRuleToIncidence(set_ids);
+    }
+  }
+
+  bool LazySetCover::RemoveRule(const vector<string>& sets) {
+    vector<SetId> set_ids;
+    return FindSetIds(sets, &set_ids) && RemoveRuleFromCover(set_ids);
+  }
+
+  bool LazySetCover::RemoveRuleFromCover(const vector<SetId>& set_ids) {
+    if (kernel_.get() != nullptr) {
+      LOG4CXX_WARN(lazy_set_cover_logger, "Can't remove rules with a kernel.");
+      return false;
+    }
+    SetId covered_by = kNoSet;
+    if (!RemoveRuleFromIncidence(set_ids, &covered_by)) {
+      return false;
+    }
+    if (cover_counts_.size() != cover_->size()) {
+      RebuildCoverCounts();
+    }
+    // Only the set that covered it first covers fewer rules, everyone
+    // after it has one less uncovered rule before it.
+    if (covered_by != kNoSet) {
+      changed_sets_.push_back(covered_by);
+    }
+    set<SetId> empty_sets;
+    UpdateCoverCounts(&empty_sets);
+    CleanUpEmptySets(empty_sets);
+    return true;
+  }
+
+  bool LazySetCover::AddToSet(const vector<string>& rule_sets,
+			      const string& set_name) {
+    vector<SetId> set_ids;
+    return FindSetIds(rule_sets, &set_ids)
+      && AddToSetInCover(set_ids, set_names_->Intern(set_name));
+  }
+
+  bool LazySetCover::RemoveFromSet(const vector<string>& rule_sets,
+				   const string& set_name) {
+    vector<SetId> set_ids;
+    SetId set_id = kNoSet;
+    return FindSetIds(rule_sets, &set_ids)
+      && set_names_->Find(set_name, &set_id)
+      && RemoveFromSetInCover(set_ids, set_id);
+  }
+
+  bool LazySetCover::AddToSetInCover(const vector<SetId>& rule_sets,
+				     SetId set_id) {
+    if (kernel_.get() != nullptr) {
+      LOG4CXX_WARN(lazy_set_cover_logger, "Can't change rules with a kernel.");
+      return false;
+    }
+    uint64_t rule_id = incidence_->FindRule(rule_sets);
+    if (rule_id == kNoRule || rule_id >= rule_processing_infos_->size()
+	|| !incidence_->AddMembership(rule_id, set_id)) {
+      return false;
+    }
+    if (set_processing_infos_->size() < incidence_->num_sets()) {
+      set_processing_infos_->resize(incidence_->num_sets());
+    }
+    if (cover_counts_.size() != cover_->size()) {
+      RebuildCoverCounts();
+    }
+    SetId covered_by = rule_processing_infos_->at(rule_id).first_covered_by;
+    if (InCover(set_id) && InCoverOrder(set_id)
+	&& (!InCoverOrder(covered_by) || cover_->Precedes(set_id, covered_by))) {
+      MoveRuleTo(rule_id, set_id);
+      set<SetId> empty_sets;
+      UpdateCoverCounts(&empty_sets);
+      CleanUpEmptySets(empty_sets);
+    }
+    return true;
+  }
+
+  bool LazySetCover::RemoveFromSetInCover(const vector<SetId>& rule_sets,
+					  SetId set_id) {
+    if (kernel_.get() != nullptr) {
+      LOG4CXX_WARN(lazy_set_cover_logger, "Can't change rules with a kernel.");
+      return false;
+    }
+    uint64_t rule_id = incidence_->FindRule(rule_sets);
+    if (rule_id == kNoRule || rule_id >= rule_processing_infos_->size()
+	|| !incidence_->RemoveMembership(rule_id, set_id)) {
+      return false;
+    }
+    if (cover_counts_.size() != cover_->size()) {
+      RebuildCoverCounts();
+    }
+    if (rule_processing_infos_->at(rule_id).first_covered_by != set_id) {
+      return true;
+    }
+    Span<SetId> sets = incidence_->SetsOf(rule_id);
+    SetId first = kNoSet;
+    for (auto other_set_id : sets) {
+      if (InCover(other_set_id) && InCoverOrder(other_set_id)
+	  && (first == kNoSet || cover_->Precedes(other_set_id, first))) {
+	first = other_set_id;
+      }
+    }
+    set<SetId> empty_sets;
+    if (first != kNoSet) {
+      MoveRuleTo(rule_id, first);
+      UpdateCoverCounts(&empty_sets);
+      CleanUpEmptySets(empty_sets);
+      return true;
+    }
+    // No set in cover has it, so it's a new rule now.
+    vector<SetId> set_ids(sets.begin(), sets.end());
+    changed_sets_.push_back(RemoveRuleWithId(rule_id));
+    UpdateCoverCounts(&empty_sets);
+    CleanUpEmptySets(empty_sets);
+    AddRuleToIncidence(set_ids);
+    UpdateCover();
+    return true;
+  }
+
+  void LazySetCover::MoveRuleTo(uint64_t rule_id, SetId set_id) {
+    RuleProcessingInfo& rp = rule_processing_infos_->at(rule_id);
+    if (InCover(rp.first_covered_by)) {
+      set_processing_infos_->at(rp.first_covered_by).RemoveRule(rule_id);
+      changed_sets_.push_back(rp.first_covered_by);
+    }
+    set_processing_infos_->at(set_id).AddRule(rule_id);
+    changed_sets_.push_back(set_id);
+    rp.first_covered_by = set_id;
+  }
+
   void LazySetCover::UpdateCover() { 
-    if (rule_infos_->size() == 0) {
+    if (incidence_->num_rules() == 0) {
       LOG4CXX_WARN(lazy_set_cover_logger, "No rule yet.");
       return;
     }
-    MakeCoverOrderMap();
-    string last_rule_covered_by;
+    if (kernel_.get() != nullptr && !last_rule_in_kernel_) {
+      LOG4CXX_INFO(lazy_set_cover_logger, "Last rule covered already.");
+      return;
+    }
+    last_rule_in_kernel_ = false;
+    if (cover_counts_.size() != cover_->size()) {
+      RebuildCoverCounts();
+    }
+    SetId last_rule_covered_by = kNoSet;
 
-    pair<string, uint64_t> best_move_up;
-    GetBestSetToMoveUp(&best_move_up);
+    pair<SetId, uint64_t> best_move_up;
+    SetId before_set = kNoSet;
+    GetBestSetToMoveUp(&best_move_up, &before_set);
     
-    if (!best_move_up.first.empty()) {
+    if (best_move_up.first != kNoSet) {
     // Insert temp. set if some set can be moved up.
-      last_rule_covered_by = InsertNewSet(best_move_up);
+      last_rule_covered_by = InsertNewSet(best_move_up, before_set);
     } else {
       // If cover is unchanged, find first set that covers latest rule.
       last_rule_covered_by = FirstSetThatCoversLastRule();
@@ -276,7 +441,7 @@ namespace incremental_atpg {
     LOG4CXX_INFO(lazy_set_cover_logger, "Should cover with " 
 		 << last_rule_covered_by);
 
-    if (last_rule_covered_by.empty()) {
+    if (last_rule_covered_by == kNoSet) {
       LOG4CXX_ERROR(lazy_set_cover_logger, "Can't find set to cover last rule.");
       return;
     }
@@ -289,36 +454,28 @@ namespace incremental_atpg {
 
     LOG4CXX_INFO(lazy_set_cover_logger, "Updated Cover Rules.");
 
-    // Fix num_uncovered in set_processing_infos_ using covers_rules.
-    set<string> empty_sets;
-    FixNumUncoveredUsingCoverRules(&empty_sets);
+    // Fix counts in @cover_counts_ using covers_rules.
+    set<SetId> empty_sets;
+    UpdateCoverCounts(&empty_sets);
 
-    LOG4CXX_INFO(lazy_set_cover_logger, "Fixed NumUncovered using Cover Rules.");
+    LOG4CXX_INFO(lazy_set_cover_logger, "Updated cover counts.");
 
     CleanUpEmptySets(empty_sets);
       
     LOG4CXX_INFO(lazy_set_cover_logger, "Cleaned Up Empty Sets.");
-    // Change tmp_name back to regular name
-    // In cover, set_infos, set_processing_infos, cover_order.
-    if (!best_move_up.first.empty()) {
+    // Change tmp id back to regular id
+    // In cover and set_processing_infos.
+    if (best_move_up.first != kNoSet) {
       ChangeSetName(last_rule_covered_by, best_move_up.first);
     }
 
   }
-  void LazySetCover::MakeCoverOrderMap() { 
-    cover_order_.reset(new map<string, uint64_t>);
-    uint64_t order = 0;
-    for (auto const& set_name : *cover_.get()) {
-      cover_order_->insert(make_pair(set_name, order));
-      ++order;
-    }
-  }
-
-  bool LazySetCover::WhereWouldSetGo(const string& set_name, uint64_t* before_uncovered) { 
-    vector<string> covered_by_sets;
-    if (set_infos_->find(set_name) == set_infos_->end()) {
+  bool LazySetCover::WhereWouldSetGo(SetId set_id, uint64_t* before_uncovered,
+				     SetId* before_set) { 
+    vector<SetId> covered_by_sets;
+    if (set_id >= incidence_->num_sets()) {
       LOG4CXX_ERROR(lazy_set_cover_logger, 
-		    "Set " << set_name << " not in set_infos_.");
+		    "Set " << set_id << " not in incidence_.");
       return false;
     }
 
@@ -327,11 +484,12 @@ namespace incremental_atpg {
       covered_by_sets.push_back(cover_->front());
     }
 
-    SetInfo info = set_infos_->at(set_name);
-    for (auto const& rule_id : info.all_rules) {
+    uint64_t last_rule = incidence_->num_rules() - 1;
+    Span<uint64_t> all_rules = incidence_->RulesOf(set_id);
+    for (auto const& rule_id : all_rules) {
       if (rule_processing_infos_->size() <= rule_id
-	  || rule_processing_infos_->operator[](rule_id).first_covered_by.empty()) {
-	if (rule_id != rule_infos_->size() - 1) {
+	  || !rule_processing_infos_->operator[](rule_id).Covered()) {
+	if (rule_id != last_rule) {
 	  LOG4CXX_ERROR(lazy_set_cover_logger, "Rule " 
 		       << rule_id << " not covered/ in processing_..");
 	}
@@ -341,20 +499,12 @@ namespace incremental_atpg {
       covered_by_sets.push_back(rule_processing_infos_->operator[](rule_id).first_covered_by);
     }
     // Compare with all the other sets that contain new rule? If they're in cover.
-    for (auto const& other_set_with_new_rule : rule_infos_->back().all_sets) {
-      if (set_processing_infos_->find(other_set_with_new_rule)
-	  != set_processing_infos_->end()) {
+    for (auto const& other_set_with_new_rule : incidence_->SetsOf(last_rule)) {
+      if (InCover(other_set_with_new_rule)) {
 	covered_by_sets.push_back(other_set_with_new_rule);
       }
     }
 
-    if (cover_order_->size() != cover_->size()) {
-      LOG4CXX_WARN(lazy_set_cover_logger, "Cover has " << cover_->size()
-		      << " sets, cover_order_ has " << cover_order_->size()
-		      << ". MakeCoverOrderMap().");
-      MakeCoverOrderMap();
-    }
-
     if (!SortByCoverOrder(&covered_by_sets)) {
       LOG4CXX_ERROR(lazy_set_cover_logger, "Couldn't sort covering sets.");
       return false;
@@ -363,11 +513,13 @@ namespace incremental_atpg {
     GetUnique(&covered_by_sets);
 
     *before_uncovered = 0;
-    set<uint64_t> uncovered_rules(info.all_rules.cbegin(), info.all_rules.cend());
-    for (auto const& other_set_name : covered_by_sets) {
-      LOG4CXX_INFO(lazy_set_cover_logger, "Comparing " << set_name
-		   << "(" << uncovered_rules.size() << ") vs " << other_set_name);
-      if (BetterThanSet(other_set_name, &uncovered_rules, before_uncovered)) {
+    *before_set = kNoSet;
+    set<uint64_t> uncovered_rules(all_rules.begin(), all_rules.end());
+    for (auto const& other_set_id : covered_by_sets) {
+      LOG4CXX_INFO(lazy_set_cover_logger, "Comparing " << set_id
+		   << "(" << uncovered_rules.size() << ") vs " << other_set_id);
+      if (BetterThanSet(other_set_id, &uncovered_rules, before_uncovered)) {
+	*before_set = other_set_id;
     	return true;
       }
     }
@@ -381,75 +533,63 @@ namespace incremental_atpg {
     return false;
   }
 
-  bool LazySetCover::CompareUsingMap(const string& lhs,
-				     const string& rhs,
-				     const map<string, uint64_t>& order) {
-    if (order.find(lhs) == order.end() ||
-	order.find(rhs) == order.end()) {
-      return strcmp(lhs.c_str(), rhs.c_str()) < 0;
-    } else {
-      return order.at(lhs) < order.at(rhs);
-    }
-  }
-
-  // Sorts @sets by index of set in @cover_order_.
-  bool LazySetCover::SortByCoverOrder(vector<string>* sets) { 
-    // Check all the sets are in cover_order_
-    for (auto const& set_name : *sets) {
-      if (cover_order_->find(set_name) == cover_order_->end()) {
-	LOG4CXX_ERROR(lazy_set_cover_logger, "Set " << set_name
-		     << " not in cover_order_.");
+  // Sorts @sets by position of set in @cover_.
+  bool LazySetCover::SortByCoverOrder(vector<SetId>* sets) { 
+    // Check all the sets are in cover_
+    for (auto const& set_id : *sets) {
+      if (!InCoverOrder(set_id)) {
+	LOG4CXX_ERROR(lazy_set_cover_logger, "Set " << set_id
+		     << " not in cover_.");
 	return false;
       }
     }
-      using std::placeholders::_1;
-      using std::placeholders::_2;
-
-      auto compare_callback = bind(&LazySetCover::CompareUsingMap, this,
-				   _1, _2, *cover_order_.get());
+      const OrderList& order = *cover_.get();
+      auto compare_callback = [&order] (SetId lhs, SetId rhs) {
+	return order.Precedes(lhs, rhs);
+      };
       sort(sets->begin(), sets->end(), compare_callback);
       return true;
   }
 
   // Remove duplicates from @sets. @sets should be sorted.
-  void LazySetCover::GetUnique(vector<string>* sets) { 
+  void LazySetCover::GetUnique(vector<SetId>* sets) { 
     auto new_end = unique(sets->begin(), sets->end());
     sets->resize(std::distance(sets->begin(), new_end));
   }
 
-  // Returns true, if @uncovered_rules has more rules than @other_set_name's
-  // covers_rules (plus one, if @set_infos_ indicates it also has the last rule added.)
+  // Returns true, if @uncovered_rules has more rules than @other_set_id's
+  // covers_rules (plus one, if @incidence_ indicates it also has the last rule added.)
   // Otherwise removes common rules from @uncovered_rules and returns false.
-  bool LazySetCover::BetterThanSet(const string& other_set_name, 
+  bool LazySetCover::BetterThanSet(SetId other_set_id, 
 				   set<uint64_t>* uncovered_rules,
 				   uint64_t* before_uncovered) { 
-    if (set_processing_infos_->find(other_set_name)
-	== set_processing_infos_->end()) {
-      LOG4CXX_ERROR(lazy_set_cover_logger, "Other set " << other_set_name
+    if (!InCover(other_set_id)) {
+      LOG4CXX_ERROR(lazy_set_cover_logger, "Other set " << other_set_id
 		    << " not in set_processing_infos_, maybe not in cover too?");
       // TODO(lav): kind of arbitrary
       return false;
     }
-    SetProcessingInfo info = set_processing_infos_->at(other_set_name);
+    const SetProcessingInfo& info = set_processing_infos_->at(other_set_id);
     uint64_t other_set_covers = info.covers_rules.size();
-    // Last rule info not added to processing yet so check rule_infos
-    const vector<string>& last_rule_in = rule_infos_->back().all_sets;
+    // Last rule info not added to processing yet so check incidence_
+    uint64_t last_rule = incidence_->num_rules() - 1;
+    Span<SetId> last_rule_in = incidence_->SetsOf(last_rule);
     bool other_set_has_last_rule = false;
-    if (find(last_rule_in.cbegin(), last_rule_in.cend(), other_set_name) 
-	!= last_rule_in.cend()) {
+    if (find(last_rule_in.begin(), last_rule_in.end(), other_set_id) 
+	!= last_rule_in.end()) {
       ++other_set_covers;
       other_set_has_last_rule = true;
     }
-    LOG4CXX_INFO(lazy_set_cover_logger, "Other set " << other_set_name
+    LOG4CXX_INFO(lazy_set_cover_logger, "Other set " << other_set_id
 		 << " covers " << other_set_covers << " and "
 		 << "size of uncovered rules is " << uncovered_rules->size());
     if (uncovered_rules->size() > other_set_covers) {
-      *before_uncovered = info.num_uncovered;
+      *before_uncovered = NumUncovered(other_set_id);
       return true;
     }
     // TODO(lav): use set to store uncovered rules.
     if (other_set_has_last_rule) {
-      uncovered_rules->erase(rule_infos_->size()-1);
+      uncovered_rules->erase(last_rule);
     }
     for (auto const& rule : info.covers_rules) {
       uncovered_rules->erase(rule);
@@ -458,4 +598,3 @@ namespace incremental_atpg {
   }
 
 }  // namespace incremental_atpg
-
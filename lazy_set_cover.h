@@ -11,6 +11,8 @@
 
 #include "gtest/gtest_prod.h"
 #include "set_cover.h"
+#include "kernel.h"
+#include "prefix_sum_list.h"
 
 namespace incremental_atpg {
   using std::vector;
@@ -21,121 +23,193 @@ namespace incremental_atpg {
   using std::pair;
   using std::set;
 
+  // Doesn't keep num_uncovered in @set_processing_infos_ up to date,
+  // it's NumUncovered, from @cover_counts_.
   class LazySetCover : public SetCover {
   public:
     log4cxx::LoggerPtr lazy_set_cover_logger;
     LazySetCover();
-    // Takes ownership of @set_infos..
-    LazySetCover(map<string, SetInfo>* set_infos,
-		     vector<RuleInfo>* rule_infos);
-    // Takes ownership of @..._infos and @cover
-    LazySetCover(map<string, SetInfo>* set_infos,
-		 vector<RuleInfo>* rule_infos,
-		 map<string, SetProcessingInfo>* set_processing_infos,
+    // Takes ownership of @set_names, @incidence.
+    LazySetCover(SymbolTable* set_names,
+		 Incidence* incidence);
+    // Takes ownership of @set_names, @..._infos and @cover
+    LazySetCover(SymbolTable* set_names,
+		 Incidence* incidence,
+		 vector<SetProcessingInfo>* set_processing_infos,
 		 vector<RuleProcessingInfo>* rule_processing_infos,
-		 list<string>* cover);
-
-    // AddRule inherited from SetCover.
-    // Get..ProcessingInfo also.
+		 OrderList* cover);
+
+    // Get..ProcessingInfo inherited from SetCover.
+
+    // Like SetCover::AddRule, but with a kernel only rules that go
+    // through it get to @incidence_.
+    void AddRule(const vector<string>& sets);
+    // Whether to run rules through an IncrementalKernel, so rules a
+    // forced set covers or that are the same as an earlier rule don't
+    // get to @incidence_ and the cover. Call before adding rules.
+    // Default is false.
+    void SetKernelize(bool kernelize) {
+      kernel_.reset(kernelize ? new IncrementalKernel : nullptr);
+    }
+    // Null unless kernelizing.
+    const IncrementalKernel* kernel() const {
+      return kernel_.get();
+    }
+
+    // Removes a rule in exactly @sets, in any order, in time about
+    // that of UpdateCover. The set that covered it first loses it,
+    // and leaves cover if that was its last rule, other sets stay
+    // where they are. Call after UpdateCover for the last rule added.
+    // Returns false if there's no such rule, or when kernelizing,
+    // since the kernel can't take rules back.
+    bool RemoveRule(const vector<string>& sets);
+    // Puts the rule in exactly @rule_sets in set @set_name too. If
+    // the set is in cover before the one that covered the rule first,
+    // it covers it first now, nothing else moves. Returns false if
+    // there's no such rule, it's in the set already, or when
+    // kernelizing. Call after UpdateCover, like RemoveRule.
+    bool AddToSet(const vector<string>& rule_sets, const string& set_name);
+    // Takes the rule in exactly @rule_sets out of set @set_name. If
+    // that set covered it first, the next set in cover with the rule
+    // does now, or if there's none, the rule gets covered like a new
+    // one, by UpdateCover. Returns false if there's no such rule, it
+    // isn't in the set, or it's the only set it's in, or when
+    // kernelizing.
+    bool RemoveFromSet(const vector<string>& rule_sets, const string& set_name);
 
     // Finds set cover to cover latest rule added.
     // @cover_ should cover all rules up to last one.
     // @set_processing_infos_ and @rule_processing_infos_ should
     // be correct up to last rule added.
-    // @set_infos and @rule_infos_ contain all info through last rule.
+    // @incidence_ contains all rules through last rule.
   void UpdateCover();
 
   protected:
 
-  // Need @cover_order_, @rule_processing_infos_ @set_processing_infos_ up to last rule
-  // and @set_infos, @rule_infos through last rule.
+  // Need @rule_processing_infos_ @set_processing_infos_ up to last rule
+  // and @incidence_ through last rule.
   // Populates @before_uncovered with the number of uncovered rules, 
-  // at which point, set_name should
-  // be inserted in current cover. According to the heuristic, this is the
+  // at which point, @set_id should
+  // be inserted in current cover, and @before_set with the set in
+  // cover it'd go before (kNoSet if at the end). According to the heuristic, this is the
   // earliest position in the cover, where any existing set in cover has rules
-  // in common with @set_name and would cover fewer new rules than @set_name,
+  // in common with @set_id and would cover fewer new rules than @set_id,
   // were it to be inserted instead. Returns false in case of error or if 
   // there's no such position.
-  bool WhereWouldSetGo(const string& set_name, uint64_t* before_uncovered);
+  bool WhereWouldSetGo(SetId set_id, uint64_t* before_uncovered,
+		       SetId* before_set);
 
-  // Populate @cover_order_ with sets in cover and their index.
-  void MakeCoverOrderMap();
+  // True if @set_id is in @cover_, including temporary sets.
+  bool InCoverOrder(SetId set_id) const {
+    return cover_->Contains(set_id);
+  }
 
-  // Return true if order[@lhs] < order[@rhs].
-  // Both should be in @order.
-  bool CompareUsingMap(const string& lhs, const string& rhs,
-		       const map<string, uint64_t>& order);
-  
-  // Sorts @sets in ascending order by index of set in @cover_order_.
-  bool SortByCoverOrder(vector<string>* sets);
+  // Sorts @sets in ascending order by position of set in @cover_.
+  bool SortByCoverOrder(vector<SetId>* sets);
 
   // Remove duplicates from @sets.
-  void GetUnique(vector<string>* sets);
+  void GetUnique(vector<SetId>* sets);
 
-  // Returns true, if @uncovered_rules has more rules than @other_set_name's
-  // cover_rules (plus one, if @set_infos_ indicates it also has the last rule added.)
-  // Then fills in @before_uncovered with uncovered rules when @other_set_name
+  // Returns true, if @uncovered_rules has more rules than @other_set_id's
+  // cover_rules (plus one, if @incidence_ indicates it also has the last rule added.)
+  // Then fills in @before_uncovered with uncovered rules when @other_set_id
   // was added to cover (0 if it's not in cover, shouldn't happen will log warning.)
   // Otherwise removes common rules from @uncovered_rules and returns false.
-  bool BetterThanSet(const string& other_set_name, set<uint64_t>* uncovered_rules,
+  bool BetterThanSet(SetId other_set_id, set<uint64_t>* uncovered_rules,
 		     uint64_t* before_uncovered);
 
   /////////////////////////////////////////////////////////////////
 
-  // Finds best set to move up, to cover last rule added.
-  void GetBestSetToMoveUp(pair<string, uint64_t>* best_move_up);
+  // Finds best set to move up, to cover last rule added, and the set
+  // in cover it goes before.
+  void GetBestSetToMoveUp(pair<SetId, uint64_t>* best_move_up,
+			  SetId* before_set);
 
   // Makes a copy of @best_move_up.first and inserts in cover
-  // when there are @best_move_up.second rules to cover.
-  // Updates @set_infos_, @set_processing_infos_, @cover_
-  // and @cover_order_.
-  // Returns name of copy.
-  string InsertNewSet(pair<string, uint64_t> best_move_up);
+  // when there are @best_move_up.second rules to cover, which is
+  // right before @before_set, or at the end if that's 0.
+  // Updates @set_processing_infos_ and @cover_.
+  // The copy gets a new id past the last set in @incidence_,
+  // until ChangeSetName. It has no rules in @incidence_.
+  // Returns id of copy.
+  SetId InsertNewSet(pair<SetId, uint64_t> best_move_up, SetId before_set);
 
   // Iterates through cover, referring to set_processing_infos_
-  // and rules_info_ to return the name of the first set that covers
+  // and rules_info_ to return the id of the first set that covers
   // the latest rule added.
-  string FirstSetThatCoversLastRule();
+  SetId FirstSetThatCoversLastRule();
 
   // Updates @cover_rules for sets in @set_processing_infos
   // and @first_covered_by for rules in @rule_processing_infos
   // given that @last_rule_covered_by is the first set
-  // to cover the last rule. Uses @cover_order_ to find
+  // to cover the last rule. Uses @cover_ to find
   // relative order of sets. 
-  void UpdateCoverRules(string last_rule_covered_by);
-
-  // Iterates through cover, and resets num_uncovered starting
-  // with rule_infos_->size() and decreasing it by number of 
-  // rules in each set's @cover_rules. Fills @empty_sets
-  // with names of set that don't cover any new rules.
-  void FixNumUncoveredUsingCoverRules(set<string>* empty_sets);
+  void UpdateCoverRules(SetId last_rule_covered_by);
+
+  // Sets counts in @cover_counts_ of sets whose @cover_rules
+  // UpdateCoverRules changed. Fills @empty_sets with ids of those
+  // that don't cover any new rules.
+  void UpdateCoverCounts(set<SetId>* empty_sets);
+
+  // Like RemoveRule, AddToSet and RemoveFromSet, with ids of sets.
+  bool RemoveRuleFromCover(const vector<SetId>& set_ids);
+  bool AddToSetInCover(const vector<SetId>& rule_sets, SetId set_id);
+  bool RemoveFromSetInCover(const vector<SetId>& rule_sets, SetId set_id);
+  // Makes @set_id, which should be in cover, the set that covers
+  // @rule_id first instead of the one that did, and marks both
+  // changed for UpdateCoverCounts.
+  void MoveRuleTo(uint64_t rule_id, SetId set_id);
+
+  // Rules in @rule_processing_infos_ that weren't removed.
+  uint64_t NumLiveRules() const {
+    return rule_processing_infos_->size() - incidence_->num_removed_rules();
+  }
+  // Number of uncovered rules just before @set_id in cover, out of
+  // live rules in @rule_processing_infos_. @set_id should be in cover.
+  uint64_t NumUncovered(SetId set_id) const {
+    return NumLiveRules() - cover_counts_.SumBefore(set_id);
+  }
+  // Refills @cover_counts_ from @cover_ and @set_processing_infos_.
+  // Empty sets get cleaned up by next UpdateCover.
+  void RebuildCoverCounts();
+  // Include @cover_counts_.
+  void ResetProcessingInfo();
+  bool LoadState(SnapshotReader* reader);
 
-  // Remove @empty_sets from @cover_, @cover_order_ and @set_processing_infos
+  // Remove @empty_sets from @cover_ and @set_processing_infos
   // They can't be in @rule_processing_infos_ obviously. TODO(lav): sanity check.
-  void CleanUpEmptySets(const set<string>& empty_sets);
-
-  // Change set name in @set_infos, @..processing etc.
-  void ChangeSetName(const string& tmp_set_name,
-		     const string& real_set_name);
-
-  // Include @cover_order_ and @.._processing_infos_
-  void ResetProcessingInfo();
-  unique_ptr<map<string, uint64_t> > cover_order_;
+  void CleanUpEmptySets(const set<SetId>& empty_sets);
+
+  // Move set @tmp_set_id to @real_set_id in @..processing etc.
+  // Drops @tmp_set_id's slot if it's the last one.
+  void ChangeSetName(SetId tmp_set_id,
+		     SetId real_set_id);
+
+  // Sets in @cover_, with number of rules each covers first.
+  PrefixSumList cover_counts_;
+  // Sets whose @cover_rules changed in this UpdateCover.
+  vector<SetId> changed_sets_;
+  unique_ptr<IncrementalKernel> kernel_;
+  // Whether last rule added went through @kernel_.
+  bool last_rule_in_kernel_;
   private:
     friend class LazySetCoverTest;
     FRIEND_TEST(LazySetCoverTest, UpdateCover);
     FRIEND_TEST(LazySetCoverTest, BetterThanSet);
     FRIEND_TEST(LazySetCoverTest, WhereWouldSetGo);
-    FRIEND_TEST(LazySetCoverTest, MakeCoverOrderMap);
+    FRIEND_TEST(LazySetCoverTest, CoverOrder);
     FRIEND_TEST(LazySetCoverTest, SortByCoverOrder);
     FRIEND_TEST(LazySetCoverTest, GetUnique);
     FRIEND_TEST(LazySetCoverTest, GetBestSetToMoveUp);
     FRIEND_TEST(LazySetCoverTest, InsertNewSet);
     FRIEND_TEST(LazySetCoverTest, FirstSetThatCoversLastRule);
     FRIEND_TEST(LazySetCoverTest, UpdateCoverRules);
-    FRIEND_TEST(LazySetCoverTest, FixNumUncoveredUsingCoverRules);
+    FRIEND_TEST(LazySetCoverTest, UpdateCoverCounts);
     FRIEND_TEST(LazySetCoverTest, CleanUpEmptySets);
     FRIEND_TEST(LazySetCoverTest, ChangeSetName);
+    FRIEND_TEST(LazySetCoverTest, Kernelize);
+    FRIEND_TEST(LazySetCoverTest, RemoveRule);
+    FRIEND_TEST(LazySetCoverTest, Memberships);
   };
 }  // namespace incremental_atpg
 #endif  // INCREMENTAL_ATPG_LAZY_SET_COVER_H_
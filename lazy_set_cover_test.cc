@@ -30,6 +30,11 @@ namespace incremental_atpg {
     }
     virtual void TearDown() {
     }
+    // Interns @set_name if it's new, so tests can put sets in
+    // cover before adding rules.
+    SetId Id(const string& set_name) {
+      return sc_->set_names_->Intern(set_name);
+    }
     std::unique_ptr<LazySetCover> sc_;
   };
 
@@ -44,32 +49,130 @@ namespace incremental_atpg {
 	sc_->AddRule({"rain"});
         sc_->UpdateCover();
 	EXPECT_EQ(2, sc_->cover_->size());
-	EXPECT_EQ("dog", sc_->rule_processing_infos_->at(0).first_covered_by);
-	EXPECT_EQ("dog", sc_->rule_processing_infos_->at(1).first_covered_by);
-	EXPECT_EQ("rain", sc_->rule_processing_infos_->at(2).first_covered_by);
+	EXPECT_EQ(Id("dog"), sc_->rule_processing_infos_->at(0).first_covered_by);
+	EXPECT_EQ(Id("dog"), sc_->rule_processing_infos_->at(1).first_covered_by);
+	EXPECT_EQ(Id("rain"), sc_->rule_processing_infos_->at(2).first_covered_by);
 	sc_->AddRule({"rain"});
         sc_->UpdateCover();
 	EXPECT_EQ(2, sc_->cover_->size());
-	EXPECT_EQ("dog", sc_->cover_->front());
+	EXPECT_EQ(Id("dog"), sc_->cover_->front());
 	sc_->AddRule({"rain"});
         sc_->UpdateCover();
 	EXPECT_EQ(2, sc_->cover_->size());
-	EXPECT_EQ("rain", sc_->cover_->front());
-	EXPECT_EQ("dog", sc_->cover_->back());
+	EXPECT_EQ(Id("rain"), sc_->cover_->front());
+	EXPECT_EQ(Id("dog"), sc_->cover_->back());
+	EXPECT_EQ(list<string>({"rain", "dog"}), sc_->GetCover());
+	// Temporary set copies don't outlive UpdateCover.
+	EXPECT_EQ(3, sc_->set_processing_infos_->size());
+  }
+
+  TEST_F(LazySetCoverTest, Kernelize) {
+    sc_->SetKernelize(true);
+    sc_->AddRule({"dog", "cat"});
+    sc_->UpdateCover();
+    // Same as rule 0.
+    sc_->AddRule({"cat", "dog"});
+    sc_->UpdateCover();
+    EXPECT_EQ(1, sc_->incidence_->num_rules());
+    EXPECT_EQ(2, sc_->kernel()->Weight(0));
+    // Forces "rain".
+    sc_->AddRule({"rain"});
+    sc_->UpdateCover();
+    // Covered by "rain".
+    sc_->AddRule({"rain", "cat", "sand"});
+    sc_->UpdateCover();
+    EXPECT_EQ(2, sc_->incidence_->num_rules());
+    EXPECT_EQ(4, sc_->kernel()->num_rules());
+    EXPECT_EQ(kNotInKernel, sc_->kernel()->KernelRule(3));
+    EXPECT_TRUE(sc_->kernel()->Forced(Id("rain")));
+    EXPECT_EQ(2, sc_->cover_->size());
+    EXPECT_EQ(2, sc_->rule_processing_infos_->size());
+    EXPECT_EQ(Id("rain"), sc_->rule_processing_infos_->at(1).first_covered_by);
   }
 
-  TEST_F(LazySetCoverTest, MakeCoverOrderMap) {
-    sc_->cover_->push_back("cat");
-    sc_->cover_->push_back("jellyfish");
-    sc_->cover_->push_back("sand");
-    sc_->MakeCoverOrderMap();
-    EXPECT_EQ(3, sc_->cover_order_->size());
-    EXPECT_TRUE(sc_->cover_order_->find("cat") != sc_->cover_order_->end());
-    EXPECT_EQ(0, sc_->cover_order_->at("cat"));
-    EXPECT_TRUE(sc_->cover_order_->find("jellyfish") != sc_->cover_order_->end());
-    EXPECT_EQ(1, sc_->cover_order_->at("jellyfish"));
-    EXPECT_TRUE(sc_->cover_order_->find("sand") != sc_->cover_order_->end());
-    EXPECT_EQ(2, sc_->cover_order_->at("sand"));
+  TEST_F(LazySetCoverTest, RemoveRule) {
+    sc_->AddRule({"dog"});
+    sc_->UpdateCover();
+    sc_->AddRule({"dog", "cat"});
+    sc_->UpdateCover();
+    sc_->AddRule({"rain"});
+    sc_->UpdateCover();
+    sc_->AddRule({"rain", "sand"});
+    sc_->UpdateCover();
+    EXPECT_EQ(list<string>({"dog", "rain"}), sc_->GetCover());
+    EXPECT_FALSE(sc_->RemoveRule({"cat"}));
+    EXPECT_FALSE(sc_->RemoveRule({"crab"}));
+
+    EXPECT_TRUE(sc_->RemoveRule({"dog"}));
+    EXPECT_EQ(list<string>({"dog", "rain"}), sc_->GetCover());
+    EXPECT_EQ(3, sc_->NumUncovered(Id("dog")));
+    EXPECT_EQ(2, sc_->NumUncovered(Id("rain")));
+    // Dog has no rules left.
+    EXPECT_TRUE(sc_->RemoveRule({"cat", "dog"}));
+    EXPECT_EQ(list<string>({"rain"}), sc_->GetCover());
+    EXPECT_FALSE(sc_->InCover(Id("dog")));
+    EXPECT_EQ(2, sc_->NumUncovered(Id("rain")));
+
+    sc_->AddRule({"cat"});
+    sc_->UpdateCover();
+    EXPECT_EQ(list<string>({"rain", "cat"}), sc_->GetCover());
+    EXPECT_EQ(1, sc_->NumUncovered(Id("cat")));
+    EXPECT_EQ(Id("cat"), sc_->rule_processing_infos_->at(4).first_covered_by);
+
+    sc_.reset(new LazySetCover);
+    sc_->SetKernelize(true);
+    sc_->AddRule({"dog"});
+    sc_->UpdateCover();
+    EXPECT_FALSE(sc_->RemoveRule({"dog"}));
+  }
+
+  TEST_F(LazySetCoverTest, Memberships) {
+    sc_->AddRule({"dog"});
+    sc_->UpdateCover();
+    sc_->AddRule({"dog", "cat"});
+    sc_->UpdateCover();
+    sc_->AddRule({"rain"});
+    sc_->UpdateCover();
+    sc_->AddRule({"rain", "sand"});
+    sc_->UpdateCover();
+    EXPECT_EQ(list<string>({"dog", "rain"}), sc_->GetCover());
+    EXPECT_FALSE(sc_->AddToSet({"rain"}, "rain"));
+    EXPECT_FALSE(sc_->AddToSet({"crab"}, "rain"));
+
+    // Dog is before rain, covers rule 2 first now.
+    EXPECT_TRUE(sc_->AddToSet({"rain"}, "dog"));
+    EXPECT_EQ(Id("dog"), sc_->rule_processing_infos_->at(2).first_covered_by);
+    EXPECT_EQ(1, sc_->NumUncovered(Id("rain")));
+    // Rain has no rules left.
+    EXPECT_TRUE(sc_->AddToSet({"rain", "sand"}, "dog"));
+    EXPECT_EQ(list<string>({"dog"}), sc_->GetCover());
+
+    // Cat isn't in cover, nothing moves.
+    EXPECT_TRUE(sc_->RemoveFromSet({"cat", "dog"}, "cat"));
+    EXPECT_EQ(Id("dog"), sc_->rule_processing_infos_->at(1).first_covered_by);
+    EXPECT_FALSE(sc_->RemoveFromSet({"dog"}, "dog"));
+    EXPECT_FALSE(sc_->RemoveFromSet({"dog"}, "crab"));
+    // No set in cover has rule 3 now, it's covered as a new rule.
+    EXPECT_TRUE(sc_->RemoveFromSet({"dog", "rain", "sand"}, "dog"));
+    EXPECT_TRUE(sc_->incidence_->IsRemoved(3));
+    EXPECT_EQ(5, sc_->rule_processing_infos_->size());
+    EXPECT_EQ(list<string>({"dog", "sand"}), sc_->GetCover());
+    EXPECT_EQ(1, sc_->NumUncovered(Id("sand")));
+    EXPECT_EQ(Id("sand"), sc_->rule_processing_infos_->at(4).first_covered_by);
+  }
+
+  TEST_F(LazySetCoverTest, CoverOrder) {
+    sc_->cover_->push_back(Id("cat"));
+    sc_->cover_->push_back(Id("jellyfish"));
+    sc_->cover_->push_back(Id("sand"));
+    Id("crab");
+    EXPECT_EQ(3, sc_->cover_->size());
+    EXPECT_TRUE(sc_->InCoverOrder(Id("cat")));
+    EXPECT_TRUE(sc_->InCoverOrder(Id("jellyfish")));
+    EXPECT_TRUE(sc_->InCoverOrder(Id("sand")));
+    EXPECT_FALSE(sc_->InCoverOrder(Id("crab")));
+    EXPECT_TRUE(sc_->cover_->Precedes(Id("cat"), Id("jellyfish")));
+    EXPECT_TRUE(sc_->cover_->Precedes(Id("jellyfish"), Id("sand")));
   }
 
   TEST_F(LazySetCoverTest, WhereWouldSetGo) {
@@ -77,14 +180,15 @@ namespace incremental_atpg {
 	sc_->AddRule({"dog"});
 	sc_->AddRule({"cat"});
 
-	sc_->cover_->push_back("dog");
-	sc_->cover_->push_back("cat");
+	sc_->cover_->push_back(Id("dog"));
+	sc_->cover_->push_back(Id("cat"));
 	
 	sc_->ResetProcessingInfo();
 	sc_->AddRule({"dog", "rain"});
 	uint64_t before_uncovered;
-	EXPECT_FALSE(sc_->WhereWouldSetGo("dog", &before_uncovered));
-	EXPECT_FALSE(sc_->WhereWouldSetGo("rain", &before_uncovered));
+	SetId before_set;
+	EXPECT_FALSE(sc_->WhereWouldSetGo(Id("dog"), &before_uncovered, &before_set));
+	EXPECT_FALSE(sc_->WhereWouldSetGo(Id("rain"), &before_uncovered, &before_set));
       }
 
       {
@@ -92,61 +196,62 @@ namespace incremental_atpg {
 	sc_->AddRule({"dog"});
 	sc_->AddRule({"cat"});
 
-	sc_->cover_->push_back("cat");
-	sc_->cover_->push_back("dog");
+	sc_->cover_->push_back(Id("cat"));
+	sc_->cover_->push_back(Id("dog"));
 	
 	sc_->ResetProcessingInfo();
 	sc_->AddRule({"dog", "rain"});
 
 	uint64_t before_uncovered;
+	SetId before_set;
 	// Since we only compare it to "dog". Maybe we should make
 	// an exception and compare it to the first set too.
-	EXPECT_TRUE(sc_->WhereWouldSetGo("dog", &before_uncovered));
+	EXPECT_TRUE(sc_->WhereWouldSetGo(Id("dog"), &before_uncovered, &before_set));
 	EXPECT_EQ(2, before_uncovered);
+	EXPECT_EQ(Id("cat"), before_set);
 	// I need to fix my heuristic. Do I compare against
 	// as many sets in cover as I can - e.g., "dog" has no
 	// rule in comon except last one, "cat" has no rule
 	// in common but it's the first set in the cover.
 	// Also when I'm comparing I should take into account
 	// that the other set may also have the last rule.
-	EXPECT_FALSE(sc_->WhereWouldSetGo("rain", &before_uncovered));
+	EXPECT_FALSE(sc_->WhereWouldSetGo(Id("rain"), &before_uncovered, &before_set));
       }
   }
 
   TEST_F(LazySetCoverTest, GetUnique) {
-    vector<string> sets({"Gary", "Patrick", "Squidward", "Squidward", "Krusty",
-	  "Sandy", "Sandy", "Plankton"}); 
+    vector<SetId> sets({Id("Gary"), Id("Patrick"), Id("Squidward"), Id("Squidward"),
+	  Id("Krusty"), Id("Sandy"), Id("Sandy"), Id("Plankton")}); 
     sc_->GetUnique(&sets);
     EXPECT_EQ(6, sets.size());
-    EXPECT_EQ("Gary", sets.at(0));
-    EXPECT_EQ("Squidward", sets.at(2));
-    EXPECT_EQ("Krusty", sets.at(3));
-    EXPECT_EQ("Sandy", sets.at(4));
-    EXPECT_EQ("Plankton", sets.at(5));
+    EXPECT_EQ(Id("Gary"), sets.at(0));
+    EXPECT_EQ(Id("Squidward"), sets.at(2));
+    EXPECT_EQ(Id("Krusty"), sets.at(3));
+    EXPECT_EQ(Id("Sandy"), sets.at(4));
+    EXPECT_EQ(Id("Plankton"), sets.at(5));
     
  }
   TEST_F(LazySetCoverTest, SortByCoverOrder) {
-    sc_->cover_->push_back("cat");
-    sc_->cover_->push_back("jellyfish");
-    sc_->cover_->push_back("squarepants");
-    sc_->cover_->push_back("starward");
-
-    sc_->MakeCoverOrderMap();
+    Id("starward");
+    sc_->cover_->push_back(Id("cat"));
+    sc_->cover_->push_back(Id("jellyfish"));
+    sc_->cover_->push_back(Id("squarepants"));
+    sc_->cover_->push_back(Id("starward"));
 
-    vector<string> sets({"squarepants", "cat", "jellyfish", "starward"});
+    vector<SetId> sets({Id("squarepants"), Id("cat"), Id("jellyfish"), Id("starward")});
     sc_->SortByCoverOrder(&sets);
     EXPECT_EQ(4, sets.size());
-    EXPECT_EQ("cat", sets.at(0));
-    EXPECT_EQ("jellyfish", sets.at(1));
-    EXPECT_EQ("squarepants", sets.at(2));
-    EXPECT_EQ("starward", sets.at(3));
+    EXPECT_EQ(Id("cat"), sets.at(0));
+    EXPECT_EQ(Id("jellyfish"), sets.at(1));
+    EXPECT_EQ(Id("squarepants"), sets.at(2));
+    EXPECT_EQ(Id("starward"), sets.at(3));
   }
   TEST_F(LazySetCoverTest, BetterThanSet) {
     sc_->AddRule({"dog"});
     sc_->AddRule({"cat"});
     
-    sc_->cover_->push_back("dog");
-    sc_->cover_->push_back("cat");
+    sc_->cover_->push_back(Id("dog"));
+    sc_->cover_->push_back(Id("cat"));
 
     sc_->ResetProcessingInfo();
     sc_->AddRule({"dog", "rain"});
@@ -154,103 +259,106 @@ namespace incremental_atpg {
     set<uint64_t> rain_uncovered_rules({2});
     uint64_t before_uncovered = 0;
     
-    EXPECT_FALSE(sc_->BetterThanSet("dog", &dog_uncovered_rules, &before_uncovered));
+    EXPECT_FALSE(sc_->BetterThanSet(Id("dog"), &dog_uncovered_rules, &before_uncovered));
     EXPECT_EQ(0, dog_uncovered_rules.size());
-    EXPECT_FALSE(sc_->BetterThanSet("cat", &dog_uncovered_rules, &before_uncovered));
+    EXPECT_FALSE(sc_->BetterThanSet(Id("cat"), &dog_uncovered_rules, &before_uncovered));
   }
 
   TEST_F(LazySetCoverTest, GetBestSetToMoveUp) { 
     sc_->AddRule({"dog"});
-    pair<string, uint64_t> best_move_up;
-    sc_->GetBestSetToMoveUp(&best_move_up);
-    EXPECT_EQ("dog", best_move_up.first);
+    pair<SetId, uint64_t> best_move_up;
+    SetId before_set;
+    sc_->GetBestSetToMoveUp(&best_move_up, &before_set);
+    EXPECT_EQ(Id("dog"), best_move_up.first);
+    EXPECT_EQ(kNoSet, before_set);
     EXPECT_EQ(0, best_move_up.second);
-    sc_->cover_->push_back("dog");
+    sc_->cover_->push_back(Id("dog"));
     sc_->ResetProcessingInfo();
 
     sc_->AddRule({"dog", "rain"});
-    best_move_up = make_pair("", 0);
-    sc_->GetBestSetToMoveUp(&best_move_up);
-    EXPECT_EQ("", best_move_up.first);
+    best_move_up = make_pair(kNoSet, 0);
+    sc_->GetBestSetToMoveUp(&best_move_up, &before_set);
+    EXPECT_EQ(kNoSet, best_move_up.first);
     EXPECT_EQ(0, best_move_up.second);
     sc_->ResetProcessingInfo();
 
     sc_->AddRule({"rain"});
-    best_move_up = make_pair("", 0);
-    sc_->GetBestSetToMoveUp(&best_move_up);
-    EXPECT_EQ("rain", best_move_up.first);
+    best_move_up = make_pair(kNoSet, 0);
+    sc_->GetBestSetToMoveUp(&best_move_up, &before_set);
+    EXPECT_EQ(Id("rain"), best_move_up.first);
     EXPECT_EQ(0, best_move_up.second);
 
 }
   TEST_F(LazySetCoverTest, InsertNewSet) { 
     {    
       sc_->AddRule({"dog"});
-      string name = sc_->InsertNewSet(make_pair("dog", 0));
+      SetId tmp = sc_->InsertNewSet(make_pair(Id("dog"), 0), kNoSet);
+      EXPECT_NE(Id("dog"), tmp);
       EXPECT_EQ(1, sc_->cover_->size());
-      EXPECT_EQ(name, sc_->cover_->back());
-      EXPECT_TRUE(sc_->cover_order_->find(name) !=
-		  sc_->cover_order_->end());
-      EXPECT_EQ(0, sc_->cover_order_->at(name));
+      EXPECT_EQ(tmp, sc_->cover_->back());
+      EXPECT_TRUE(sc_->InCoverOrder(tmp));
     }
     {
       sc_.reset(new LazySetCover);
       sc_->AddRule({"dog"});
       sc_->AddRule({"dog", "cat"});
-      sc_->cover_->push_back("dog");
-      sc_->cover_->push_back("cat");
+      sc_->cover_->push_back(Id("dog"));
+      sc_->cover_->push_back(Id("cat"));
       sc_->ResetProcessingInfo();
       sc_->AddRule({"rain"});
-      string name = sc_->InsertNewSet(make_pair("rain", 2));
+      SetId tmp = sc_->InsertNewSet(make_pair(Id("rain"), 2), Id("dog"));
       EXPECT_EQ(3, sc_->cover_->size());
-      EXPECT_EQ(name, sc_->cover_->front());
-      EXPECT_TRUE(sc_->cover_order_->find(name) !=
-		  sc_->cover_order_->end());
-      EXPECT_EQ(0, sc_->cover_order_->at(name));
-      EXPECT_EQ(0, sc_->cover_order_->at("dog"));
+      EXPECT_EQ(tmp, sc_->cover_->front());
+      EXPECT_TRUE(sc_->InCoverOrder(tmp));
+      EXPECT_TRUE(sc_->cover_->Precedes(tmp, Id("dog")));
     }
 }
   /*
   TEST_F(LazySetCoverTest, FirstSetThatCoversLastRule) { }
   TEST_F(LazySetCoverTest, UpdateCoverRules) { }
-  TEST_F(LazySetCoverTest, FixNumUncoveredUsingCoverRules) { }
+  TEST_F(LazySetCoverTest, UpdateCoverCounts) { }
   */
   TEST_F(LazySetCoverTest, CleanUpEmptySets) { 
     sc_->AddRule({"dog"});
     sc_->AddRule({"cat", "dog"});
     
-    sc_->cover_->push_back("dog");
-    sc_->cover_->push_back("cat");
+    sc_->cover_->push_back(Id("dog"));
+    sc_->cover_->push_back(Id("cat"));
 
     sc_->ResetProcessingInfo();    
-    EXPECT_EQ(2, sc_->set_processing_infos_->size());
-    EXPECT_EQ(0, sc_->set_processing_infos_->at("cat").GetNumRules());
+    EXPECT_TRUE(sc_->InCover(Id("dog")));
+    EXPECT_TRUE(sc_->InCover(Id("cat")));
+    EXPECT_EQ(0, sc_->set_processing_infos_->at(Id("cat")).GetNumRules());
     // Can put any set in empty sets.
-    set<string> empty_sets({"dog"});
+    set<SetId> empty_sets({Id("dog")});
     sc_->CleanUpEmptySets(empty_sets);
     EXPECT_EQ(1, sc_->cover_->size());
-    EXPECT_EQ("cat", sc_->cover_->back());
-    EXPECT_EQ(1, sc_->set_processing_infos_->size());
-    EXPECT_EQ(1, sc_->cover_order_->size());
-    EXPECT_EQ(2, sc_->set_infos_->size());
+    EXPECT_EQ(Id("cat"), sc_->cover_->back());
+    EXPECT_FALSE(sc_->InCover(Id("dog")));
+    EXPECT_TRUE(sc_->InCover(Id("cat")));
+    EXPECT_FALSE(sc_->InCoverOrder(Id("dog")));
+    EXPECT_TRUE(sc_->InCoverOrder(Id("cat")));
+    EXPECT_EQ(2, sc_->incidence_->num_sets());
 }
 
   TEST_F(LazySetCoverTest, ChangeSetName) {
     sc_->AddRule({"dog"});
     sc_->AddRule({"cat", "dog"});
     
-    sc_->cover_->push_back("dog");
-    sc_->cover_->push_back("cat");
+    sc_->cover_->push_back(Id("dog"));
+    sc_->cover_->push_back(Id("cat"));
 
     sc_->ResetProcessingInfo();    
     EXPECT_EQ(2, sc_->set_processing_infos_->size());
-    EXPECT_EQ(0, sc_->set_processing_infos_->at("cat").GetNumRules());
-
-    sc_->ChangeSetName("dog", "pig");
-    EXPECT_TRUE(sc_->set_infos_->find("dog") == sc_->set_infos_->end());
-    EXPECT_TRUE(sc_->set_infos_->find("pig") != sc_->set_infos_->end());
-    EXPECT_EQ("pig", sc_->rule_processing_infos_->at(0).first_covered_by);
-    EXPECT_EQ("pig", sc_->rule_processing_infos_->at(1).first_covered_by);
-    // But rule_infos is not changed.
+    EXPECT_EQ(0, sc_->set_processing_infos_->at(Id("cat")).GetNumRules());
+
+    sc_->ChangeSetName(Id("dog"), Id("pig"));
+    EXPECT_FALSE(sc_->InCover(Id("dog")));
+    EXPECT_TRUE(sc_->InCover(Id("pig")));
+    EXPECT_EQ(Id("pig"), sc_->cover_->front());
+    EXPECT_EQ(Id("pig"), sc_->rule_processing_infos_->at(0).first_covered_by);
+    EXPECT_EQ(Id("pig"), sc_->rule_processing_infos_->at(1).first_covered_by);
+    // But incidence is not changed.
 }
 
 }  // namespace incremental_atpg
@@ -1,6 +1,7 @@
 #include "online_set_cover.h"
 
 #include <vector>
+#include <chrono>
 #include <cstring>
 #include <string>
 #include <memory>
@@ -10,12 +11,17 @@
 #include <algorithm> // for std::sort
 #include <stdint.h>
 #include <utility>
+#include <limits>
+#include <thread>
+#include <mutex>
 #include <log4cxx/logger.h>
 
 #include "gtest/gtest_prod.h"
 #include "set_cover.h"
 #include "lazy_set_cover.h"
 #include "greedy_set_cover.h"
+#include "snapshot.h"
+#include "op_log.h"
 
 namespace incremental_atpg {
   using std::log;
@@ -30,6 +36,9 @@ namespace incremental_atpg {
   using std::bind;
   using std::sort;
   using std::unique;
+  using std::numeric_limits;
+  using std::chrono::steady_clock;
+  using std::chrono::duration;
 
   using log4cxx::LoggerPtr;
   using log4cxx::Logger;
@@ -40,10 +49,20 @@ namespace incremental_atpg {
       LOG4CXX_WARN(online_set_cover_logger, "Update once after add.");
       return;
     }
+    LogRecord record(LogRecord::kAddRule, {sets});
+    if (!LogChange(&record)) {
+      return;
+    }
     ++adds_;
     LazySetCover::AddRule(sets);
   }
 
+  OnlineSetCover::~OnlineSetCover() {
+    if (rebuild_.get() != nullptr) {
+      rebuild_->thread.join();
+    }
+  }
+
   void OnlineSetCover::UpdateCover() {
     if (updates_ + 1 != adds_) {
       LOG4CXX_WARN(online_set_cover_logger, "Update once after add.");
@@ -51,42 +70,538 @@ namespace incremental_atpg {
     }
     ++updates_;
     LazySetCover::UpdateCover();
+    if (rebuild_.get() != nullptr) {
+      QueueRulesForRebuild();
+      FinishRebuild(false);
+      return;
+    }
     if (!GoodEnough()) {
+      if (background_rebuild_) {
+	StartRebuild();
+      } else {
+	RebuildWithGreedy();
+      }
+    }
+  }
 
-      gr_.reset(new GreedySetCover(set_infos_.release(),
-				   rule_infos_.release()));
+  void OnlineSetCover::AddRules(const vector<vector<string> >& rules,
+				BatchStats* stats) {
+    if (adds_ != updates_) {
+      LOG4CXX_WARN(online_set_cover_logger, "Update once after add.");
+      return;
+    }
+    LogRecord record(LogRecord::kAddRules, rules);
+    if (!LogChange(&record)) {
+      return;
+    }
+    BatchStats batch;
+    batch.num_rules = rules.size();
+    batch.cover_size_before = cover_->size();
+    uint64_t num_rules_before = incidence_->num_rules();
+    // Lazy cover has to stay good while greedy runs in background.
+    bool only_greedy = !background_rebuild_ && rebuild_.get() == nullptr
+      && rules.size() > num_rules_before;
+
+    // Wall time, which is what a caller waits, also with greedy on
+    // many threads.
+    steady_clock::time_point begin = steady_clock::now();
+    uint64_t num_empty = 0;
+    for (auto const& sets : rules) {
+      // No set can cover it, cover would never be good again.
+      if (sets.empty()) {
+	++num_empty;
+	continue;
+      }
+      LazySetCover::AddRule(sets);
+      if (!only_greedy) {
+	LazySetCover::UpdateCover();
+      }
+    }
+    if (num_empty > 0) {
+      LOG4CXX_WARN(online_set_cover_logger, "Skipped " << num_empty
+		   << " empty rules in batch.");
+    }
+    adds_ += rules.size();
+    updates_ += rules.size();
+    batch.num_new_rules = incidence_->num_rules() - num_rules_before;
+    steady_clock::time_point now = steady_clock::now();
+    batch.lazy_seconds = duration<double>(now - begin).count();
+
+    begin = now;
+    if (rebuild_.get() != nullptr) {
+      QueueRulesForRebuild();
+      FinishRebuild(false);
+    } else if (incidence_->num_rules() > 0 && (only_greedy || !GoodEnough())) {
+      if (background_rebuild_) {
+	StartRebuild();
+      } else {
+	RebuildWithGreedy();
+      }
+      batch.greedy = true;
+    }
+    batch.greedy_seconds = duration<double>(steady_clock::now() - begin).count();
+    batch.cover_size_after = cover_->size();
+    LOG4CXX_INFO(online_set_cover_logger, "Batch of " << batch.num_rules << " rules, "
+		 << batch.num_new_rules << " new, cover went from "
+		 << batch.cover_size_before << " to " << batch.cover_size_after
+		 << " sets" << (batch.greedy ? " with greedy." : "."));
+    if (stats != nullptr) {
+      *stats = batch;
+    }
+  }
+
+  bool OnlineSetCover::RemoveRule(const vector<string>& sets) {
+    if (adds_ != updates_) {
+      LOG4CXX_WARN(online_set_cover_logger, "Update once after add.");
+      return false;
+    }
+    LogRecord record(LogRecord::kRemoveRule, {sets});
+    if (!LogChange(&record)) {
+      return false;
+    }
+    vector<SetId> set_ids;
+    return FindSetIds(sets, &set_ids)
+      && ChangeRule(RuleChange(RuleChange::kRemoveRule, set_ids));
+  }
+
+  bool OnlineSetCover::AddToSet(const vector<string>& rule_sets,
+				const string& set_name) {
+    if (adds_ != updates_) {
+      LOG4CXX_WARN(online_set_cover_logger, "Update once after add.");
+      return false;
+    }
+    LogRecord record(LogRecord::kAddToSet, {rule_sets}, set_name);
+    if (!LogChange(&record)) {
+      return false;
+    }
+    vector<SetId> set_ids;
+    return FindSetIds(rule_sets, &set_ids)
+      && ChangeRule(RuleChange(RuleChange::kAddToSet, set_ids,
+			       set_names_->Intern(set_name)));
+  }
+
+  bool OnlineSetCover::RemoveFromSet(const vector<string>& rule_sets,
+				     const string& set_name) {
+    if (adds_ != updates_) {
+      LOG4CXX_WARN(online_set_cover_logger, "Update once after add.");
+      return false;
+    }
+    LogRecord record(LogRecord::kRemoveFromSet, {rule_sets}, set_name);
+    if (!LogChange(&record)) {
+      return false;
+    }
+    vector<SetId> set_ids;
+    SetId set_id = kNoSet;
+    return FindSetIds(rule_sets, &set_ids)
+      && GetSetId(set_name, &set_id)
+      && ChangeRule(RuleChange(RuleChange::kRemoveFromSet, set_ids, set_id));
+  }
+
+  bool OnlineSetCover::ChangeRule(const RuleChange& change) {
+    if (rebuild_.get() != nullptr) {
+      // Rules added so far go to @rebuild_ before the change.
+      QueueRulesForRebuild();
+    }
+    if (!ReplayChange(change)) {
+      return false;
+    }
+    if (rebuild_.get() != nullptr) {
+      {
+	std::lock_guard<std::mutex> lock(rebuild_->mutex);
+	rebuild_->pending.push_back(change);
+	// A rule the change added is replayed by it.
+	rebuild_->num_queued = incidence_->num_rules();
+      }
+      FinishRebuild(false);
+      return true;
+    }
+    if (incidence_->num_live_rules() > 0 && !GoodEnough()) {
+      if (background_rebuild_) {
+	StartRebuild();
+      } else {
+	RebuildWithGreedy();
+      }
+    }
+    return true;
+  }
+
+  void OnlineSetCover::RebuildWithGreedy() {
+    SetCover* greedy = nullptr;
+    if (greedy_engine_ == kParallelGreedy) {
+      pgr_.reset(new ParallelGreedySetCover(set_names_.release(),
+					    incidence_.release()));
+      pgr_->SetOptions(parallel_greedy_options_);
+      pgr_->UpdateCover();
+      greedy = pgr_.get();
+    } else if (solve_by_component_ && component_covers_.get() != nullptr) {
+      // Infos only changed in components with rules added since, so
+      // greedy only rebuilds those.
+      gr_.reset(new GreedySetCover(set_names_.release(),
+				   incidence_.release(),
+				   set_processing_infos_.release(),
+				   rule_processing_infos_.release(),
+				   cover_.release()));
+      gr_->SetSolveByComponent(true, num_threads_);
+      gr_->SetComponentCovers(component_covers_.release(), true);
+      gr_->UpdateCover();
+      greedy = gr_.get();
+    } else if (solve_by_component_) {
+      gr_.reset(new GreedySetCover(set_names_.release(),
+				   incidence_.release()));
+      gr_->SetSolveByComponent(true, num_threads_);
+      gr_->UpdateCover();
+      greedy = gr_.get();
+    } else if (warm_start_ && greedy_cover_.get() != nullptr) {
+      gr_.reset(new GreedySetCover(set_names_.release(),
+				   incidence_.release(),
+				   new vector<SetProcessingInfo>,
+				   new vector<RuleProcessingInfo>,
+				   new OrderList(*greedy_cover_)));
+      gr_->SetWarmStart(true);
+      gr_->SetCoverIsGreedyFor(greedy_num_rules_);
+      gr_->UpdateCover();
+      greedy = gr_.get();
+    } else {
+      gr_.reset(new GreedySetCover(set_names_.release(),
+				   incidence_.release()));
       //set_processing_infos_.release(),
       //rule_processing_infos_.release(),
       //cover_.release()));
-      ++greedy_updates_;
       gr_->UpdateCover();
+      greedy = gr_.get();
+    }
+    ++greedy_updates_;
 
-      set_infos_.reset(gr_->ReleaseSetInfos());
-      rule_infos_.reset(gr_->ReleaseRuleInfos());
-      set_processing_infos_.reset(gr_->ReleaseSetProcessingInfos());
-      rule_processing_infos_.reset(gr_->ReleaseRuleProcessingInfos());
-      cover_.reset(gr_->ReleaseCover());
-      double min = 1.0;
-      if (GetMin(&min)) {
-	LOG4CXX_INFO(online_set_cover_logger, "Reset best_greedy_fraction_ to " << min
-		     << ". Reciprocal is " << (1.0/best_greedy_fraction_) << ".");
-	best_greedy_fraction_ = min;
-      } else {
-	LOG4CXX_INFO(online_set_cover_logger, "Couldn't reset best_greedy_fraction_ to " << min);
+    set_names_.reset(greedy->ReleaseSetNames());
+    incidence_.reset(greedy->ReleaseIncidence());
+    set_processing_infos_.reset(greedy->ReleaseSetProcessingInfos());
+    rule_processing_infos_.reset(greedy->ReleaseRuleProcessingInfos());
+    cover_.reset(greedy->ReleaseCover());
+    RebuildCoverCounts();
+    if (greedy == gr_.get()) {
+      greedy_cover_.reset(new OrderList(*cover_));
+      greedy_num_rules_ = incidence_->num_rules();
+      component_covers_.reset(gr_->ReleaseComponentCovers());
+    } else {
+      greedy_cover_.reset(nullptr);
+      component_covers_.reset(nullptr);
+    }
+    double min = 1.0;
+    if (GetMin(&min)) {
+      LOG4CXX_INFO(online_set_cover_logger, "Reset best_greedy_fraction_ to " << min
+		   << ". Reciprocal is " << (1.0/best_greedy_fraction_) << ".");
+      best_greedy_fraction_ = min;
+    } else {
+      LOG4CXX_INFO(online_set_cover_logger, "Couldn't reset best_greedy_fraction_ to " << min);
+    }
+    gr_.reset(nullptr);
+    pgr_.reset(nullptr);
+  }
+
+  void OnlineSetCover::StartRebuild() {
+    LOG4CXX_INFO(online_set_cover_logger, "Starting greedy in background with "
+		 << incidence_->num_rules() << " rules.");
+    OnlineSetCover* replica = nullptr;
+    if (solve_by_component_ && component_covers_.get() != nullptr) {
+      // Component covers need the infos that go with them.
+      replica = new OnlineSetCover(new SymbolTable(*set_names_),
+				   new Incidence(*incidence_),
+				   new vector<SetProcessingInfo>(*set_processing_infos_),
+				   new vector<RuleProcessingInfo>(*rule_processing_infos_),
+				   new OrderList(*cover_));
+    } else {
+      replica = new OnlineSetCover(new SymbolTable(*set_names_),
+				   new Incidence(*incidence_));
+    }
+    replica->SetGreedyEngine(greedy_engine_, parallel_greedy_options_);
+    replica->SetWarmStart(warm_start_);
+    replica->SetSolveByComponent(solve_by_component_, num_threads_);
+    if (greedy_cover_.get() != nullptr) {
+      replica->greedy_cover_.reset(new OrderList(*greedy_cover_));
+      replica->greedy_num_rules_ = greedy_num_rules_;
+    }
+    replica->component_covers_.reset(component_covers_.release());
+
+    rebuild_.reset(new BackgroundRebuild);
+    rebuild_->replica.reset(replica);
+    rebuild_->num_queued = incidence_->num_rules();
+    BackgroundRebuild* rebuild = rebuild_.get();
+    rebuild->thread = std::thread([rebuild] () {
+	rebuild->replica->RebuildWithGreedy();
+	// Catch up with rules added meanwhile, until there are none.
+	while (true) {
+	  vector<RuleChange> changes;
+	  {
+	    std::lock_guard<std::mutex> lock(rebuild->mutex);
+	    if (rebuild->pending.empty()) {
+	      rebuild->done = true;
+	      return;
+	    }
+	    changes.swap(rebuild->pending);
+	  }
+	  for (auto const& change : changes) {
+	    rebuild->replica->ReplayChange(change);
+	  }
+	}
+      });
+  }
+
+  void OnlineSetCover::QueueRulesForRebuild() {
+    std::lock_guard<std::mutex> lock(rebuild_->mutex);
+    for (uint64_t rule_id = rebuild_->num_queued; rule_id < incidence_->num_rules(); rule_id++) {
+      Span<SetId> sets = incidence_->SetsOf(rule_id);
+      rebuild_->pending.push_back(RuleChange(RuleChange::kAddRule,
+					     vector<SetId>(sets.begin(), sets.end())));
+    }
+    rebuild_->num_queued = incidence_->num_rules();
+  }
+
+  bool OnlineSetCover::FinishRebuild(bool wait) {
+    if (rebuild_.get() == nullptr) {
+      return false;
+    }
+    if (!wait) {
+      std::lock_guard<std::mutex> lock(rebuild_->mutex);
+      if (!rebuild_->done) {
+	return false;
       }
+    }
+    QueueRulesForRebuild();
+    rebuild_->thread.join();
 
-      cover_order_.reset(new map<string, uint64_t>);
-      gr_.reset(nullptr);
+    // Rules queued after thread was done.
+    OnlineSetCover* replica = rebuild_->replica.get();
+    for (auto const& change : rebuild_->pending) {
+      replica->ReplayChange(change);
+    }
+    LOG4CXX_INFO(online_set_cover_logger, "Swapping in greedy cover from background, "
+		 << rebuild_->pending.size() << " changes replayed here.");
+
+    // Same rules, in the same order, and @set_names_ has all the sets.
+    incidence_.reset(replica->incidence_.release());
+    set_processing_infos_.reset(replica->set_processing_infos_.release());
+    rule_processing_infos_.reset(replica->rule_processing_infos_.release());
+    cover_.reset(replica->cover_.release());
+    cover_counts_ = std::move(replica->cover_counts_);
+    changed_sets_.clear();
+    greedy_cover_.reset(replica->greedy_cover_.release());
+    greedy_num_rules_ = replica->greedy_num_rules_;
+    component_covers_.reset(replica->component_covers_.release());
+    best_greedy_fraction_ = replica->best_greedy_fraction_;
+    ++greedy_updates_;
+    rebuild_.reset(nullptr);
+    return true;
+  }
+
+  bool OnlineSetCover::ReplayChange(const RuleChange& change) {
+    if (change.kind == RuleChange::kAddRule) {
+      AddRuleToIncidence(change.set_ids);
+      LazySetCover::UpdateCover();
+      return true;
+    }
+    if (change.kind == RuleChange::kRemoveRule) {
+      return RemoveRuleFromCover(change.set_ids);
     }
+    bool changed = change.kind == RuleChange::kAddToSet
+      ? AddToSetInCover(change.set_ids, change.set_id)
+      : RemoveFromSetInCover(change.set_ids, change.set_id);
+    if (changed) {
+      // Warm start and component covers count on old rules staying
+      // the same.
+      greedy_cover_.reset(nullptr);
+      component_covers_.reset(nullptr);
+    }
+    return changed;
+  }
+
+  bool OnlineSetCover::SaveSnapshot(const string& path) {
+    if (adds_ != updates_) {
+      LOG4CXX_WARN(online_set_cover_logger, "Update once after add.");
+      return false;
+    }
+    if (kernel_.get() != nullptr) {
+      LOG4CXX_WARN(online_set_cover_logger, "Can't save a kernel.");
+      return false;
+    }
+    FinishRebuild(true);
+    SnapshotWriter writer;
+    if (!writer.Open(path)) {
+      LOG4CXX_ERROR(online_set_cover_logger, "Can't write snapshot to " << path);
+      return false;
+    }
+    // Counters go first, so LoadSnapshot has them before it replaces
+    // anything.
+    writer.WriteValue(adds_);
+    writer.WriteValue(updates_);
+    writer.WriteValue(greedy_updates_);
+    writer.WriteValue(greedy_adds_);
+    writer.WriteValue(best_greedy_fraction_);
+    writer.WriteValue(greedy_num_rules_);
+    writer.WriteValue(log_sequence_);
+    uint8_t has_greedy_cover = greedy_cover_.get() != nullptr;
+    writer.WriteValue(has_greedy_cover);
+    if (has_greedy_cover) {
+      writer.Write(vector<SetId>(greedy_cover_->begin(), greedy_cover_->end()));
+    } else {
+      writer.Write(vector<SetId>());
+    }
+    SaveState(&writer);
+    if (!writer.Close()) {
+      LOG4CXX_ERROR(online_set_cover_logger, "Can't write snapshot to " << path);
+      return false;
+    }
+    // Snapshot is synced, so log can go. Replay would skip what's in
+    // it anyway, by sequence number.
+    if (log_.get() != nullptr && !log_->Reset()) {
+      LOG4CXX_WARN(online_set_cover_logger, "Can't empty log after snapshot.");
+    }
+    return true;
+  }
+
+  bool OnlineSetCover::LoadSnapshot(const string& path) {
+    SnapshotReader reader;
+    if (!reader.Open(path)) {
+      LOG4CXX_ERROR(online_set_cover_logger, "No snapshot of version "
+		    << kSnapshotVersion << " in " << path);
+      return false;
+    }
+    uint64_t adds = 0;
+    uint64_t updates = 0;
+    uint64_t greedy_updates = 0;
+    uint64_t greedy_adds = 0;
+    double best_greedy_fraction = 1.0;
+    uint64_t greedy_num_rules = 0;
+    uint64_t log_sequence = 0;
+    uint8_t has_greedy_cover = 0;
+    vector<SetId> greedy_cover;
+    if (!reader.ReadValue(&adds) || !reader.ReadValue(&updates)
+	|| !reader.ReadValue(&greedy_updates) || !reader.ReadValue(&greedy_adds)
+	|| !reader.ReadValue(&best_greedy_fraction)
+	|| !reader.ReadValue(&greedy_num_rules)
+	|| !reader.ReadValue(&log_sequence)
+	|| !reader.ReadValue(&has_greedy_cover) || !reader.Read(&greedy_cover)) {
+      LOG4CXX_ERROR(online_set_cover_logger, "Bad snapshot in " << path);
+      return false;
+    }
+    FinishRebuild(true);
+    if (!LoadState(&reader)) {
+      LOG4CXX_ERROR(online_set_cover_logger, "Bad snapshot in " << path);
+      return false;
+    }
+    if (!reader.AtEnd()) {
+      LOG4CXX_WARN(online_set_cover_logger, "Snapshot in " << path
+		   << " has more than was read.");
+    }
+    adds_ = adds;
+    updates_ = updates;
+    greedy_updates_ = greedy_updates;
+    greedy_adds_ = greedy_adds;
+    best_greedy_fraction_ = best_greedy_fraction;
+    greedy_num_rules_ = greedy_num_rules;
+    log_sequence_ = log_sequence;
+    // It has changes made to what was here before.
+    CloseLog();
+    greedy_cover_.reset(nullptr);
+    if (has_greedy_cover) {
+      greedy_cover_.reset(new OrderList);
+      for (auto set_id : greedy_cover) {
+	greedy_cover_->push_back(set_id);
+      }
+    }
+    component_covers_.reset(nullptr);
+    return true;
+  }
+
+  bool OnlineSetCover::LogChange(LogRecord* record) {
+    record->sequence = log_sequence_;
+    if (log_.get() != nullptr) {
+      log_->Append(*record);
+      if (!log_->Commit()) {
+	LOG4CXX_ERROR(online_set_cover_logger, "Can't write change to log.");
+	return false;
+      }
+    }
+    ++log_sequence_;
+    return true;
+  }
+
+  bool OnlineSetCover::OpenLog(const string& path) {
+    if (adds_ != updates_) {
+      LOG4CXX_WARN(online_set_cover_logger, "Update once after add.");
+      return false;
+    }
+    CloseLog();
+    unique_ptr<OpLog> log(new OpLog);
+    vector<LogRecord> records;
+    if (!log->Open(path, &records)) {
+      LOG4CXX_ERROR(online_set_cover_logger, "Can't open log " << path);
+      return false;
+    }
+    // Changes are logged one after the other, a gap or repeat means
+    // the log isn't one of this cover's.
+    for (uint64_t i = 1; i < records.size(); i++) {
+      if (records[i].sequence != records[i - 1].sequence + 1) {
+	LOG4CXX_ERROR(online_set_cover_logger, "Log " << path << " has change "
+		      << records[i].sequence << " after "
+		      << records[i - 1].sequence << ".");
+	return false;
+      }
+    }
+    // Ones before @log_sequence_ are in the cover already.
+    auto first = records.begin();
+    while (first != records.end() && first->sequence < log_sequence_) {
+      ++first;
+    }
+    if (first != records.end() && first->sequence != log_sequence_) {
+      LOG4CXX_ERROR(online_set_cover_logger, "Log " << path << " starts at change "
+		    << first->sequence << ", cover has " << log_sequence_ << ".");
+      return false;
+    }
+    uint64_t num_replayed = records.end() - first;
+    for (; first != records.end(); ++first) {
+      if (!ReplayRecord(*first)) {
+	LOG4CXX_WARN(online_set_cover_logger, "Change " << first->sequence
+		     << " in log " << path << " didn't apply.");
+      }
+    }
+    LOG4CXX_INFO(online_set_cover_logger, "Replayed " << num_replayed
+		 << " changes from log " << path);
+    log_ = std::move(log);
+    return true;
+  }
+
+  bool OnlineSetCover::ReplayRecord(const LogRecord& record) {
+    if (record.kind == LogRecord::kAddRules) {
+      AddRules(record.rules);
+      return true;
+    }
+    if (record.rules.size() != 1) {
+      // Still counts as a change.
+      ++log_sequence_;
+      return false;
+    }
+    const vector<string>& sets = record.rules[0];
+    if (record.kind == LogRecord::kAddRule) {
+      AddRule(sets);
+      UpdateCover();
+      return true;
+    }
+    if (record.kind == LogRecord::kRemoveRule) {
+      return RemoveRule(sets);
+    }
+    if (record.kind == LogRecord::kAddToSet) {
+      return AddToSet(sets, record.set_name);
+    }
+    return RemoveFromSet(sets, record.set_name);
   }
 
   void OnlineSetCover::ShowStats() {
-    if (NoNullPtrs()  && rule_infos_->size() > 0) {
+    if (NoNullPtrs()  && incidence_->num_rules() > 0) {
     LOG4CXX_WARN(online_set_cover_logger, "Size of cover is " << cover_->size() << ", "
 		 << "Lower bound on best set cover is " << (1.0/best_greedy_fraction_) << ", "
-		 << "Size of cover within " << (2.0 * log(rule_infos_->size()))/best_greedy_fraction_ << ", "
-		 << "Number of rules is " << rule_infos_->size() << ", "
-		 << "Number of sets is " << set_infos_->size() << ", "
+		 << "Size of cover within " << (2.0 * log(incidence_->num_rules()))/best_greedy_fraction_ << ", "
+		 << "Number of rules is " << incidence_->num_rules() << ", "
+		 << "Number of sets is " << incidence_->num_sets() << ", "
 		 << greedy_updates_ << " greedy updates of " << updates_ << ".");
     } else {
       LOG4CXX_ERROR(online_set_cover_logger, "ShowStats has nullptrs.");
@@ -95,8 +610,8 @@ namespace incremental_atpg {
   }
 
   bool OnlineSetCover::NoNullPtrs() {
-    if (rule_infos_.get() == nullptr) {
-      LOG4CXX_ERROR(online_set_cover_logger, "rule_infos_ is NULL.");
+    if (incidence_.get() == nullptr) {
+      LOG4CXX_ERROR(online_set_cover_logger, "incidence_ is NULL.");
       return false;
     }
     if (cover_.get() == nullptr) {
@@ -110,42 +625,41 @@ namespace incremental_atpg {
     return true;
   } 
 
-  bool OnlineSetCover::GetSum(double* sum) {
+  bool OnlineSetCover::SumFractions(double stop_above, double* sum) {
     if (!NoNullPtrs()) {
-      LOG4CXX_ERROR(online_set_cover_logger, "In GetSum, with nullptrs.");
+      LOG4CXX_ERROR(online_set_cover_logger, "In SumFractions, with nullptrs.");
       return false;
     }
-        
+
+    // From the back, rules left uncovered after a set are the ones
+    // later sets cover first, plus those nobody covers.
     *sum = 0.0;
-    uint64_t num_sets = 0;
-    for (auto set_name : *cover_.get()) {
-      if (set_processing_infos_->find(set_name) 
-	  == set_processing_infos_->end()) {
-	LOG4CXX_ERROR(online_set_cover_logger, "Set " << set_name
+    uint64_t num_uncovered = NumLiveRules() - cover_counts_.total();
+    for (SetId set_id = cover_->back(); set_id != kNoSet; set_id = cover_->Prev(set_id)) {
+      if (!InCover(set_id)) {
+	LOG4CXX_ERROR(online_set_cover_logger, "Set " << GetSetName(set_id)
 		      << " not in set_processing_infos_.");
 	return false;
       }
-      SetProcessingInfo sp = set_processing_infos_->at(set_name);
-      if (sp.GetNumRules() == 0) {
-	LOG4CXX_ERROR(online_set_cover_logger, "Set " << set_name << " covers no new rules.");
+      uint64_t num_rules = cover_counts_.Get(set_id);
+      if (num_rules == 0) {
+	LOG4CXX_ERROR(online_set_cover_logger, "Set " << GetSetName(set_id)
+		      << " covers no new rules.");
 	return false;
       }
-      if (sp.num_uncovered != 0) {
-	*sum += ((double)sp.GetNumRules())/sp.num_uncovered;
-      } else {
-	LOG4CXX_ERROR(online_set_cover_logger, "Zero uncovered rules before " << set_name) ;
-	return false;
+      num_uncovered += num_rules;
+      *sum += ((double) num_rules)/num_uncovered;
+      if (*sum > stop_above) {
+	return true;
       }
-      ++num_sets;
-      //if (*sum > 1.0) {
-      //	LOG4CXX_WARN(online_set_cover_logger, "Sum exceeds 1.0 after " << num_sets
-      //		     << " of " << cover_->size()) ;
-      //return false;
-      //}
     }
     return true;
   }
 
+  bool OnlineSetCover::GetSum(double* sum) {
+    return SumFractions(numeric_limits<double>::infinity(), sum);
+  }
+
   bool OnlineSetCover::GetMin(double* min) {
     if (!NoNullPtrs()) {
       LOG4CXX_ERROR(online_set_cover_logger, "In GetMin, with nullptrs.");
@@ -153,29 +667,24 @@ namespace incremental_atpg {
     }
         
     *min = 1.0;
-    uint64_t num_sets = 0;
-    for (auto set_name : *cover_.get()) {
-      if (set_processing_infos_->find(set_name) 
-	  == set_processing_infos_->end()) {
-	LOG4CXX_ERROR(online_set_cover_logger, "Set " << set_name
+    uint64_t num_uncovered = NumLiveRules() - cover_counts_.total();
+    for (SetId set_id = cover_->back(); set_id != kNoSet; set_id = cover_->Prev(set_id)) {
+      if (!InCover(set_id)) {
+	LOG4CXX_ERROR(online_set_cover_logger, "Set " << GetSetName(set_id)
 		      << " not in set_processing_infos_.");
 	return false;
       }
-      SetProcessingInfo sp = set_processing_infos_->at(set_name);
-      if (sp.GetNumRules() == 0) {
-	LOG4CXX_ERROR(online_set_cover_logger, "Set " << set_name << " covers no new rules.");
+      uint64_t num_rules = cover_counts_.Get(set_id);
+      if (num_rules == 0) {
+	LOG4CXX_ERROR(online_set_cover_logger, "Set " << GetSetName(set_id)
+		      << " covers no new rules.");
 	return false;
       }
-      if (sp.num_uncovered != 0) {
-	double fraction =  ((double)sp.GetNumRules())/sp.num_uncovered;
-	if (fraction < *min) {
-	  *min = fraction;
-	}
-      } else {
-	LOG4CXX_ERROR(online_set_cover_logger, "Zero uncovered rules before " << set_name) ;
-	return false;
+      num_uncovered += num_rules;
+      double fraction =  ((double) num_rules)/num_uncovered;
+      if (fraction < *min) {
+	*min = fraction;
       }
-      ++num_sets;
     }
     if (*min >= 1.0) {
       return false;
@@ -190,9 +699,12 @@ namespace incremental_atpg {
       return false;
     }
         
+    // Last sets have the largest fractions, so the sum usually gets
+    // past @lower_bound long before the front. Only a cover that
+    // isn't good enough is walked all the way, and greedy runs then.
     double sum = 0.0;
     double lower_bound = (cover_->size() * best_greedy_fraction_)/2.0;
-    if (best_greedy_fraction_ < 1.0 && GetSum(&sum)) {
+    if (best_greedy_fraction_ < 1.0 && SumFractions(lower_bound, &sum)) {
       if (sum > lower_bound) {
 	return true;
       }
@@ -206,28 +718,28 @@ namespace incremental_atpg {
       return false;
     }
 
-    if (rule_infos_.get() == nullptr) {
-      LOG4CXX_ERROR(online_set_cover_logger, "In SanityCheck, but rule_infos_ is NULL.");
+    if (incidence_.get() == nullptr) {
+      LOG4CXX_ERROR(online_set_cover_logger, "In SanityCheck, but incidence_ is NULL.");
       return false;
     }
 
-    uint64_t num_uncovered = rule_infos_->size();
+    uint64_t num_uncovered = incidence_->num_live_rules();
     set<uint64_t> rules_covered;
-    for (auto set_name : *cover_.get()) {
-      if (set_processing_infos_->find(set_name) 
-	  == set_processing_infos_->end()) {
+    for (auto set_id : *cover_.get()) {
+      const string& set_name = GetSetName(set_id);
+      if (!InCover(set_id)) {
 	LOG4CXX_ERROR(online_set_cover_logger, "Set " << set_name
 		      << " not in set_processing_infos_.");
 	return false;
       }
-      SetProcessingInfo sp = set_processing_infos_->at(set_name);
-      if (num_uncovered != sp.num_uncovered) {
+      const SetProcessingInfo& sp = set_processing_infos_->at(set_id);
+      if (num_uncovered != NumUncovered(set_id)) {
 	LOG4CXX_ERROR(online_set_cover_logger, "Set " << set_name
-		      << " says " << num_uncovered << " uncovered rules,"
+		      << " says " << NumUncovered(set_id) << " uncovered rules,"
 		      " expected " << num_uncovered);
 	return false;
       }
-      for (auto rule_id : sp.GetRules()) {
+      for (auto rule_id : sp.covers_rules) {
 	num_uncovered -= 1;
 	if (rule_id >= rule_processing_infos_->size()) {
 	  LOG4CXX_ERROR(online_set_cover_logger, "Rule " << rule_id
@@ -235,12 +747,12 @@ namespace incremental_atpg {
 			<< " not in rule_processing_infos_.");
 	  return false;
 	}
-	RuleProcessingInfo rp = rule_processing_infos_->at(rule_id);
-	if (rp.first_covered_by != set_name) {
+	const RuleProcessingInfo& rp = rule_processing_infos_->at(rule_id);
+	if (rp.first_covered_by != set_id) {
 	  LOG4CXX_ERROR(online_set_cover_logger, "Rule " << rule_id
 			<< " in Set " << set_name 
 			<< " but processing info says it's first "
-			" covered by " << rp.first_covered_by);
+			" covered by " << GetSetName(rp.first_covered_by));
 	  return false;
 	}
 	if (!rules_covered.insert(rule_id).second) {
@@ -251,7 +763,7 @@ namespace incremental_atpg {
       }
     }
 
-    if (rules_covered.size() != rule_infos_->size()) {
+    if (rules_covered.size() != incidence_->num_live_rules()) {
       LOG4CXX_ERROR(online_set_cover_logger, "Not all rules covered.");
       return false;
     }
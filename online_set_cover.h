@@ -8,12 +8,16 @@
 #include <map>
 #include <stdint.h>
 #include <utility>
+#include <thread>
+#include <mutex>
 #include <log4cxx/logger.h>
 
 #include "gtest/gtest_prod.h"
 #include "set_cover.h"
 #include "lazy_set_cover.h"
 #include "greedy_set_cover.h"
+#include "parallel_greedy_set_cover.h"
+#include "op_log.h"
 
 namespace incremental_atpg {
   using std::vector;
@@ -25,71 +29,306 @@ namespace incremental_atpg {
   using std::set;
   using std::list;
 
+  // Greedy set cover OnlineSetCover falls back to when its cover
+  // isn't good enough.
+  enum GreedyEngine {
+    kSerialGreedy,
+    // ParallelGreedySetCover, cover may be a bit larger.
+    kParallelGreedy
+  };
+
+  // What OnlineSetCover::AddRules did with a batch.
+  struct BatchStats {
+    uint64_t num_rules;
+    // Rules that got to @incidence_, e.g., not dropped by a kernel.
+    uint64_t num_new_rules;
+    uint64_t cover_size_before;
+    uint64_t cover_size_after;
+    // Whether greedy ran (or started in background) for the batch.
+    bool greedy;
+    // Spent adding rules and updating lazy cover, and in greedy.
+    double lazy_seconds;
+    double greedy_seconds;
+  BatchStats()
+  : num_rules(0),
+      num_new_rules(0),
+      cover_size_before(0),
+      cover_size_after(0),
+      greedy(false),
+      lazy_seconds(0.0),
+      greedy_seconds(0.0) { }
+  };
+
+  class OnlineSetCover;
+
+  // Change to rules in @incidence_ while greedy runs in background.
+  struct RuleChange {
+    enum Kind {
+      kAddRule,
+      kRemoveRule,
+      kAddToSet,
+      kRemoveFromSet
+    };
+    Kind kind;
+    // Sets the rule is in, before the change.
+    vector<SetId> set_ids;
+    // Set it goes in or out of, for kAddToSet and kRemoveFromSet.
+    SetId set_id;
+  RuleChange(Kind change_kind, const vector<SetId>& ids, SetId set = kNoSet)
+  : kind(change_kind),
+      set_ids(ids),
+      set_id(set) { }
+  };
+
+  // Greedy cover being found on a thread, see
+  // OnlineSetCover::SetBackgroundRebuild.
+  struct BackgroundRebuild {
+    std::thread thread;
+    std::mutex mutex;
+    // Finds greedy cover of rules in snapshot, then replays
+    // @pending. Only the thread touches it until @done.
+    unique_ptr<OnlineSetCover> replica;
+    // Rules added to or removed from @incidence_ since snapshot, in
+    // order, not handed to @replica yet. Under @mutex.
+    vector<RuleChange> pending;
+    // Set by thread, under @mutex, when it found @pending empty.
+    bool done;
+    // Rules before this are in snapshot or @pending.
+    uint64_t num_queued;
+  BackgroundRebuild()
+  : done(false),
+      num_queued(0) { }
+  };
+
   class OnlineSetCover : public LazySetCover {
   public:
     log4cxx::LoggerPtr online_set_cover_logger;
    
   OnlineSetCover()
     : gr_(nullptr),
+      pgr_(nullptr),
+      greedy_engine_(kSerialGreedy),
+      warm_start_(true),
+      greedy_num_rules_(0),
+      solve_by_component_(false),
+      num_threads_(0),
+      background_rebuild_(false),
       adds_(0),
       updates_(0),
       best_greedy_fraction_(1.0),
       greedy_updates_(0),
-      greedy_adds_(0) {
+      greedy_adds_(0),
+      log_sequence_(0) {
       online_set_cover_logger = Logger::getLogger("OnlineSetCover");
       online_set_cover_logger->setLevel(log4cxx::Level::getWarn());
     }
 
-    // Takes ownership of @set_infos..
-  OnlineSetCover(map<string, SetInfo>* set_infos,
-		 vector<RuleInfo>* rule_infos)
-    : LazySetCover(set_infos, rule_infos),
+    // Takes ownership of @set_names, @incidence.
+  OnlineSetCover(SymbolTable* set_names,
+		 Incidence* incidence)
+    : LazySetCover(set_names, incidence),
       gr_(nullptr),
+      pgr_(nullptr),
+      greedy_engine_(kSerialGreedy),
+      warm_start_(true),
+      greedy_num_rules_(0),
+      solve_by_component_(false),
+      num_threads_(0),
+      background_rebuild_(false),
       adds_(0),
       updates_(0),
       best_greedy_fraction_(1.0),
       greedy_updates_(0),
-      greedy_adds_(0)  {
+      greedy_adds_(0),
+      log_sequence_(0) {
       online_set_cover_logger = Logger::getLogger("OnlineSetCover");
       online_set_cover_logger->setLevel(log4cxx::Level::getWarn());
     }
 
-  OnlineSetCover(map<string, SetInfo>* set_infos,
-		 vector<RuleInfo>* rule_infos,
-		 map<string, SetProcessingInfo>* set_processing_infos,
+  OnlineSetCover(SymbolTable* set_names,
+		 Incidence* incidence,
+		 vector<SetProcessingInfo>* set_processing_infos,
 		 vector<RuleProcessingInfo>* rule_processing_infos,
-		 list<string>* cover)
-    : LazySetCover(set_infos, rule_infos, set_processing_infos,
+		 OrderList* cover)
+    : LazySetCover(set_names, incidence, set_processing_infos,
 		   rule_processing_infos, cover),
       gr_(nullptr),
+      pgr_(nullptr),
+      greedy_engine_(kSerialGreedy),
+      warm_start_(true),
+      greedy_num_rules_(0),
+      solve_by_component_(false),
+      num_threads_(0),
+      background_rebuild_(false),
       adds_(0),
       updates_(0),
       best_greedy_fraction_(1.0),
       greedy_updates_(0),
-      greedy_adds_(0)  {
+      greedy_adds_(0),
+      log_sequence_(0) {
       online_set_cover_logger = Logger::getLogger("OnlineSetCover");
       online_set_cover_logger->setLevel(log4cxx::Level::getWarn());
     }
 
+    // Waits for a background rebuild, if there's one.
+    ~OnlineSetCover();
+
     void AddRule(const vector<string>& sets);
     void UpdateCover();
+    // Adds all @rules and updates cover, like AddRule and UpdateCover
+    // for each, but only checks the cover is good enough, and falls
+    // back to greedy, once at the end. If the batch has more rules
+    // than there are so far, goes straight to greedy. Skips empty
+    // rules, which no cover has, with a warning. Fills in @stats if
+    // it isn't null.
+    void AddRules(const vector<vector<string> >& rules,
+		  BatchStats* stats = nullptr);
+    // Like LazySetCover::RemoveRule, AddToSet and RemoveFromSet, then
+    // fall back to greedy if cover isn't good enough anymore, like
+    // UpdateCover. With a background rebuild, the change is replayed
+    // on it too.
+    bool RemoveRule(const vector<string>& sets);
+    bool AddToSet(const vector<string>& rule_sets, const string& set_name);
+    bool RemoveFromSet(const vector<string>& rule_sets, const string& set_name);
     void ShowStats();
     bool SanityCheck();
+    // Number of UpdateCover's, or rules AddRules added, so far, and
+    // how many times cover was rebuilt with greedy.
+    uint64_t num_updates() const {
+      return updates_;
+    }
+    uint64_t num_greedy_updates() const {
+      return greedy_updates_;
+    }
+    // Writes everything needed to pick up where we are to @path, in
+    // one binary file, replacing it only once it's all written:
+    // sets, rules, processing infos, cover, counters and last greedy
+    // cover. Options and component covers aren't saved. Waits for a
+    // background rebuild first. Returns false if it can't write, in
+    // the middle of an add, or when kernelizing.
+    bool SaveSnapshot(const string& path);
+    // Replaces everything SaveSnapshot writes with what's in @path.
+    // Returns false, and changes nothing, if it can't read a
+    // snapshot of this version there. Closes log, if there's one.
+    bool LoadSnapshot(const string& path);
+    // Replays changes in log at @path the cover doesn't have yet,
+    // e.g., made after the snapshot LoadSnapshot loaded, then writes
+    // every change from now on to it before making it: AddRule,
+    // AddRules (one record and one sync for the batch), RemoveRule,
+    // AddToSet and RemoveFromSet. SaveSnapshot empties it. Replay
+    // gets the exact cover back without background rebuilds, whose
+    // timing it can't repeat. Returns false, and replays nothing, if
+    // it can't open a log there, or the log starts after the cover.
+    bool OpenLog(const string& path);
+    void CloseLog() {
+      log_.reset(nullptr);
+    }
+    // Used by later UpdateCover's. Default is kSerialGreedy,
+    // @options are only used with kParallelGreedy.
+    void SetGreedyEngine(GreedyEngine greedy_engine,
+			 const ParallelGreedyOptions& options = ParallelGreedyOptions()) {
+      greedy_engine_ = greedy_engine;
+      parallel_greedy_options_ = options;
+    }
+    // Whether GreedySetCover starts from the last cover it found,
+    // see GreedySetCover::SetWarmStart. Default is true.
+    void SetWarmStart(bool warm_start) {
+      warm_start_ = warm_start;
+    }
+    // Whether GreedySetCover only re-runs in components with rules
+    // added since its last cover, see
+    // GreedySetCover::SetSolveByComponent. Takes precedence over warm
+    // start. Default is false.
+    void SetSolveByComponent(bool solve_by_component, unsigned num_threads = 0) {
+      solve_by_component_ = solve_by_component;
+      num_threads_ = num_threads;
+    }
+    // Whether greedy runs on a thread when cover isn't good enough,
+    // on copies of @set_names_ and @incidence_. The lazy cover keeps
+    // getting updated meanwhile, and rules added since the copy are
+    // replayed on the greedy cover, which replaces it in a later
+    // UpdateCover once it has caught up. Default is false.
+    void SetBackgroundRebuild(bool background_rebuild) {
+      background_rebuild_ = background_rebuild;
+    }
+    bool RebuildInProgress() const {
+      return rebuild_.get() != nullptr;
+    }
+    // Blocks until background rebuild, if there's one, is done and
+    // swapped in.
+    void WaitForRebuild() {
+      FinishRebuild(true);
+    }
 
   protected:
     unique_ptr<GreedySetCover> gr_;
+    unique_ptr<ParallelGreedySetCover> pgr_;
+    GreedyEngine greedy_engine_;
+    ParallelGreedyOptions parallel_greedy_options_;
+    bool warm_start_;
+    // Last cover GreedySetCover found and number of rules then, if
+    // there's one.
+    unique_ptr<OrderList> greedy_cover_;
+    uint64_t greedy_num_rules_;
+    bool solve_by_component_;
+    unsigned num_threads_;
+    // What GreedySetCover picked in each component last time.
+    unique_ptr<ComponentCovers> component_covers_;
+    bool background_rebuild_;
+    unique_ptr<BackgroundRebuild> rebuild_;
+
+    // Replaces cover with a greedy one, with engine and options set.
+    void RebuildWithGreedy();
+    // Snapshots rules so far into a replica and runs RebuildWithGreedy
+    // on it in @rebuild_.
+    void StartRebuild();
+    // Hands rules added to @incidence_ since last time to @rebuild_.
+    void QueueRulesForRebuild();
+    // If @rebuild_ is done, or once it is if @wait, replays rules it
+    // hasn't seen and swaps its cover in. Returns true if it did.
+    bool FinishRebuild(bool wait);
+    // Makes @change to lazy cover, hands it to @rebuild_ if there's
+    // one, else checks cover is still good enough. Returns false if
+    // it can't be made.
+    bool ChangeRule(const RuleChange& change);
+    // Makes @change to lazy cover. Returns false if it can't be made.
+    bool ReplayChange(const RuleChange& change);
+    // Numbers @record and writes it to @log_, if there's one. Returns
+    // false if it can't, and the change mustn't be made.
+    bool LogChange(LogRecord* record);
+    // Makes change in @record again, like it was made first.
+    bool ReplayRecord(const LogRecord& record);
     bool NoNullPtrs();
+    // Fraction of a set is number of rules it covers first over
+    // number of rules uncovered just before it. Both walk cover once
+    // from the back, with a running count instead of NumUncovered.
     bool GetMin(double* min);
     bool GetSum(double* sum);
+    // Like GetSum, but stops once @sum is above @stop_above. Returns
+    // false if some set it got to covers no new rules.
+    bool SumFractions(double stop_above, double* sum);
     bool GoodEnough();
     uint64_t adds_;
     uint64_t updates_;
     double best_greedy_fraction_;
     uint64_t greedy_updates_;
     uint64_t greedy_adds_;
+    unique_ptr<OpLog> log_;
+    // Sequence number of next change, in log or not.
+    uint64_t log_sequence_;
   private:
     friend class OnlineSetCoverTest;
     FRIEND_TEST(OnlineSetCoverTest, UpdateCover);
+    FRIEND_TEST(OnlineSetCoverTest, ParallelGreedy);
+    FRIEND_TEST(OnlineSetCoverTest, WarmStart);
+    FRIEND_TEST(OnlineSetCoverTest, SolveByComponent);
+    FRIEND_TEST(OnlineSetCoverTest, SolveByComponentInBackground);
+    FRIEND_TEST(OnlineSetCoverTest, BackgroundRebuild);
+    FRIEND_TEST(OnlineSetCoverTest, AddRules);
+    FRIEND_TEST(OnlineSetCoverTest, RemoveRule);
+    FRIEND_TEST(OnlineSetCoverTest, Memberships);
+    FRIEND_TEST(OnlineSetCoverTest, Snapshot);
+    FRIEND_TEST(OnlineSetCoverTest, OpLog);
   };
 }  // namespace incremental_atpg
 #endif  // INCREMENTAL_ATPG_ONLINE_SET_COVER_H_
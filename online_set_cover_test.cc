@@ -1,6 +1,7 @@
 #include "online_set_cover.h"
 #include "gtest/gtest.h"
 
+#include <cstdio>
 #include <ctime>
 #include <fstream>
 #include <memory>
@@ -43,6 +44,11 @@ namespace incremental_atpg {
     }
     virtual void TearDown() {
     }
+    SetId Id(const string& set_name) {
+      SetId set_id = kNoSet;
+      sc_->GetSetId(set_name, &set_id);
+      return set_id;
+    }
     std::unique_ptr<OnlineSetCover> sc_;
   };
 
@@ -64,26 +70,350 @@ namespace incremental_atpg {
     sc_->UpdateCover();
     EXPECT_TRUE(sc_->SanityCheck());
     EXPECT_EQ(2, sc_->cover_->size());
-    EXPECT_EQ("dog", sc_->rule_processing_infos_->at(0).first_covered_by);
-    EXPECT_EQ("dog", sc_->rule_processing_infos_->at(1).first_covered_by);
-    EXPECT_EQ("rain", sc_->rule_processing_infos_->at(2).first_covered_by);
+    EXPECT_EQ(Id("dog"), sc_->rule_processing_infos_->at(0).first_covered_by);
+    EXPECT_EQ(Id("dog"), sc_->rule_processing_infos_->at(1).first_covered_by);
+    EXPECT_EQ(Id("rain"), sc_->rule_processing_infos_->at(2).first_covered_by);
 
     LOG4CXX_WARN(sc_->online_set_cover_logger, "\n\nAdding {\"rain\"}");
     sc_->AddRule({"rain"});
     sc_->UpdateCover();
     EXPECT_TRUE(sc_->SanityCheck());
     EXPECT_EQ(2, sc_->cover_->size());
-    EXPECT_EQ("dog", sc_->cover_->front());
+    EXPECT_EQ(Id("dog"), sc_->cover_->front());
 
     LOG4CXX_WARN(sc_->online_set_cover_logger, "\n\nAdding {\"rain\"}");
     sc_->AddRule({"rain"});
     sc_->UpdateCover();
     EXPECT_EQ(2, sc_->cover_->size());
-    EXPECT_EQ("rain", sc_->cover_->front());
-    EXPECT_EQ("dog", sc_->cover_->back());
+    EXPECT_EQ(Id("rain"), sc_->cover_->front());
+    EXPECT_EQ(Id("dog"), sc_->cover_->back());
+  }
+
+  TEST_F(OnlineSetCoverTest, ParallelGreedy) {
+    ParallelGreedyOptions options;
+    options.num_threads = 4;
+    sc_->SetGreedyEngine(kParallelGreedy, options);
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      sc_->AddRule({GetString(rule % 17), GetString(rule % 5 + 17),
+	    GetString((rule * rule) % 23 + 22)});
+      sc_->UpdateCover();
+      EXPECT_TRUE(sc_->SanityCheck());
+    }
+    EXPECT_GT(sc_->greedy_updates_, 0);
+  }
+
+  TEST_F(OnlineSetCoverTest, WarmStart) {
+    OnlineSetCover cold;
+    cold.SetWarmStart(false);
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      vector<string> sets = {GetString(rule % 17), GetString(rule % 5 + 17),
+			     GetString((rule * rule) % 23 + 22)};
+      sc_->AddRule(sets);
+      cold.AddRule(sets);
+      sc_->UpdateCover();
+      cold.UpdateCover();
+      EXPECT_TRUE(sc_->SanityCheck());
+      ASSERT_EQ(cold.GetCover(), sc_->GetCover());
+    }
+    EXPECT_GT(sc_->greedy_updates_, 1);
+  }
+
+  TEST_F(OnlineSetCoverTest, SolveByComponent) {
+    OnlineSetCover whole;
+    sc_->SetSolveByComponent(true, 4);
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      // Sets of different slices only meet now and then.
+      uint64_t slice = rule % 6;
+      vector<string> sets = {GetString(slice * 100 + rule % 7),
+			     GetString(slice * 100 + (rule * rule) % 11 + 7)};
+      if (rule % 50 == 49) {
+	sets.push_back(GetString((slice + 1) % 6 * 100));
+      }
+      sc_->AddRule(sets);
+      whole.AddRule(sets);
+      sc_->UpdateCover();
+      whole.UpdateCover();
+      EXPECT_TRUE(sc_->SanityCheck());
+      ASSERT_EQ(whole.GetCover(), sc_->GetCover());
+    }
+    EXPECT_GT(sc_->greedy_updates_, 1);
+  }
+
+  TEST_F(OnlineSetCoverTest, SolveByComponentInBackground) {
+    sc_->SetSolveByComponent(true, 2);
+    sc_->SetBackgroundRebuild(true);
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      uint64_t slice = rule % 6;
+      vector<string> sets = {GetString(slice * 100 + rule % 7),
+			     GetString(slice * 100 + (rule * rule) % 11 + 7)};
+      sc_->AddRule(sets);
+      sc_->UpdateCover();
+      EXPECT_TRUE(sc_->SanityCheck());
+      if (rule % 50 == 49) {
+	// Replica solves the components with rules since last time,
+	// with infos of the rest copied in.
+	sc_->WaitForRebuild();
+	EXPECT_TRUE(sc_->SanityCheck());
+      }
+    }
+    sc_->WaitForRebuild();
+    EXPECT_TRUE(sc_->SanityCheck());
+    EXPECT_GT(sc_->greedy_updates_, 1);
+  }
+
+  TEST_F(OnlineSetCoverTest, BackgroundRebuild) {
+    sc_->SetBackgroundRebuild(true);
+    bool started = false;
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      sc_->AddRule({GetString(rule % 17), GetString(rule % 5 + 17),
+	    GetString((rule * rule) % 23 + 22)});
+      sc_->UpdateCover();
+      // Lazy cover is still good while greedy runs.
+      EXPECT_TRUE(sc_->SanityCheck());
+      started = started || sc_->RebuildInProgress();
+    }
+    EXPECT_TRUE(started);
+    sc_->WaitForRebuild();
+    EXPECT_FALSE(sc_->RebuildInProgress());
+    EXPECT_TRUE(sc_->SanityCheck());
+    EXPECT_EQ(300, sc_->incidence_->num_rules());
+    EXPECT_GT(sc_->greedy_updates_, 0);
+  }
+
+  TEST_F(OnlineSetCoverTest, AddRules) {
+    vector<vector<string> > rules;
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      rules.push_back({GetString(rule % 17), GetString(rule % 5 + 17),
+	    GetString((rule * rule) % 23 + 22)});
+    }
+    // More rules than so far, straight to greedy.
+    BatchStats stats;
+    sc_->AddRules(vector<vector<string> >(rules.begin(), rules.begin() + 200), &stats);
+    EXPECT_TRUE(sc_->SanityCheck());
+    EXPECT_EQ(200, stats.num_rules);
+    EXPECT_EQ(200, stats.num_new_rules);
+    EXPECT_EQ(0, stats.cover_size_before);
+    EXPECT_EQ(sc_->cover_->size(), stats.cover_size_after);
+    EXPECT_TRUE(stats.greedy);
+    EXPECT_EQ(1, sc_->greedy_updates_);
+
+    // Lazy for the rest, one rule at a time still works after.
+    sc_->AddRules(vector<vector<string> >(rules.begin() + 200, rules.end() - 1), &stats);
+    EXPECT_TRUE(sc_->SanityCheck());
+    EXPECT_EQ(99, stats.num_rules);
+    EXPECT_EQ(sc_->cover_->size(), stats.cover_size_after);
+    sc_->AddRule(rules.back());
+    sc_->UpdateCover();
+    EXPECT_TRUE(sc_->SanityCheck());
+    EXPECT_EQ(300, sc_->incidence_->num_rules());
+
+    // Empty rules are skipped, also when they're all of a first batch.
+    OnlineSetCover empty;
+    empty.AddRules({{}}, &stats);
+    EXPECT_TRUE(empty.SanityCheck());
+    EXPECT_EQ(1, stats.num_rules);
+    EXPECT_EQ(0, stats.num_new_rules);
+    EXPECT_FALSE(stats.greedy);
+    EXPECT_EQ(0, empty.incidence_->num_rules());
+    empty.AddRules({{}, rules[0], {}}, &stats);
+    EXPECT_TRUE(empty.SanityCheck());
+    EXPECT_EQ(1, stats.num_new_rules);
+    EXPECT_EQ(1, empty.incidence_->num_rules());
+  }
+
+  TEST_F(OnlineSetCoverTest, RemoveRule) {
+    vector<vector<string> > rules;
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      rules.push_back({GetString(rule % 17), GetString(rule % 5 + 17),
+	    GetString((rule * rule) % 23 + 22)});
+      sc_->AddRule(rules.back());
+      sc_->UpdateCover();
+    }
+    EXPECT_FALSE(sc_->RemoveRule({GetString(0)}));
+    for (uint64_t rule = 0; rule < 300; rule += 3) {
+      EXPECT_TRUE(sc_->RemoveRule(rules[rule]));
+      EXPECT_TRUE(sc_->SanityCheck());
+    }
+    EXPECT_EQ(200, sc_->incidence_->num_live_rules());
+    // Greedy drops removed rules.
+    sc_->RebuildWithGreedy();
+    EXPECT_TRUE(sc_->SanityCheck());
+    EXPECT_EQ(200, sc_->incidence_->num_rules());
+    sc_->AddRule(rules[0]);
+    sc_->UpdateCover();
+    EXPECT_TRUE(sc_->SanityCheck());
+
+    // Removals while greedy runs in background get replayed on it.
+    sc_.reset(new OnlineSetCover);
+    sc_->SetBackgroundRebuild(true);
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      sc_->AddRule(rules[rule]);
+      sc_->UpdateCover();
+      if (rule % 3 == 2) {
+	EXPECT_TRUE(sc_->RemoveRule(rules[rule - 1]));
+      }
+      EXPECT_TRUE(sc_->SanityCheck());
+    }
+    sc_->WaitForRebuild();
+    EXPECT_TRUE(sc_->SanityCheck());
+    EXPECT_EQ(200, sc_->incidence_->num_live_rules());
+    EXPECT_GT(sc_->greedy_updates_, 0);
+  }
+
+  TEST_F(OnlineSetCoverTest, Memberships) {
+    vector<vector<string> > rules;
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      rules.push_back({GetString(rule % 17), GetString(rule % 5 + 17),
+	    GetString((rule * rule) % 23 + 22)});
+      sc_->AddRule(rules.back());
+      sc_->UpdateCover();
+    }
+    // Every other rule moves from one set to another, as when a
+    // packet's path changes.
+    for (uint64_t rule = 0; rule < 300; rule += 2) {
+      string to = GetString(rule % 7 + 45);
+      EXPECT_TRUE(sc_->AddToSet(rules[rule], to));
+      rules[rule].push_back(to);
+      EXPECT_TRUE(sc_->SanityCheck());
+      EXPECT_TRUE(sc_->RemoveFromSet(rules[rule], rules[rule][0]));
+      rules[rule].erase(rules[rule].begin());
+      EXPECT_TRUE(sc_->SanityCheck());
+    }
+    EXPECT_FALSE(sc_->RemoveFromSet(rules[1], GetString(45)));
+    EXPECT_EQ(300, sc_->incidence_->num_live_rules());
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      EXPECT_NE(kNoRule, sc_->incidence_->FindRule(vector<SetId>({Id(rules[rule][0]),
+	      Id(rules[rule][1]), Id(rules[rule][2])})));
+    }
+
+    // Same with greedy in background.
+    sc_.reset(new OnlineSetCover);
+    sc_->SetBackgroundRebuild(true);
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      sc_->AddRule(rules[rule]);
+      sc_->UpdateCover();
+      if (rule % 2 == 1) {
+	EXPECT_TRUE(sc_->RemoveFromSet(rules[rule - 1], rules[rule - 1][0]));
+	EXPECT_TRUE(sc_->AddToSet({rules[rule - 1][1], rules[rule - 1][2]},
+				  GetString(rule % 11 + 52)));
+      }
+      EXPECT_TRUE(sc_->SanityCheck());
+    }
+    sc_->WaitForRebuild();
+    EXPECT_TRUE(sc_->SanityCheck());
+    EXPECT_EQ(300, sc_->incidence_->num_live_rules());
+  }
+
+  TEST_F(OnlineSetCoverTest, Snapshot) {
+    vector<vector<string> > rules;
+    for (uint64_t rule = 0; rule < 400; rule++) {
+      rules.push_back({GetString(rule % 17), GetString(rule % 5 + 17),
+	    GetString((rule * rule) % 23 + 22)});
+    }
+    for (uint64_t rule = 0; rule < 300; rule++) {
+      sc_->AddRule(rules[rule]);
+      sc_->UpdateCover();
+    }
+    sc_->RemoveRule(rules[3]);
+    sc_->AddToSet(rules[4], "sand");
+    EXPECT_TRUE(sc_->SaveSnapshot("online_set_cover_test.snp"));
+
+    OnlineSetCover loaded;
+    EXPECT_FALSE(loaded.LoadSnapshot("no_such_file.snp"));
+    ASSERT_TRUE(loaded.LoadSnapshot("online_set_cover_test.snp"));
+    std::remove("online_set_cover_test.snp");
+    EXPECT_TRUE(loaded.SanityCheck());
+    EXPECT_EQ(sc_->GetCover(), loaded.GetCover());
+    EXPECT_EQ(sc_->updates_, loaded.updates_);
+    EXPECT_EQ(sc_->greedy_updates_, loaded.greedy_updates_);
+    EXPECT_EQ(sc_->best_greedy_fraction_, loaded.best_greedy_fraction_);
+    EXPECT_EQ(sc_->incidence_->num_live_rules(), loaded.incidence_->num_live_rules());
+
+    // Both go on the same way.
+    for (uint64_t rule = 300; rule < 400; rule++) {
+      sc_->AddRule(rules[rule]);
+      sc_->UpdateCover();
+      loaded.AddRule(rules[rule]);
+      loaded.UpdateCover();
+      ASSERT_EQ(sc_->GetCover(), loaded.GetCover());
+    }
+    EXPECT_TRUE(loaded.SanityCheck());
+  }
+
+  TEST_F(OnlineSetCoverTest, OpLog) {
+    const string log_path = "online_set_cover_test.log";
+    const string snapshot_path = "online_set_cover_test.snp";
+    std::remove(log_path.c_str());
+    vector<vector<string> > rules;
+    for (uint64_t rule = 0; rule < 400; rule++) {
+      rules.push_back({GetString(rule % 19), GetString(rule % 7 + 19),
+	    GetString((rule * rule) % 29 + 26)});
+    }
+    ASSERT_TRUE(sc_->OpenLog(log_path));
+    for (uint64_t rule = 0; rule < 100; rule++) {
+      sc_->AddRule(rules[rule]);
+      sc_->UpdateCover();
+    }
+    sc_->AddRules(vector<vector<string> >(rules.begin() + 100, rules.begin() + 200));
+    EXPECT_TRUE(sc_->RemoveRule(rules[5]));
+    EXPECT_FALSE(sc_->RemoveRule({"no", "such", "rule"}));
+    EXPECT_TRUE(sc_->AddToSet(rules[6], "sand"));
+
+    // Log alone gets the same cover back.
+    {
+      OnlineSetCover replayed;
+      ASSERT_TRUE(replayed.OpenLog(log_path));
+      EXPECT_TRUE(replayed.SanityCheck());
+      EXPECT_EQ(sc_->GetCover(), replayed.GetCover());
+      EXPECT_EQ(sc_->log_sequence_, replayed.log_sequence_);
+    }
+
+    ASSERT_TRUE(sc_->SaveSnapshot(snapshot_path));
+    for (uint64_t rule = 200; rule < 300; rule++) {
+      sc_->AddRule(rules[rule]);
+      sc_->UpdateCover();
+    }
+    EXPECT_TRUE(sc_->RemoveFromSet(rules[7], rules[7][0]));
+    EXPECT_TRUE(sc_->RemoveRule(rules[250]));
+    sc_->AddRules(vector<vector<string> >(rules.begin() + 300, rules.end()));
+    sc_->CloseLog();
+
+    // Snapshot and log tail after it, without changes in the log
+    // before the snapshot.
+    OnlineSetCover recovered;
+    ASSERT_TRUE(recovered.LoadSnapshot(snapshot_path));
+    ASSERT_TRUE(recovered.OpenLog(log_path));
+    EXPECT_TRUE(recovered.SanityCheck());
+    EXPECT_EQ(sc_->GetCover(), recovered.GetCover());
+    EXPECT_EQ(sc_->log_sequence_, recovered.log_sequence_);
+    EXPECT_EQ(sc_->greedy_updates_, recovered.greedy_updates_);
+    EXPECT_EQ(sc_->incidence_->num_live_rules(),
+	      recovered.incidence_->num_live_rules());
+
+    // A log that starts after the cover doesn't replay.
+    OnlineSetCover fresh;
+    EXPECT_FALSE(fresh.OpenLog(log_path));
+    EXPECT_EQ(0, fresh.incidence_->num_rules());
+
+    // Nor does one with a change twice.
+    std::remove(log_path.c_str());
+    {
+      OpLog log;
+      ASSERT_TRUE(log.Open(log_path, nullptr));
+      LogRecord record(LogRecord::kAddRules, {rules[0]});
+      log.Append(record);
+      record.sequence = 1;
+      log.Append(record);
+      log.Append(record);
+      ASSERT_TRUE(log.Commit());
+    }
+    EXPECT_FALSE(fresh.OpenLog(log_path));
+    EXPECT_EQ(0, fresh.incidence_->num_rules());
+    std::remove(log_path.c_str());
+    std::remove(snapshot_path.c_str());
   }
 
-  /* 
+  /*
   TEST_F(OnlineSetCoverTest, UpdateCoverMany) {
     vector<vector<string> > sets(num_rules_);
     srand(10);
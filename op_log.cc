@@ -0,0 +1,282 @@
+#include "op_log.h"
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+
+  static const char kMagic[8] = {'I', 'A', 'T', 'P', 'G', 'L', 'O', 'G'};
+  static const uint32_t kByteOrderMark = 0x01020304;
+  static const uint64_t kHeaderSize = 16;
+  static const uint64_t kRecordHeaderSize = 8;
+  // Anything bigger is a bad size, not a record.
+  static const uint32_t kMaxRecordSize = 1 << 30;
+
+  static vector<uint32_t> MakeCrcTable() {
+    vector<uint32_t> table(256);
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int bit = 0; bit < 8; bit++) {
+	c = (c & 1) ? 0xedb88320U ^ (c >> 1) : c >> 1;
+      }
+      table[i] = c;
+    }
+    return table;
+  }
+
+  // CRC-32 (IEEE), one table lookup per byte.
+  static uint32_t Crc32(const char* data, uint64_t size) {
+    static const vector<uint32_t> table = MakeCrcTable();
+    uint32_t crc = 0xffffffffU;
+    for (uint64_t i = 0; i < size; i++) {
+      crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffffU;
+  }
+
+  static void PutUint32(uint32_t value, string* out) {
+    out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  static void PutString(const string& value, string* out) {
+    PutUint32(value.size(), out);
+    out->append(value);
+  }
+
+  // Reads values off a payload, failing once it runs out.
+  class PayloadReader {
+  public:
+  PayloadReader(const char* data, uint64_t size)
+    : data_(data),
+      left_(size) { }
+    template <typename T>
+      bool Get(T* value) {
+      if (left_ < sizeof(T)) {
+	return false;
+      }
+      std::memcpy(value, data_, sizeof(T));
+      data_ += sizeof(T);
+      left_ -= sizeof(T);
+      return true;
+    }
+    bool GetString(string* value) {
+      uint32_t size = 0;
+      if (!Get(&size) || left_ < size) {
+	return false;
+      }
+      value->assign(data_, size);
+      data_ += size;
+      left_ -= size;
+      return true;
+    }
+    bool AtEnd() const {
+      return left_ == 0;
+    }
+  private:
+    const char* data_;
+    uint64_t left_;
+  };
+
+  static bool ParsePayload(const char* data, uint64_t size, LogRecord* record) {
+    PayloadReader reader(data, size);
+    uint8_t kind = 0;
+    uint32_t num_rules = 0;
+    if (!reader.Get(&record->sequence) || !reader.Get(&kind)
+	|| kind > LogRecord::kRemoveFromSet || !reader.Get(&num_rules)
+	|| num_rules > size) {
+      return false;
+    }
+    record->kind = static_cast<LogRecord::Kind>(kind);
+    record->rules.assign(num_rules, vector<string>());
+    for (auto& rule : record->rules) {
+      uint32_t num_sets = 0;
+      if (!reader.Get(&num_sets) || num_sets > size) {
+	return false;
+      }
+      rule.resize(num_sets);
+      for (auto& set_name : rule) {
+	if (!reader.GetString(&set_name)) {
+	  return false;
+	}
+      }
+    }
+    return reader.GetString(&record->set_name) && reader.AtEnd();
+  }
+
+  OpLog::OpLog()
+    : fd_(-1),
+      sync_(true) {
+  }
+
+  OpLog::~OpLog() {
+    Close();
+  }
+
+  void OpLog::Close() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = -1;
+    buffer_.clear();
+  }
+
+  bool OpLog::Read(const string& path, vector<LogRecord>* records,
+		   uint64_t* valid_size) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < kHeaderSize) {
+      close(fd);
+      return false;
+    }
+    uint64_t size = st.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    const char* data = static_cast<const char*>(mapped);
+    uint32_t version = 0;
+    uint32_t byte_order = 0;
+    std::memcpy(&version, data + sizeof(kMagic), sizeof(uint32_t));
+    std::memcpy(&byte_order, data + sizeof(kMagic) + sizeof(uint32_t), sizeof(uint32_t));
+    if (std::memcmp(data, kMagic, sizeof(kMagic)) != 0
+	|| version != kOpLogVersion || byte_order != kByteOrderMark) {
+      munmap(mapped, size);
+      return false;
+    }
+    uint64_t offset = kHeaderSize;
+    LogRecord record;
+    while (size - offset >= kRecordHeaderSize) {
+      uint32_t payload_size = 0;
+      uint32_t crc = 0;
+      std::memcpy(&payload_size, data + offset, sizeof(uint32_t));
+      std::memcpy(&crc, data + offset + sizeof(uint32_t), sizeof(uint32_t));
+      const char* payload = data + offset + kRecordHeaderSize;
+      if (payload_size > kMaxRecordSize
+	  || payload_size > size - offset - kRecordHeaderSize
+	  || Crc32(payload, payload_size) != crc
+	  || !ParsePayload(payload, payload_size, &record)) {
+	break;
+      }
+      if (records != nullptr) {
+	records->push_back(record);
+      }
+      offset += kRecordHeaderSize + payload_size;
+    }
+    munmap(mapped, size);
+    *valid_size = offset;
+    return true;
+  }
+
+  bool OpLog::Open(const string& path, vector<LogRecord>* records) {
+    Close();
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      Close();
+      return false;
+    }
+    // Nothing was committed before a torn header.
+    if ((uint64_t) st.st_size < kHeaderSize) {
+      if (ftruncate(fd_, 0) != 0 || !WriteHeader()) {
+	Close();
+	return false;
+      }
+      return true;
+    }
+    uint64_t valid_size = 0;
+    if (!Read(path, records, &valid_size)
+	|| ftruncate(fd_, valid_size) != 0
+	|| lseek(fd_, valid_size, SEEK_SET) < 0) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  bool OpLog::WriteHeader() {
+    string header(kMagic, sizeof(kMagic));
+    PutUint32(kOpLogVersion, &header);
+    PutUint32(kByteOrderMark, &header);
+    buffer_.insert(0, header);
+    return Commit();
+  }
+
+  void OpLog::Append(const LogRecord& record) {
+    string payload;
+    payload.append(reinterpret_cast<const char*>(&record.sequence), sizeof(uint64_t));
+    payload.push_back(static_cast<char>(record.kind));
+    PutUint32(record.rules.size(), &payload);
+    for (auto const& rule : record.rules) {
+      PutUint32(rule.size(), &payload);
+      for (auto const& set_name : rule) {
+	PutString(set_name, &payload);
+      }
+    }
+    PutString(record.set_name, &payload);
+    PutUint32(payload.size(), &buffer_);
+    PutUint32(Crc32(payload.data(), payload.size()), &buffer_);
+    buffer_.append(payload);
+  }
+
+  bool OpLog::Commit() {
+    if (fd_ < 0) {
+      return false;
+    }
+    off_t committed = lseek(fd_, 0, SEEK_CUR);
+    // Records are dropped either way, a caller that gets false takes
+    // them as not made.
+    string buffer;
+    buffer.swap(buffer_);
+    const char* data = buffer.data();
+    uint64_t left = buffer.size();
+    bool ok = true;
+    while (ok && left > 0) {
+      ssize_t written = write(fd_, data, left);
+      if (written < 0 && errno == EINTR) {
+	continue;
+      }
+      ok = written > 0;
+      if (ok) {
+	data += written;
+	left -= written;
+      }
+    }
+    ok = ok && (!sync_ || fdatasync(fd_) == 0);
+    if (!ok) {
+      // Records after a torn one would never be read, and ones that
+      // didn't sync mustn't be replayed either.
+      if (committed >= 0 && ftruncate(fd_, committed) == 0) {
+	lseek(fd_, committed, SEEK_SET);
+      }
+    }
+    return ok;
+  }
+
+  bool OpLog::Reset() {
+    if (fd_ < 0) {
+      return false;
+    }
+    buffer_.clear();
+    if (ftruncate(fd_, 0) != 0 || lseek(fd_, 0, SEEK_SET) < 0) {
+      return false;
+    }
+    return WriteHeader();
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,98 @@
+#ifndef INCREMENTAL_ATPG_OP_LOG_H_
+#define INCREMENTAL_ATPG_OP_LOG_H_
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+
+  // Bumped whenever the record layout changes.
+  const uint32_t kOpLogVersion = 1;
+
+  // One change to rules, as OnlineSetCover was asked to make it.
+  struct LogRecord {
+    enum Kind {
+      // One rule, added and updated like OnlineSetCover::AddRule and
+      // UpdateCover.
+      kAddRule,
+      // Rules added with one OnlineSetCover::AddRules.
+      kAddRules,
+      kRemoveRule,
+      kAddToSet,
+      kRemoveFromSet
+    };
+    // Changes are numbered from 0, in the order they're made.
+    uint64_t sequence;
+    Kind kind;
+    // Set names of the rules added, or of the one rule changed.
+    vector<vector<string> > rules;
+    // Set the rule goes in or out of, for kAddToSet and kRemoveFromSet.
+    string set_name;
+  LogRecord()
+  : sequence(0),
+      kind(kAddRule) { }
+  LogRecord(Kind record_kind, const vector<vector<string> >& record_rules,
+	    const string& name = string())
+  : sequence(0),
+      kind(record_kind),
+      rules(record_rules),
+      set_name(name) { }
+  };
+
+  // Append-only log of changes, written before they're made. File is a
+  // 16 byte header (magic, version, byte order mark), then records,
+  // each its payload size, CRC-32 of its payload and the payload.
+  //
+  // Append only buffers, Commit writes all buffered records with one
+  // write and syncs once, so a batch costs one fsync. A crash in the
+  // middle of a Commit leaves a torn or bad record at the end, which
+  // Read stops at and Open cuts off.
+  class OpLog {
+  public:
+    OpLog();
+    // Closes file, dropping records not committed.
+    ~OpLog();
+
+    // Reads records in @path, if it exists, into @records, if it isn't
+    // null, cuts off anything after the last good one and opens it
+    // for appending. Returns false if it can't, or @path is something
+    // else than a log of this version.
+    bool Open(const string& path, vector<LogRecord>* records);
+    void Append(const LogRecord& record);
+    // Writes records appended since last Commit to file and syncs
+    // it, if @sync_ (default). Returns false if it can't, and then
+    // cuts them off the file again.
+    bool Commit();
+    // Drops all records, e.g., once a snapshot has them.
+    bool Reset();
+    void Close();
+    bool IsOpen() const {
+      return fd_ >= 0;
+    }
+    // Without sync, a crash of the process loses nothing committed,
+    // but one of the machine may.
+    void SetSync(bool sync) {
+      sync_ = sync;
+    }
+    // Reads good records in @path into @records, stopping at the
+    // first torn or bad one, and sets @valid_size to where it
+    // is. Maps file in, doesn't sync. Returns false if @path can't be
+    // read or isn't a log of this version.
+    static bool Read(const string& path, vector<LogRecord>* records,
+		     uint64_t* valid_size);
+
+  protected:
+    bool WriteHeader();
+    int fd_;
+    bool sync_;
+    // Records appended since last Commit.
+    string buffer_;
+  private:
+    friend class OpLogTest;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_OP_LOG_H_
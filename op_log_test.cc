@@ -0,0 +1,133 @@
+#include "op_log.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <unistd.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+  using std::fstream;
+
+class OpLogTest : public testing::Test {
+ protected:
+  OpLogTest()
+    : path_("op_log_test.log") { }
+  virtual void TearDown() {
+    std::remove(path_.c_str());
+  }
+  uint64_t ValidSize() {
+    uint64_t valid_size = 0;
+    OpLog::Read(path_, nullptr, &valid_size);
+    return valid_size;
+  }
+  string path_;
+};
+
+TEST_F(OpLogTest, AppendRead) {
+  OpLog log;
+  vector<LogRecord> records;
+  ASSERT_TRUE(log.Open(path_, &records));
+  EXPECT_TRUE(records.empty());
+  LogRecord add(LogRecord::kAddRules, {{"cat", "dog"}, {}, {""}});
+  add.sequence = 4;
+  log.Append(add);
+  LogRecord move(LogRecord::kAddToSet, {{"cat"}}, "sand");
+  move.sequence = 5;
+  log.Append(move);
+  // Nothing is written before Commit.
+  EXPECT_EQ(16, ValidSize());
+  ASSERT_TRUE(log.Commit());
+  log.Close();
+
+  uint64_t valid_size = 0;
+  ASSERT_TRUE(OpLog::Read(path_, &records, &valid_size));
+  ASSERT_EQ(2, records.size());
+  EXPECT_EQ(4, records[0].sequence);
+  EXPECT_EQ(LogRecord::kAddRules, records[0].kind);
+  EXPECT_EQ(add.rules, records[0].rules);
+  EXPECT_EQ("", records[0].set_name);
+  EXPECT_EQ(5, records[1].sequence);
+  EXPECT_EQ(LogRecord::kAddToSet, records[1].kind);
+  EXPECT_EQ(move.rules, records[1].rules);
+  EXPECT_EQ("sand", records[1].set_name);
+
+  // Appends go after what's there.
+  records.clear();
+  ASSERT_TRUE(log.Open(path_, &records));
+  EXPECT_EQ(2, records.size());
+  log.Append(LogRecord(LogRecord::kRemoveRule, {{"dog"}}));
+  ASSERT_TRUE(log.Commit());
+  records.clear();
+  ASSERT_TRUE(OpLog::Read(path_, &records, &valid_size));
+  EXPECT_EQ(3, records.size());
+  EXPECT_EQ(LogRecord::kRemoveRule, records[2].kind);
+
+  ASSERT_TRUE(log.Reset());
+  records.clear();
+  ASSERT_TRUE(OpLog::Read(path_, &records, &valid_size));
+  EXPECT_TRUE(records.empty());
+  EXPECT_EQ(16, valid_size);
+}
+
+TEST_F(OpLogTest, TornTail) {
+  OpLog log;
+  ASSERT_TRUE(log.Open(path_, nullptr));
+  log.Append(LogRecord(LogRecord::kAddRule, {{"cat"}}));
+  ASSERT_TRUE(log.Commit());
+  uint64_t one_record = ValidSize();
+  log.Append(LogRecord(LogRecord::kAddRule, {{"dog", "fish"}}));
+  ASSERT_TRUE(log.Commit());
+  uint64_t two_records = ValidSize();
+  log.Close();
+
+  // Cut off in the middle of the second record.
+  ASSERT_EQ(0, truncate(path_.c_str(), two_records - 3));
+  EXPECT_EQ(one_record, ValidSize());
+  vector<LogRecord> records;
+  ASSERT_TRUE(log.Open(path_, &records));
+  EXPECT_EQ(1, records.size());
+  log.Append(LogRecord(LogRecord::kRemoveRule, {{"cat"}}));
+  ASSERT_TRUE(log.Commit());
+  log.Close();
+  records.clear();
+  uint64_t valid_size = 0;
+  ASSERT_TRUE(OpLog::Read(path_, &records, &valid_size));
+  ASSERT_EQ(2, records.size());
+  EXPECT_EQ(LogRecord::kRemoveRule, records[1].kind);
+
+  // Flipped byte in the last record fails its checksum.
+  {
+    fstream file(path_.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(valid_size - 2);
+    file.put('x');
+  }
+  records.clear();
+  ASSERT_TRUE(OpLog::Read(path_, &records, &valid_size));
+  EXPECT_EQ(1, records.size());
+  EXPECT_EQ(one_record, valid_size);
+}
+
+TEST_F(OpLogTest, BadFiles) {
+  uint64_t valid_size = 0;
+  EXPECT_FALSE(OpLog::Read(path_, nullptr, &valid_size));
+  {
+    ofstream out(path_.c_str());
+    out << "not a log, just some text";
+  }
+  OpLog log;
+  EXPECT_FALSE(log.Open(path_, nullptr));
+  EXPECT_FALSE(log.IsOpen());
+  EXPECT_FALSE(log.Commit());
+
+  // Torn header, nothing was committed.
+  ASSERT_EQ(0, truncate(path_.c_str(), 5));
+  ASSERT_TRUE(log.Open(path_, nullptr));
+  EXPECT_EQ(16, ValidSize());
+}
+}  // namespace incremental_atpg
@@ -0,0 +1,193 @@
+#include "order_list.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::min;
+
+  // Tags are in [1, kMaxTag), 0 is before the first set.
+  static const unsigned kTagBits = 62;
+  static const uint64_t kMaxTag = 1ULL << kTagBits;
+  // Gap left after the last set when pushing back, so a long run of
+  // push_back's doesn't eat up the room at the end.
+  static const uint64_t kAppendGap = 1ULL << 32;
+  // 2/T in the paper. A range of 2^i tags can be spread out when it
+  // has fewer than kDensity^i sets. kDensity^kTagBits > 2^32, so
+  // there's always room for every set id.
+  static const double kDensity = 1.44;
+
+  OrderList::OrderList()
+    : head_(kNoSet),
+      tail_(kNoSet),
+      size_(0),
+      num_relabeled_(0) {
+  }
+
+  void OrderList::Grow(SetId set_id) {
+    if (set_id >= tags_.size()) {
+      tags_.resize(set_id + 1, kNotInList);
+      next_.resize(set_id + 1, kNoSet);
+      prev_.resize(set_id + 1, kNoSet);
+    }
+  }
+
+  bool OrderList::push_back(SetId set_id) {
+    if (set_id == kNoSet || Contains(set_id)) {
+      return false;
+    }
+    Grow(set_id);
+    LinkAfter(tail_, set_id);
+    return true;
+  }
+
+  void OrderList::pop_back() {
+    Erase(tail_);
+  }
+
+  bool OrderList::InsertBefore(SetId next, SetId set_id) {
+    if (next == kNoSet) {
+      return push_back(set_id);
+    }
+    if (set_id == kNoSet || Contains(set_id) || !Contains(next)) {
+      return false;
+    }
+    Grow(set_id);
+    LinkAfter(prev_[next], set_id);
+    return true;
+  }
+
+  bool OrderList::Erase(SetId set_id) {
+    if (!Contains(set_id)) {
+      return false;
+    }
+    SetId prev = prev_[set_id];
+    SetId next = next_[set_id];
+    if (prev == kNoSet) {
+      head_ = next;
+    } else {
+      next_[prev] = next;
+    }
+    if (next == kNoSet) {
+      tail_ = prev;
+    } else {
+      prev_[next] = prev;
+    }
+    tags_[set_id] = kNotInList;
+    next_[set_id] = prev_[set_id] = kNoSet;
+    --size_;
+    return true;
+  }
+
+  bool OrderList::Replace(SetId old_id, SetId new_id) {
+    if (!Contains(old_id) || new_id == kNoSet || Contains(new_id)) {
+      return false;
+    }
+    Grow(new_id);
+    SetId prev = prev_[old_id];
+    SetId next = next_[old_id];
+    tags_[new_id] = tags_[old_id];
+    prev_[new_id] = prev;
+    next_[new_id] = next;
+    if (prev == kNoSet) {
+      head_ = new_id;
+    } else {
+      next_[prev] = new_id;
+    }
+    if (next == kNoSet) {
+      tail_ = new_id;
+    } else {
+      prev_[next] = new_id;
+    }
+    tags_[old_id] = kNotInList;
+    next_[old_id] = prev_[old_id] = kNoSet;
+    return true;
+  }
+
+  void OrderList::clear() {
+    SetId set_id = head_;
+    while (set_id != kNoSet) {
+      SetId next = next_[set_id];
+      tags_[set_id] = kNotInList;
+      next_[set_id] = prev_[set_id] = kNoSet;
+      set_id = next;
+    }
+    head_ = tail_ = kNoSet;
+    size_ = 0;
+  }
+
+  void OrderList::LinkAfter(SetId prev, SetId set_id) {
+    SetId next = prev == kNoSet ? head_ : next_[prev];
+    uint64_t lo = prev == kNoSet ? 0 : tags_[prev];
+    uint64_t hi = next == kNoSet ? kMaxTag : tags_[next];
+    if (hi - lo < 2) {
+      Relabel(prev);
+      lo = prev == kNoSet ? 0 : tags_[prev];
+      hi = next == kNoSet ? kMaxTag : tags_[next];
+    }
+    if (next == kNoSet) {
+      tags_[set_id] = lo + min((hi - lo) / 2, kAppendGap);
+    } else {
+      tags_[set_id] = lo + (hi - lo) / 2;
+    }
+
+    prev_[set_id] = prev;
+    next_[set_id] = next;
+    if (prev == kNoSet) {
+      head_ = set_id;
+    } else {
+      next_[prev] = set_id;
+    }
+    if (next == kNoSet) {
+      tail_ = set_id;
+    } else {
+      prev_[next] = set_id;
+    }
+    ++size_;
+  }
+
+  void OrderList::Relabel(SetId prev) {
+    uint64_t anchor = prev == kNoSet ? 0 : tags_[prev];
+    // Sets in range are [@first, @last], @count of them.
+    SetId first = prev;
+    SetId last = prev;
+    uint64_t count = prev == kNoSet ? 0 : 1;
+    double max_count = 1.0;
+    for (unsigned i = 1; i <= kTagBits; i++) {
+      max_count *= kDensity;
+      uint64_t range = 1ULL << i;
+      uint64_t lo = anchor & ~(range - 1);
+      uint64_t hi = lo + range;
+      if (first != kNoSet) {
+	while (prev_[first] != kNoSet && tags_[prev_[first]] >= lo) {
+	  first = prev_[first];
+	  ++count;
+	}
+      }
+      SetId next = last == kNoSet ? head_ : next_[last];
+      while (next != kNoSet && tags_[next] < hi) {
+	if (first == kNoSet) {
+	  first = next;
+	}
+	last = next;
+	++count;
+	next = next_[next];
+      }
+      // One more for the set about to go in.
+      if (count + 1 <= max_count) {
+	uint64_t spacing = range / (count + 1);
+	uint64_t tag = lo;
+	SetId set_id = first;
+	for (uint64_t j = 0; j < count; j++) {
+	  tag += spacing;
+	  tags_[set_id] = tag;
+	  set_id = next_[set_id];
+	}
+	num_relabeled_ += count;
+	return;
+      }
+    }
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,147 @@
+#ifndef INCREMENTAL_ATPG_ORDER_LIST_H_
+#define INCREMENTAL_ATPG_ORDER_LIST_H_
+#include <vector>
+#include <iterator>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "symbol_table.h"
+
+namespace incremental_atpg {
+  using std::vector;
+
+  // Tag of sets not in list.
+  const uint64_t kNotInList = UINT64_MAX;
+
+  // Ordered list of distinct sets that can tell which of two sets
+  // comes first in O(1), e.g., the cover.
+  //
+  // Every set in list has an integer tag, and tags increase along the
+  // list. A new set gets the tag halfway between its neighbors. When
+  // there's no room between them, sets around the spot are relabeled
+  // evenly, after Bender et al., "Two simplified algorithms for
+  // maintaining order in a list", ESA 2002: the smallest aligned
+  // range of 2^i tags around the spot that has at most (2/T)^i sets
+  // is spread out. That's amortized O(log n) relabels per insert,
+  // and none at all while sets are only pushed back.
+  //
+  // Nodes are indexed by set id, like @set_processing_infos_, so
+  // there's no lookup.
+  class OrderList {
+  public:
+    class const_iterator {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef SetId value_type;
+      typedef ptrdiff_t difference_type;
+      typedef const SetId* pointer;
+      typedef const SetId& reference;
+
+    const_iterator(const OrderList* list, SetId set_id)
+      : list_(list), set_id_(set_id) { }
+      const SetId& operator*() const {
+	return set_id_;
+      }
+      const_iterator& operator++() {
+	set_id_ = list_->Next(set_id_);
+	return *this;
+      }
+      const_iterator operator++(int) {
+	const_iterator old = *this;
+	++*this;
+	return old;
+      }
+      bool operator==(const const_iterator& other) const {
+	return set_id_ == other.set_id_;
+      }
+      bool operator!=(const const_iterator& other) const {
+	return set_id_ != other.set_id_;
+      }
+    private:
+      const OrderList* list_;
+      SetId set_id_;
+    };
+
+    OrderList();
+
+    // Appends @set_id. Returns false and does nothing if it's in list.
+    bool push_back(SetId set_id);
+    void pop_back();
+    // Inserts @set_id right before @next, or at the end if @next is
+    // kNoSet. Returns false and does nothing if @set_id is in list or
+    // @next isn't.
+    bool InsertBefore(SetId next, SetId set_id);
+    // Removes @set_id. Returns false if it isn't in list.
+    bool Erase(SetId set_id);
+    // Puts @new_id where @old_id is, with its tag. @old_id should be
+    // in list and @new_id shouldn't.
+    bool Replace(SetId old_id, SetId new_id);
+    void clear();
+
+    bool Contains(SetId set_id) const {
+      return set_id < tags_.size() && tags_[set_id] != kNotInList;
+    }
+    // True if @lhs comes before @rhs. Both should be in list.
+    bool Precedes(SetId lhs, SetId rhs) const {
+      return tags_[lhs] < tags_[rhs];
+    }
+    // Increases along the list, kNotInList if @set_id isn't in it.
+    // Changes when sets are inserted, so only good for comparing.
+    uint64_t Tag(SetId set_id) const {
+      return Contains(set_id) ? tags_[set_id] : kNotInList;
+    }
+    // Neighbors of @set_id, which should be in list. kNoSet past ends.
+    SetId Next(SetId set_id) const {
+      return next_[set_id];
+    }
+    SetId Prev(SetId set_id) const {
+      return prev_[set_id];
+    }
+
+    SetId front() const {
+      return head_;
+    }
+    SetId back() const {
+      return tail_;
+    }
+    uint64_t size() const {
+      return size_;
+    }
+    bool empty() const {
+      return size_ == 0;
+    }
+    const_iterator begin() const {
+      return const_iterator(this, head_);
+    }
+    const_iterator end() const {
+      return const_iterator(this, kNoSet);
+    }
+    // Total number of relabeled sets so far.
+    uint64_t num_relabeled() const {
+      return num_relabeled_;
+    }
+
+  protected:
+    // Makes room for @set_id in node arrays.
+    void Grow(SetId set_id);
+    // Links @set_id right after @prev (at the front if kNoSet), with
+    // a tag between theirs.
+    void LinkAfter(SetId prev, SetId set_id);
+    // Tags around @prev are spread out so there's room right after it.
+    void Relabel(SetId prev);
+
+    // Indexed by set id.
+    vector<uint64_t> tags_;
+    vector<SetId> next_;
+    vector<SetId> prev_;
+    SetId head_;
+    SetId tail_;
+    uint64_t size_;
+    uint64_t num_relabeled_;
+  private:
+    friend class OrderListTest;
+    FRIEND_TEST(OrderListTest, Relabel);
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_ORDER_LIST_H_
@@ -0,0 +1,106 @@
+#include "order_list.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+
+class OrderListTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    list_.reset(new OrderList);
+  }
+  vector<SetId> Sets() const {
+    return vector<SetId>(list_->begin(), list_->end());
+  }
+  std::unique_ptr<OrderList> list_;
+};
+
+TEST_F(OrderListTest, PushBackErase) {
+  EXPECT_TRUE(list_->empty());
+  EXPECT_TRUE(list_->push_back(3));
+  EXPECT_TRUE(list_->push_back(0));
+  EXPECT_TRUE(list_->push_back(7));
+  EXPECT_FALSE(list_->push_back(0));
+  EXPECT_EQ(3, list_->size());
+  EXPECT_EQ(vector<SetId>({3, 0, 7}), Sets());
+  EXPECT_EQ(3, list_->front());
+  EXPECT_EQ(7, list_->back());
+  EXPECT_TRUE(list_->Precedes(3, 0));
+  EXPECT_TRUE(list_->Precedes(0, 7));
+  EXPECT_FALSE(list_->Precedes(7, 3));
+
+  EXPECT_TRUE(list_->Erase(0));
+  EXPECT_FALSE(list_->Erase(0));
+  EXPECT_FALSE(list_->Contains(0));
+  EXPECT_EQ(kNotInList, list_->Tag(0));
+  EXPECT_EQ(vector<SetId>({3, 7}), Sets());
+  list_->pop_back();
+  EXPECT_EQ(vector<SetId>({3}), Sets());
+  EXPECT_EQ(3, list_->back());
+  list_->clear();
+  EXPECT_TRUE(list_->empty());
+  EXPECT_FALSE(list_->Contains(3));
+  EXPECT_TRUE(list_->push_back(3));
+}
+
+TEST_F(OrderListTest, InsertBeforeReplace) {
+  list_->push_back(1);
+  list_->push_back(2);
+  EXPECT_TRUE(list_->InsertBefore(2, 5));
+  EXPECT_TRUE(list_->InsertBefore(1, 4));
+  EXPECT_TRUE(list_->InsertBefore(kNoSet, 6));
+  EXPECT_FALSE(list_->InsertBefore(9, 8));
+  EXPECT_FALSE(list_->InsertBefore(1, 2));
+  EXPECT_EQ(vector<SetId>({4, 1, 5, 2, 6}), Sets());
+  EXPECT_TRUE(list_->Precedes(5, 2));
+
+  EXPECT_TRUE(list_->Replace(5, 9));
+  EXPECT_FALSE(list_->Replace(5, 10));
+  EXPECT_FALSE(list_->Replace(1, 2));
+  EXPECT_EQ(vector<SetId>({4, 1, 9, 2, 6}), Sets());
+  EXPECT_FALSE(list_->Contains(5));
+  EXPECT_TRUE(list_->Precedes(1, 9));
+  EXPECT_TRUE(list_->Precedes(9, 2));
+  EXPECT_TRUE(list_->Replace(4, 0));
+  EXPECT_EQ(0, list_->front());
+  EXPECT_TRUE(list_->Replace(6, 7));
+  EXPECT_EQ(7, list_->back());
+}
+
+TEST_F(OrderListTest, Relabel) {
+  // Always inserting right after the first set halves the gap, so
+  // it runs out and has to relabel.
+  const SetId num_sets = 2000;
+  list_->push_back(0);
+  list_->push_back(num_sets);
+  for (SetId set_id = num_sets - 1; set_id > 0; set_id--) {
+    EXPECT_TRUE(list_->InsertBefore(list_->Next(0), set_id));
+  }
+  EXPECT_LT(0, list_->num_relabeled());
+  vector<SetId> sets = Sets();
+  ASSERT_EQ(num_sets + 1, sets.size());
+  for (SetId set_id = 0; set_id <= num_sets; set_id++) {
+    EXPECT_EQ(set_id, sets[set_id]);
+    if (set_id > 0) {
+      EXPECT_LT(list_->tags_[set_id - 1], list_->tags_[set_id]);
+    }
+  }
+
+  // Same at the front.
+  list_.reset(new OrderList);
+  for (SetId set_id = num_sets; set_id-- > 0; ) {
+    EXPECT_TRUE(list_->InsertBefore(list_->front(), set_id));
+  }
+  sets = Sets();
+  for (SetId set_id = 0; set_id < num_sets; set_id++) {
+    EXPECT_EQ(set_id, sets[set_id]);
+    if (set_id > 0) {
+      EXPECT_TRUE(list_->Precedes(set_id - 1, set_id));
+    }
+  }
+}
+}  // namespace incremental_atpg
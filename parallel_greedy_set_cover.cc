@@ -0,0 +1,288 @@
+#include "parallel_greedy_set_cover.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <list>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <cmath>
+#include <stdint.h>
+#include <log4cxx/logger.h>
+
+#include "gtest/gtest_prod.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::unique_ptr;
+  using std::list;
+  using std::atomic;
+  using std::thread;
+  using std::function;
+  using std::pair;
+  using std::make_pair;
+  using std::sort;
+  using std::upper_bound;
+  using std::max;
+  using std::min;
+
+  using log4cxx::LoggerPtr;
+  using log4cxx::Logger;
+  using log4cxx::Level;
+
+  // Not worth starting a thread for fewer sets or rules than this.
+  static const uint64_t kMinPerThread = 256;
+
+  ParallelGreedySetCover::ParallelGreedySetCover()
+    : num_threads_(1),
+      seed_(0),
+      num_rounds_(0) {
+    parallel_greedy_set_cover_logger = Logger::getLogger("ParallelGreedySetCover");
+    parallel_greedy_set_cover_logger->setLevel(log4cxx::Level::getWarn());
+  }
+
+  ParallelGreedySetCover::ParallelGreedySetCover(SymbolTable* set_names,
+						 Incidence* incidence)
+    : SetCover(set_names, incidence),
+      num_threads_(1),
+      seed_(0),
+      num_rounds_(0) {
+    parallel_greedy_set_cover_logger = Logger::getLogger("ParallelGreedySetCover");
+    parallel_greedy_set_cover_logger->setLevel(log4cxx::Level::getWarn());
+  }
+
+  ParallelGreedySetCover::ParallelGreedySetCover(SymbolTable* set_names,
+						 Incidence* incidence,
+						 vector<SetProcessingInfo>* set_processing_infos,
+						 vector<RuleProcessingInfo>* rule_processing_infos,
+						 OrderList* cover)
+    : SetCover(set_names, incidence, set_processing_infos,
+	       rule_processing_infos, cover),
+      num_threads_(1),
+      seed_(0),
+      num_rounds_(0) {
+    parallel_greedy_set_cover_logger = Logger::getLogger("ParallelGreedySetCover");
+    parallel_greedy_set_cover_logger->setLevel(log4cxx::Level::getWarn());
+  }
+
+  void ParallelGreedySetCover::MakeBands(uint64_t max_uncovered) {
+    band_starts_.assign(1, 1);
+    while (band_starts_.back() <= max_uncovered) {
+      uint64_t start = band_starts_.back();
+      uint64_t next = (uint64_t) ceil(start * (1.0 + options_.epsilon));
+      band_starts_.push_back(max(start + 1, next));
+    }
+  }
+
+  uint64_t ParallelGreedySetCover::Band(uint64_t num_uncovered) const {
+    return upper_bound(band_starts_.begin(), band_starts_.end(), num_uncovered)
+      - band_starts_.begin() - 1;
+  }
+
+  uint64_t ParallelGreedySetCover::NumUncovered(SetId set_id) const {
+    uint64_t num_uncovered = 0;
+    for (auto const& rule_id: incidence_->RulesOf(set_id)) {
+      if (!rule_processing_infos_->at(rule_id).Covered()) {
+	num_uncovered++;
+      }
+    }
+    return num_uncovered;
+  }
+
+  uint64_t ParallelGreedySetCover::Priority(uint64_t round, SetId set_id) const {
+    // splitmix64 of seed, round and set. Set id goes in the low bits
+    // so no two sets tie.
+    uint64_t z = seed_ + (round << 32) + set_id + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z = z ^ (z >> 31);
+    return ((z | (1ULL << 63)) & ~0xffffffffULL) | set_id;
+  }
+
+  void ParallelGreedySetCover::ParallelFor(uint64_t n,
+					   const function<void(uint64_t)>& body) const {
+    uint64_t num_chunks = min((uint64_t) num_threads_,
+			      (n + kMinPerThread - 1) / kMinPerThread);
+    if (num_chunks <= 1 || pool_.get() == nullptr) {
+      for (uint64_t i = 0; i < n; i++) {
+	body(i);
+      }
+      return;
+    }
+    uint64_t chunk = (n + num_chunks - 1) / num_chunks;
+    pool_->Run(num_chunks, [&](uint64_t c) {
+	uint64_t end = min(n, (c + 1) * chunk);
+	for (uint64_t i = c * chunk; i < end; i++) {
+	  body(i);
+	}
+      });
+  }
+
+  void ParallelGreedySetCover::AddToCover(SetId set_id, uint64_t* num_covered) {
+    cover_->push_back(set_id);
+    SetProcessingInfo& sp = set_processing_infos_->at(set_id);
+    sp.num_uncovered = incidence_->num_rules() - *num_covered;
+    sp.in_cover = true;
+    for (auto const& rule_id: incidence_->RulesOf(set_id)) {
+      RuleProcessingInfo& rp = rule_processing_infos_->at(rule_id);
+      if (!rp.Covered()) {
+	rp.first_covered_by = set_id;
+	sp.AddRule(rule_id);
+	*num_covered += 1;
+      }
+    }
+    LOG4CXX_INFO(parallel_greedy_set_cover_logger,
+		 "Pushed back " << GetSetName(set_id) << " on cover.");
+  }
+
+  void ParallelGreedySetCover::RunRound(uint64_t band, vector<SetId>* active,
+					uint64_t* num_covered) {
+    uint64_t round = num_rounds_++;
+    uint64_t num_active = active->size();
+    vector<uint64_t> priorities(num_active);
+
+    // Each uncovered rule goes to highest priority set it's in.
+    ParallelFor(num_active, [&](uint64_t i) {
+	SetId set_id = active->at(i);
+	uint64_t priority = Priority(round, set_id);
+	priorities[i] = priority;
+	for (auto const& rule_id: incidence_->RulesOf(set_id)) {
+	  if (rule_processing_infos_->at(rule_id).Covered()) {
+	    continue;
+	  }
+	  atomic<uint64_t>& reserved = reserved_by_[rule_id];
+	  uint64_t current = reserved.load(std::memory_order_relaxed);
+	  while (current < priority
+		 && !reserved.compare_exchange_weak(current, priority));
+	}
+      });
+
+    // Sets that got most of their rules are picked. Highest priority
+    // set got all of them, so there's at least one.
+    vector<char> picked(num_active, false);
+    ParallelFor(num_active, [&](uint64_t i) {
+	SetId set_id = active->at(i);
+	uint64_t num_reserved = 0;
+	for (auto const& rule_id: incidence_->RulesOf(set_id)) {
+	  if (!rule_processing_infos_->at(rule_id).Covered()
+	      && reserved_by_[rule_id].load(std::memory_order_relaxed) == priorities[i]) {
+	    num_reserved++;
+	  }
+	}
+	picked[i] = num_reserved >= (1.0 - options_.epsilon) * num_uncovered_[set_id];
+      });
+
+    ParallelFor(num_active, [&](uint64_t i) {
+	for (auto const& rule_id: incidence_->RulesOf(active->at(i))) {
+	  reserved_by_[rule_id].store(0, std::memory_order_relaxed);
+	}
+      });
+
+    // Picked sets go in cover in order of priority. Rules a set
+    // reserved can't be in a set before it, so it covers all of them.
+    vector<pair<uint64_t, SetId> > by_priority;
+    vector<SetId> rest;
+    for (uint64_t i = 0; i < num_active; i++) {
+      if (picked[i]) {
+	by_priority.push_back(make_pair(priorities[i], active->at(i)));
+      } else {
+	rest.push_back(active->at(i));
+      }
+    }
+    sort(by_priority.rbegin(), by_priority.rend());
+
+    for (auto const& p: by_priority) {
+      AddToCover(p.second, num_covered);
+    }
+    LOG4CXX_INFO(parallel_greedy_set_cover_logger, "Round " << round << " in band "
+		 << band << " picked " << by_priority.size() << " of "
+		 << num_active << " sets.");
+    active->swap(rest);
+  }
+
+  void ParallelGreedySetCover::UpdateCover() {
+    if (incidence_->num_removed_rules() > 0) {
+      DropRemovedRules();
+    }
+    cover_->clear();
+    ResetProcessingInfo();
+
+    if (options_.epsilon <= 0 || options_.epsilon >= 1) {
+      LOG4CXX_WARN(parallel_greedy_set_cover_logger, "Epsilon " << options_.epsilon
+		   << " not in (0, 1), using " << ParallelGreedyOptions().epsilon << ".");
+      options_.epsilon = ParallelGreedyOptions().epsilon;
+    }
+    num_threads_ = options_.num_threads;
+    if (num_threads_ == 0) {
+      num_threads_ = max(1u, thread::hardware_concurrency());
+    }
+    if (pool_.get() == nullptr || pool_->num_threads() != num_threads_) {
+      pool_.reset(new ThreadPool(num_threads_));
+    }
+    if (options_.deterministic) {
+      seed_ = options_.seed;
+    } else {
+      std::random_device random;
+      seed_ = ((uint64_t) random() << 32) | random();
+    }
+    num_rounds_ = 0;
+
+    uint64_t num_sets = incidence_->num_sets();
+    uint64_t num_rules = incidence_->num_rules();
+    uint64_t max_uncovered = 0;
+    num_uncovered_.assign(num_sets, 0);
+    for (SetId set_id = 0; set_id < num_sets; set_id++) {
+      num_uncovered_[set_id] = incidence_->RulesOf(set_id).size();
+      max_uncovered = max(max_uncovered, num_uncovered_[set_id]);
+    }
+    MakeBands(max_uncovered);
+
+    reserved_by_.reset(new atomic<uint64_t>[num_rules]);
+    ParallelFor(num_rules, [&](uint64_t rule_id) {
+	reserved_by_[rule_id].store(0, std::memory_order_relaxed);
+      });
+
+    vector<vector<SetId> > bands(band_starts_.size() - 1);
+    for (SetId set_id = 0; set_id < num_sets; set_id++) {
+      if (num_uncovered_[set_id] > 0) {
+	bands[Band(num_uncovered_[set_id])].push_back(set_id);
+      }
+    }
+
+    uint64_t num_covered = 0;
+    for (uint64_t band = bands.size(); band-- > 0 && num_covered < num_rules; ) {
+      vector<SetId>& active = bands[band];
+      while (!active.empty()) {
+	ParallelFor(active.size(), [&](uint64_t i) {
+	    num_uncovered_[active[i]] = NumUncovered(active[i]);
+	  });
+	// Sets that lost too many rules move to a lower band.
+	vector<SetId> in_band;
+	for (auto const& set_id: active) {
+	  uint64_t num_uncovered = num_uncovered_[set_id];
+	  if (num_uncovered >= band_starts_[band]) {
+	    in_band.push_back(set_id);
+	  } else if (num_uncovered > 0) {
+	    bands[Band(num_uncovered)].push_back(set_id);
+	  }
+	}
+	active.swap(in_band);
+	if (active.empty()) {
+	  break;
+	}
+	RunRound(band, &active, &num_covered);
+      }
+    }
+    reserved_by_.reset(nullptr);
+
+    if (num_covered < num_rules) {
+      LOG4CXX_WARN(parallel_greedy_set_cover_logger, num_covered
+		   << " rules covered out of " << num_rules << ".");
+    }
+  }
+}  // namespace incremental_atpg
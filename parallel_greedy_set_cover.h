@@ -0,0 +1,119 @@
+#ifndef INCREMENTAL_ATPG_PARALLEL_GREEDY_SET_COVER_H_
+#define INCREMENTAL_ATPG_PARALLEL_GREEDY_SET_COVER_H_
+#include <vector>
+#include <string>
+#include <memory>
+#include <list>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <log4cxx/logger.h>
+
+#include "gtest/gtest_prod.h"
+#include "set_cover.h"
+#include "thread_pool.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::unique_ptr;
+  using std::list;
+  using std::atomic;
+  using std::function;
+
+  struct ParallelGreedyOptions {
+    // Sets whose number of uncovered rules is within a factor of
+    // (1 + @epsilon) are picked in the same round. Should be in (0, 1).
+    double epsilon;
+    // Number of threads, 0 means one per hardware thread.
+    unsigned num_threads;
+    // If true, same rules always give the same cover, using @seed.
+    // Else seed is picked at random for each UpdateCover.
+    bool deterministic;
+    uint64_t seed;
+  ParallelGreedyOptions()
+  : epsilon(0.1),
+      num_threads(0),
+      deterministic(true),
+      seed(0) { }
+  };
+
+  // Greedy set cover that adds many sets to cover per round, after
+  // Blelloch, Peng and Tangwongsan, "Linear-work greedy parallel
+  // approximate set cover and variants", SPAA 2011.
+  //
+  // Sets are bucketed by number of uncovered rules into bands of
+  // width (1 + epsilon), and bands are processed from the top down.
+  // In a round, every set in the band gets a random priority and
+  // each uncovered rule is reserved by the highest priority set it's
+  // in, in parallel. Sets that reserved at least (1 - epsilon) of
+  // their uncovered rules are added to cover. The others get their
+  // counts fixed and stay in the band, or drop to a lower one.
+  //
+  // Cover is within about (1 + epsilon) / (1 - epsilon) of what
+  // GreedySetCover finds, not the same.
+  class ParallelGreedySetCover : public SetCover {
+  public:
+    log4cxx::LoggerPtr parallel_greedy_set_cover_logger;
+    ParallelGreedySetCover();
+    ParallelGreedySetCover(SymbolTable* set_names,
+			   Incidence* incidence);
+    ParallelGreedySetCover(SymbolTable* set_names,
+			   Incidence* incidence,
+			   vector<SetProcessingInfo>* set_processing_infos,
+			   vector<RuleProcessingInfo>* rule_processing_infos,
+			   OrderList* cover);
+
+    // Finds set cover from scratch for rules in latest @incidence_,
+    // after dropping removed rules from it.
+    void UpdateCover();
+
+    // Used by later UpdateCover's.
+    void SetOptions(const ParallelGreedyOptions& options) {
+      options_ = options;
+    }
+    // Number of rounds in last UpdateCover.
+    uint64_t num_rounds() const {
+      return num_rounds_;
+    }
+
+  protected:
+    // Fills in @band_starts_: band b is [@band_starts_[b],
+    // @band_starts_[b+1]), starting at 1, up to @max_uncovered.
+    void MakeBands(uint64_t max_uncovered);
+    // Band that @num_uncovered (> 0) falls in.
+    uint64_t Band(uint64_t num_uncovered) const;
+    // Number of rules in @set_id not covered yet.
+    uint64_t NumUncovered(SetId set_id) const;
+    // Random priority of @set_id in round @round, unique in a round.
+    // Never 0, that means a rule isn't reserved.
+    uint64_t Priority(uint64_t round, SetId set_id) const;
+    // Runs @body(i) for i in [0, @n), split among threads of @pool_.
+    void ParallelFor(uint64_t n, const function<void(uint64_t)>& body) const;
+    // Runs one round on @active, sets in band @band with
+    // @num_uncovered_ fixed. Adds picked sets to cover and leaves the
+    // rest in @active.
+    void RunRound(uint64_t band, vector<SetId>* active, uint64_t* num_covered);
+    // Adds @set_id to cover and covers its rules, like
+    // GreedySetCover::UpdateProcessingInfo.
+    void AddToCover(SetId set_id, uint64_t* num_covered);
+
+    ParallelGreedyOptions options_;
+    unsigned num_threads_;
+    uint64_t seed_;
+    uint64_t num_rounds_;
+    vector<uint64_t> band_starts_;
+    // Indexed by set id, upper bound on uncovered rules in set.
+    vector<uint64_t> num_uncovered_;
+    // Indexed by rule id, priority of set that reserved it in
+    // this round, or 0.
+    unique_ptr<atomic<uint64_t>[]> reserved_by_;
+    unique_ptr<ThreadPool> pool_;
+
+  private:
+    friend class ParallelGreedySetCoverTest;
+    FRIEND_TEST(ParallelGreedySetCoverTest, Bands);
+    FRIEND_TEST(ParallelGreedySetCoverTest, Priority);
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_PARALLEL_GREEDY_SET_COVER_H_
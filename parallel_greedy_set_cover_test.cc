@@ -0,0 +1,106 @@
+#include "set_cover.h"
+#include "greedy_set_cover.h"
+#include "parallel_greedy_set_cover.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+#include <set>
+#include <stdint.h>
+
+#include "log4cxx/logger.h"
+#include "log4cxx/basicconfigurator.h"
+#include "log4cxx/helpers/exception.h"
+
+namespace incremental_atpg {
+  using std::to_string;
+  using std::string;
+  using std::vector;
+  using std::set;
+
+  class ParallelGreedySetCoverTest : public testing::Test {
+  protected:
+    ParallelGreedySetCoverTest() { 
+      log4cxx::BasicConfigurator::resetConfiguration();
+      log4cxx::BasicConfigurator::configure();
+    }
+
+    virtual void SetUp() {
+      sc_.reset(new ParallelGreedySetCover);
+      // Enough rules and sets that ParallelFor starts threads.
+      for (uint64_t rule = 0; rule < 3000; rule++) {
+	rules_.push_back({to_string(rule % 401), to_string(rule % 37 + 401),
+	      to_string((rule * rule) % 613 + 438), to_string(rule / 300 + 1051)});
+      }
+      for (auto const& rule : rules_) {
+	sc_->AddRule(rule);
+      }
+    }
+    virtual void TearDown() {
+    }
+    // Every rule is in some set in cover, and first covered by it.
+    void ExpectCovers(const SetCover& sc) {
+      set<string> cover;
+      for (auto const& set_name : sc.GetCover()) {
+	EXPECT_TRUE(cover.insert(set_name).second);
+      }
+      vector<RuleProcessingInfo> infos = sc.GetRuleProcessingInfos();
+      ASSERT_EQ(rules_.size(), infos.size());
+      for (uint64_t rule_id = 0; rule_id < rules_.size(); rule_id++) {
+	ASSERT_TRUE(infos[rule_id].Covered());
+	EXPECT_EQ(1, cover.count(sc.GetSetName(infos[rule_id].first_covered_by)));
+      }
+    }
+    vector<vector<string> > rules_;
+    std::unique_ptr<ParallelGreedySetCover> sc_;
+  };
+
+  TEST_F(ParallelGreedySetCoverTest, Bands) {
+    sc_->options_.epsilon = 0.5;
+    sc_->MakeBands(10);
+    EXPECT_EQ(vector<uint64_t>({1, 2, 3, 5, 8, 12}), sc_->band_starts_);
+    EXPECT_EQ(0, sc_->Band(1));
+    EXPECT_EQ(2, sc_->Band(4));
+    EXPECT_EQ(3, sc_->Band(5));
+    EXPECT_EQ(4, sc_->Band(10));
+  }
+
+  TEST_F(ParallelGreedySetCoverTest, Priority) {
+    set<uint64_t> priorities;
+    for (SetId set_id = 0; set_id < 1000; set_id++) {
+      uint64_t priority = sc_->Priority(3, set_id);
+      EXPECT_NE(0, priority);
+      EXPECT_TRUE(priorities.insert(priority).second);
+    }
+  }
+
+  TEST_F(ParallelGreedySetCoverTest, UpdateCover) {
+    ParallelGreedyOptions options;
+    options.num_threads = 1;
+    sc_->SetOptions(options);
+    sc_->UpdateCover();
+    ExpectCovers(*sc_);
+    list<string> one_thread = sc_->GetCover();
+
+    // Same seed, same cover, however many threads.
+    options.num_threads = 8;
+    sc_->SetOptions(options);
+    sc_->UpdateCover();
+    ExpectCovers(*sc_);
+    EXPECT_EQ(one_thread, sc_->GetCover());
+    EXPECT_GT(sc_->num_rounds(), 0);
+
+    options.deterministic = false;
+    sc_->SetOptions(options);
+    sc_->UpdateCover();
+    ExpectCovers(*sc_);
+
+    GreedySetCover greedy;
+    for (auto const& rule : rules_) {
+      greedy.AddRule(rule);
+    }
+    greedy.UpdateCover();
+    EXPECT_LE(sc_->GetCover().size(), 2 * greedy.GetCover().size());
+  }
+
+}  // namespace incremental_atpg
@@ -0,0 +1,205 @@
+#include "prefix_sum_list.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+
+  // splitmix64 of @set_id, so the same sets give the same tree.
+  static uint64_t Priority(SetId set_id) {
+    uint64_t z = set_id + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  PrefixSumList::PrefixSumList()
+    : root_(kNoSet),
+      size_(0) {
+  }
+
+  void PrefixSumList::MakeLeaf(SetId set_id, uint64_t count) {
+    if (set_id >= in_list_.size()) {
+      left_.resize(set_id + 1, kNoSet);
+      right_.resize(set_id + 1, kNoSet);
+      parent_.resize(set_id + 1, kNoSet);
+      priorities_.resize(set_id + 1, 0);
+      counts_.resize(set_id + 1, 0);
+      sums_.resize(set_id + 1, 0);
+      in_list_.resize(set_id + 1, false);
+    }
+    left_[set_id] = right_[set_id] = parent_[set_id] = kNoSet;
+    priorities_[set_id] = Priority(set_id);
+    counts_[set_id] = sums_[set_id] = count;
+    in_list_[set_id] = true;
+    ++size_;
+  }
+
+  SetId PrefixSumList::Rightmost(SetId node) const {
+    while (right_[node] != kNoSet) {
+      node = right_[node];
+    }
+    return node;
+  }
+
+  bool PrefixSumList::push_back(SetId set_id, uint64_t count) {
+    if (set_id == kNoSet || Contains(set_id)) {
+      return false;
+    }
+    MakeLeaf(set_id, count);
+    if (root_ == kNoSet) {
+      root_ = set_id;
+    } else {
+      Attach(Rightmost(root_), false, set_id);
+    }
+    return true;
+  }
+
+  bool PrefixSumList::InsertBefore(SetId next, SetId set_id, uint64_t count) {
+    if (next == kNoSet) {
+      return push_back(set_id, count);
+    }
+    if (set_id == kNoSet || Contains(set_id) || !Contains(next)) {
+      return false;
+    }
+    MakeLeaf(set_id, count);
+    // Right after the last set before @next.
+    if (left_[next] == kNoSet) {
+      Attach(next, true, set_id);
+    } else {
+      Attach(Rightmost(left_[next]), false, set_id);
+    }
+    return true;
+  }
+
+  void PrefixSumList::Attach(SetId parent, bool left, SetId set_id) {
+    if (left) {
+      left_[parent] = set_id;
+    } else {
+      right_[parent] = set_id;
+    }
+    parent_[set_id] = parent;
+    AddToSums(parent, counts_[set_id]);
+    while (parent_[set_id] != kNoSet
+	   && priorities_[parent_[set_id]] < priorities_[set_id]) {
+      RotateUp(set_id);
+    }
+  }
+
+  void PrefixSumList::AddToSums(SetId node, uint64_t delta) {
+    for (; node != kNoSet; node = parent_[node]) {
+      sums_[node] += delta;
+    }
+  }
+
+  void PrefixSumList::RotateUp(SetId node) {
+    SetId parent = parent_[node];
+    SetId grandparent = parent_[parent];
+    if (left_[parent] == node) {
+      left_[parent] = right_[node];
+      if (right_[node] != kNoSet) {
+	parent_[right_[node]] = parent;
+      }
+      right_[node] = parent;
+    } else {
+      right_[parent] = left_[node];
+      if (left_[node] != kNoSet) {
+	parent_[left_[node]] = parent;
+      }
+      left_[node] = parent;
+    }
+    parent_[parent] = node;
+    parent_[node] = grandparent;
+    if (grandparent == kNoSet) {
+      root_ = node;
+    } else if (left_[grandparent] == parent) {
+      left_[grandparent] = node;
+    } else {
+      right_[grandparent] = node;
+    }
+    sums_[node] = sums_[parent];
+    sums_[parent] = counts_[parent] + Sum(left_[parent]) + Sum(right_[parent]);
+  }
+
+  bool PrefixSumList::Erase(SetId set_id) {
+    if (!Contains(set_id)) {
+      return false;
+    }
+    Set(set_id, 0);
+    // Rotate it down to a leaf, then cut it off.
+    while (left_[set_id] != kNoSet || right_[set_id] != kNoSet) {
+      SetId child = left_[set_id];
+      if (child == kNoSet
+	  || (right_[set_id] != kNoSet
+	      && priorities_[right_[set_id]] > priorities_[child])) {
+	child = right_[set_id];
+      }
+      RotateUp(child);
+    }
+    SetId parent = parent_[set_id];
+    if (parent == kNoSet) {
+      root_ = kNoSet;
+    } else if (left_[parent] == set_id) {
+      left_[parent] = kNoSet;
+    } else {
+      right_[parent] = kNoSet;
+    }
+    parent_[set_id] = kNoSet;
+    in_list_[set_id] = false;
+    --size_;
+    return true;
+  }
+
+  bool PrefixSumList::Replace(SetId old_id, SetId new_id) {
+    if (!Contains(old_id) || new_id == kNoSet || Contains(new_id)) {
+      return false;
+    }
+    MakeLeaf(new_id, counts_[old_id]);
+    priorities_[new_id] = priorities_[old_id];
+    sums_[new_id] = sums_[old_id];
+    SetId parent = parent_[old_id];
+    left_[new_id] = left_[old_id];
+    right_[new_id] = right_[old_id];
+    parent_[new_id] = parent;
+    if (left_[new_id] != kNoSet) {
+      parent_[left_[new_id]] = new_id;
+    }
+    if (right_[new_id] != kNoSet) {
+      parent_[right_[new_id]] = new_id;
+    }
+    if (parent == kNoSet) {
+      root_ = new_id;
+    } else if (left_[parent] == old_id) {
+      left_[parent] = new_id;
+    } else {
+      right_[parent] = new_id;
+    }
+    left_[old_id] = right_[old_id] = parent_[old_id] = kNoSet;
+    in_list_[old_id] = false;
+    --size_;
+    return true;
+  }
+
+  void PrefixSumList::Set(SetId set_id, uint64_t count) {
+    AddToSums(set_id, count - counts_[set_id]);
+    counts_[set_id] = count;
+  }
+
+  void PrefixSumList::clear() {
+    in_list_.assign(in_list_.size(), false);
+    root_ = kNoSet;
+    size_ = 0;
+  }
+
+  uint64_t PrefixSumList::SumBefore(SetId set_id) const {
+    uint64_t sum = Sum(left_[set_id]);
+    for (SetId node = set_id; parent_[node] != kNoSet; node = parent_[node]) {
+      SetId parent = parent_[node];
+      if (right_[parent] == node) {
+	sum += counts_[parent] + Sum(left_[parent]);
+      }
+    }
+    return sum;
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,95 @@
+#ifndef INCREMENTAL_ATPG_PREFIX_SUM_LIST_H_
+#define INCREMENTAL_ATPG_PREFIX_SUM_LIST_H_
+#include <vector>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "symbol_table.h"
+
+namespace incremental_atpg {
+  using std::vector;
+
+  // Ordered list of distinct sets with a count each, e.g., number of
+  // rules each set in cover covers first, that can sum the counts of
+  // all sets before a given set in O(log n).
+  //
+  // A Fenwick tree needs fixed positions, but sets get inserted in
+  // the middle of the list, so this is a treap keyed by position
+  // instead: sets are nodes of a binary tree in list order, each with
+  // the sum of counts in its subtree, and heap ordered by a hash of
+  // the set id to keep it balanced. Insert, erase, changing a count
+  // and the sum before a set are all O(log n) expected.
+  //
+  // Nodes are indexed by set id, so there's no lookup.
+  class PrefixSumList {
+  public:
+    PrefixSumList();
+
+    // Appends @set_id with @count. Returns false and does nothing if
+    // it's in list.
+    bool push_back(SetId set_id, uint64_t count);
+    // Inserts @set_id with @count right before @next, or at the end
+    // if @next is kNoSet. Returns false and does nothing if @set_id
+    // is in list or @next isn't.
+    bool InsertBefore(SetId next, SetId set_id, uint64_t count);
+    // Removes @set_id. Returns false if it isn't in list.
+    bool Erase(SetId set_id);
+    // Puts @new_id where @old_id is, with its count. @old_id should
+    // be in list and @new_id shouldn't.
+    bool Replace(SetId old_id, SetId new_id);
+    // Changes count of @set_id, which should be in list.
+    void Set(SetId set_id, uint64_t count);
+    void clear();
+
+    bool Contains(SetId set_id) const {
+      return set_id < in_list_.size() && in_list_[set_id];
+    }
+    // Count of @set_id, which should be in list.
+    uint64_t Get(SetId set_id) const {
+      return counts_[set_id];
+    }
+    // Sum of counts of sets before @set_id, which should be in list.
+    uint64_t SumBefore(SetId set_id) const;
+    // Sum of all counts.
+    uint64_t total() const {
+      return Sum(root_);
+    }
+    uint64_t size() const {
+      return size_;
+    }
+    bool empty() const {
+      return size_ == 0;
+    }
+
+  protected:
+    uint64_t Sum(SetId node) const {
+      return node == kNoSet ? 0 : sums_[node];
+    }
+    // Makes room for @set_id in node arrays and sets it up as a leaf.
+    void MakeLeaf(SetId set_id, uint64_t count);
+    // Hangs leaf @set_id under @parent, on the left if @left, and
+    // rotates it up to where its priority belongs.
+    void Attach(SetId parent, bool left, SetId set_id);
+    // Adds @delta (mod 2^64) to sums of @node and its ancestors.
+    void AddToSums(SetId node, uint64_t delta);
+    // Moves @node up above its parent, keeping list order.
+    void RotateUp(SetId node);
+    // Last set in subtree of @node.
+    SetId Rightmost(SetId node) const;
+
+    // Indexed by set id.
+    vector<SetId> left_;
+    vector<SetId> right_;
+    vector<SetId> parent_;
+    vector<uint64_t> priorities_;
+    vector<uint64_t> counts_;
+    vector<uint64_t> sums_;
+    vector<bool> in_list_;
+    SetId root_;
+    uint64_t size_;
+  private:
+    friend class PrefixSumListTest;
+    FRIEND_TEST(PrefixSumListTest, Balanced);
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_PREFIX_SUM_LIST_H_
@@ -0,0 +1,86 @@
+#include "prefix_sum_list.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::max;
+
+class PrefixSumListTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    list_.reset(new PrefixSumList);
+  }
+  uint64_t Depth(SetId node) const {
+    if (node == kNoSet) {
+      return 0;
+    }
+    return 1 + max(Depth(list_->left_[node]), Depth(list_->right_[node]));
+  }
+  std::unique_ptr<PrefixSumList> list_;
+};
+
+TEST_F(PrefixSumListTest, SumBefore) {
+  EXPECT_TRUE(list_->push_back(3, 5));
+  EXPECT_TRUE(list_->push_back(0, 2));
+  EXPECT_TRUE(list_->push_back(7, 4));
+  EXPECT_FALSE(list_->push_back(0, 1));
+  EXPECT_EQ(3, list_->size());
+  EXPECT_EQ(11, list_->total());
+  EXPECT_EQ(0, list_->SumBefore(3));
+  EXPECT_EQ(5, list_->SumBefore(0));
+  EXPECT_EQ(7, list_->SumBefore(7));
+
+  // 3, 1, 0, 7
+  EXPECT_TRUE(list_->InsertBefore(0, 1, 10));
+  EXPECT_FALSE(list_->InsertBefore(9, 2, 1));
+  EXPECT_EQ(5, list_->SumBefore(1));
+  EXPECT_EQ(15, list_->SumBefore(0));
+  EXPECT_EQ(17, list_->SumBefore(7));
+
+  list_->Set(3, 1);
+  EXPECT_EQ(1, list_->Get(3));
+  EXPECT_EQ(13, list_->SumBefore(7));
+  EXPECT_TRUE(list_->Erase(1));
+  EXPECT_FALSE(list_->Erase(1));
+  EXPECT_FALSE(list_->Contains(1));
+  EXPECT_EQ(3, list_->SumBefore(7));
+  EXPECT_EQ(7, list_->total());
+
+  EXPECT_TRUE(list_->Replace(0, 8));
+  EXPECT_FALSE(list_->Replace(0, 9));
+  EXPECT_FALSE(list_->Contains(0));
+  EXPECT_EQ(2, list_->Get(8));
+  EXPECT_EQ(1, list_->SumBefore(8));
+  EXPECT_EQ(3, list_->SumBefore(7));
+  list_->clear();
+  EXPECT_TRUE(list_->empty());
+  EXPECT_TRUE(list_->push_back(7, 1));
+  EXPECT_EQ(1, list_->total());
+}
+
+TEST_F(PrefixSumListTest, Balanced) {
+  // Sets go in at the front, or in the middle, with count i + 1 for
+  // set i, so the sum before set i is i * (i + 1) / 2.
+  const SetId num_sets = 4096;
+  list_->push_back(num_sets - 1, num_sets);
+  for (SetId set_id = num_sets - 1; set_id-- > 0; ) {
+    EXPECT_TRUE(list_->InsertBefore(set_id + 1, set_id, set_id + 1));
+  }
+  for (SetId set_id = 0; set_id < num_sets; set_id++) {
+    EXPECT_EQ((uint64_t) set_id * (set_id + 1) / 2, list_->SumBefore(set_id));
+  }
+  EXPECT_GT(64, Depth(list_->root_));
+  for (SetId set_id = 0; set_id < num_sets; set_id += 2) {
+    list_->Erase(set_id);
+  }
+  EXPECT_EQ(num_sets / 2, list_->size());
+  EXPECT_EQ(2, list_->SumBefore(3));
+  EXPECT_EQ(2 + 4, list_->SumBefore(5));
+  EXPECT_GT(64, Depth(list_->root_));
+}
+}  // namespace incremental_atpg
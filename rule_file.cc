@@ -0,0 +1,239 @@
+#include "rule_file.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "sharded_symbol_table.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+
+  // Like isspace in the C locale, which is what >> splits on.
+  static inline bool IsSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+  }
+
+  RuleFile::RuleFile()
+    : data_(nullptr),
+      size_(0),
+      next_(nullptr) {
+  }
+
+  RuleFile::~RuleFile() {
+    Close();
+  }
+
+  void RuleFile::Close() {
+    if (data_ != nullptr && size_ > 0) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = next_ = nullptr;
+    size_ = 0;
+  }
+
+  bool RuleFile::Open(const string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      return false;
+    }
+    if (st.st_size == 0) {
+      // Can't map nothing, but it's a file with no rules.
+      close(fd);
+      static const char kEmpty = 0;
+      data_ = next_ = &kEmpty;
+      return true;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      return false;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    data_ = next_ = static_cast<const char*>(data);
+    size_ = st.st_size;
+    return true;
+  }
+
+  const char* RuleFile::FindNewline(const char* begin, const char* end) {
+#ifdef __SSE2__
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - begin >= 16; begin += 16) {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+      int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline));
+      if (mask != 0) {
+	return begin + __builtin_ctz(mask);
+      }
+    }
+#endif
+    for (; begin != end && *begin != '\n'; ++begin) { }
+    return begin;
+  }
+
+  const char* RuleFile::FindSpace(const char* begin, const char* end, bool space) {
+#ifdef __SSE2__
+    const __m128i blank = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    // '\t' to '\r' are the 5 bytes at most 4 past '\t'.
+    const __m128i four = _mm_set1_epi8(4);
+    for (; end - begin >= 16; begin += 16) {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+      __m128i past_tab = _mm_sub_epi8(bytes, tab);
+      __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(bytes, blank),
+				      _mm_cmpeq_epi8(_mm_min_epu8(past_tab, four), past_tab));
+      int mask = _mm_movemask_epi8(is_space);
+      if (!space) {
+	mask ^= 0xffff;
+      }
+      if (mask != 0) {
+	return begin + __builtin_ctz(mask);
+      }
+    }
+#endif
+    for (; begin != end && IsSpace(*begin) != space; ++begin) { }
+    return begin;
+  }
+
+  const char* RuleFile::ParseLine(const char* line, const char* end,
+				  vector<Span<char> >* names) {
+    names->clear();
+    const char* line_end = FindNewline(line, end);
+    const char* name = FindSpace(line, line_end, false);
+    while (name != line_end) {
+      const char* name_end = FindSpace(name, line_end, true);
+      names->push_back(Span<char>(name, name_end));
+      name = FindSpace(name_end, line_end, false);
+    }
+    return line_end == end ? end : line_end + 1;
+  }
+
+  bool RuleFile::NextRule(vector<Span<char> >* names) {
+    const char* end = data_ + size_;
+    if (next_ == end) {
+      names->clear();
+      return false;
+    }
+    next_ = ParseLine(next_, end, names);
+    return true;
+  }
+
+  bool RuleFile::NextRule(SymbolTable* symbols, vector<SetId>* set_ids) {
+    set_ids->clear();
+    if (!NextRule(&names_)) {
+      return false;
+    }
+    for (auto const& name : names_) {
+      name_.assign(name.begin(), name.size());
+      set_ids->push_back(symbols->Intern(name_));
+    }
+    return true;
+  }
+
+  vector<const char*> RuleFile::ChunkBounds(uint64_t num_chunks) const {
+    const char* end = data_ + size_;
+    vector<const char*> bounds(1, data_);
+    for (uint64_t chunk = 1; chunk < num_chunks; chunk++) {
+      const char* bound = data_ + size_ * chunk / num_chunks;
+      if (bound <= bounds.back()) {
+	continue;
+      }
+      // Lines go to the chunk they start in.
+      bound = FindNewline(bound - 1, end);
+      if (bound == end) {
+	break;
+      }
+      bounds.push_back(bound + 1);
+    }
+    bounds.push_back(end);
+    return bounds;
+  }
+
+  void RuleFile::ReadAll(ThreadPool* pool, vector<vector<string> >* rules) {
+    vector<const char*> bounds = ChunkBounds(pool->num_threads() * 4);
+    uint64_t num_chunks = bounds.size() - 1;
+    vector<vector<vector<string> > > chunk_rules(num_chunks);
+    pool->Run(num_chunks, [&](uint64_t chunk) {
+	vector<Span<char> > names;
+	for (const char* line = bounds[chunk]; line != bounds[chunk + 1]; ) {
+	  line = ParseLine(line, bounds[chunk + 1], &names);
+	  chunk_rules[chunk].push_back(vector<string>());
+	  vector<string>& rule = chunk_rules[chunk].back();
+	  rule.reserve(names.size());
+	  for (auto const& name : names) {
+	    rule.push_back(ToString(name));
+	  }
+	}
+      });
+    // Where each chunk's rules go, then they move there in parallel.
+    vector<uint64_t> firsts(num_chunks + 1, rules->size());
+    for (uint64_t chunk = 0; chunk < num_chunks; chunk++) {
+      firsts[chunk + 1] = firsts[chunk] + chunk_rules[chunk].size();
+    }
+    rules->resize(firsts.back());
+    pool->Run(num_chunks, [&](uint64_t chunk) {
+	std::move(chunk_rules[chunk].begin(), chunk_rules[chunk].end(),
+		  rules->begin() + firsts[chunk]);
+	vector<vector<string> >().swap(chunk_rules[chunk]);
+      });
+    next_ = data_ + size_;
+  }
+
+  void RuleFile::ReadAll(ThreadPool* pool, SymbolTable* symbols,
+			 vector<uint64_t>* offsets, vector<SetId>* set_ids) {
+    vector<const char*> bounds = ChunkBounds(pool->num_threads() * 4);
+    uint64_t num_chunks = bounds.size() - 1;
+    ShardedSymbolTable sharded;
+    // Temporary ids of each chunk's names, and where each rule ends.
+    vector<vector<SetId> > chunk_ids(num_chunks);
+    vector<vector<uint64_t> > chunk_ends(num_chunks);
+    pool->Run(num_chunks, [&](uint64_t chunk) {
+	vector<Span<char> > names;
+	string name;
+	for (const char* line = bounds[chunk]; line != bounds[chunk + 1]; ) {
+	  line = ParseLine(line, bounds[chunk + 1], &names);
+	  for (auto const& span : names) {
+	    name.assign(span.begin(), span.size());
+	    chunk_ids[chunk].push_back(sharded.Intern(name, span.begin() - data_));
+	  }
+	  chunk_ends[chunk].push_back(chunk_ids[chunk].size());
+	}
+      });
+    vector<SetId> new_ids;
+    sharded.Renumber(symbols, &new_ids);
+
+    vector<uint64_t> first_rules(num_chunks + 1, 0);
+    vector<uint64_t> first_ids(num_chunks + 1, 0);
+    for (uint64_t chunk = 0; chunk < num_chunks; chunk++) {
+      first_rules[chunk + 1] = first_rules[chunk] + chunk_ends[chunk].size();
+      first_ids[chunk + 1] = first_ids[chunk] + chunk_ids[chunk].size();
+    }
+    offsets->assign(first_rules.back() + 1, 0);
+    set_ids->resize(first_ids.back());
+    pool->Run(num_chunks, [&](uint64_t chunk) {
+	uint64_t rule_id = first_rules[chunk];
+	for (auto rule_end : chunk_ends[chunk]) {
+	  (*offsets)[++rule_id] = first_ids[chunk] + rule_end;
+	}
+	auto out = set_ids->begin() + first_ids[chunk];
+	for (auto id : chunk_ids[chunk]) {
+	  *out++ = new_ids[id];
+	}
+      });
+    next_ = data_ + size_;
+  }
+}  // namespace incremental_atpg
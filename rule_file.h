@@ -0,0 +1,78 @@
+#ifndef INCREMENTAL_ATPG_RULE_FILE_H_
+#define INCREMENTAL_ATPG_RULE_FILE_H_
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "span.h"
+#include "symbol_table.h"
+#include "thread_pool.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+
+  // Reads a rule file, one rule per line, its set names separated by
+  // whitespace, the way Util::WriteRulesToFile writes it. Every line
+  // is a rule, empty ones too, like with getline.
+  //
+  // The file is mapped in, lines and names are found 16 bytes at a
+  // time with SSE2 (byte by byte without it), and names are handed out
+  // as spans into the mapping, or interned right away, so there's no
+  // allocation per name.
+  class RuleFile {
+  public:
+    RuleFile();
+    // Unmaps file.
+    ~RuleFile();
+
+    // Maps @path in. Returns false if it can't.
+    bool Open(const string& path);
+    void Close();
+    // Set names of next rule, pointing into the file, so good until
+    // Close. Returns false, with @names empty, after the last rule.
+    bool NextRule(vector<Span<char> >* names);
+    // Like above, but interns names in @symbols and gives their ids.
+    bool NextRule(SymbolTable* symbols, vector<SetId>* set_ids);
+    // Starts over from the first rule.
+    void Rewind() {
+      next_ = data_;
+    }
+    // Appends all rules to @rules, in file order. The file is split
+    // at line boundaries into chunks that threads of @pool parse, and
+    // each chunk's rules move to their place in parallel too.
+    void ReadAll(ThreadPool* pool, vector<vector<string> >* rules);
+    // Reads all rules like above, interning names with a
+    // ShardedSymbolTable, so ids in @symbols are the same as reading
+    // with NextRule from the start. Sets of rule i are
+    // @set_ids[@offsets[i], @offsets[i + 1]).
+    void ReadAll(ThreadPool* pool, SymbolTable* symbols,
+		 vector<uint64_t>* offsets, vector<SetId>* set_ids);
+
+  protected:
+    // Set names of line starting at @line, which ends at @end or a
+    // newline before. Returns start of next line.
+    static const char* ParseLine(const char* line, const char* end,
+				 vector<Span<char> >* names);
+    // Starts of about @num_chunks chunks of whole lines, then end of
+    // file.
+    vector<const char*> ChunkBounds(uint64_t num_chunks) const;
+    // First byte in [@begin, @end) that is a newline, @end if none.
+    static const char* FindNewline(const char* begin, const char* end);
+    // First byte in [@begin, @end) that is whitespace if @space, or
+    // isn't if not, @end if none.
+    static const char* FindSpace(const char* begin, const char* end, bool space);
+
+    const char* data_;
+    uint64_t size_;
+    // Start of next line.
+    const char* next_;
+    vector<Span<char> > names_;
+    // Reused for lookups, so interning allocates only for new names.
+    string name_;
+  private:
+    friend class RuleFileTest;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_RULE_FILE_H_
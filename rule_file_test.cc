@@ -0,0 +1,146 @@
+#include "rule_file.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+  using std::stringstream;
+  using std::istream_iterator;
+
+class RuleFileTest : public testing::Test {
+ protected:
+  RuleFileTest()
+    : path_("rule_file_test.rules") { }
+  virtual void TearDown() {
+    std::remove(path_.c_str());
+  }
+  void Write(const string& contents) {
+    ofstream out(path_.c_str(), std::ios::binary);
+    out << contents;
+  }
+  // What getline and >> make of @contents.
+  vector<vector<string> > Expected(const string& contents) {
+    vector<vector<string> > rules;
+    stringstream in(contents);
+    string line;
+    while (getline(in, line)) {
+      stringstream words(line);
+      rules.push_back(vector<string>(istream_iterator<string>(words),
+				     istream_iterator<string>()));
+    }
+    return rules;
+  }
+  vector<vector<string> > Read() {
+    vector<vector<string> > rules;
+    RuleFile in;
+    EXPECT_TRUE(in.Open(path_));
+    vector<Span<char> > names;
+    while (in.NextRule(&names)) {
+      rules.push_back(vector<string>());
+      for (auto const& name : names) {
+	rules.back().push_back(ToString(name));
+      }
+    }
+    EXPECT_TRUE(names.empty());
+    return rules;
+  }
+  string path_;
+};
+
+TEST_F(RuleFileTest, SameAsGetline) {
+  vector<string> files = {
+    "",
+    "\n",
+    "1 2 3 \n4\n",
+    "no newline at end",
+    "\n\n  \t \n7",
+    "  leading and trailing  \r\n\tcarriage\rreturn\v\f tab\t\n",
+    // Names and runs of spaces longer than a 16 byte block.
+    "a_name_that_is_longer_than_sixteen_bytes b                  c\n"
+    "                                 d\n"
+    "0123456789abcdef 0123456789abcde 0123456789abcdefg\n",
+  };
+  string big;
+  for (int rule = 0; rule < 1000; rule++) {
+    for (int set = 0; set < rule % 13; set++) {
+      big += std::to_string(rule * set % 997) + string(set % 3 + 1, ' ');
+    }
+    big += "\n";
+  }
+  files.push_back(big);
+  for (auto const& contents : files) {
+    Write(contents);
+    EXPECT_EQ(Expected(contents), Read()) << contents;
+  }
+}
+
+TEST_F(RuleFileTest, Intern) {
+  Write("cat dog\n\ndog fish cat\n");
+  RuleFile in;
+  EXPECT_FALSE(in.Open("no_such_file.rules"));
+  ASSERT_TRUE(in.Open(path_));
+  SymbolTable symbols;
+  vector<SetId> set_ids;
+  EXPECT_TRUE(in.NextRule(&symbols, &set_ids));
+  EXPECT_EQ(vector<SetId>({0, 1}), set_ids);
+  EXPECT_TRUE(in.NextRule(&symbols, &set_ids));
+  EXPECT_TRUE(set_ids.empty());
+  EXPECT_TRUE(in.NextRule(&symbols, &set_ids));
+  EXPECT_EQ(vector<SetId>({1, 2, 0}), set_ids);
+  EXPECT_FALSE(in.NextRule(&symbols, &set_ids));
+  EXPECT_EQ(3, symbols.size());
+  EXPECT_EQ("fish", symbols.Name(2));
+
+  in.Rewind();
+  EXPECT_TRUE(in.NextRule(&symbols, &set_ids));
+  EXPECT_EQ(vector<SetId>({0, 1}), set_ids);
+}
+
+TEST_F(RuleFileTest, ReadAll) {
+  string contents;
+  for (int rule = 0; rule < 5000; rule++) {
+    for (int set = 0; set < rule % 11; set++) {
+      contents += std::to_string((rule + 1) * (set + 3) % 1009) + " ";
+    }
+    contents += rule % 97 == 0 ? "\n\n" : "\n";
+  }
+  contents += "last line";
+  Write(contents);
+  vector<vector<string> > expected = Expected(contents);
+
+  for (unsigned num_threads : {1, 3, 8}) {
+    ThreadPool pool(num_threads);
+    RuleFile in;
+    ASSERT_TRUE(in.Open(path_));
+    vector<vector<string> > rules;
+    in.ReadAll(&pool, &rules);
+    EXPECT_EQ(expected, rules);
+
+    // Same ids as interning one rule after the other.
+    SymbolTable serial_symbols;
+    serial_symbols.Intern("42");
+    SymbolTable symbols(serial_symbols);
+    vector<uint64_t> offsets;
+    vector<SetId> set_ids;
+    in.ReadAll(&pool, &symbols, &offsets, &set_ids);
+    in.Rewind();
+    vector<SetId> serial_ids;
+    ASSERT_EQ(expected.size() + 1, offsets.size());
+    for (uint64_t rule_id = 0; rule_id < expected.size(); rule_id++) {
+      ASSERT_TRUE(in.NextRule(&serial_symbols, &serial_ids));
+      EXPECT_EQ(serial_ids, vector<SetId>(set_ids.begin() + offsets[rule_id],
+					  set_ids.begin() + offsets[rule_id + 1]));
+    }
+    EXPECT_EQ(serial_symbols.size(), symbols.size());
+  }
+}
+}  // namespace incremental_atpg
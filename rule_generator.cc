@@ -0,0 +1,202 @@
+#include "rule_generator.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+#include "binary_rule_file.h"
+#include "thread_pool.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+  using std::upper_bound;
+  using std::sort;
+  using std::unique;
+  using std::min;
+
+  // Chunks per thread made before they're written.
+  static const uint64_t kChunksPerThread = 2;
+  // Above this mean, Poisson draws are normal ones.
+  static const double kMaxExactPoissonMean = 30.0;
+
+  RuleGenerator::RuleGenerator(uint64_t num_rules, uint64_t num_sets,
+			       uint64_t max_rules_per_set,
+			       const vector<double>& zipf,
+			       uint64_t seed)
+    : num_rules_(num_rules),
+      num_sets_(num_sets),
+      seed_(seed),
+      keep_(num_sets, 1.0),
+      alias_(num_sets),
+      mean_sets_per_rule_(0.0) {
+    vector<double> weights(num_sets);
+    double total = 0.0;
+    for (uint64_t set_id = 0; set_id < num_sets; set_id++) {
+      // Sets have streams of their own, apart from the rules'.
+      StreamRng rng(~seed, set_id);
+      uint64_t rank = upper_bound(zipf.begin(), zipf.end(), rng.NextDouble())
+	- zipf.begin() + 1;
+      weights[set_id] = uint64_t((double) rank / zipf.size() * max_rules_per_set);
+      total += weights[set_id];
+    }
+    if (num_rules > 0) {
+      mean_sets_per_rule_ = total / num_rules;
+    }
+    if (total == 0.0) {
+      return;
+    }
+    // Vose's alias method: a set under the mean weight keeps its
+    // share of its slot and gives the rest to one over it.
+    vector<uint64_t> small, large;
+    for (uint64_t set_id = 0; set_id < num_sets; set_id++) {
+      alias_[set_id] = set_id;
+      weights[set_id] *= num_sets / total;
+      (weights[set_id] < 1.0 ? small : large).push_back(set_id);
+    }
+    while (!small.empty() && !large.empty()) {
+      uint64_t under = small.back();
+      uint64_t over = large.back();
+      small.pop_back();
+      keep_[under] = weights[under];
+      alias_[under] = over;
+      weights[over] -= 1.0 - weights[under];
+      if (weights[over] < 1.0) {
+	large.pop_back();
+	small.push_back(over);
+      }
+    }
+    // What's left is 1 but for rounding.
+  }
+
+  uint64_t RuleGenerator::Poisson(double mean, StreamRng* rng) {
+    if (mean <= kMaxExactPoissonMean) {
+      double limit = std::exp(-mean);
+      double product = rng->NextDouble();
+      uint64_t count = 0;
+      while (product > limit) {
+	product *= rng->NextDouble();
+	++count;
+      }
+      return count;
+    }
+    // Box-Muller, with 1 - u in (0, 1].
+    double normal = std::sqrt(-2.0 * std::log(1.0 - rng->NextDouble()))
+      * std::cos(2.0 * M_PI * rng->NextDouble());
+    double count = std::floor(mean + std::sqrt(mean) * normal + 0.5);
+    return count < 0.0 ? 0 : count;
+  }
+
+  void RuleGenerator::MakeRule(uint64_t rule_id, vector<uint64_t>* set_ids) const {
+    set_ids->clear();
+    if (mean_sets_per_rule_ == 0.0) {
+      return;
+    }
+    StreamRng rng(seed_, rule_id);
+    uint64_t num_draws = min(Poisson(mean_sets_per_rule_, &rng), num_sets_);
+    for (uint64_t draw = 0; draw < num_draws; draw++) {
+      // Whole part picks the slot, the rest whether to keep it.
+      double slot = rng.NextDouble() * num_sets_;
+      uint64_t set_id = min<uint64_t>(slot, num_sets_ - 1);
+      set_ids->push_back(slot - set_id < keep_[set_id] ? set_id : alias_[set_id]);
+    }
+    // The same set drawn twice is in the rule once.
+    sort(set_ids->begin(), set_ids->end());
+    set_ids->erase(unique(set_ids->begin(), set_ids->end()), set_ids->end());
+  }
+
+  void RuleGenerator::MakeChunk(uint64_t begin, uint64_t end, string* text) const {
+    vector<uint64_t> set_ids;
+    for (uint64_t rule_id = begin; rule_id < end; rule_id++) {
+      MakeRule(rule_id, &set_ids);
+      if (set_ids.empty()) {
+	continue;
+      }
+      for (uint64_t i = 0; i < set_ids.size(); i++) {
+	if (i > 0) {
+	  text->push_back(' ');
+	}
+	text->append(SetName(set_ids[i]));
+      }
+      text->push_back('\n');
+    }
+  }
+
+  void RuleGenerator::Generate(unsigned num_threads,
+			       const function<void(const string&)>& write) const {
+    ThreadPool pool(num_threads);
+    uint64_t num_chunks = (num_rules_ + kRulesPerChunk - 1) / kRulesPerChunk;
+    vector<string> chunks(pool.num_threads() * kChunksPerThread);
+    for (uint64_t first = 0; first < num_chunks; first += chunks.size()) {
+      uint64_t batch = min<uint64_t>(chunks.size(), num_chunks - first);
+      pool.Run(batch, [&](uint64_t i) {
+	  uint64_t begin = (first + i) * kRulesPerChunk;
+	  chunks[i].clear();
+	  MakeChunk(begin, min(begin + kRulesPerChunk, num_rules_), &chunks[i]);
+	});
+      for (uint64_t i = 0; i < batch; i++) {
+	write(chunks[i]);
+      }
+    }
+  }
+
+  bool RuleGenerator::WriteText(const string& path, unsigned num_threads) const {
+    ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out.good()) {
+      return false;
+    }
+    Generate(num_threads, [&](const string& chunk) {
+	out.write(chunk.data(), chunk.size());
+      });
+    out.close();
+    return !out.fail();
+  }
+
+  bool RuleGenerator::WriteBinary(const string& path, unsigned num_threads) const {
+    BinaryRuleWriter writer;
+    if (!writer.Open(path)) {
+      return false;
+    }
+    vector<Span<char> > names;
+    Generate(num_threads, [&](const string& chunk) {
+	// Lines are names with a space between each, see MakeChunk.
+	const char* end = chunk.data() + chunk.size();
+	const char* name = chunk.data();
+	for (const char* pos = name; pos < end; pos++) {
+	  if (*pos == ' ' || *pos == '\n') {
+	    names.push_back(Span<char>(name, pos));
+	    name = pos + 1;
+	  }
+	  if (*pos == '\n') {
+	    writer.AddRule(names);
+	    names.clear();
+	  }
+	}
+      });
+    return writer.Close();
+  }
+
+  RuleSource* RuleGenerator::NewRuleSource() const {
+    uint64_t next = 0;
+    vector<uint64_t> set_ids;
+    return new FunctionRuleSource([this, next, set_ids] (vector<string>* sets) mutable {
+	// Skips empty rules, like the files.
+	do {
+	  if (next == num_rules_) {
+	    sets->clear();
+	    return false;
+	  }
+	  MakeRule(next++, &set_ids);
+	} while (set_ids.empty());
+	sets->resize(set_ids.size());
+	for (uint64_t i = 0; i < set_ids.size(); i++) {
+	  (*sets)[i] = SetName(set_ids[i]);
+	}
+	return true;
+      });
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,109 @@
+#ifndef INCREMENTAL_ATPG_RULE_GENERATOR_H_
+#define INCREMENTAL_ATPG_RULE_GENERATOR_H_
+#include <vector>
+#include <string>
+#include <functional>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "rule_source.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::function;
+
+  // Rules generated at a time.
+  const uint64_t kRulesPerChunk = 8192;
+
+  // Random numbers of stream @stream of @seed, the @counter-th being
+  // a hash of the three, SplitMix64 style, so any stream can start
+  // anywhere without drawing the ones before.
+  class StreamRng {
+  public:
+    StreamRng(uint64_t seed, uint64_t stream)
+      : key_(Mix(Mix(seed) + stream)),
+      counter_(0) { }
+    uint64_t Next() {
+      return Mix(key_ + 0x9e3779b97f4a7c15ULL * ++counter_);
+    }
+    // In [0, 1).
+    double NextDouble() {
+      return (Next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+    static uint64_t Mix(uint64_t x) {
+      x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+      return x ^ (x >> 31);
+    }
+
+  protected:
+    uint64_t key_;
+    uint64_t counter_;
+  };
+
+  // Same kind of instance as Util::MakeRules, but made a rule at a
+  // time, so it's never all in memory. Set s goes in about w(s) of
+  // the rules, where w(s) is a Zipf draw from @zipf times
+  // @max_rules_per_set, like there. So each rule gets a Poisson
+  // number of sets, with mean sum of w(s) over @num_rules, each
+  // drawn with chance proportional to w(s).
+  //
+  // Each set's draw, and each rule's, comes from its own stream of
+  // @seed, so rule i is the same whichever thread makes it, in
+  // whatever order, and files are the same for any number of threads.
+  class RuleGenerator {
+  public:
+    RuleGenerator(uint64_t num_rules, uint64_t num_sets,
+		  uint64_t max_rules_per_set,
+		  const vector<double>& zipf,
+		  uint64_t seed);
+
+    // Sets of rule @rule_id, sorted. Safe to call from many threads.
+    void MakeRule(uint64_t rule_id, vector<uint64_t>* set_ids) const;
+    // Name of set @set_id, like Util::GetString.
+    static string SetName(uint64_t set_id) {
+      return std::to_string(set_id);
+    }
+    // Write all rules but empty ones to @path, text (see RuleFile) or
+    // binary (see BinaryRuleWriter), generating a few chunks at a
+    // time on @num_threads threads, 0 for one per hardware thread,
+    // then writing them in order. Returns false if the file can't be
+    // written.
+    bool WriteText(const string& path, unsigned num_threads) const;
+    bool WriteBinary(const string& path, unsigned num_threads) const;
+    // Hands out the same rules as the files, one at a time, e.g., to
+    // Evaluate. Caller owns it, and this has to outlive it.
+    RuleSource* NewRuleSource() const;
+
+    uint64_t num_rules() const {
+      return num_rules_;
+    }
+    double mean_sets_per_rule() const {
+      return mean_sets_per_rule_;
+    }
+
+  protected:
+    // Text of rules in chunks of kRulesPerChunk, a line for each but
+    // empty ones, @write called with each in order.
+    void Generate(unsigned num_threads,
+		  const function<void(const string&)>& write) const;
+    // Appends lines of rules in [@begin, @end) to @text.
+    void MakeChunk(uint64_t begin, uint64_t end, string* text) const;
+    // Poisson draw with mean @mean.
+    static uint64_t Poisson(double mean, StreamRng* rng);
+
+    uint64_t num_rules_;
+    uint64_t num_sets_;
+    uint64_t seed_;
+    // Alias table of w(s), so drawing a set takes one number and one
+    // lookup: set s is drawn with chance (@keep_[s] + sum of
+    // 1 - @keep_[t] over t with @alias_[t] == s) / num_sets.
+    vector<double> keep_;
+    vector<uint64_t> alias_;
+    double mean_sets_per_rule_;
+  private:
+    friend class RuleGeneratorTest;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_RULE_GENERATOR_H_
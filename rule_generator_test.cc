@@ -0,0 +1,110 @@
+#include "rule_generator.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "util.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::unique_ptr;
+  using std::sort;
+
+class RuleGeneratorTest : public testing::Test {
+ protected:
+  RuleGeneratorTest()
+    // More rules than a batch of chunks on 3 threads.
+    : generator_(7 * kRulesPerChunk + 100, 3000, 200, Util::zipf_1, 10),
+    text_path_("rule_generator_test.txt"),
+    binary_path_("rule_generator_test.bin") { }
+  virtual void TearDown() {
+    std::remove(text_path_.c_str());
+    std::remove(binary_path_.c_str());
+  }
+  string Contents(const string& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+  }
+  // All rules of @source, sets of each sorted.
+  vector<vector<string> > ReadAll(RuleSource* source) {
+    vector<vector<string> > rules;
+    vector<string> sets;
+    while (source->NextRule(&sets)) {
+      sort(sets.begin(), sets.end());
+      rules.push_back(sets);
+    }
+    return rules;
+  }
+  RuleGenerator generator_;
+  string text_path_;
+  string binary_path_;
+};
+
+TEST_F(RuleGeneratorTest, MakeRule) {
+  vector<uint64_t> set_ids, again;
+  uint64_t num_sets = 0;
+  for (uint64_t rule_id = 0; rule_id < 1000; rule_id++) {
+    generator_.MakeRule(rule_id, &set_ids);
+    EXPECT_TRUE(std::is_sorted(set_ids.begin(), set_ids.end()));
+    EXPECT_TRUE(std::adjacent_find(set_ids.begin(), set_ids.end()) == set_ids.end());
+    generator_.MakeRule(rule_id, &again);
+    EXPECT_EQ(set_ids, again);
+    num_sets += set_ids.size();
+  }
+  // A few sets drawn twice.
+  EXPECT_NEAR(generator_.mean_sets_per_rule(), num_sets / 1000.0,
+	      0.1 * generator_.mean_sets_per_rule());
+
+  RuleGenerator other_seed(generator_.num_rules(), 3000, 200, Util::zipf_1, 11);
+  generator_.MakeRule(0, &set_ids);
+  other_seed.MakeRule(0, &again);
+  EXPECT_NE(set_ids, again);
+}
+
+TEST_F(RuleGeneratorTest, SameForAnyThreads) {
+  ASSERT_TRUE(generator_.WriteText(text_path_, 1));
+  string one_thread = Contents(text_path_);
+  ASSERT_TRUE(generator_.WriteText(text_path_, 3));
+  EXPECT_EQ(one_thread, Contents(text_path_));
+
+  TextRuleSource text;
+  ASSERT_TRUE(text.Open(text_path_));
+  vector<vector<string> > rules = ReadAll(&text);
+  // Few rules are empty.
+  EXPECT_GT(rules.size(), 6 * kRulesPerChunk);
+  unique_ptr<RuleSource> source(generator_.NewRuleSource());
+  EXPECT_EQ(rules, ReadAll(source.get()));
+
+  ASSERT_TRUE(generator_.WriteBinary(binary_path_, 3));
+  BinaryRuleSource binary;
+  ASSERT_TRUE(binary.Open(binary_path_));
+  EXPECT_EQ(rules, ReadAll(&binary));
+}
+
+TEST_F(RuleGeneratorTest, WriteLargeText) {
+  // Size UtilTest.WriteRulesToFile used to make with MakeRules, on
+  // every hardware thread.
+  RuleGenerator generator(700000, 300000, 200, Util::zipf_1, 10);
+  ASSERT_TRUE(generator.WriteText(text_path_, 0));
+  TextRuleSource text;
+  ASSERT_TRUE(text.Open(text_path_));
+  vector<string> sets;
+  uint64_t num_rules = 0;
+  while (text.NextRule(&sets)) {
+    ++num_rules;
+  }
+  // Few rules are empty.
+  EXPECT_GT(num_rules, 600000);
+  EXPECT_LE(num_rules, 700000);
+}
+}  // namespace incremental_atpg
@@ -0,0 +1,54 @@
+#include "rule_source.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::unique_ptr;
+
+  bool TextRuleSource::NextRule(vector<string>* sets) {
+    if (!file_.NextRule(&names_)) {
+      sets->clear();
+      return false;
+    }
+    sets->resize(names_.size());
+    for (uint64_t i = 0; i < names_.size(); i++) {
+      (*sets)[i].assign(names_[i].begin(), names_[i].size());
+    }
+    return true;
+  }
+
+  bool BinaryRuleSource::NextRule(vector<string>* sets) {
+    if (!reader_.NextRule(&set_ids_)) {
+      sets->clear();
+      return false;
+    }
+    sets->resize(set_ids_.size());
+    for (uint64_t i = 0; i < set_ids_.size(); i++) {
+      (*sets)[i] = reader_.symbols().Name(set_ids_[i]);
+    }
+    return true;
+  }
+
+  bool VectorRuleSource::NextRule(vector<string>* sets) {
+    if (next_ == rules_.size()) {
+      sets->clear();
+      return false;
+    }
+    *sets = rules_[next_++];
+    return true;
+  }
+
+  RuleSource* OpenRuleSource(const string& path) {
+    if (BinaryRuleReader::IsBinary(path)) {
+      unique_ptr<BinaryRuleSource> source(new BinaryRuleSource);
+      return source->Open(path) ? source.release() : nullptr;
+    }
+    unique_ptr<TextRuleSource> source(new TextRuleSource);
+    return source->Open(path) ? source.release() : nullptr;
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,90 @@
+#ifndef INCREMENTAL_ATPG_RULE_SOURCE_H_
+#define INCREMENTAL_ATPG_RULE_SOURCE_H_
+#include <vector>
+#include <string>
+#include <functional>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "span.h"
+#include "symbol_table.h"
+#include "rule_file.h"
+#include "binary_rule_file.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::function;
+
+  // Hands out rules one at a time, so whoever takes them, e.g.,
+  // SetCover::IngestRules or Evaluate, never holds all of them, only
+  // the state it builds from them.
+  class RuleSource {
+  public:
+    virtual ~RuleSource() { }
+    // Fills in @sets with set names of next rule, reusing strings in
+    // it. Returns false after the last rule.
+    virtual bool NextRule(vector<string>* sets) = 0;
+  };
+
+  // Text rule file, see RuleFile.
+  class TextRuleSource : public RuleSource {
+  public:
+    // Returns false if @path can't be read.
+    bool Open(const string& path) {
+      return file_.Open(path);
+    }
+    bool NextRule(vector<string>* sets);
+
+  protected:
+    RuleFile file_;
+    vector<Span<char> > names_;
+  };
+
+  // Binary rule file, see BinaryRuleReader. Sets of each rule come
+  // sorted by id.
+  class BinaryRuleSource : public RuleSource {
+  public:
+    // Returns false if @path isn't a binary rule file.
+    bool Open(const string& path) {
+      return reader_.Open(path);
+    }
+    bool NextRule(vector<string>* sets);
+
+  protected:
+    BinaryRuleReader reader_;
+    vector<SetId> set_ids_;
+  };
+
+  // Rules someone already has, e.g., in tests.
+  class VectorRuleSource : public RuleSource {
+  public:
+    explicit VectorRuleSource(const vector<vector<string> >& rules)
+      : rules_(rules),
+      next_(0) { }
+    bool NextRule(vector<string>* sets);
+
+  protected:
+    const vector<vector<string> >& rules_;
+    uint64_t next_;
+  };
+
+  // Rules made up as they're asked for, e.g., by a generator, by
+  // calling @next_rule with @sets.
+  class FunctionRuleSource : public RuleSource {
+  public:
+    explicit FunctionRuleSource(const function<bool(vector<string>*)>& next_rule)
+      : next_rule_(next_rule) { }
+    bool NextRule(vector<string>* sets) {
+      return next_rule_(sets);
+    }
+
+  protected:
+    function<bool(vector<string>*)> next_rule_;
+  };
+
+  // Text or binary source for @path, whichever it is. Returns
+  // nullptr if it can't be read.
+  RuleSource* OpenRuleSource(const string& path);
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_RULE_SOURCE_H_
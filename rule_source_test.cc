@@ -0,0 +1,111 @@
+#include "rule_source.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+  using std::unique_ptr;
+  using std::sort;
+
+class RuleSourceTest : public testing::Test {
+ protected:
+  RuleSourceTest()
+    : rules_({{"cat", "dog"}, {"dog"}, {"pig", "cat", "fish"}}),
+    text_path_("rule_source_test.txt"),
+    binary_path_("rule_source_test.bin") { }
+  virtual void SetUp() {
+    ofstream out(text_path_.c_str());
+    for (auto const& rule : rules_) {
+      for (uint64_t i = 0; i < rule.size(); i++) {
+	out << (i == 0 ? "" : " ") << rule[i];
+      }
+      out << "\n";
+    }
+    out.close();
+    BinaryRuleWriter writer;
+    ASSERT_TRUE(writer.Open(binary_path_));
+    for (auto const& rule : rules_) {
+      writer.AddRule(rule);
+    }
+    ASSERT_TRUE(writer.Close());
+  }
+  virtual void TearDown() {
+    std::remove(text_path_.c_str());
+    std::remove(binary_path_.c_str());
+  }
+  // All rules left in @source, sets of each sorted if @sorted.
+  vector<vector<string> > ReadAll(RuleSource* source, bool sorted) {
+    vector<vector<string> > rules;
+    vector<string> sets;
+    while (source->NextRule(&sets)) {
+      if (sorted) {
+	sort(sets.begin(), sets.end());
+      }
+      rules.push_back(sets);
+    }
+    return rules;
+  }
+  vector<vector<string> > Sorted(vector<vector<string> > rules) {
+    for (auto& rule : rules) {
+      sort(rule.begin(), rule.end());
+    }
+    return rules;
+  }
+  vector<vector<string> > rules_;
+  string text_path_;
+  string binary_path_;
+};
+
+TEST_F(RuleSourceTest, Files) {
+  TextRuleSource text;
+  ASSERT_TRUE(text.Open(text_path_));
+  EXPECT_EQ(rules_, ReadAll(&text, false));
+
+  BinaryRuleSource binary;
+  EXPECT_FALSE(binary.Open(text_path_));
+  ASSERT_TRUE(binary.Open(binary_path_));
+  EXPECT_EQ(Sorted(rules_), ReadAll(&binary, true));
+}
+
+TEST_F(RuleSourceTest, OpenRuleSource) {
+  unique_ptr<RuleSource> text(OpenRuleSource(text_path_));
+  ASSERT_TRUE(text != nullptr);
+  EXPECT_TRUE(dynamic_cast<TextRuleSource*>(text.get()) != nullptr);
+  EXPECT_EQ(rules_, ReadAll(text.get(), false));
+
+  unique_ptr<RuleSource> binary(OpenRuleSource(binary_path_));
+  ASSERT_TRUE(binary != nullptr);
+  EXPECT_TRUE(dynamic_cast<BinaryRuleSource*>(binary.get()) != nullptr);
+  EXPECT_EQ(Sorted(rules_), ReadAll(binary.get(), true));
+
+  EXPECT_TRUE(OpenRuleSource("no_such_file.txt") == nullptr);
+}
+
+TEST_F(RuleSourceTest, InMemory) {
+  VectorRuleSource vector_source(rules_);
+  EXPECT_EQ(rules_, ReadAll(&vector_source, false));
+
+  uint64_t next = 0;
+  FunctionRuleSource function_source([&] (vector<string>* sets) {
+      if (next == 2) {
+	return false;
+      }
+      sets->assign(1, "s" + std::to_string(next++));
+      return true;
+    });
+  EXPECT_EQ(vector<vector<string> >({{"s0"}, {"s1"}}),
+	    ReadAll(&function_source, false));
+  // Stays done.
+  vector<string> sets;
+  EXPECT_FALSE(function_source.NextRule(&sets));
+}
+}  // namespace incremental_atpg
@@ -1,5 +1,6 @@
 #include "set_cover.h"
 
+#include <algorithm>
 #include <set>
 #include <vector>
 #include <string>
@@ -8,6 +9,9 @@
 #include <list>
 #include "log4cxx/logger.h"
 
+#include "snapshot.h"
+#include "rule_source.h"
+
 namespace incremental_atpg {
   using std::vector;
   using std::string;
@@ -19,43 +23,234 @@ namespace incremental_atpg {
   using log4cxx::Logger;
   using log4cxx::Level;
 
-  // Takes ownership of @set_infos, @rule_infos.
-  SetCover::SetCover(map<string, SetInfo>* set_infos,
-		     vector<RuleInfo>* rule_infos)
-    : set_infos_(set_infos),
-      rule_infos_(rule_infos),
-      set_processing_infos_(new map<string, SetProcessingInfo>),
+  // Takes ownership of @set_names, @incidence.
+  SetCover::SetCover(SymbolTable* set_names,
+		     Incidence* incidence)
+    : set_names_(set_names),
+      incidence_(incidence),
+      set_processing_infos_(new vector<SetProcessingInfo>),
       rule_processing_infos_(new vector<RuleProcessingInfo>),
-      cover_(new list<string>) {
+      cover_(new OrderList) {
     set_cover_logger = Logger::getLogger("SetCover");
     set_cover_logger->setLevel(log4cxx::Level::getWarn());
     set_cover_logger->setLevel(log4cxx::Level::getWarn());
   }
 
   void SetCover::AddRule(const vector<string>& sets) {
-    uint64_t new_rule = rule_infos_->size();
-    rule_infos_->push_back(sets);
-    map<string, SetInfo>::iterator it;
-    for (auto const& set_id : sets) {
-      if ((it = set_infos_->find(set_id)) != set_infos_->end()) {
-	it->second.AddRule(new_rule);
-      } else {
-	SetInfo info;
-	info.AddRule(new_rule);
-	set_infos_->insert(make_pair(set_id, info));
+    AddRuleToIncidence(InternSets(sets));
+  }
+
+  uint64_t SetCover::IngestRules(RuleSource* source, uint64_t max_rules) {
+    uint64_t num_added = 0;
+    // Reused for every rule.
+    vector<string> sets;
+    vector<SetId> set_ids;
+    while (num_added < max_rules && source->NextRule(&sets)) {
+      if (sets.empty()) {
+	continue;
+      }
+      set_ids.clear();
+      for (auto const& set_name : sets) {
+	set_ids.push_back(set_names_->Intern(set_name));
       }
+      AddRuleToIncidence(set_ids);
+      ++num_added;
     }
+    return num_added;
   }
 
-  map<string, SetInfo> SetCover::GetSetInfos() const {
-    return *set_infos_.get();
+  vector<SetId> SetCover::InternSets(const vector<string>& sets) {
+    vector<SetId> set_ids;
+    set_ids.reserve(sets.size());
+    for (auto const& set_name : sets) {
+      set_ids.push_back(set_names_->Intern(set_name));
+    }
+    return set_ids;
   }
 
-  vector<RuleInfo> SetCover::GetRuleInfos() const {
-    return *rule_infos_.get();
+  void SetCover::AddRuleToIncidence(const vector<SetId>& set_ids) {
+    incidence_->AddRule(set_ids);
+    if (set_processing_infos_->size() < incidence_->num_sets()) {
+      set_processing_infos_->resize(incidence_->num_sets());
+    }
   }
 
-  map<string, SetProcessingInfo> SetCover::GetSetProcessingInfos() const {
+  bool SetCover::RemoveRule(const vector<string>& sets) {
+    vector<SetId> set_ids;
+    SetId covered_by = kNoSet;
+    return FindSetIds(sets, &set_ids)
+      && RemoveRuleFromIncidence(set_ids, &covered_by);
+  }
+
+  bool SetCover::FindSetIds(const vector<string>& sets,
+			    vector<SetId>* set_ids) const {
+    set_ids->clear();
+    for (auto const& set_name : sets) {
+      SetId set_id = kNoSet;
+      if (!set_names_->Find(set_name, &set_id)) {
+	return false;
+      }
+      set_ids->push_back(set_id);
+    }
+    return true;
+  }
+
+  bool SetCover::RemoveRuleFromIncidence(const vector<SetId>& set_ids,
+					 SetId* covered_by) {
+    *covered_by = kNoSet;
+    uint64_t rule_id = incidence_->FindRule(set_ids);
+    if (rule_id == kNoRule) {
+      LOG4CXX_INFO(set_cover_logger, "No rule to remove.");
+      return false;
+    }
+    *covered_by = RemoveRuleWithId(rule_id);
+    return true;
+  }
+
+  SetId SetCover::RemoveRuleWithId(uint64_t rule_id) {
+    SetId covered_by = kNoSet;
+    incidence_->RemoveRule(rule_id);
+    if (rule_id < rule_processing_infos_->size()) {
+      RuleProcessingInfo& rp = rule_processing_infos_->at(rule_id);
+      if (rp.Covered() && InCover(rp.first_covered_by)) {
+	covered_by = rp.first_covered_by;
+	set_processing_infos_->at(covered_by).RemoveRule(rule_id);
+      }
+      rp = RuleProcessingInfo();
+    }
+    return covered_by;
+  }
+
+  void SetCover::DropRemovedRules() {
+    vector<uint64_t> new_ids;
+    incidence_->DropRemovedRules(&new_ids);
+    vector<RuleProcessingInfo>* rule_processing_infos = new vector<RuleProcessingInfo>;
+    for (uint64_t rule_id = 0; rule_id < rule_processing_infos_->size(); rule_id++) {
+      if (new_ids[rule_id] != kNoRule) {
+	rule_processing_infos->push_back(rule_processing_infos_->at(rule_id));
+      }
+    }
+    rule_processing_infos_.reset(rule_processing_infos);
+    for (auto& sp : *set_processing_infos_) {
+      set<uint64_t> covers_rules;
+      for (auto rule_id : sp.covers_rules) {
+	covers_rules.insert(new_ids[rule_id]);
+      }
+      sp.covers_rules.swap(covers_rules);
+    }
+  }
+
+  void SetCover::SaveState(SnapshotWriter* writer) const {
+    set_names_->Save(writer);
+    incidence_->Save(writer);
+    vector<uint64_t> num_uncovered;
+    vector<uint8_t> in_cover;
+    num_uncovered.reserve(set_processing_infos_->size());
+    in_cover.reserve(set_processing_infos_->size());
+    for (auto const& sp : *set_processing_infos_) {
+      num_uncovered.push_back(sp.num_uncovered);
+      in_cover.push_back(sp.in_cover);
+    }
+    writer->Write(num_uncovered);
+    writer->Write(in_cover);
+    vector<SetId> first_covered_by;
+    first_covered_by.reserve(rule_processing_infos_->size());
+    for (auto const& rp : *rule_processing_infos_) {
+      first_covered_by.push_back(rp.first_covered_by);
+    }
+    writer->Write(first_covered_by);
+    writer->Write(vector<SetId>(cover_->begin(), cover_->end()));
+  }
+
+  bool SetCover::LoadState(SnapshotReader* reader) {
+    unique_ptr<SymbolTable> set_names(new SymbolTable);
+    unique_ptr<Incidence> incidence(new Incidence);
+    vector<uint64_t> num_uncovered;
+    vector<uint8_t> in_cover;
+    vector<SetId> first_covered_by;
+    vector<SetId> cover;
+    if (!set_names->Load(reader) || !incidence->Load(reader)
+	|| !reader->Read(&num_uncovered) || !reader->Read(&in_cover)
+	|| !reader->Read(&first_covered_by) || !reader->Read(&cover)) {
+      return false;
+    }
+    // Sections have to agree with each other, else cover is corrupt
+    // from the start.
+    uint64_t num_sets = incidence->num_sets();
+    if (num_uncovered.size() != num_sets || in_cover.size() != num_sets
+	|| set_names->size() != num_sets
+	|| first_covered_by.size() != incidence->num_rules()) {
+      return false;
+    }
+    // Sets in cover, and only those, are flagged in cover.
+    uint64_t num_in_cover = 0;
+    for (auto flag : in_cover) {
+      num_in_cover += flag != 0;
+    }
+    for (auto set_id : cover) {
+      if (set_id >= num_sets || !in_cover[set_id]) {
+	return false;
+      }
+    }
+    if (num_in_cover != cover.size()) {
+      return false;
+    }
+
+    unique_ptr<vector<SetProcessingInfo> > set_processing_infos(
+	new vector<SetProcessingInfo>(num_uncovered.size()));
+    for (SetId set_id = 0; set_id < num_uncovered.size(); set_id++) {
+      SetProcessingInfo& sp = set_processing_infos->at(set_id);
+      sp.num_uncovered = num_uncovered[set_id];
+      sp.in_cover = in_cover[set_id];
+    }
+    // Rules go in increasing order, always at the end of the set.
+    unique_ptr<vector<RuleProcessingInfo> > rule_processing_infos(
+	new vector<RuleProcessingInfo>);
+    rule_processing_infos->reserve(first_covered_by.size());
+    for (uint64_t rule_id = 0; rule_id < first_covered_by.size(); rule_id++) {
+      SetId set_id = first_covered_by[rule_id];
+      if (set_id != kNoSet) {
+	// Rule is covered by a set in cover that has it.
+	if (set_id >= num_sets || !in_cover[set_id]) {
+	  return false;
+	}
+	Span<uint64_t> rules = incidence->RulesOf(set_id);
+	if (!std::binary_search(rules.begin(), rules.end(), rule_id)) {
+	  return false;
+	}
+	set<uint64_t>& covers_rules = set_processing_infos->at(set_id).covers_rules;
+	covers_rules.insert(covers_rules.end(), rule_id);
+      }
+      rule_processing_infos->push_back(RuleProcessingInfo(set_id));
+    }
+    unique_ptr<OrderList> cover_order(new OrderList);
+    for (auto set_id : cover) {
+      if (!cover_order->push_back(set_id)) {
+	return false;
+      }
+    }
+
+    set_names_.swap(set_names);
+    incidence_.swap(incidence);
+    set_processing_infos_.swap(set_processing_infos);
+    rule_processing_infos_.swap(rule_processing_infos);
+    cover_.swap(cover_order);
+    return true;
+  }
+
+  const string& SetCover::GetSetName(SetId set_id) const {
+    return set_names_->Name(set_id);
+  }
+
+  bool SetCover::GetSetId(const string& set_name, SetId* set_id) const {
+    return set_names_->Find(set_name, set_id);
+  }
+
+  Incidence SetCover::GetIncidence() const {
+    return *incidence_.get();
+  }
+
+  vector<SetProcessingInfo> SetCover::GetSetProcessingInfos() const {
     return *set_processing_infos_.get();
   }
 
@@ -64,18 +259,22 @@ namespace incremental_atpg {
   }
 
   list<string> SetCover::GetCover() const {
-    return *cover_.get();
+    list<string> cover;
+    for (auto set_id : *cover_.get()) {
+      cover.push_back(set_names_->Name(set_id));
+    }
+    return cover;
   }
 
-  map<string, SetInfo>* SetCover::ReleaseSetInfos() {
-    return set_infos_.release();
+  SymbolTable* SetCover::ReleaseSetNames() {
+    return set_names_.release();
   }
 
-  vector<RuleInfo>* SetCover::ReleaseRuleInfos() {
-    return rule_infos_.release();
+  Incidence* SetCover::ReleaseIncidence() {
+    return incidence_.release();
   }
 
-  map<string, SetProcessingInfo>* SetCover::ReleaseSetProcessingInfos() {
+  vector<SetProcessingInfo>* SetCover::ReleaseSetProcessingInfos() {
     return set_processing_infos_.release();
   }
 
@@ -83,20 +282,16 @@ namespace incremental_atpg {
     return rule_processing_infos_.release();
   }
 
-  list<string>* SetCover::ReleaseCover() {
+  OrderList* SetCover::ReleaseCover() {
     return cover_.release();
   }
 
   void SetCover::ResetProcessingInfo() {
-    set_processing_infos_.reset(new map<string, SetProcessingInfo>);
+    set_processing_infos_.reset(new vector<SetProcessingInfo>(incidence_->num_sets()));
     rule_processing_infos_.reset(new vector<RuleProcessingInfo>);
-    vector<string>::iterator set_id;
-    uint64_t num_uncovered_rules = rule_infos_->size();
+    uint64_t num_uncovered_rules = incidence_->num_live_rules();
 
-    for (uint64_t i = 0; i < num_uncovered_rules; i++) {
-      RuleProcessingInfo uncovered_rule;
-      rule_processing_infos_->push_back(uncovered_rule);
-    }
+    rule_processing_infos_->resize(incidence_->num_rules());
 
     if (cover_->size() == 0) {
       LOG4CXX_INFO(set_cover_logger,
@@ -104,38 +299,33 @@ namespace incremental_atpg {
       return;
     }
 
-    map<string, SetInfo>::iterator sIt;
-    map<string, SetProcessingInfo>::iterator spIt;
-
     for (auto const& set_id : *cover_.get()) {
-      if ((sIt = set_infos_->find(set_id))
-	  == set_infos_->end()) {
-	LOG4CXX_WARN(set_cover_logger, "Set " << set_id << " not in set_infos_.");
+      if (set_id >= incidence_->num_sets()) {
+	LOG4CXX_WARN(set_cover_logger, "Set " << set_id << " not in incidence_.");
 	continue;
       }
       // Check we haven't processed this already.
-      if ((spIt = set_processing_infos_->find(set_id))
-	  != set_processing_infos_->end()) {
+      SetProcessingInfo& sp = set_processing_infos_->at(set_id);
+      if (sp.in_cover) {
 	LOG4CXX_INFO(set_cover_logger, "Set " << set_id << " duplicate in cover.");
 	continue;
       } else {
-	SetProcessingInfo sp;
 	sp.num_uncovered = num_uncovered_rules;
-	spIt = set_processing_infos_->insert(make_pair(set_id, sp)).first;
+	sp.in_cover = true;
       }
 
-      for (auto const& rule_id : sIt->second.all_rules) {
-	if (rule_id >= rule_infos_->size()) {
+      for (auto const& rule_id : incidence_->RulesOf(set_id)) {
+	if (rule_id >= incidence_->num_rules()) {
 	  LOG4CXX_WARN(set_cover_logger, "Rule " << rule_id << " not in infos_.");
 	  continue;
 	}
-	RuleProcessingInfo rule_info(set_id);
-	if (!rule_processing_infos_->at(rule_id).first_covered_by.empty()){
+	RuleProcessingInfo& rp = rule_processing_infos_->at(rule_id);
+	if (rp.Covered()) {
 	  LOG4CXX_INFO(set_cover_logger, "Rule " << rule_id 
 		       << " already covered before set " << set_id);
 	} else {
-	  rule_processing_infos_->at(rule_id).first_covered_by = set_id;
-	  spIt->second.AddRule(rule_id);
+	  rp.first_covered_by = set_id;
+	  sp.AddRule(rule_id);
 	  --num_uncovered_rules;
 	}
       }
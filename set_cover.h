@@ -10,6 +10,9 @@
 #include <log4cxx/logger.h>
 
 #include "gtest/gtest_prod.h"
+#include "symbol_table.h"
+#include "incidence.h"
+#include "order_list.h"
 
 namespace incremental_atpg {
   using std::vector;
@@ -22,13 +25,8 @@ namespace incremental_atpg {
   using log4cxx::Logger;
   using log4cxx::Level;
 
-  struct SetInfo {
-    // Updated only every new rule.
-    vector<uint64_t> all_rules; 
-    void AddRule(uint64_t new_rule) {
-      all_rules.push_back(new_rule);
-    }
-  };
+  class RuleSource;
+
   struct SetProcessingInfo {
     // Maintained by the set cover algorithms for sets in cover.
     // Number of rules not in cover, that this set covers.
@@ -36,6 +34,12 @@ namespace incremental_atpg {
     // Number of uncovered rules just before this set
     // was added to cover.
     uint64_t num_uncovered;
+    // Whether this set is in cover. Replaces checking for the set
+    // in a map of processing infos.
+    bool in_cover;
+  SetProcessingInfo()
+  : num_uncovered(0),
+      in_cover(false) { }
     void AddRule(uint64_t new_rule) {
       covers_rules.insert(new_rule);
     }
@@ -50,46 +54,44 @@ namespace incremental_atpg {
     }
   };
 
-  struct RuleInfo {
-    vector<string> all_sets;
-  RuleInfo(const vector<string>& all_sets)
-  : all_sets(all_sets) { }
-  };
-
   struct RuleProcessingInfo {
     // Used by set cover algorithm.
     // Maintained for all rules, to keep track
     // of which ones have been covered already.
     RuleProcessingInfo() 
-    : first_covered_by("") { }
-    RuleProcessingInfo(const string& first_set) 
+    : first_covered_by(kNoSet) { }
+    RuleProcessingInfo(SetId first_set) 
     : first_covered_by(first_set) { }
+    bool Covered() const {
+      return first_covered_by != kNoSet;
+    }
 
-    string first_covered_by;
+    SetId first_covered_by;
   };
 
   class SetCover {
   public:
     log4cxx::LoggerPtr set_cover_logger;
     SetCover() 
-      : set_infos_(new map<string, SetInfo>),
-      rule_infos_(new vector<RuleInfo>),
-      set_processing_infos_(new map<string, SetProcessingInfo>),
+      : set_names_(new SymbolTable),
+      incidence_(new Incidence),
+      set_processing_infos_(new vector<SetProcessingInfo>),
       rule_processing_infos_(new vector<RuleProcessingInfo>),
-      cover_(new list<string>) {
+      cover_(new OrderList) {
       set_cover_logger = Logger::getLogger("SetCover");
       set_cover_logger->setLevel(log4cxx::Level::getWarn());
 
     }
-    // Takes ownership of all @.._infos. Avoids copying when
-    // we're switching between two kinds.
-    SetCover(map<string, SetInfo>* set_infos,
-	     vector<RuleInfo>* rule_infos,
-	     map<string, SetProcessingInfo>* set_processing_infos,
+    // Takes ownership of @set_names, @incidence and all @.._infos.
+    // Avoids copying when we're switching between two kinds. All of
+    // them are indexed by ids in @set_names.
+    SetCover(SymbolTable* set_names,
+	     Incidence* incidence,
+	     vector<SetProcessingInfo>* set_processing_infos,
 	     vector<RuleProcessingInfo>* rule_processing_infos,
-	     list<string>* cover)
-      : set_infos_(set_infos),
-      rule_infos_(rule_infos),
+	     OrderList* cover)
+      : set_names_(set_names),
+      incidence_(incidence),
       set_processing_infos_(set_processing_infos),
       rule_processing_infos_(rule_processing_infos),
       cover_(cover) {
@@ -98,40 +100,90 @@ namespace incremental_atpg {
       }      
 
     // For testing.
-    explicit SetCover(map<string, SetInfo>* set_infos,
-	     vector<RuleInfo>* rule_infos);
+    explicit SetCover(SymbolTable* set_names,
+		      Incidence* incidence);
 
-    // Update @set_infos_ and @rule_infos_ for new rule.
+    // Interns @sets in @set_names_ and adds new rule to @incidence_.
     void AddRule(const vector<string>& sets);
+    // Adds up to @max_rules rules from @source like AddRule, one at a
+    // time, so only @incidence_ ends up holding them. Skips empty
+    // rules, which no set covers. For covers updated once after, like
+    // GreedySetCover. Returns number of rules added.
+    uint64_t IngestRules(RuleSource* source, uint64_t max_rules = UINT64_MAX);
+    // Removes a rule in exactly @sets, in any order, from @incidence_
+    // and processing infos. The set that covered it first no longer
+    // covers it, but stays in cover. Returns false if there's no such
+    // rule.
+    bool RemoveRule(const vector<string>& sets);
+    // Names of sets in cover, in order.
     list<string> GetCover() const;
-    map<string, SetInfo> GetSetInfos() const;
-    vector<RuleInfo> GetRuleInfos() const;
-    map<string, SetProcessingInfo> GetSetProcessingInfos() const;
+    // Name of set with id @set_id, empty if there's no such set.
+    const string& GetSetName(SetId set_id) const;
+    // Returns true and fills in @set_id if set @set_name was seen.
+    bool GetSetId(const string& set_name, SetId* set_id) const;
+    Incidence GetIncidence() const;
+    vector<SetProcessingInfo> GetSetProcessingInfos() const;
     vector<RuleProcessingInfo> GetRuleProcessingInfos() const;
 
-    list<string>* ReleaseCover();
-    map<string, SetInfo>* ReleaseSetInfos();
-    vector<RuleInfo>* ReleaseRuleInfos();
-    map<string, SetProcessingInfo>* ReleaseSetProcessingInfos();
+    SymbolTable* ReleaseSetNames();
+    OrderList* ReleaseCover();
+    Incidence* ReleaseIncidence();
+    vector<SetProcessingInfo>* ReleaseSetProcessingInfos();
     vector<RuleProcessingInfo>* ReleaseRuleProcessingInfos();
 
   protected:
+    // True if @set_id has processing info, i.e., it's in cover.
+    bool InCover(SetId set_id) const {
+      return set_id < set_processing_infos_->size()
+	&& set_processing_infos_->at(set_id).in_cover;
+    }
 
-    // Resets processing using @cover, @set_infos_ and @rule_infos.
+    // Ids of @sets in @set_names_, interning new ones.
+    vector<SetId> InternSets(const vector<string>& sets);
+    // Adds rule in @set_ids to @incidence_, makes room for new sets in
+    // @set_processing_infos_.
+    void AddRuleToIncidence(const vector<SetId>& set_ids);
+    // Returns true and fills in @set_ids with ids of @sets if they
+    // were all seen.
+    bool FindSetIds(const vector<string>& sets, vector<SetId>* set_ids) const;
+    // Removes a rule in exactly @set_ids from @incidence_ and
+    // processing infos. Fills in @covered_by with the set that
+    // covered it first, kNoSet if none. Returns false if there's no
+    // such rule.
+    bool RemoveRuleFromIncidence(const vector<SetId>& set_ids, SetId* covered_by);
+    // Same for rule @rule_id. Returns set that covered it first,
+    // kNoSet if none.
+    SetId RemoveRuleWithId(uint64_t rule_id);
+    // Renumbers rules in @incidence_ without removed ones, and in
+    // processing infos with them.
+    void DropRemovedRules();
+    // Writes @set_names_, @incidence_, processing infos and @cover_
+    // to @writer. Rules each set covers aren't written, they follow
+    // from first_covered_by.
+    void SaveState(SnapshotWriter* writer) const;
+    // Replaces all of them with what SaveState wrote to @reader.
+    // Returns false, and leaves them alone, if it isn't there.
+    bool LoadState(SnapshotReader* reader);
+    // Resets processing using @cover and @incidence_.
     void ResetProcessingInfo();
     // Removes sets which don't cover new rules from cover.
     // Also includes duplicates.
     void RemoveEmptySets();
-    // Data.
-    unique_ptr<map<string, SetInfo> > set_infos_;
-    unique_ptr<vector<RuleInfo> > rule_infos_;
-    unique_ptr<map<string, SetProcessingInfo> > set_processing_infos_;
+    // Data. Sets are referred to by their id in @set_names_ everywhere,
+    // @incidence_ and @set_processing_infos_ are indexed by it.
+    unique_ptr<SymbolTable> set_names_;
+    unique_ptr<Incidence> incidence_;
+    unique_ptr<vector<SetProcessingInfo> > set_processing_infos_;
     unique_ptr<vector<RuleProcessingInfo> > rule_processing_infos_;
-    unique_ptr<list<string> > cover_;
+    unique_ptr<OrderList> cover_;
   private:
     friend class SetCoverTest;
     FRIEND_TEST(SetCoverTest, SetUp);
     FRIEND_TEST(SetCoverTest, ResetProcessingInfo);
+    FRIEND_TEST(SetCoverTest, AddRule);
+    FRIEND_TEST(SetCoverTest, IngestRules);
+    FRIEND_TEST(SetCoverTest, RemoveRule);
+    FRIEND_TEST(SnapshotTest, SetCoverState);
   };
 }  // namespace incremental_atpg
 #endif  // INCREMENTAL_ATPG_SET_COVER_H_
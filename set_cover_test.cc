@@ -8,6 +8,7 @@
 #include "log4cxx/logger.h"
 #include "log4cxx/basicconfigurator.h"
 #include "log4cxx/helpers/exception.h"
+#include "rule_source.h"
 
 namespace incremental_atpg {
   using std::to_string;
@@ -28,29 +29,21 @@ class SetCoverTest : public testing::Test {
 };
 
 TEST_F(SetCoverTest, SetUp) {
-  map<string, SetInfo>* set_infos
-    = new map<string, SetInfo>();
-  SetInfo cat;
-  cat.AddRule(0);
-  set_infos->insert(make_pair("cat", cat));
-  SetInfo bob;
-  bob.AddRule(0);
-  bob.AddRule(1);
-  set_infos->insert(make_pair("bob", bob));
+  SymbolTable* set_names = new SymbolTable();
+  SetId cat_id = set_names->Intern("cat");
+  SetId bob_id = set_names->Intern("bob");
+  Incidence* incidence = new Incidence();
+  vector<SetId> rule0;
+  rule0.push_back(cat_id);
+  rule0.push_back(bob_id);
+  incidence->AddRule(rule0);
+  vector<SetId> rule1;
+  rule1.push_back(bob_id);
+  incidence->AddRule(rule1);
 
-  vector<RuleInfo>* rule_infos = new vector<RuleInfo>();
-  vector<string> rule0;
-  rule0.push_back("cat");
-  rule0.push_back("bob");
-  RuleInfo info0(rule0);
-  vector<string> rule1;
-  rule1.push_back("bob");
-  RuleInfo info1(rule1);
-
-  rule_infos->push_back(info0);
-  rule_infos->push_back(info1);
-
-  sc_.reset(new SetCover(set_infos, rule_infos));
+  sc_.reset(new SetCover(set_names, incidence));
+  EXPECT_EQ("bob", sc_->GetSetName(bob_id));
+  EXPECT_EQ(2, sc_->GetIncidence().RulesOf(bob_id).size());
   /*
   uint64_t expected_index = max_uint_/ 2;
   om_->InsertAtEnd("India", Value("New Delhi"));
@@ -67,22 +60,25 @@ TEST_F(SetCoverTest, SetUp) {
       sc_->ResetProcessingInfo();
       EXPECT_EQ(2, sc_->rule_processing_infos_->size());
       for (auto const& rp : *sc_->rule_processing_infos_.get()) {
-	EXPECT_TRUE(rp.first_covered_by.empty());
+	EXPECT_FALSE(rp.Covered());
+      }
+      for (auto const& sp : *sc_->set_processing_infos_.get()) {
+	EXPECT_FALSE(sp.in_cover);
       }
-      EXPECT_TRUE(sc_->set_processing_infos_->empty());
     }
     
+    SetId cat_id;
+    ASSERT_TRUE(sc_->GetSetId("cat", &cat_id));
     {
-      sc_->cover_->push_back("cat");
+      sc_->cover_->push_back(cat_id);
       sc_->ResetProcessingInfo();
       EXPECT_EQ(2, sc_->rule_processing_infos_->size());
       for (auto const& rp : *sc_->rule_processing_infos_.get()) {
-	EXPECT_EQ("cat", rp.first_covered_by);
+	EXPECT_EQ(cat_id, rp.first_covered_by);
       }
-      EXPECT_EQ(1, sc_->set_processing_infos_->size());
-      EXPECT_TRUE(sc_->set_processing_infos_->find("cat") !=
-		  sc_->set_processing_infos_->end());
-      SetProcessingInfo sp = sc_->set_processing_infos_->at("cat");
+      EXPECT_EQ(2, sc_->set_processing_infos_->size());
+      EXPECT_TRUE(sc_->InCover(cat_id));
+      SetProcessingInfo sp = sc_->set_processing_infos_->at(cat_id);
       EXPECT_EQ(2, sp.num_uncovered);
       EXPECT_EQ(2, sp.covers_rules.size());
       EXPECT_TRUE(sp.covers_rules.find(0) != sp.covers_rules.end());
@@ -91,4 +87,72 @@ TEST_F(SetCoverTest, SetUp) {
     
   }
 
+  TEST_F(SetCoverTest, AddRule) {
+    sc_->AddRule({"cat", "dog"});
+    sc_->AddRule({"dog"});
+    SetId cat_id, dog_id;
+    ASSERT_TRUE(sc_->GetSetId("cat", &cat_id));
+    ASSERT_TRUE(sc_->GetSetId("dog", &dog_id));
+    EXPECT_FALSE(sc_->GetSetId("pig", &dog_id));
+    EXPECT_EQ(0, cat_id);
+    EXPECT_EQ(1, dog_id);
+    EXPECT_EQ(2, sc_->incidence_->num_sets());
+    EXPECT_EQ(2, sc_->incidence_->num_rules());
+    EXPECT_EQ(2, sc_->incidence_->RulesOf(dog_id).size());
+    Span<SetId> rule0 = sc_->incidence_->SetsOf(0);
+    EXPECT_EQ(vector<SetId>({cat_id, dog_id}), vector<SetId>(rule0.begin(), rule0.end()));
+    EXPECT_EQ(2, sc_->set_processing_infos_->size());
+
+    sc_->cover_->push_back(dog_id);
+    EXPECT_EQ(list<string>({"dog"}), sc_->GetCover());
+  }
+
+  TEST_F(SetCoverTest, IngestRules) {
+    vector<vector<string> > rules = {{"cat", "dog"}, {}, {"dog"}, {"fish"}};
+    uint64_t next = 0;
+    FunctionRuleSource source([&] (vector<string>* sets) {
+	if (next == rules.size()) {
+	  return false;
+	}
+	*sets = rules[next++];
+	return true;
+      });
+    // Empty rule doesn't count.
+    EXPECT_EQ(2, sc_->IngestRules(&source, 2));
+    EXPECT_EQ(3, next);
+    EXPECT_EQ(2, sc_->incidence_->num_rules());
+    EXPECT_EQ(2, sc_->incidence_->num_sets());
+    EXPECT_EQ(1, sc_->IngestRules(&source));
+    EXPECT_EQ(3, sc_->incidence_->num_rules());
+    EXPECT_EQ(3, sc_->set_processing_infos_->size());
+    EXPECT_EQ(0, sc_->IngestRules(&source));
+  }
+
+  TEST_F(SetCoverTest, RemoveRule) {
+    sc_->AddRule({"cat", "dog"});
+    sc_->AddRule({"dog"});
+    sc_->AddRule({"cat"});
+    SetId cat_id, dog_id;
+    ASSERT_TRUE(sc_->GetSetId("cat", &cat_id));
+    ASSERT_TRUE(sc_->GetSetId("dog", &dog_id));
+    sc_->cover_->push_back(dog_id);
+    sc_->cover_->push_back(cat_id);
+    sc_->ResetProcessingInfo();
+
+    EXPECT_FALSE(sc_->RemoveRule({"pig"}));
+    EXPECT_FALSE(sc_->RemoveRule({"cat", "dog", "cat", "pig"}));
+    EXPECT_TRUE(sc_->RemoveRule({"dog", "cat"}));
+    EXPECT_FALSE(sc_->RemoveRule({"cat", "dog"}));
+    EXPECT_EQ(set<uint64_t>({1}), sc_->set_processing_infos_->at(dog_id).covers_rules);
+    EXPECT_FALSE(sc_->rule_processing_infos_->at(0).Covered());
+    EXPECT_EQ(2, sc_->incidence_->num_live_rules());
+
+    sc_->DropRemovedRules();
+    EXPECT_EQ(2, sc_->incidence_->num_rules());
+    EXPECT_EQ(2, sc_->rule_processing_infos_->size());
+    EXPECT_EQ(set<uint64_t>({0}), sc_->set_processing_infos_->at(dog_id).covers_rules);
+    EXPECT_EQ(set<uint64_t>({1}), sc_->set_processing_infos_->at(cat_id).covers_rules);
+    EXPECT_EQ(cat_id, sc_->rule_processing_infos_->at(1).first_covered_by);
+  }
+
 }  // namespace incremental_atpg
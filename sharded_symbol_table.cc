@@ -0,0 +1,80 @@
+#include "sharded_symbol_table.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::mutex;
+  using std::lock_guard;
+  using std::pair;
+  using std::make_pair;
+  using std::sort;
+  using std::min;
+
+  ShardedSymbolTable::ShardedSymbolTable(unsigned num_shards)
+    : shard_bits_(0) {
+    while ((1U << shard_bits_) < num_shards) {
+      ++shard_bits_;
+    }
+    for (unsigned shard = 0; shard < (1U << shard_bits_); shard++) {
+      shards_.emplace_back(new Shard);
+    }
+  }
+
+  SetId ShardedSymbolTable::Intern(const string& name, uint64_t position) {
+    uint64_t shard_id = std::hash<string>()(name) & ((1U << shard_bits_) - 1);
+    Shard& shard = *shards_[shard_id];
+    lock_guard<mutex> lock(shard.lock);
+    auto it = shard.ids.find(name);
+    if (it != shard.ids.end()) {
+      it->second.first_position = min(it->second.first_position, position);
+      return it->second.id;
+    }
+    Entry entry;
+    entry.id = (shard.ids.size() << shard_bits_) | shard_id;
+    entry.first_position = position;
+    shard.ids.insert(make_pair(name, entry));
+    return entry.id;
+  }
+
+  uint64_t ShardedSymbolTable::size() const {
+    uint64_t size = 0;
+    for (auto const& shard : shards_) {
+      size += shard->ids.size();
+    }
+    return size;
+  }
+
+  void ShardedSymbolTable::Renumber(SymbolTable* symbols,
+				    vector<SetId>* new_ids) const {
+    // Only distinct names get sorted, not every time one was seen.
+    vector<pair<uint64_t, const pair<const string, Entry>*> > by_position;
+    by_position.reserve(size());
+    uint64_t max_id = 0;
+    for (auto const& shard : shards_) {
+      for (auto const& name_entry : shard->ids) {
+	by_position.push_back(make_pair(name_entry.second.first_position,
+					&name_entry));
+	max_id = std::max<uint64_t>(max_id, name_entry.second.id + 1);
+      }
+    }
+    sort(by_position.begin(), by_position.end(),
+	 [] (const pair<uint64_t, const pair<const string, Entry>*>& lhs,
+	     const pair<uint64_t, const pair<const string, Entry>*>& rhs)
+	 { return lhs.first < rhs.first; });
+    new_ids->assign(max_id, kNoSet);
+    for (auto const& position_name : by_position) {
+      (*new_ids)[position_name.second->second.id] =
+	symbols->Intern(position_name.second->first);
+    }
+  }
+}  // namespace incremental_atpg
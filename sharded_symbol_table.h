@@ -0,0 +1,57 @@
+#ifndef INCREMENTAL_ATPG_SHARDED_SYMBOL_TABLE_H_
+#define INCREMENTAL_ATPG_SHARDED_SYMBOL_TABLE_H_
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+#include "symbol_table.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::unordered_map;
+  using std::mutex;
+  using std::unique_ptr;
+
+  // Interns names from many threads at once, e.g., chunks of a rule
+  // file. Names hash to one of a few shards, each with its own lock,
+  // so threads rarely wait on each other.
+  //
+  // Ids it hands out are only good until Renumber, which gives each
+  // name the id it would have gotten in a SymbolTable, interning
+  // names in order of where they were first seen, e.g., their offset
+  // in the file. So ids don't depend on how threads got scheduled.
+  class ShardedSymbolTable {
+  public:
+    // @num_shards is rounded up to a power of 2.
+    explicit ShardedSymbolTable(unsigned num_shards = 64);
+
+    // Returns temporary id of @name, seen at @position. Safe to call
+    // from many threads.
+    SetId Intern(const string& name, uint64_t position);
+    // Interns all names in @symbols, by first position, and sets
+    // @new_ids[id] to the id there of the name with temporary @id.
+    void Renumber(SymbolTable* symbols, vector<SetId>* new_ids) const;
+    uint64_t size() const;
+
+  protected:
+    struct Entry {
+      SetId id;
+      uint64_t first_position;
+    };
+    struct Shard {
+      mutex lock;
+      unordered_map<string, Entry> ids;
+    };
+    vector<unique_ptr<Shard> > shards_;
+    // Temporary id is number in shard, then shard in low bits.
+    unsigned shard_bits_;
+  private:
+    friend class ShardedSymbolTableTest;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_SHARDED_SYMBOL_TABLE_H_
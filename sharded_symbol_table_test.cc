@@ -0,0 +1,72 @@
+#include "sharded_symbol_table.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::string;
+  using std::vector;
+  using std::thread;
+
+class ShardedSymbolTableTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    table_.reset(new ShardedSymbolTable(4));
+  }
+  std::unique_ptr<ShardedSymbolTable> table_;
+};
+
+TEST_F(ShardedSymbolTableTest, Renumber) {
+  SetId dog = table_->Intern("dog", 5);
+  SetId cat = table_->Intern("cat", 7);
+  EXPECT_EQ(dog, table_->Intern("dog", 9));
+  // Seen earlier than dog after all.
+  EXPECT_EQ(cat, table_->Intern("cat", 1));
+  SetId fish = table_->Intern("fish", 6);
+  EXPECT_EQ(3, table_->size());
+
+  SymbolTable symbols;
+  symbols.Intern("fish");
+  vector<SetId> new_ids;
+  table_->Renumber(&symbols, &new_ids);
+  EXPECT_EQ(3, symbols.size());
+  EXPECT_EQ(0, new_ids[fish]);
+  EXPECT_EQ(1, new_ids[cat]);
+  EXPECT_EQ(2, new_ids[dog]);
+}
+
+TEST_F(ShardedSymbolTableTest, Threads) {
+  // Each thread sees every name, at positions that make name i first
+  // seen at i, whichever thread gets there first.
+  const uint64_t num_names = 1000;
+  const unsigned num_threads = 4;
+  vector<vector<SetId> > ids(num_threads, vector<SetId>(num_names));
+  vector<thread> threads;
+  for (unsigned t = 0; t < num_threads; t++) {
+    threads.push_back(thread([&, t] () {
+	  for (uint64_t i = 0; i < num_names; i++) {
+	    uint64_t name = (i * 7 + t * 13) % num_names;
+	    ids[t][name] = table_->Intern(std::to_string(name), name * num_threads + t);
+	  }
+	}));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(num_names, table_->size());
+  SymbolTable symbols;
+  vector<SetId> new_ids;
+  table_->Renumber(&symbols, &new_ids);
+  for (uint64_t name = 0; name < num_names; name++) {
+    for (unsigned t = 1; t < num_threads; t++) {
+      EXPECT_EQ(ids[0][name], ids[t][name]);
+    }
+    EXPECT_EQ(name, new_ids[ids[0][name]]);
+    EXPECT_EQ(std::to_string(name), symbols.Name(name));
+  }
+}
+}  // namespace incremental_atpg
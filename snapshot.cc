@@ -0,0 +1,177 @@
+#include "snapshot.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+
+  static const char kMagic[8] = {'I', 'A', 'T', 'P', 'G', 'S', 'N', 'P'};
+  // Reads back as something else with the other byte order.
+  static const uint32_t kByteOrderMark = 0x01020304;
+  static const uint64_t kHeaderSize = 16;
+  static const uint64_t kSectionHeaderSize = 16;
+  static const uint64_t kAlignment = 8;
+
+  static uint64_t Padding(uint64_t size) {
+    return (kAlignment - size % kAlignment) % kAlignment;
+  }
+
+  // Syncs file or directory at @path. Returns false if it can't.
+  static bool Sync(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+  }
+
+  SnapshotWriter::SnapshotWriter()
+    : num_sections_(0),
+      ok_(false) {
+  }
+
+  SnapshotWriter::~SnapshotWriter() {
+    if (out_.is_open()) {
+      out_.close();
+      std::remove(tmp_path_.c_str());
+    }
+  }
+
+  bool SnapshotWriter::Open(const string& path) {
+    path_ = path;
+    tmp_path_ = path + ".tmp";
+    num_sections_ = 0;
+    out_.open(tmp_path_.c_str(), std::ios::binary | std::ios::trunc);
+    ok_ = out_.is_open();
+    out_.write(kMagic, sizeof(kMagic));
+    out_.write(reinterpret_cast<const char*>(&kSnapshotVersion), sizeof(uint32_t));
+    out_.write(reinterpret_cast<const char*>(&kByteOrderMark), sizeof(uint32_t));
+    ok_ = ok_ && out_.good();
+    return ok_;
+  }
+
+  void SnapshotWriter::WriteArray(const void* data, uint32_t element_size,
+				  uint64_t count) {
+    if (!ok_) {
+      return;
+    }
+    out_.write(reinterpret_cast<const char*>(&num_sections_), sizeof(uint32_t));
+    out_.write(reinterpret_cast<const char*>(&element_size), sizeof(uint32_t));
+    out_.write(reinterpret_cast<const char*>(&count), sizeof(uint64_t));
+    uint64_t size = element_size * count;
+    out_.write(static_cast<const char*>(data), size);
+    static const char kZeros[kAlignment] = {0};
+    out_.write(kZeros, Padding(size));
+    ++num_sections_;
+    ok_ = out_.good();
+  }
+
+  bool SnapshotWriter::Close() {
+    if (!out_.is_open()) {
+      return false;
+    }
+    out_.close();
+    ok_ = ok_ && !out_.fail();
+    // Data has to be on disk before the rename is, else a crash can
+    // leave an empty file at @path_.
+    if (!ok_ || !Sync(tmp_path_)
+	|| std::rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+      std::remove(tmp_path_.c_str());
+      return false;
+    }
+    string::size_type slash = path_.rfind('/');
+    string dir = slash == string::npos ? "." : path_.substr(0, slash + 1);
+    return Sync(dir);
+  }
+
+  SnapshotReader::SnapshotReader()
+    : data_(nullptr),
+      size_(0),
+      offset_(0),
+      num_sections_(0) {
+  }
+
+  SnapshotReader::~SnapshotReader() {
+    Close();
+  }
+
+  void SnapshotReader::Close() {
+    if (data_ != nullptr) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = offset_ = 0;
+    num_sections_ = 0;
+  }
+
+  bool SnapshotReader::Open(const string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < kHeaderSize) {
+      close(fd);
+      return false;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      return false;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(data);
+    size_ = st.st_size;
+
+    uint32_t version = 0;
+    uint32_t byte_order = 0;
+    std::memcpy(&version, data_ + sizeof(kMagic), sizeof(uint32_t));
+    std::memcpy(&byte_order, data_ + sizeof(kMagic) + sizeof(uint32_t), sizeof(uint32_t));
+    if (std::memcmp(data_, kMagic, sizeof(kMagic)) != 0
+	|| version != kSnapshotVersion || byte_order != kByteOrderMark) {
+      Close();
+      return false;
+    }
+    offset_ = kHeaderSize;
+    return true;
+  }
+
+  bool SnapshotReader::NextArray(uint32_t element_size, const void** data,
+				 uint64_t* count) {
+    if (data_ == nullptr || size_ - offset_ < kSectionHeaderSize) {
+      return false;
+    }
+    uint32_t index = 0;
+    uint32_t size_of_element = 0;
+    std::memcpy(&index, data_ + offset_, sizeof(uint32_t));
+    std::memcpy(&size_of_element, data_ + offset_ + sizeof(uint32_t), sizeof(uint32_t));
+    std::memcpy(count, data_ + offset_ + 2 * sizeof(uint32_t), sizeof(uint64_t));
+    uint64_t left = size_ - offset_ - kSectionHeaderSize;
+    if (index != num_sections_ || size_of_element != element_size
+	|| *count > left / element_size) {
+      return false;
+    }
+    uint64_t size = element_size * *count;
+    if (size + Padding(size) > left) {
+      return false;
+    }
+    *data = data_ + offset_ + kSectionHeaderSize;
+    offset_ += kSectionHeaderSize + size + Padding(size);
+    ++num_sections_;
+    return true;
+  }
+}  // namespace incremental_atpg
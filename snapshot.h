@@ -0,0 +1,122 @@
+#ifndef INCREMENTAL_ATPG_SNAPSHOT_H_
+#define INCREMENTAL_ATPG_SNAPSHOT_H_
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <type_traits>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+
+  // Bumped whenever what goes in a snapshot, or its order, changes.
+  const uint32_t kSnapshotVersion = 2;
+
+  // Snapshot file: a 16 byte header (magic, version, byte order mark),
+  // then sections one after the other. A section is an array of plain
+  // values: its index, element size and count, then the elements as
+  // they are in memory, padded to 8 bytes. Sections have no names,
+  // readers read them in the order writers wrote them, and the index
+  // and element size catch a reader that's out of step.
+  //
+  // Readers map the file in and copy each array out with one memcpy,
+  // so only plain values go in, enforced at compile time. What's built
+  // on them isn't saved and gets rebuilt on load: the unordered_map of
+  // a SymbolTable, the per-set std::set covers_rules of processing
+  // infos, and the union-find components of an Incidence. Files are in
+  // the writer's byte order, the mark catches a reader with another one.
+  class SnapshotWriter {
+  public:
+    SnapshotWriter();
+    // Removes temporary file if Close wasn't called.
+    ~SnapshotWriter();
+
+    // Starts writing to a temporary file next to @path, which Close
+    // renames to @path, so a crash never leaves half a snapshot at
+    // @path. Returns false if it can't be created.
+    bool Open(const string& path);
+    template <typename T>
+      void Write(const vector<T>& values) {
+      static_assert(std::is_pod<T>::value, "Snapshots hold plain values only.");
+      WriteArray(values.data(), sizeof(T), values.size());
+    }
+    template <typename T>
+      void WriteValue(const T& value) {
+      static_assert(std::is_pod<T>::value, "Snapshots hold plain values only.");
+      WriteArray(&value, sizeof(T), 1);
+    }
+    // Flushes and syncs file, renames it to path and syncs its
+    // directory, so once it returns true the snapshot survives a
+    // crash of the machine too. Returns false if anything failed
+    // since Open.
+    bool Close();
+
+  protected:
+    void WriteArray(const void* data, uint32_t element_size, uint64_t count);
+
+    ofstream out_;
+    string path_;
+    string tmp_path_;
+    uint32_t num_sections_;
+    bool ok_;
+  };
+
+  class SnapshotReader {
+  public:
+    SnapshotReader();
+    // Unmaps file.
+    ~SnapshotReader();
+
+    // Maps @path in. Returns false if it can't, or it isn't a
+    // snapshot of this version.
+    bool Open(const string& path);
+    // Read next section into @values. Return false if it isn't there,
+    // or isn't an array of T.
+    template <typename T>
+      bool Read(vector<T>* values) {
+      static_assert(std::is_pod<T>::value, "Snapshots hold plain values only.");
+      const void* data = nullptr;
+      uint64_t count = 0;
+      if (!NextArray(sizeof(T), &data, &count)) {
+	return false;
+      }
+      const T* begin = static_cast<const T*>(data);
+      values->assign(begin, begin + count);
+      return true;
+    }
+    template <typename T>
+      bool ReadValue(T* value) {
+      static_assert(std::is_pod<T>::value, "Snapshots hold plain values only.");
+      const void* data = nullptr;
+      uint64_t count = 0;
+      if (!NextArray(sizeof(T), &data, &count) || count != 1) {
+	return false;
+      }
+      std::memcpy(value, data, sizeof(T));
+      return true;
+    }
+    // True once every section was read.
+    bool AtEnd() const {
+      return offset_ == size_;
+    }
+
+  protected:
+    // Points @data at next section's @count elements, if it has
+    // elements of @element_size.
+    bool NextArray(uint32_t element_size, const void** data, uint64_t* count);
+    void Close();
+
+    const char* data_;
+    uint64_t size_;
+    uint64_t offset_;
+    uint32_t num_sections_;
+  private:
+    friend class SnapshotTest;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_SNAPSHOT_H_
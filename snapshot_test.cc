@@ -0,0 +1,258 @@
+#include "snapshot.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "symbol_table.h"
+#include "incidence.h"
+#include "set_cover.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::ofstream;
+
+class SnapshotTest : public testing::Test {
+ protected:
+  SnapshotTest()
+    : path_("snapshot_test.snp") { }
+  virtual void TearDown() {
+    std::remove(path_.c_str());
+  }
+  string path_;
+};
+
+TEST_F(SnapshotTest, WriteRead) {
+  SnapshotWriter writer;
+  ASSERT_TRUE(writer.Open(path_));
+  writer.Write(vector<uint64_t>({7, 8, 9}));
+  writer.Write(vector<char>({'a', 'b', 'c'}));
+  writer.Write(vector<SetId>());
+  writer.WriteValue(0.25);
+  ASSERT_TRUE(writer.Close());
+
+  SnapshotReader reader;
+  ASSERT_TRUE(reader.Open(path_));
+  vector<uint64_t> numbers;
+  vector<char> chars;
+  vector<SetId> empty(1, 0);
+  double value = 0.0;
+  EXPECT_TRUE(reader.Read(&numbers));
+  EXPECT_TRUE(reader.Read(&chars));
+  EXPECT_TRUE(reader.Read(&empty));
+  EXPECT_FALSE(reader.AtEnd());
+  // Wrong type.
+  uint32_t small = 0;
+  EXPECT_FALSE(reader.ReadValue(&small));
+  EXPECT_TRUE(reader.ReadValue(&value));
+  EXPECT_TRUE(reader.AtEnd());
+  EXPECT_FALSE(reader.Read(&numbers));
+  EXPECT_EQ(vector<uint64_t>({7, 8, 9}), numbers);
+  EXPECT_EQ(vector<char>({'a', 'b', 'c'}), chars);
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(0.25, value);
+}
+
+TEST_F(SnapshotTest, BadFiles) {
+  SnapshotReader reader;
+  EXPECT_FALSE(reader.Open(path_));
+  {
+    ofstream out(path_.c_str());
+    out << "not a snapshot, just text";
+  }
+  EXPECT_FALSE(reader.Open(path_));
+
+  // Cut off in the middle of a section.
+  SnapshotWriter writer;
+  ASSERT_TRUE(writer.Open(path_));
+  writer.Write(vector<uint64_t>(100, 1));
+  ASSERT_TRUE(writer.Close());
+  ASSERT_EQ(0, truncate(path_.c_str(), 16 + 16 + 400));
+  ASSERT_TRUE(reader.Open(path_));
+  vector<uint64_t> numbers;
+  EXPECT_FALSE(reader.Read(&numbers));
+
+  // Writer that's never closed leaves old file alone.
+  {
+    SnapshotWriter unfinished;
+    ASSERT_TRUE(unfinished.Open(path_));
+    unfinished.Write(vector<uint64_t>(5, 2));
+  }
+  ASSERT_TRUE(reader.Open(path_));
+  EXPECT_FALSE(reader.Read(&numbers));
+  EXPECT_FALSE(std::ifstream((path_ + ".tmp").c_str()).good());
+}
+
+TEST_F(SnapshotTest, SymbolTableIncidence) {
+  SymbolTable names;
+  names.Intern("cat");
+  names.Intern("");
+  names.Intern("dog");
+  Incidence incidence;
+  incidence.AddRule({0, 1});
+  incidence.AddRule({2});
+  incidence.AddRule({1, 2});
+  incidence.RemoveRule(1);
+  incidence.AddMembership(0, 2);
+
+  SnapshotWriter writer;
+  ASSERT_TRUE(writer.Open(path_));
+  names.Save(&writer);
+  incidence.Save(&writer);
+  ASSERT_TRUE(writer.Close());
+
+  SnapshotReader reader;
+  ASSERT_TRUE(reader.Open(path_));
+  SymbolTable loaded_names;
+  Incidence loaded;
+  ASSERT_TRUE(loaded_names.Load(&reader));
+  ASSERT_TRUE(loaded.Load(&reader));
+  EXPECT_TRUE(reader.AtEnd());
+  EXPECT_EQ(3, loaded_names.size());
+  SetId dog_id = kNoSet;
+  EXPECT_TRUE(loaded_names.Find("dog", &dog_id));
+  EXPECT_EQ(2, dog_id);
+  EXPECT_EQ("", loaded_names.Name(1));
+
+  EXPECT_EQ(3, loaded.num_rules());
+  EXPECT_TRUE(loaded.IsRemoved(1));
+  EXPECT_EQ(incidence.num_memberships(), loaded.num_memberships());
+  for (uint64_t rule_id = 0; rule_id < 3; rule_id++) {
+    Span<SetId> sets = loaded.SetsOf(rule_id);
+    Span<SetId> expected = incidence.SetsOf(rule_id);
+    EXPECT_EQ(vector<SetId>(expected.begin(), expected.end()),
+	      vector<SetId>(sets.begin(), sets.end()));
+  }
+  for (SetId set_id = 0; set_id < 3; set_id++) {
+    Span<uint64_t> rules = loaded.RulesOf(set_id);
+    Span<uint64_t> expected = incidence.RulesOf(set_id);
+    EXPECT_EQ(vector<uint64_t>(expected.begin(), expected.end()),
+	      vector<uint64_t>(rules.begin(), rules.end()));
+  }
+  EXPECT_EQ(1, loaded.components().num_components());
+  EXPECT_EQ(3, loaded.AddRule({0}));
+}
+
+TEST_F(SnapshotTest, IncidenceIdsOutOfRange) {
+  // One rule in one set, as Incidence::Save writes them, but with
+  // @set_id for the set of the rule and @rule_id for the rule of the
+  // set.
+  auto write = [this](SetId set_id, uint64_t rule_id) {
+    SnapshotWriter writer;
+    ASSERT_TRUE(writer.Open(path_));
+    writer.Write(vector<uint64_t>({0}));
+    writer.Write(vector<uint64_t>({1}));
+    writer.Write(vector<SetId>({set_id}));
+    writer.WriteValue(uint64_t(0));
+    writer.Write(vector<uint64_t>());
+    writer.Write(vector<uint64_t>({0}));
+    writer.Write(vector<uint64_t>({1}));
+    writer.Write(vector<uint64_t>({1}));
+    writer.Write(vector<uint64_t>({rule_id}));
+    writer.WriteValue(uint64_t(0));
+    ASSERT_TRUE(writer.Close());
+  };
+  for (int bad = 0; bad < 3; bad++) {
+    write(bad == 1 ? 1 : 0, bad == 2 ? 1 : 0);
+    SnapshotReader reader;
+    ASSERT_TRUE(reader.Open(path_));
+    Incidence loaded;
+    EXPECT_EQ(bad == 0, loaded.Load(&reader));
+  }
+}
+
+TEST_F(SnapshotTest, IncidenceUnsortedSet) {
+  // Two rules in one set, listed in order or not.
+  for (int sorted = 0; sorted < 2; sorted++) {
+    SnapshotWriter writer;
+    ASSERT_TRUE(writer.Open(path_));
+    writer.Write(vector<uint64_t>({0, 1}));
+    writer.Write(vector<uint64_t>({1, 2}));
+    writer.Write(vector<SetId>({0, 0}));
+    writer.WriteValue(uint64_t(0));
+    writer.Write(vector<uint64_t>());
+    writer.Write(vector<uint64_t>({0}));
+    writer.Write(vector<uint64_t>({2}));
+    writer.Write(vector<uint64_t>({2}));
+    writer.Write(sorted ? vector<uint64_t>({0, 1}) : vector<uint64_t>({1, 0}));
+    writer.WriteValue(uint64_t(0));
+    ASSERT_TRUE(writer.Close());
+    SnapshotReader reader;
+    ASSERT_TRUE(reader.Open(path_));
+    Incidence loaded;
+    EXPECT_EQ(sorted == 1, loaded.Load(&reader));
+  }
+}
+
+TEST_F(SnapshotTest, SymbolTableDuplicates) {
+  for (int duplicate = 0; duplicate < 2; duplicate++) {
+    SnapshotWriter writer;
+    ASSERT_TRUE(writer.Open(path_));
+    writer.Write(vector<char>({'c', 'a', 't', duplicate ? 'c' : 'd', 'a',
+	    duplicate ? 't' : 'g'}));
+    writer.Write(vector<uint64_t>({3, 6}));
+    ASSERT_TRUE(writer.Close());
+    SnapshotReader reader;
+    ASSERT_TRUE(reader.Open(path_));
+    SymbolTable loaded;
+    EXPECT_EQ(duplicate == 0, loaded.Load(&reader));
+  }
+}
+
+TEST_F(SnapshotTest, SetCoverState) {
+  // Rules {a, b}, {b}, {c}, covered by b and c, as SaveState writes
+  // them, but for what @change does to the sections.
+  struct State {
+    vector<string> names;
+    vector<uint64_t> num_uncovered;
+    vector<uint8_t> in_cover;
+    vector<SetId> first_covered_by;
+    vector<SetId> cover;
+  };
+  auto load = [this](void (*change)(State*)) {
+    State state = {{"a", "b", "c"}, {0, 3, 1}, {0, 1, 1}, {1, 1, 2}, {1, 2}};
+    if (change != nullptr) {
+      change(&state);
+    }
+    SymbolTable names;
+    for (auto const& name : state.names) {
+      names.Intern(name);
+    }
+    Incidence incidence;
+    incidence.AddRule({0, 1});
+    incidence.AddRule({1});
+    incidence.AddRule({2});
+    SnapshotWriter writer;
+    EXPECT_TRUE(writer.Open(path_));
+    names.Save(&writer);
+    incidence.Save(&writer);
+    writer.Write(state.num_uncovered);
+    writer.Write(state.in_cover);
+    writer.Write(state.first_covered_by);
+    writer.Write(state.cover);
+    EXPECT_TRUE(writer.Close());
+    SnapshotReader reader;
+    EXPECT_TRUE(reader.Open(path_));
+    SetCover loaded;
+    return loaded.LoadState(&reader);
+  };
+  EXPECT_TRUE(load(nullptr));
+  // Sizes.
+  EXPECT_FALSE(load([](State* state) { state->first_covered_by.pop_back(); }));
+  EXPECT_FALSE(load([](State* state) { state->num_uncovered.pop_back(); }));
+  EXPECT_FALSE(load([](State* state) { state->in_cover.push_back(0); }));
+  EXPECT_FALSE(load([](State* state) { state->names.push_back("d"); }));
+  // Cover and in_cover flags.
+  EXPECT_FALSE(load([](State* state) { state->cover.push_back(3); }));
+  EXPECT_FALSE(load([](State* state) { state->in_cover[2] = 0; }));
+  EXPECT_FALSE(load([](State* state) { state->in_cover[0] = 1; }));
+  // Rules covered by a set not in cover, or one they aren't in.
+  EXPECT_FALSE(load([](State* state) { state->first_covered_by[0] = 0; }));
+  EXPECT_FALSE(load([](State* state) { state->first_covered_by[1] = 2; }));
+}
+}  // namespace incremental_atpg
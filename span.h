@@ -0,0 +1,31 @@
+#ifndef INCREMENTAL_ATPG_SPAN_H_
+#define INCREMENTAL_ATPG_SPAN_H_
+#include <string>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::string;
+
+  // Read-only view of a contiguous range of T's someone else owns,
+  // e.g., in one of the arrays of @Incidence or in a mapped file.
+  template <typename T>
+    class Span {
+  public:
+  Span() : begin_(nullptr), end_(nullptr) { }
+  Span(const T* begin, const T* end) : begin_(begin), end_(end) { }
+    const T* begin() const { return begin_; }
+    const T* end() const { return end_; }
+    uint64_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+    const T& operator[](uint64_t i) const { return begin_[i]; }
+    const T& back() const { return *(end_ - 1); }
+  private:
+    const T* begin_;
+    const T* end_;
+  };
+
+  inline string ToString(const Span<char>& chars) {
+    return string(chars.begin(), chars.size());
+  }
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_SPAN_H_
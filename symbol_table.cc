@@ -0,0 +1,88 @@
+#include "symbol_table.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "snapshot.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::unordered_map;
+  using std::make_pair;
+
+  SetId SymbolTable::Intern(const string& name) {
+    // Most names are seen before, and insert would build a node for
+    // them anyway.
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+    auto inserted = ids_.insert(make_pair(name, (SetId) names_.size()));
+    if (inserted.second) {
+      names_.push_back(name);
+    }
+    return inserted.first->second;
+  }
+
+  bool SymbolTable::Find(const string& name, SetId* id) const {
+    auto it = ids_.find(name);
+    if (it == ids_.end()) {
+      return false;
+    }
+    *id = it->second;
+    return true;
+  }
+
+  void SymbolTable::Save(SnapshotWriter* writer) const {
+    // All names back to back, and where each one ends.
+    vector<char> chars;
+    vector<uint64_t> ends;
+    ends.reserve(names_.size());
+    for (auto const& name : names_) {
+      chars.insert(chars.end(), name.begin(), name.end());
+      ends.push_back(chars.size());
+    }
+    writer->Write(chars);
+    writer->Write(ends);
+  }
+
+  bool SymbolTable::Load(SnapshotReader* reader) {
+    vector<char> chars;
+    vector<uint64_t> ends;
+    if (!reader->Read(&chars) || !reader->Read(&ends)) {
+      return false;
+    }
+    vector<string> names;
+    names.reserve(ends.size());
+    uint64_t begin = 0;
+    for (auto end : ends) {
+      if (end < begin || end > chars.size()) {
+	return false;
+      }
+      names.push_back(string(chars.begin() + begin, chars.begin() + end));
+      begin = end;
+    }
+    unordered_map<string, SetId> ids;
+    ids.reserve(names.size());
+    for (uint64_t id = 0; id < names.size(); id++) {
+      // Find would only ever get one of them.
+      if (!ids.insert(make_pair(names[id], (SetId) id)).second) {
+	return false;
+      }
+    }
+    ids_.swap(ids);
+    names_.swap(names);
+    return true;
+  }
+
+  const string& SymbolTable::Name(SetId id) const {
+    static const string kEmpty;
+    if (id >= names_.size()) {
+      return kEmpty;
+    }
+    return names_[id];
+  }
+}  // namespace incremental_atpg
@@ -0,0 +1,49 @@
+#ifndef INCREMENTAL_ATPG_SYMBOL_TABLE_H_
+#define INCREMENTAL_ATPG_SYMBOL_TABLE_H_
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::unordered_map;
+
+  // Dense id of a set. Ids are handed out in the order names are first seen.
+  typedef uint32_t SetId;
+  // Marks "no set", e.g., a rule that isn't covered yet.
+  const SetId kNoSet = UINT32_MAX;
+
+  class SnapshotWriter;
+  class SnapshotReader;
+
+  // Interns set names to dense @SetId's, so that the set cover
+  // algorithms can keep per-set state in vectors indexed by id.
+  // Names are only needed again at the API boundary.
+  class SymbolTable {
+  public:
+    SymbolTable() { }
+
+    // Returns id of @name, adding it if it's new.
+    SetId Intern(const string& name);
+    // Returns true and fills in @id if @name was interned.
+    bool Find(const string& name, SetId* id) const;
+    // Name of @id. Empty for ids not in the table (e.g., temporary sets).
+    const string& Name(SetId id) const;
+    uint64_t size() const {
+      return names_.size();
+    }
+
+    // Writes names, in id order, to @writer.
+    void Save(SnapshotWriter* writer) const;
+    // Replaces table with names from @reader. Returns false, and
+    // leaves table alone, if they're not there.
+    bool Load(SnapshotReader* reader);
+
+  private:
+    unordered_map<string, SetId> ids_;
+    vector<string> names_;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_SYMBOL_TABLE_H_
@@ -0,0 +1,39 @@
+#include "symbol_table.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::string;
+
+class SymbolTableTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    table_.reset(new SymbolTable);
+  }
+  std::unique_ptr<SymbolTable> table_;
+};
+
+TEST_F(SymbolTableTest, Intern) {
+  EXPECT_EQ(0, table_->Intern("cat"));
+  EXPECT_EQ(1, table_->Intern("dog"));
+  EXPECT_EQ(0, table_->Intern("cat"));
+  EXPECT_EQ(2, table_->size());
+  EXPECT_EQ("cat", table_->Name(0));
+  EXPECT_EQ("dog", table_->Name(1));
+  EXPECT_EQ("", table_->Name(2));
+  EXPECT_EQ("", table_->Name(kNoSet));
+}
+
+TEST_F(SymbolTableTest, Find) {
+  table_->Intern("cat");
+  table_->Intern("dog");
+  SetId set_id = kNoSet;
+  EXPECT_TRUE(table_->Find("dog", &set_id));
+  EXPECT_EQ(1, set_id);
+  EXPECT_FALSE(table_->Find("pig", &set_id));
+  EXPECT_EQ(1, set_id);
+  EXPECT_EQ(2, table_->size());
+}
+}  // namespace incremental_atpg
@@ -0,0 +1,93 @@
+#include "thread_pool.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::thread;
+  using std::mutex;
+  using std::unique_lock;
+  using std::lock_guard;
+  using std::function;
+
+  ThreadPool::ThreadPool(unsigned num_threads)
+    : body_(nullptr),
+      num_tasks_(0),
+      next_task_(0),
+      generation_(0),
+      num_busy_(0),
+      stopping_(false) {
+    if (num_threads == 0) {
+      num_threads = thread::hardware_concurrency();
+    }
+    for (unsigned i = 1; i < num_threads; i++) {
+      workers_.push_back(thread(&ThreadPool::Work, this));
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      lock_guard<mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    start_.notify_all();
+    for (auto& worker: workers_) {
+      worker.join();
+    }
+  }
+
+  void ThreadPool::Run(uint64_t n, const function<void(uint64_t)>& body) {
+    if (workers_.empty() || n <= 1) {
+      for (uint64_t i = 0; i < n; i++) {
+	body(i);
+      }
+      return;
+    }
+    {
+      lock_guard<mutex> lock(mutex_);
+      body_ = &body;
+      num_tasks_ = n;
+      next_task_ = 0;
+      num_busy_ = workers_.size();
+      ++generation_;
+    }
+    start_.notify_all();
+    RunTasks();
+    unique_lock<mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return num_busy_ == 0; });
+    body_ = nullptr;
+  }
+
+  void ThreadPool::RunTasks() {
+    for (uint64_t i = next_task_++; i < num_tasks_; i = next_task_++) {
+      (*body_)(i);
+    }
+  }
+
+  void ThreadPool::Work() {
+    uint64_t generation = 0;
+    while (true) {
+      {
+	unique_lock<mutex> lock(mutex_);
+	start_.wait(lock, [this, generation]() {
+	    return stopping_ || generation_ != generation;
+	  });
+	if (stopping_) {
+	  return;
+	}
+	generation = generation_;
+      }
+      RunTasks();
+      lock_guard<mutex> lock(mutex_);
+      if (--num_busy_ == 0) {
+	done_.notify_all();
+      }
+    }
+  }
+}  // namespace incremental_atpg
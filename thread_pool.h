@@ -0,0 +1,60 @@
+#ifndef INCREMENTAL_ATPG_THREAD_POOL_H_
+#define INCREMENTAL_ATPG_THREAD_POOL_H_
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::thread;
+  using std::mutex;
+  using std::condition_variable;
+  using std::atomic;
+  using std::function;
+
+  // Fixed set of threads that run tasks numbered 0 .. n-1, so threads
+  // aren't started over for every parallel loop. Threads take the
+  // next task number as they finish one, so tasks of very different
+  // sizes (e.g., components) still spread out evenly.
+  class ThreadPool {
+  public:
+    // Uses @num_threads threads in all, counting the one calling Run.
+    // 0 means one per hardware thread.
+    explicit ThreadPool(unsigned num_threads);
+    ~ThreadPool();
+
+    // Runs @body(i) for i in [0, @n), returns when all are done. One
+    // Run at a time.
+    void Run(uint64_t n, const function<void(uint64_t)>& body);
+    unsigned num_threads() const {
+      return workers_.size() + 1;
+    }
+
+  protected:
+    // Loop of each worker thread.
+    void Work();
+    // Runs tasks of current Run till there's none left.
+    void RunTasks();
+
+    vector<thread> workers_;
+    mutex mutex_;
+    condition_variable start_;
+    condition_variable done_;
+    // Current Run, set under @mutex_ before @generation_ goes up.
+    const function<void(uint64_t)>* body_;
+    uint64_t num_tasks_;
+    atomic<uint64_t> next_task_;
+    // Number of Run's so far, workers wake up when it changes.
+    uint64_t generation_;
+    // Workers still running tasks of current Run.
+    unsigned num_busy_;
+    bool stopping_;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_THREAD_POOL_H_
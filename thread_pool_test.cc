@@ -0,0 +1,37 @@
+#include "thread_pool.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::atomic;
+
+TEST(ThreadPoolTest, Run) {
+  ThreadPool pool(4);
+  EXPECT_EQ(4, pool.num_threads());
+  // Every task runs once, over and over.
+  for (uint64_t n = 0; n < 100; n += 7) {
+    vector<atomic<uint64_t> > runs(n);
+    for (auto& r : runs) {
+      r = 0;
+    }
+    pool.Run(n, [&](uint64_t i) { runs[i]++; });
+    for (uint64_t i = 0; i < n; i++) {
+      EXPECT_EQ(1, runs[i]);
+    }
+  }
+}
+
+TEST(ThreadPoolTest, OneThread) {
+  ThreadPool pool(1);
+  EXPECT_EQ(1, pool.num_threads());
+  uint64_t sum = 0;
+  pool.Run(10, [&](uint64_t i) { sum += i; });
+  EXPECT_EQ(45, sum);
+}
+
+}  // namespace incremental_atpg
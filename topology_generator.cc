@@ -0,0 +1,161 @@
+#include "topology_generator.h"
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <stdint.h>
+
+#include "rule_generator.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+  using std::deque;
+
+  static const uint16_t kUnreachable = UINT16_MAX;
+
+  void Topology::AddLink(uint64_t a, uint64_t b) {
+    neighbors_[a].push_back(b);
+    neighbors_[b].push_back(a);
+  }
+
+  Topology Topology::FatTree(uint64_t k) {
+    uint64_t half = k / 2;
+    uint64_t num_core = half * half;
+    Topology topology(num_core + k * k);
+    for (uint64_t pod = 0; pod < k; pod++) {
+      // Aggregation switches of the pod, then its edge switches.
+      uint64_t first_aggregation = num_core + pod * k;
+      uint64_t first_edge = first_aggregation + half;
+      for (uint64_t i = 0; i < half; i++) {
+	for (uint64_t j = 0; j < half; j++) {
+	  topology.AddLink(first_edge + i, first_aggregation + j);
+	  // Aggregation switch i goes to core switches of group i.
+	  topology.AddLink(first_aggregation + i, i * half + j);
+	}
+	topology.AddEndpoint(first_edge + i);
+      }
+    }
+    return topology;
+  }
+
+  Topology Topology::Wan(uint64_t num_switches, uint64_t num_shortcuts,
+			 uint64_t seed) {
+    Topology topology(num_switches);
+    for (uint64_t a = 0; a < num_switches; a++) {
+      if (a + 1 < num_switches) {
+	topology.AddLink(a, a + 1);
+      }
+      topology.AddEndpoint(a);
+    }
+    if (num_switches < 3) {
+      return topology;
+    }
+    topology.AddLink(num_switches - 1, 0);
+    StreamRng rng(seed, 0);
+    for (uint64_t shortcut = 0; shortcut < num_shortcuts; shortcut++) {
+      uint64_t a = rng.Next() % num_switches;
+      uint64_t b = rng.Next() % num_switches;
+      if (a != b) {
+	topology.AddLink(a, b);
+      }
+    }
+    return topology;
+  }
+
+  TopologyRuleGenerator::TopologyRuleGenerator(const Topology& topology,
+					       uint64_t num_packets,
+					       uint64_t rules_per_switch,
+					       uint64_t num_catch_all,
+					       double catch_all_chance,
+					       uint64_t seed)
+    : topology_(topology),
+      num_packets_(num_packets),
+      rules_per_switch_(rules_per_switch),
+      num_catch_all_(num_catch_all),
+      catch_all_chance_(catch_all_chance),
+      seed_(seed),
+      distances_(topology.endpoints().size()) {
+    // Breadth first from each endpoint.
+    deque<uint64_t> queue;
+    for (uint64_t i = 0; i < distances_.size(); i++) {
+      vector<uint16_t>& distance = distances_[i];
+      distance.assign(topology.num_switches(), kUnreachable);
+      distance[topology.endpoints()[i]] = 0;
+      queue.push_back(topology.endpoints()[i]);
+      while (!queue.empty()) {
+	uint64_t a = queue.front();
+	queue.pop_front();
+	if (distance[a] + 1 == kUnreachable) {
+	  continue;
+	}
+	for (auto b : topology.neighbors(a)) {
+	  if (distance[b] == kUnreachable) {
+	    distance[b] = distance[a] + 1;
+	    queue.push_back(b);
+	  }
+	}
+      }
+    }
+  }
+
+  void TopologyRuleGenerator::MakePath(uint64_t packet_id,
+				       vector<uint64_t>* path) const {
+    path->clear();
+    const vector<uint64_t>& endpoints = topology_.endpoints();
+    if (endpoints.size() < 2) {
+      return;
+    }
+    StreamRng rng(seed_, packet_id);
+    uint64_t source = rng.Next() % endpoints.size();
+    uint64_t destination = rng.Next() % (endpoints.size() - 1);
+    if (destination >= source) {
+      ++destination;
+    }
+    const vector<uint16_t>& distance = distances_[destination];
+    uint64_t at = endpoints[source];
+    if (distance[at] == kUnreachable) {
+      return;
+    }
+    path->push_back(at);
+    vector<uint64_t> next_hops;
+    while (distance[at] > 0) {
+      next_hops.clear();
+      for (auto b : topology_.neighbors(at)) {
+	if (distance[b] + 1 == distance[at]) {
+	  next_hops.push_back(b);
+	}
+      }
+      at = next_hops[rng.Next() % next_hops.size()];
+      path->push_back(at);
+    }
+  }
+
+  uint64_t TopologyRuleGenerator::ForwardingRule(uint64_t switch_id,
+						 uint64_t destination) const {
+    return num_catch_all_ + switch_id * rules_per_switch_
+      + destination * rules_per_switch_ / topology_.num_switches();
+  }
+
+  void TopologyRuleGenerator::MakeRules(vector<vector<string> >* rules) const {
+    rules->assign(num_rules(), vector<string>());
+    vector<uint64_t> path;
+    for (uint64_t packet_id = 0; packet_id < num_packets_; packet_id++) {
+      const string name = RuleGenerator::SetName(packet_id);
+      // Catch-alls have streams of their own, apart from the paths'.
+      StreamRng rng(~seed_, packet_id);
+      for (uint64_t rule = 0; rule < num_catch_all_; rule++) {
+	if (rng.NextDouble() < catch_all_chance_) {
+	  (*rules)[rule].push_back(name);
+	}
+      }
+      if (rules_per_switch_ == 0) {
+	continue;
+      }
+      MakePath(packet_id, &path);
+      for (auto switch_id : path) {
+	(*rules)[ForwardingRule(switch_id, path.back())].push_back(name);
+      }
+    }
+  }
+}  // namespace incremental_atpg
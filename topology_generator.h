@@ -0,0 +1,99 @@
+#ifndef INCREMENTAL_ATPG_TOPOLOGY_GENERATOR_H_
+#define INCREMENTAL_ATPG_TOPOLOGY_GENERATOR_H_
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include "gtest/gtest_prod.h"
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+
+  // Switches and links between them, and the switches packets start
+  // and end at, e.g., edge switches of a fat-tree.
+  class Topology {
+  public:
+    explicit Topology(uint64_t num_switches)
+      : neighbors_(num_switches) { }
+
+    // k-ary fat-tree, for even @k: (k/2)^2 core switches, then k pods
+    // of k/2 aggregation and k/2 edge switches each. Packets go
+    // between edge switches, through 3 switches in a pod, 5 across.
+    static Topology FatTree(uint64_t k);
+    // Ring of @num_switches, all endpoints, with @num_shortcuts more
+    // links between random switches of @seed, so paths are a handful
+    // of switches long, like in a WAN.
+    static Topology Wan(uint64_t num_switches, uint64_t num_shortcuts,
+			uint64_t seed);
+
+    void AddLink(uint64_t a, uint64_t b);
+    void AddEndpoint(uint64_t a) {
+      endpoints_.push_back(a);
+    }
+    uint64_t num_switches() const {
+      return neighbors_.size();
+    }
+    const vector<uint64_t>& neighbors(uint64_t a) const {
+      return neighbors_[a];
+    }
+    const vector<uint64_t>& endpoints() const {
+      return endpoints_;
+    }
+
+  protected:
+    vector<vector<uint64_t> > neighbors_;
+    vector<uint64_t> endpoints_;
+  };
+
+  // Instance like the ones from real networks, where sets are test
+  // packets and rules are forwarding rules they go through. Each
+  // packet goes between two random endpoints of @topology, on a
+  // shortest path, picking among equally short next hops at random,
+  // like ECMP. Every switch has @rules_per_switch rules, each for a
+  // contiguous range of destinations, so packets to nearby
+  // destinations hit the same rules. And there are @num_catch_all
+  // rules, e.g., ACLs on every switch, each hit by a packet with
+  // chance @catch_all_chance, so a few rules have almost every
+  // packet.
+  //
+  // Packet i's path comes from stream i of @seed, see StreamRng, so
+  // it doesn't depend on the other packets. Paths are under 2^16 - 1
+  // hops, endpoints further apart aren't connected.
+  class TopologyRuleGenerator {
+  public:
+    // Keeps a copy of @topology.
+    TopologyRuleGenerator(const Topology& topology, uint64_t num_packets,
+			  uint64_t rules_per_switch, uint64_t num_catch_all,
+			  double catch_all_chance, uint64_t seed);
+
+    // Switches packet @packet_id goes through, first to last.
+    void MakePath(uint64_t packet_id, vector<uint64_t>* path) const;
+    // Catch-all rules, then rules of switch 0, 1, ..., each with
+    // names of packets that hit it, so Util::WriteRulesToFile writes
+    // them as a rule file. Rules no packet hits are empty.
+    void MakeRules(vector<vector<string> >* rules) const;
+    uint64_t num_rules() const {
+      return num_catch_all_ + topology_.num_switches() * rules_per_switch_;
+    }
+
+  protected:
+    // Rule that packets to switch @destination hit at switch
+    // @switch_id.
+    uint64_t ForwardingRule(uint64_t switch_id, uint64_t destination) const;
+
+    const Topology topology_;
+    uint64_t num_packets_;
+    uint64_t rules_per_switch_;
+    uint64_t num_catch_all_;
+    double catch_all_chance_;
+    uint64_t seed_;
+    // @distances_[i][s] is number of hops from switch s to endpoint
+    // i. 16 bits keep it a quarter the size for endpoints * switches
+    // entries.
+    vector<vector<uint16_t> > distances_;
+  private:
+    friend class TopologyGeneratorTest;
+  };
+}  // namespace incremental_atpg
+#endif  // INCREMENTAL_ATPG_TOPOLOGY_GENERATOR_H_
@@ -0,0 +1,103 @@
+#include "topology_generator.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace incremental_atpg {
+  using std::vector;
+  using std::string;
+
+class TopologyGeneratorTest : public testing::Test {
+ protected:
+  // Whether each switch of @path links to the one after.
+  bool Connected(const Topology& topology, const vector<uint64_t>& path) {
+    for (uint64_t i = 0; i + 1 < path.size(); i++) {
+      const vector<uint64_t>& neighbors = topology.neighbors(path[i]);
+      if (std::find(neighbors.begin(), neighbors.end(), path[i + 1])
+	  == neighbors.end()) {
+	return false;
+      }
+    }
+    return true;
+  }
+};
+
+TEST_F(TopologyGeneratorTest, FatTree) {
+  Topology topology = Topology::FatTree(4);
+  EXPECT_EQ(20, topology.num_switches());
+  EXPECT_EQ(8, topology.endpoints().size());
+  uint64_t num_links = 0;
+  for (uint64_t a = 0; a < topology.num_switches(); a++) {
+    num_links += topology.neighbors(a).size();
+  }
+  EXPECT_EQ(2 * 32, num_links);
+
+  TopologyRuleGenerator generator(topology, 1000, 4, 0, 0.0, 10);
+  vector<uint64_t> path, again;
+  bool across_pods = false;
+  for (uint64_t packet_id = 0; packet_id < 1000; packet_id++) {
+    generator.MakePath(packet_id, &path);
+    ASSERT_TRUE(path.size() == 3 || path.size() == 5);
+    EXPECT_TRUE(Connected(topology, path));
+    EXPECT_NE(path.front(), path.back());
+    across_pods |= path.size() == 5;
+    generator.MakePath(packet_id, &again);
+    EXPECT_EQ(path, again);
+  }
+  EXPECT_TRUE(across_pods);
+}
+
+TEST_F(TopologyGeneratorTest, Wan) {
+  Topology topology = Topology::Wan(60, 30, 10);
+  EXPECT_EQ(60, topology.endpoints().size());
+  TopologyRuleGenerator generator(topology, 1000, 10, 0, 0.0, 10);
+  // Keeps its own topology.
+  TopologyRuleGenerator from_temporary(Topology::Wan(60, 30, 10), 1000, 10, 0, 0.0, 10);
+  vector<uint64_t> path, again;
+  uint64_t longest = 0;
+  for (uint64_t packet_id = 0; packet_id < 1000; packet_id++) {
+    generator.MakePath(packet_id, &path);
+    ASSERT_GE(path.size(), 2);
+    EXPECT_TRUE(Connected(topology, path));
+    from_temporary.MakePath(packet_id, &again);
+    EXPECT_EQ(path, again);
+    longest = std::max<uint64_t>(longest, path.size());
+  }
+  // Shortcuts keep paths short, but not all one hop.
+  EXPECT_LE(longest, 15);
+  EXPECT_GE(longest, 4);
+}
+
+TEST_F(TopologyGeneratorTest, MakeRules) {
+  Topology topology = Topology::FatTree(4);
+  const uint64_t num_packets = 500;
+  TopologyRuleGenerator generator(topology, num_packets, 4, 2, 0.95, 10);
+  vector<vector<string> > rules;
+  generator.MakeRules(&rules);
+  ASSERT_EQ(2 + 20 * 4, rules.size());
+  // Catch-alls have almost every packet.
+  for (uint64_t rule = 0; rule < 2; rule++) {
+    EXPECT_GT(rules[rule].size(), 0.9 * num_packets);
+    EXPECT_LE(rules[rule].size(), num_packets);
+  }
+  // Every packet is in a forwarding rule for each switch on its path.
+  uint64_t num_hits = 0;
+  for (uint64_t rule = 2; rule < rules.size(); rule++) {
+    num_hits += rules[rule].size();
+  }
+  uint64_t path_lengths = 0;
+  vector<uint64_t> path;
+  for (uint64_t packet_id = 0; packet_id < num_packets; packet_id++) {
+    generator.MakePath(packet_id, &path);
+    path_lengths += path.size();
+  }
+  EXPECT_EQ(path_lengths, num_hits);
+
+  vector<vector<string> > again;
+  generator.MakeRules(&again);
+  EXPECT_EQ(rules, again);
+}
+}  // namespace incremental_atpg
@@ -18,6 +18,9 @@
 #include <log4cxx/logger.h>
 
 #include "gtest/gtest_prod.h"
+#include "rule_file.h"
+#include "binary_rule_file.h"
+#include "thread_pool.h"
 
 namespace incremental_atpg {
   using std::vector;
@@ -35,13 +38,9 @@ namespace incremental_atpg {
   using std::vector;
   using std::upper_bound;
   using std::ofstream;
-  using std::ifstream;
-  using std::getline;
-  using std::stringstream;
   using log4cxx::LoggerPtr;
   using log4cxx::Logger;
   using log4cxx::Level;
-  using std::istream_iterator;
 
   Util::Util() {
       util_logger = Logger::getLogger("Util");
@@ -49,19 +48,32 @@ namespace incremental_atpg {
     }
 
   void Util::ReadRulesFromFile(const string& input_file,
-			      vector<vector<string> >* sets) {
+			      vector<vector<string> >* sets,
+			      unsigned num_threads) {
     sets->clear();
-    ifstream in;
-    string line;
-    in.open(input_file, ifstream::in);
-    while(getline(in, line)) {
-      stringstream words_stream(line);
-      istream_iterator<string> begin(words_stream);
-      istream_iterator<string> end;
-      vector<string> words(begin, end);
-      sets->push_back(words);
-    }
-    return;
+    if (BinaryRuleReader::IsBinary(input_file)) {
+      ReadRulesFromBinaryFile(input_file, sets, num_threads);
+      return;
+    }
+    RuleFile in;
+    if (!in.Open(input_file)) {
+      LOG4CXX_WARN(util_logger, "Can't read " << input_file);
+      return;
+    }
+    if (num_threads == 1) {
+      vector<Span<char> > names;
+      while (in.NextRule(&names)) {
+	sets->push_back(vector<string>());
+	vector<string>& words = sets->back();
+	words.reserve(names.size());
+	for (auto const& name : names) {
+	  words.push_back(ToString(name));
+	}
+      }
+      return;
+    }
+    ThreadPool pool(num_threads);
+    in.ReadAll(&pool, sets);
   }
 
   void Util::MakeRules(uint64_t num_rules, uint64_t num_sets,
@@ -86,6 +98,50 @@ namespace incremental_atpg {
     }
   }
 
+  void Util::MakeNestedChainRules(uint64_t num_chains, uint64_t chain_length,
+				  uint64_t rules_per_level,
+				  vector<vector<string> >* sets) {
+    sets->clear();
+    for (uint64_t level = 0; level < chain_length; level++) {
+      for (uint64_t rule = 0; rule < rules_per_level; rule++) {
+	for (uint64_t chain = 0; chain < num_chains; chain++) {
+	  sets->push_back(vector<string>());
+	  for (uint64_t set = level; set < chain_length; set++) {
+	    sets->back().push_back("chain" + GetString(chain) + "_" + GetString(set));
+	  }
+	}
+      }
+    }
+  }
+
+  void Util::MakeStarRules(uint64_t num_spokes, uint64_t run_length,
+			   uint64_t num_rules,
+			   vector<vector<string> >* sets) {
+    sets->clear();
+    if (num_spokes == 0 || run_length == 0) {
+      return;
+    }
+    for (uint64_t rule = 0; rule < num_rules; rule++) {
+      sets->push_back({"spoke" + GetString((rule / run_length) % num_spokes)});
+      if (rule % run_length != run_length - 1) {
+	sets->back().push_back("hub");
+      }
+    }
+  }
+
+  void Util::MakeWideRules(uint64_t num_sets, uint64_t sets_per_rule,
+			   uint64_t num_rules,
+			   vector<vector<string> >* sets) {
+    sets->clear();
+    sets_per_rule = std::min(sets_per_rule, num_sets);
+    for (uint64_t rule = 0; rule < num_rules; rule++) {
+      sets->push_back(vector<string>());
+      for (uint64_t set = 0; set < sets_per_rule; set++) {
+	sets->back().push_back("wide" + GetString((rule + set) % num_sets));
+      }
+    }
+  }
+
   void Util::WriteRulesToFile(const vector<vector<string> >& sets,
 			      const string& output_file) {
     // Write to file
@@ -113,6 +169,86 @@ namespace incremental_atpg {
     LOG4CXX_WARN(util_logger, "num_rules_added: " << num_rules_added
 		 << ", max_sets_per_rule: " << max_sets_per_rule); 
   }
+  bool Util::ReadRulesFromBinaryFile(const string& input_file,
+				     vector<vector<string> >* sets,
+				     unsigned num_threads) {
+    sets->clear();
+    BinaryRuleReader in;
+    if (!in.Open(input_file)) {
+      LOG4CXX_WARN(util_logger, "Can't read " << input_file);
+      return false;
+    }
+    ThreadPool pool(num_threads);
+    vector<uint64_t> offsets;
+    vector<SetId> set_ids;
+    if (!in.ReadAll(&pool, &offsets, &set_ids)) {
+      LOG4CXX_WARN(util_logger, "Bad rules in " << input_file);
+      return false;
+    }
+    const SymbolTable& symbols = in.symbols();
+    sets->resize(in.num_rules());
+    pool.Run(in.num_rules(), [&](uint64_t rule) {
+	vector<string>& names = (*sets)[rule];
+	names.reserve(offsets[rule + 1] - offsets[rule]);
+	for (uint64_t i = offsets[rule]; i < offsets[rule + 1]; i++) {
+	  names.push_back(symbols.Name(set_ids[i]));
+	}
+      });
+    return true;
+  }
+
+  bool Util::WriteRulesToBinaryFile(const vector<vector<string> >& sets,
+				    const string& output_file) {
+    BinaryRuleWriter out;
+    if (!out.Open(output_file)) {
+      LOG4CXX_WARN(util_logger, "Can't write " << output_file);
+      return false;
+    }
+    for (auto const& rule : sets) {
+      if (rule.size() > 0) {
+	out.AddRule(rule);
+      }
+    }
+    return out.Close();
+  }
+
+  bool Util::ConvertTextToBinary(const string& text_file,
+				 const string& binary_file) {
+    RuleFile in;
+    BinaryRuleWriter out;
+    if (!in.Open(text_file) || !out.Open(binary_file)) {
+      LOG4CXX_WARN(util_logger, "Can't convert " << text_file);
+      return false;
+    }
+    vector<Span<char> > names;
+    while (in.NextRule(&names)) {
+      out.AddRule(names);
+    }
+    return out.Close();
+  }
+
+  bool Util::ConvertBinaryToText(const string& binary_file,
+				 const string& text_file) {
+    BinaryRuleReader in;
+    if (!in.Open(binary_file)) {
+      LOG4CXX_WARN(util_logger, "Can't convert " << binary_file);
+      return false;
+    }
+    ofstream out(text_file.c_str(), std::ofstream::out | std::ofstream::trunc);
+    const SymbolTable& symbols = in.symbols();
+    vector<SetId> set_ids;
+    uint64_t num_rules = 0;
+    while (in.NextRule(&set_ids)) {
+      for (auto set_id : set_ids) {
+	out << symbols.Name(set_id) << " ";
+      }
+      out << "\n";
+      ++num_rules;
+    }
+    out.close();
+    return num_rules == in.num_rules() && !out.fail();
+  }
+
   void Util::ShowRulesPerSet(const vector<vector<string> >& sets) {
     map<string, vector<uint64_t> > rules;
     uint64_t num_rules = sets.size();
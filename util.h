@@ -41,14 +41,50 @@ namespace incremental_atpg {
 
     string GetString(uint64_t num);
     uint64_t GetZipf(const vector<double>& zipf);
+    // One rule per line, see RuleFile, which is faster without
+    // the strings, or a binary rule file. Parses chunks, or blocks,
+    // of file on @num_threads threads, 0 for one per hardware thread.
     void ReadRulesFromFile(const string& input_file,
-			  vector<vector<string> >* sets);
+			  vector<vector<string> >* sets,
+			  unsigned num_threads = 1);
     void MakeRules(uint64_t num_rules, uint64_t num_sets,
 	      uint64_t max_rules_per_set,
 	      const vector<double>& zipf,
 	      vector<vector<string> >* sets);
+    // Instances that are hard for LazySetCover, each rule in order.
+    //
+    // @num_chains chains of @chain_length nested sets: rules of level
+    // l of a chain are in its sets l, l + 1, ..., so the last set has
+    // all. Levels come in order, @rules_per_level rules each, so the
+    // best set of a chain changes every level.
+    void MakeNestedChainRules(uint64_t num_chains, uint64_t chain_length,
+			      uint64_t rules_per_level,
+			      vector<vector<string> >* sets);
+    // A hub and @num_spokes spokes: runs of @run_length rules go to
+    // the spokes in turn, and the hub has all but the last rule of
+    // each run, so it stays a rule or so from overtaking the spoke
+    // whose run it is.
+    void MakeStarRules(uint64_t num_spokes, uint64_t run_length,
+		       uint64_t num_rules,
+		       vector<vector<string> >* sets);
+    // Rule i is in sets i, i + 1, ..., i + @sets_per_rule - 1, mod
+    // @num_sets, so each rule hits many sets already in cover.
+    void MakeWideRules(uint64_t num_sets, uint64_t sets_per_rule,
+		       uint64_t num_rules,
+		       vector<vector<string> >* sets);
     void WriteRulesToFile(const vector<vector<string> >& sets,
 			  const string& output_file);
+    // Like the above, but binary, see BinaryRuleWriter, so sets of
+    // each rule come back sorted by id. Writes @output_file over.
+    bool ReadRulesFromBinaryFile(const string& input_file,
+				 vector<vector<string> >* sets,
+				 unsigned num_threads = 1);
+    bool WriteRulesToBinaryFile(const vector<vector<string> >& sets,
+				const string& output_file);
+    // Rewrite a text rule file as binary, or back, one rule at a
+    // time, keeping empty rules.
+    bool ConvertTextToBinary(const string& text_file, const string& binary_file);
+    bool ConvertBinaryToText(const string& binary_file, const string& text_file);
     void ShowSetsPerRule(const vector<vector<string> >& sets);
     void ShowRulesPerSet(const vector<vector<string> >& sets);
     static const vector<double> zipf_1;
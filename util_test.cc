@@ -1,9 +1,12 @@
 #include "util.h"
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <ctime>
 #include <memory>
 #include <stdint.h>
+#include <sys/stat.h>
 
 #include "log4cxx/logger.h"
 #include "log4cxx/basicconfigurator.h"
@@ -38,13 +41,51 @@ TEST_F(UtilTest, MakeRules) {
 }
 
 TEST_F(UtilTest, WriteRulesToFile) {
-  vector<vector<string> > sets;
   // num_rules, num_sets, max_rules_per_set, distr. zipf
   // most sets should have 1-5 rules, a few have close to 30
   // all rules have many sets, few sets that are in all rules.
   // TODO(lav): Most sets have too many rules. Flip!?
-  util->MakeRules(700000, 300000, 200, Util::zipf_1, &sets);
+  // Smaller than it was, RuleGeneratorTest makes the big one. It's
+  // still what EvaluateTest reads.
+  vector<vector<string> > sets;
+  util->MakeRules(100000, 43000, 200, Util::zipf_1, &sets);
+  mkdir("tmp", 0755);
+  // WriteRulesToFile appends.
+  std::remove("tmp/WriteRulesToFileTest.out");
   util->WriteRulesToFile(sets, "tmp/WriteRulesToFileTest.out");
+
+  // Empty rules aren't written.
+  vector<vector<string> > non_empty;
+  for (auto const& rule : sets) {
+    if (!rule.empty()) {
+      non_empty.push_back(rule);
+    }
+  }
+  vector<vector<string> > read;
+  util->ReadRulesFromFile("tmp/WriteRulesToFileTest.out", &read);
+  EXPECT_EQ(non_empty, read);
+}
+
+TEST_F(UtilTest, AdversarialRules) {
+  vector<vector<string> > sets;
+  util->MakeNestedChainRules(2, 3, 2, &sets);
+  ASSERT_EQ(2 * 3 * 2, sets.size());
+  EXPECT_EQ(vector<string>({"chain0_0", "chain0_1", "chain0_2"}), sets[0]);
+  EXPECT_EQ(vector<string>({"chain1_0", "chain1_1", "chain1_2"}), sets[1]);
+  EXPECT_EQ(vector<string>({"chain0_1", "chain0_2"}), sets[4]);
+  EXPECT_EQ(vector<string>({"chain1_2"}), sets.back());
+
+  util->MakeStarRules(3, 4, 13, &sets);
+  ASSERT_EQ(13, sets.size());
+  EXPECT_EQ(vector<string>({"spoke0", "hub"}), sets[0]);
+  EXPECT_EQ(vector<string>({"spoke0"}), sets[3]);
+  EXPECT_EQ(vector<string>({"spoke1", "hub"}), sets[4]);
+  EXPECT_EQ(vector<string>({"spoke0", "hub"}), sets[12]);
+
+  util->MakeWideRules(5, 3, 4, &sets);
+  ASSERT_EQ(4, sets.size());
+  EXPECT_EQ(vector<string>({"wide0", "wide1", "wide2"}), sets[0]);
+  EXPECT_EQ(vector<string>({"wide3", "wide4", "wide0"}), sets[3]);
 }
 
 TEST_F(UtilTest, ReadRulesFromFile) {
@@ -52,5 +93,39 @@ TEST_F(UtilTest, ReadRulesFromFile) {
   //  util->ReadRulesFromFile("tmp/WriteRulesToFileTest.out", &sets);
   //  util->ShowSetsPerRule(sets);
 }
+
+// Sets of each rule sorted, since binary files keep them by id.
+vector<vector<string> > Sorted(vector<vector<string> > rules) {
+  for (auto& rule : rules) {
+    sort(rule.begin(), rule.end());
+  }
+  return rules;
+}
+
+TEST_F(UtilTest, BinaryRules) {
+  vector<vector<string> > sets;
+  util->MakeRules(2000, 500, 50, Util::zipf_1, &sets);
+  // Text writer skips empty rules.
+  vector<vector<string> > rules;
+  for (auto const& rule : sets) {
+    if (!rule.empty()) {
+      rules.push_back(rule);
+    }
+  }
+  std::remove("util_test.txt");
+  util->WriteRulesToFile(sets, "util_test.txt");
+  ASSERT_TRUE(util->ConvertTextToBinary("util_test.txt", "util_test.bin"));
+  vector<vector<string> > read;
+  util->ReadRulesFromFile("util_test.bin", &read, 3);
+  EXPECT_EQ(Sorted(rules), Sorted(read));
+  ASSERT_TRUE(util->ConvertBinaryToText("util_test.bin", "util_test.txt"));
+  util->ReadRulesFromFile("util_test.txt", &read);
+  EXPECT_EQ(Sorted(rules), Sorted(read));
+  ASSERT_TRUE(util->WriteRulesToBinaryFile(sets, "util_test.bin"));
+  EXPECT_TRUE(util->ReadRulesFromBinaryFile("util_test.bin", &read));
+  EXPECT_EQ(Sorted(rules), Sorted(read));
+  std::remove("util_test.txt");
+  std::remove("util_test.bin");
+}
  
 }  // namespace incremental_atpg